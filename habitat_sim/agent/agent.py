@@ -139,11 +139,22 @@ class Agent(object):
         self.agent_config = agent_config
 
         if reconfigure_sensors:
-            self._sensors.clear()
+            # Sensors whose specification is unchanged are kept, so that their
+            # render targets don't have to be created again
+            specs = {
+                spec.uuid: spec for spec in self.agent_config.sensor_specifications
+            }
+            for uuid, sensor in list(self._sensors.items()):
+                if uuid not in specs or sensor.specification() != specs[uuid]:
+                    del self._sensors[uuid]
+                else:
+                    sensor.set_transformation_from_spec()
+
             for spec in self.agent_config.sensor_specifications:
-                self._sensors.add(
-                    hsim.PinholeCamera(self.scene_node.create_child(), spec)
-                )
+                if spec.uuid not in self._sensors:
+                    self._sensors.add(
+                        hsim.PinholeCamera(self.scene_node.create_child(), spec)
+                    )
 
     def act(self, action_id: Any) -> bool:
         r"""Take the action specified by action_id
@@ -1,24 +1,44 @@
 from habitat_sim._ext.habitat_sim_bindings import (
+    AgentNavHandle,
+    Crowd,
+    CrowdAgentParams,
+    EpisodeGenerator,
+    EpisodeGeneratorSettings,
+    EpisodeGeneratorStats,
+    GeodesicDistanceField,
     GreedyFollowerCodes,
     GreedyGeodesicFollowerImpl,
     HitRecord,
     MultiGoalShortestPath,
+    NavEpisode,
     NavMeshSettings,
     PathFinder,
     ShortestPath,
+    ShortestPathBatch,
+    SlicedShortestPath,
     VectorGreedyCodes,
 )
 
 from .greedy_geodesic_follower import GreedyGeodesicFollower
 
 __all__ = [
+    "AgentNavHandle",
+    "Crowd",
+    "CrowdAgentParams",
+    "EpisodeGenerator",
+    "EpisodeGeneratorSettings",
+    "EpisodeGeneratorStats",
+    "GeodesicDistanceField",
     "GreedyGeodesicFollower",
     "GreedyGeodesicFollowerImpl",
     "GreedyFollowerCodes",
     "MultiGoalShortestPath",
+    "NavEpisode",
     "NavMeshSettings",
     "PathFinder",
     "ShortestPath",
+    "ShortestPathBatch",
+    "SlicedShortestPath",
     "HitRecord",
     "VectorGreedyCodes",
 ]
@@ -1,9 +1,10 @@
-from typing import Any, Dict, List, Optional
+from typing import Any, Dict, List, Optional, Sequence
 
 import attr
 import numpy as np
 
 from habitat_sim import agent, errors, scene
+from habitat_sim._ext.habitat_sim_bindings import RigidState
 from habitat_sim.nav import GreedyFollowerCodes, GreedyGeodesicFollowerImpl, PathFinder
 from habitat_sim.utils.common import quat_to_magnum
 
@@ -44,6 +45,8 @@ class GreedyGeodesicFollower(object):
         right_key: Optional[Any] = None,
         fix_thrashing: bool = True,
         thrashing_threshold: int = 16,
+        native: bool = False,
+        allow_sliding: bool = True,
     ):
         r"""Constructor
 
@@ -73,6 +76,13 @@ class GreedyGeodesicFollower(object):
         :param fix_thrashing: Whether or not to attempt to fix thrashing
         :param thrashing_threshold: The number of actions in a left -> right -> left -> ..
                                        sequence needed to be considered thrashing
+        :param native: Whether to plan with the default move_forward, turn_left
+            and turn_right actions in C++ instead of calling the agent's controls
+            from python for every candidate step. Much faster and lets
+            `find_paths()` plan on all threads, but ignores custom
+            implementations of these actions
+        :param allow_sliding: Whether steps slide along walls when planning
+            with :py:`native`, should match the simulator's ``allow_sliding``
         """
 
         self.pathfinder = pathfinder
@@ -104,17 +114,28 @@ class GreedyGeodesicFollower(object):
             0.75 * self.forward_spec.amount if goal_radius is None else goal_radius
         )
 
-        self.impl = GreedyGeodesicFollowerImpl(
-            self.pathfinder,
-            self._move_forward,
-            self._turn_left,
-            self._turn_right,
-            self.goal_radius,
-            self.forward_spec.amount,
-            np.deg2rad(self.left_spec.amount),
-            fix_thrashing,
-            thrashing_threshold,
-        )
+        if native:
+            self.impl = GreedyGeodesicFollowerImpl(
+                self.pathfinder,
+                self.goal_radius,
+                self.forward_spec.amount,
+                np.deg2rad(self.left_spec.amount),
+                fix_thrashing,
+                thrashing_threshold,
+                allow_sliding,
+            )
+        else:
+            self.impl = GreedyGeodesicFollowerImpl(
+                self.pathfinder,
+                self._move_forward,
+                self._turn_left,
+                self._turn_right,
+                self.goal_radius,
+                self.forward_spec.amount,
+                np.deg2rad(self.left_spec.amount),
+                fix_thrashing,
+                thrashing_threshold,
+            )
 
     def _find_action(self, name):
         candidates = list(
@@ -190,6 +211,31 @@ class GreedyGeodesicFollower(object):
 
         return path
 
+    def find_paths(
+        self, start_states: Sequence[agent.AgentState], goal_positions: Sequence
+    ) -> List[Optional[List[Any]]]:
+        r"""Batched version of `find_path()` that plans from every start state
+        to the goal in the same position of :p:`goal_positions`
+
+        :return: The list of actions for every pair, :py:`None` where no path
+            was found
+
+        Runs on all threads if the follower was constructed with :py:`native`.
+        The same note about actuation noise as for `find_path()` applies.
+        """
+        self.reset()
+
+        starts = [
+            RigidState(quat_to_magnum(state.rotation), state.position)
+            for state in start_states
+        ]
+        paths = self.impl.find_paths(starts, [np.asarray(g) for g in goal_positions])
+
+        return [
+            list(map(lambda v: self.action_mapping[v], path)) if len(path) else None
+            for path in paths
+        ]
+
     def reset(self):
         self.impl.reset()
         self.last_goal = None
@@ -6,7 +6,7 @@
 
 import os.path as osp
 import time
-from typing import Any, Dict, List, Optional
+from typing import Any, Dict, List, Optional, Tuple
 
 import attr
 import magnum as mn
@@ -59,6 +59,11 @@ class Simulator:
     _num_total_frames: int = attr.ib(default=0, init=False)
     _default_agent: Agent = attr.ib(init=False, default=None)
     _sensors: Dict = attr.ib(factory=dict, init=False)
+    # Agent radius and height of the navmeshes recomputed for the default agent
+    # by their navmesh id, so that ones kept with cached scenes are reused
+    _recomputed_navmeshes: Dict[int, Tuple[float, float]] = attr.ib(
+        factory=dict, init=False
+    )
     _previous_step_time = 0.0  # track the compute time of each step
 
     def __attrs_post_init__(self):
@@ -116,14 +121,38 @@ class Simulator:
         if self.config is not None and self.config.agents == config.agents:
             return
 
-        self.agents = [
-            Agent(
-                self._sim.get_active_scene_graph().get_root_node().create_child(), cfg
-            )
-            for cfg in config.agents
-        ]
+        # Existing agents are reconfigured in place, which only recreates the
+        # sensors that changed
+        prev_cfgs = self.config.agents if self.config is not None else []
+        agents = []
+        for i, cfg in enumerate(config.agents):
+            if i < len(self.agents):
+                agent = self.agents[i]
+                if cfg != prev_cfgs[i]:
+                    agent.reconfigure(cfg)
+            else:
+                agent = Agent(
+                    self._sim.get_active_scene_graph().get_root_node().create_child(),
+                    cfg,
+                )
+            agents.append(agent)
+
+        for agent in self.agents[len(agents) :]:
+            agent.close()
+
+        self.agents = agents
+
+    def _config_pathfinder(self, config: Configuration, reload_scene: bool):
+        # The navmesh only depends on the scene and the default agent's body
+        if not reload_scene and self.pathfinder is not None:
+            prev_agent_cfg = self.config.agents[self.config.sim_cfg.default_agent_id]
+            agent_cfg = config.agents[config.sim_cfg.default_agent_id]
+            if np.isclose(prev_agent_cfg.radius, agent_cfg.radius) and np.isclose(
+                prev_agent_cfg.height, agent_cfg.height
+            ):
+                self.pathfinder.seed(config.sim_cfg.random_seed)
+                return
 
-    def _config_pathfinder(self, config: Configuration):
         if "navmesh" in config.sim_cfg.scene.filepaths:
             navmesh_filenname = config.sim_cfg.scene.filepaths["navmesh"]
         else:
@@ -141,20 +170,35 @@ class Simulator:
                     osp.splitext(config.sim_cfg.scene.id)[0] + ".navmesh"
                 )
 
-        self.pathfinder = PathFinder()
-        if osp.exists(navmesh_filenname):
-            self.pathfinder.load_nav_mesh(navmesh_filenname)
-            logger.info(f"Loaded navmesh {navmesh_filenname}")
+        # The backend already loaded the navmesh next to the scene, possibly in
+        # the background or kept along with a cached scene, so its pathfinder
+        # is used unless the navmesh is somewhere else
+        scene_filepaths = config.sim_cfg.scene.filepaths
+        backend_navmesh_filename = scene_filepaths.get(
+            "navmesh",
+            osp.splitext(scene_filepaths.get("mesh", config.sim_cfg.scene.id))[0]
+            + ".navmesh",
+        )
+        if osp.normpath(backend_navmesh_filename) == osp.normpath(navmesh_filenname):
+            self.pathfinder = self._sim.pathfinder
         else:
+            self.pathfinder = PathFinder()
+            if osp.exists(navmesh_filenname):
+                self.pathfinder.load_nav_mesh(navmesh_filenname)
+                logger.info(f"Loaded navmesh {navmesh_filenname}")
+        if not osp.exists(navmesh_filenname):
             logger.warning(
                 f"Could not find navmesh {navmesh_filenname}, no collision checking will be done"
             )
 
         agent_legacy_config = AgentConfiguration()
         default_agent_config = config.agents[config.sim_cfg.default_agent_id]
-        if not np.isclose(
-            agent_legacy_config.radius, default_agent_config.radius
-        ) or not np.isclose(agent_legacy_config.height, default_agent_config.height):
+        agent_size = (default_agent_config.radius, default_agent_config.height)
+        recomputed_size = self._recomputed_navmeshes.get(self.pathfinder.nav_mesh_id)
+        if (
+            not np.isclose(agent_legacy_config.radius, default_agent_config.radius)
+            or not np.isclose(agent_legacy_config.height, default_agent_config.height)
+        ) and (recomputed_size is None or not np.allclose(recomputed_size, agent_size)):
             logger.info(
                 f"Recomputing navmesh for agent's height {default_agent_config.height} and radius"
                 f" {default_agent_config.radius}."
@@ -163,13 +207,13 @@ class Simulator:
             navmesh_settings.set_defaults()
             navmesh_settings.agent_radius = default_agent_config.radius
             navmesh_settings.agent_height = default_agent_config.height
-            self.recompute_navmesh(self.pathfinder, navmesh_settings)
+            if self.recompute_navmesh(self.pathfinder, navmesh_settings):
+                self._recomputed_navmeshes[self.pathfinder.nav_mesh_id] = agent_size
 
         self.pathfinder.seed(config.sim_cfg.random_seed)
 
-    def reconfigure(self, config: Configuration):
-        assert len(config.agents) > 0
-
+    @staticmethod
+    def _update_sim_cfg(config: Configuration):
         config.sim_cfg.create_renderer = any(
             map(lambda cfg: len(cfg.sensor_specifications) > 0, config.agents)
         )
@@ -185,28 +229,71 @@ class Simulator:
             )
         )
 
+    def prefetch_scene(self, config: Configuration):
+        r"""Starts loading the scene of config in the background
+
+        The scene meshes are parsed and their textures decoded while the
+        current scene can still be used, so that a later :ref:`reconfigure`
+        with config only has to upload them to the GPU. The navmesh next to
+        the scene is loaded in the background as well and becomes
+        :ref:`pathfinder` as is. Only one scene is prefetched at a time.
+        """
+        assert len(config.agents) > 0
+        self._update_sim_cfg(config)
+        self._sim.prefetch_scene(config.sim_cfg)
+
+    @property
+    def is_scene_prefetched(self) -> bool:
+        r"""Whether the loading started by :ref:`prefetch_scene` is done"""
+        return self._sim.is_scene_prefetched
+
+    def reconfigure(self, config: Configuration):
+        assert len(config.agents) > 0
+
+        self._update_sim_cfg(config)
+
         if self.config == config:
             return
 
+        # Only what changed is redone, the loaded scene and navmesh are kept
+        # unless the scene itself changed
+        reload_scene = (
+            self.config is None
+            or self.config.sim_cfg.requires_scene_reload(config.sim_cfg)
+        )
+
         # NB: Configure backend last as this gives more time for python's GC
         # to delete any previous instances of the simulator
         # TODO: can't do the above, sorry -- the Agent constructor needs access
         # to self._sim.get_active_scene_graph()
         self._config_backend(config)
         self._config_agents(config)
-        self._config_pathfinder(config)
+        self._config_pathfinder(config, reload_scene)
         self._sim.frustum_culling = config.sim_cfg.frustum_culling
         for i in range(len(self.agents)):
             self.agents[i].controls.move_filter_fn = self._step_filter
 
         self._default_agent = self.get_agent(config.sim_cfg.default_agent_id)
 
+        # Sensors that are still the same keep their bound render targets
         agent_cfg = config.agents[config.sim_cfg.default_agent_id]
+        prev_sensors = self._sensors
         self._sensors = {}
         for spec in agent_cfg.sensor_specifications:
-            self._sensors[spec.uuid] = Sensor(
-                sim=self._sim, agent=self._default_agent, sensor_id=spec.uuid
-            )
+            sensor = prev_sensors.pop(spec.uuid, None)
+            if (
+                sensor is None
+                or sensor._agent is not self._default_agent
+                or sensor._sensor_object
+                is not self._default_agent._sensors.get(spec.uuid)
+            ):
+                sensor = Sensor(
+                    sim=self._sim, agent=self._default_agent, sensor_id=spec.uuid
+                )
+            self._sensors[spec.uuid] = sensor
+
+        for sensor in prev_sensors.values():
+            sensor.close()
 
         for i in range(len(self.agents)):
             self.initialize_agent(i)
@@ -434,6 +521,9 @@ class Simulator:
             pathfinder, navmesh_settings, include_static_objects
         )
 
+    def update_navmesh(self, pathfinder, navmesh_settings):
+        return self._sim.update_navmesh(pathfinder, navmesh_settings)
+
     # --- lighting functions ---
     def get_light_setup(self, key=DEFAULT_LIGHTING_KEY):
         return self._sim.get_light_setup(key)
@@ -62,6 +62,17 @@ namespace Mn = Magnum;
 
 namespace esp {
 namespace assets {
+
+namespace {
+// Vertex positions and indices are kept on the CPU for collisions next to
+// the GPU copy, the other attributes are not accounted for
+std::size_t estimateMeshByteSize(BaseMesh& mesh) {
+  const CollisionMeshData& meshData = mesh.getCollisionMeshData();
+  return 2 * (meshData.positions.size() * sizeof(Mn::Vector3) +
+              meshData.indices.size() * sizeof(Mn::UnsignedInt));
+}
+}  // namespace
+
 // static constexpr arrays require redundant definitions until C++17
 constexpr char ResourceManager::NO_LIGHT_KEY[];
 constexpr char ResourceManager::DEFAULT_LIGHTING_KEY[];
@@ -1215,8 +1226,9 @@ bool ResourceManager::loadPTexMeshData(const AssetInfo& info,
     pTexMeshData->load(filename, atlasDir);
 
     // update the dictionary
-    auto inserted =
-        resourceDict_.emplace(filename, LoadedAssetData{info, {index, index}});
+    auto inserted = resourceDict_.emplace(
+        filename, LoadedAssetData{info, {index, index},
+                                  estimateMeshByteSize(*pTexMeshData)});
     MeshMetaData& meshMetaData = inserted.first->second.meshMetaData;
     meshMetaData.root.meshIDLocal = 0;
     meshMetaData.root.componentID = 0;
@@ -1283,7 +1295,11 @@ bool ResourceManager::loadInstanceMeshData(
   const std::string& filename = info.filepath;
   if (resourceDict_.count(filename) == 0) {
     std::vector<GenericInstanceMeshData::uptr> instanceMeshes;
-    if (splitSemanticMesh) {
+    std::unique_ptr<PrefetchJob> prefetched =
+        takePrefetchJob(info, splitSemanticMesh);
+    if (prefetched) {
+      instanceMeshes = std::move(prefetched->instanceMeshes);
+    } else if (splitSemanticMesh) {
       instanceMeshes =
           GenericInstanceMeshData::fromPlySplitByObjectId(*importer, filename);
     } else {
@@ -1302,18 +1318,20 @@ bool ResourceManager::loadInstanceMeshData(
     int meshEnd = meshStart + instanceMeshes.size() - 1;
     MeshMetaData meshMetaData{meshStart, meshEnd};
     meshMetaData.root.children.resize(instanceMeshes.size());
+    std::size_t byteSize = 0;
 
     for (int meshIDLocal = 0; meshIDLocal < instanceMeshes.size();
          ++meshIDLocal) {
       instanceMeshes[meshIDLocal]->uploadBuffersToGPU(false);
+      byteSize += estimateMeshByteSize(*instanceMeshes[meshIDLocal]);
       meshes_.emplace_back(std::move(instanceMeshes[meshIDLocal]));
 
       meshMetaData.root.children[meshIDLocal].meshIDLocal = meshIDLocal;
     }
 
     // update the dictionary
-    resourceDict_.emplace(filename,
-                          LoadedAssetData{info, std::move(meshMetaData)});
+    resourceDict_.emplace(
+        filename, LoadedAssetData{info, std::move(meshMetaData), byteSize});
   }
 
   // create the scene graph by request
@@ -1337,27 +1355,16 @@ bool ResourceManager::loadInstanceMeshData(
   return true;
 }
 
-bool ResourceManager::loadGeneralMeshData(
-    const AssetInfo& info,
-    scene::SceneNode* parent /* = nullptr */,
-    DrawableGroup* drawables /* = nullptr */,
-    const Mn::ResourceKey& lightSetup) {
-  const std::string& filename = info.filepath;
-  const bool fileIsLoaded = resourceDict_.count(filename) > 0;
-  const bool drawData = parent != nullptr && drawables != nullptr;
-
-  Cr::Containers::Pointer<Importer> importer;
-  CORRADE_INTERNAL_ASSERT_OUTPUT(
-      importer = importerManager_.loadAndInstantiate("AnySceneImporter"));
-
+void ResourceManager::configureImporterManager(
+    Cr::PluginManager::Manager<Importer>& manager) {
   // Preferred plugins, Basis target GPU format
-  importerManager_.setPreferredPlugins("GltfImporter", {"TinyGltfImporter"});
+  manager.setPreferredPlugins("GltfImporter", {"TinyGltfImporter"});
 #ifdef ESP_BUILD_ASSIMP_SUPPORT
-  importerManager_.setPreferredPlugins("ObjImporter", {"AssimpImporter"});
+  manager.setPreferredPlugins("ObjImporter", {"AssimpImporter"});
 #endif
   {
     Cr::PluginManager::PluginMetadata* const metadata =
-        importerManager_.metadata("BasisImporter");
+        manager.metadata("BasisImporter");
     Mn::GL::Context& context = Mn::GL::Context::current();
 #ifdef MAGNUM_TARGET_WEBGL
     if (context.isExtensionSupported<
@@ -1428,19 +1435,43 @@ bool ResourceManager::loadGeneralMeshData(
     }
 #endif
   }
+}
+
+bool ResourceManager::loadGeneralMeshData(
+    const AssetInfo& info,
+    scene::SceneNode* parent /* = nullptr */,
+    DrawableGroup* drawables /* = nullptr */,
+    const Mn::ResourceKey& lightSetup) {
+  const std::string& filename = info.filepath;
+  const bool fileIsLoaded = resourceDict_.count(filename) > 0;
+  const bool drawData = parent != nullptr && drawables != nullptr;
+
+  // A prefetched asset comes with the file opened by its importer
+  std::unique_ptr<PrefetchJob> prefetched;
+  if (!fileIsLoaded) {
+    prefetched = takePrefetchJob(info, true);
+  }
+  Cr::Containers::Pointer<Importer> importer;
+  if (prefetched) {
+    importer = std::move(prefetched->importer);
+  } else {
+    CORRADE_INTERNAL_ASSERT_OUTPUT(
+        importer = importerManager_.loadAndInstantiate("AnySceneImporter"));
+    configureImporterManager(importerManager_);
+  }
 
   // Optional File loading
   if (!fileIsLoaded) {
-    if (!importer->openFile(filename)) {
+    if (!prefetched && !importer->openFile(filename)) {
       LOG(ERROR) << "Cannot open file " << filename;
       return false;
     }
 
     // if this is a new file, load it and add it to the dictionary
     LoadedAssetData loadedAssetData{info};
-    loadTextures(*importer, loadedAssetData);
+    loadTextures(*importer, loadedAssetData, prefetched.get());
     loadMaterials(*importer, loadedAssetData);
-    loadMeshes(*importer, loadedAssetData);
+    loadMeshes(*importer, loadedAssetData, prefetched.get());
     auto inserted = resourceDict_.emplace(filename, std::move(loadedAssetData));
     MeshMetaData& meshMetaData = inserted.first->second.meshMetaData;
 
@@ -1677,21 +1708,28 @@ gfx::PhongMaterialData::uptr ResourceManager::buildPhongShadedMaterialData(
 }
 
 void ResourceManager::loadMeshes(Importer& importer,
-                                 LoadedAssetData& loadedAssetData) {
+                                 LoadedAssetData& loadedAssetData,
+                                 PrefetchJob* prefetched /* = nullptr */) {
   int meshStart = meshes_.size();
   int meshEnd = meshStart + importer.meshCount() - 1;
   loadedAssetData.meshMetaData.setMeshIndices(meshStart, meshEnd);
 
   for (int iMesh = 0; iMesh < importer.meshCount(); ++iMesh) {
-    // don't need normals if we aren't using lighting
-    auto gltfMeshData = std::make_unique<GenericMeshData>(
-        loadedAssetData.assetInfo.requiresLighting);
-    gltfMeshData->importAndSetMeshData(importer, iMesh);
+    std::unique_ptr<GenericMeshData> gltfMeshData;
+    if (prefetched) {
+      gltfMeshData = std::move(prefetched->meshes[iMesh]);
+    } else {
+      // don't need normals if we aren't using lighting
+      gltfMeshData = std::make_unique<GenericMeshData>(
+          loadedAssetData.assetInfo.requiresLighting);
+      gltfMeshData->importAndSetMeshData(importer, iMesh);
+    }
 
     // compute the mesh bounding box
     gltfMeshData->BB = computeMeshBB(gltfMeshData.get());
 
     gltfMeshData->uploadBuffersToGPU(false);
+    loadedAssetData.byteSize += estimateMeshByteSize(*gltfMeshData);
     meshes_.emplace_back(std::move(gltfMeshData));
   }
 }
@@ -1732,7 +1770,8 @@ void ResourceManager::loadMeshHierarchy(Importer& importer,
 }
 
 void ResourceManager::loadTextures(Importer& importer,
-                                   LoadedAssetData& loadedAssetData) {
+                                   LoadedAssetData& loadedAssetData,
+                                   PrefetchJob* prefetched /* = nullptr */) {
   int textureStart = textures_.size();
   int textureEnd = textureStart + importer.textureCount() - 1;
   loadedAssetData.meshMetaData.setTextureIndices(textureStart, textureEnd);
@@ -1760,12 +1799,22 @@ void ResourceManager::loadTextures(Importer& importer,
     const std::uint32_t levelCount =
         importer.image2DLevelCount(textureData->image());
     bool generateMipmap = false;
+    std::size_t textureByteSize = 0;
     for (std::uint32_t level = 0; level != levelCount; ++level) {
       // TODO:
       // it seems we have a way to just load the image once in this case,
       // as long as the image2DName include the full path to the image
-      Cr::Containers::Optional<Mn::Trade::ImageData2D> image =
-          importer.image2D(textureData->image(), level);
+      // images used by several textures are only decoded once when prefetched
+      Cr::Containers::Optional<Mn::Trade::ImageData2D> decodedImage;
+      Mn::Trade::ImageData2D* image = nullptr;
+      if (prefetched) {
+        auto& prefetchedImage = prefetched->images[textureData->image()][level];
+        if (prefetchedImage)
+          image = &*prefetchedImage;
+      } else if ((decodedImage =
+                      importer.image2D(textureData->image(), level))) {
+        image = &*decodedImage;
+      }
       if (!image) {
         LOG(ERROR) << "Cannot load texture image, skipping";
         currentTexture = nullptr;
@@ -1801,15 +1850,20 @@ void ResourceManager::loadTextures(Importer& importer,
         texture.setCompressedSubImage(level, {}, *image);
       else
         texture.setSubImage(level, {}, *image);
+      textureByteSize += image->data().size();
     }
 
     // Mip level loading failed, fail the whole texture
     if (currentTexture == nullptr)
       continue;
 
-    // Generate a mipmap if requested
-    if (generateMipmap)
+    // Generate a mipmap if requested, which adds up to a third of the base
+    // level
+    if (generateMipmap) {
       texture.generateMipmap();
+      textureByteSize += textureByteSize / 3;
+    }
+    loadedAssetData.byteSize += textureByteSize;
   }
 }
 
@@ -2087,6 +2141,152 @@ void ResourceManager::joinHeirarchy(
   }
 }
 
+std::size_t ResourceManager::getAssetByteSize(
+    const std::string& filename) const {
+  auto it = resourceDict_.find(filename);
+  return it == resourceDict_.end() ? 0 : it->second.byteSize;
+}
+
+bool ResourceManager::unloadAsset(const std::string& filename) {
+  auto it = resourceDict_.find(filename);
+  if (it == resourceDict_.end()) {
+    return false;
+  }
+
+  // The slots stay in place, as other assets index meshes_ and textures_ by
+  // their position.  Materials are small and can't be taken out of the
+  // ShaderManager once they are final, they are just never used again.
+  const MeshMetaData& meshMetaData = it->second.meshMetaData;
+  if (meshMetaData.meshIndex.first != ID_UNDEFINED) {
+    for (int iMesh = meshMetaData.meshIndex.first;
+         iMesh <= meshMetaData.meshIndex.second; ++iMesh) {
+      meshes_[iMesh] = nullptr;
+    }
+  }
+  if (meshMetaData.textureIndex.first != ID_UNDEFINED) {
+    for (int iTexture = meshMetaData.textureIndex.first;
+         iTexture <= meshMetaData.textureIndex.second; ++iTexture) {
+      textures_[iTexture] = nullptr;
+    }
+  }
+  collisionMeshGroups_.erase(filename);
+  resourceDict_.erase(it);
+  return true;
+}
+
+void ResourceManager::prefetchScene(const AssetInfo& info,
+                                    bool splitSemanticMesh /* = true */) {
+  const std::string& filename = info.filepath;
+  if (resourceDict_.count(filename) > 0 || prefetchJobs_.count(filename) > 0 ||
+      info.type == AssetType::FRL_PTEX_MESH ||
+      info.type == AssetType::SUNCG_SCENE || !io::exists(filename)) {
+    return;
+  }
+
+  auto job = std::make_unique<PrefetchJob>();
+  job->assetInfo = info;
+  job->splitSemanticMesh = splitSemanticMesh;
+#ifdef MAGNUM_BUILD_STATIC
+  job->importerManager =
+      std::make_unique<Cr::PluginManager::Manager<Importer>>("nonexistent");
+#else
+  job->importerManager =
+      std::make_unique<Cr::PluginManager::Manager<Importer>>();
+#endif
+  // the Basis format is picked here, the GL context is needed for it
+  if (info.type == AssetType::INSTANCE_MESH) {
+    CORRADE_INTERNAL_ASSERT_OUTPUT(
+        job->importer =
+            job->importerManager->loadAndInstantiate("StanfordImporter"));
+  } else {
+    CORRADE_INTERNAL_ASSERT_OUTPUT(
+        job->importer =
+            job->importerManager->loadAndInstantiate("AnySceneImporter"));
+    configureImporterManager(*job->importerManager);
+  }
+
+  PrefetchJob& jobRef = *job;
+  job->loaded = std::async(std::launch::async,
+                           [&jobRef]() { return runPrefetchJob(jobRef); });
+  prefetchJobs_.emplace(filename, std::move(job));
+}
+
+bool ResourceManager::isPrefetchingScene(const std::string& filename) const {
+  auto it = prefetchJobs_.find(filename);
+  return it != prefetchJobs_.end() &&
+         it->second->loaded.wait_for(std::chrono::seconds(0)) !=
+             std::future_status::ready;
+}
+
+void ResourceManager::discardPrefetchedScenes() {
+  // destroying the futures waits for the threads
+  prefetchJobs_.clear();
+}
+
+bool ResourceManager::runPrefetchJob(PrefetchJob& job) {
+  Importer& importer = *job.importer;
+  const std::string& filename = job.assetInfo.filepath;
+  if (job.assetInfo.type == AssetType::INSTANCE_MESH) {
+    if (job.splitSemanticMesh) {
+      job.instanceMeshes =
+          GenericInstanceMeshData::fromPlySplitByObjectId(importer, filename);
+    } else {
+      GenericInstanceMeshData::uptr meshData =
+          GenericInstanceMeshData::fromPLY(importer, filename);
+      if (meshData)
+        job.instanceMeshes.emplace_back(std::move(meshData));
+    }
+    return !job.instanceMeshes.empty();
+  }
+
+  if (!importer.openFile(filename)) {
+    return false;
+  }
+
+  job.images.resize(importer.image2DCount());
+  for (int iImage = 0; iImage < job.images.size(); ++iImage) {
+    const std::uint32_t levelCount = importer.image2DLevelCount(iImage);
+    for (std::uint32_t level = 0; level != levelCount; ++level) {
+      job.images[iImage].emplace_back(importer.image2D(iImage, level));
+    }
+  }
+
+  for (int iMesh = 0; iMesh < importer.meshCount(); ++iMesh) {
+    // don't need normals if we aren't using lighting
+    auto meshData =
+        std::make_unique<GenericMeshData>(job.assetInfo.requiresLighting);
+    meshData->importAndSetMeshData(importer, iMesh);
+    job.meshes.emplace_back(std::move(meshData));
+  }
+  return true;
+}
+
+std::unique_ptr<ResourceManager::PrefetchJob> ResourceManager::takePrefetchJob(
+    const AssetInfo& info,
+    bool splitSemanticMesh) {
+  auto it = prefetchJobs_.find(info.filepath);
+  if (it == prefetchJobs_.end()) {
+    return nullptr;
+  }
+  std::unique_ptr<PrefetchJob> job = std::move(it->second);
+  prefetchJobs_.erase(it);
+
+  if (!job->loaded.get()) {
+    LOG(WARNING) << "Prefetching " << info.filepath
+                 << " failed, loading it anew";
+    return nullptr;
+  }
+  if (job->assetInfo != info ||
+      (info.type == AssetType::INSTANCE_MESH &&
+       job->splitSemanticMesh != splitSemanticMesh)) {
+    LOG(WARNING) << info.filepath
+                 << " was prefetched with another configuration, loading "
+                    "it anew";
+    return nullptr;
+  }
+  return job;
+}
+
 std::unique_ptr<MeshData> ResourceManager::createJoinedCollisionMesh(
     const std::string& filename) {
   std::unique_ptr<MeshData> mesh = std::make_unique<MeshData>();
@@ -10,6 +10,7 @@
  * esp::assets::ResourceManager::ShaderType
  */
 
+#include <future>
 #include <map>
 #include <memory>
 #include <string>
@@ -21,11 +22,13 @@
 #include <Magnum/MeshTools/Compile.h>
 #include <Magnum/MeshTools/Transform.h>
 #include <Magnum/SceneGraph/MatrixTransformation3D.h>
+#include <Magnum/Trade/ImageData.h>
 
 #include "Asset.h"
 #include "Attributes.h"
 #include "BaseMesh.h"
 #include "CollisionMeshData.h"
+#include "GenericInstanceMeshData.h"
 #include "GenericMeshData.h"
 #include "MeshData.h"
 #include "MeshMetaData.h"
@@ -578,6 +581,57 @@ class ResourceManager {
     return resourceDict_.at(metaDataName).meshMetaData;
   }
 
+  /**
+   * @brief Estimate of the memory taken up by the meshes and textures of a
+   * loaded asset, on the CPU and the GPU together.
+   *
+   * @param filename The identifying string key for the asset. See @ref
+   * resourceDict_.
+   * @return The estimated size in bytes, 0 if the asset is not loaded.
+   */
+  std::size_t getAssetByteSize(const std::string& filename) const;
+
+  /**
+   * @brief Free the meshes, textures and collision meshes of a loaded asset.
+   *
+   * Nothing may use them anymore, i.e. the scene graphs with drawables and
+   * the physics scenes made from the asset have to be destroyed first.
+   * Loading the asset again reads it from the file anew.
+   *
+   * @param filename The identifying string key for the asset. See @ref
+   * resourceDict_.
+   * @return Whether the asset was loaded.
+   */
+  bool unloadAsset(const std::string& filename);
+
+  /**
+   * @brief Start loading a scene mesh on a background thread, so that a later
+   * @ref loadScene of it only has to upload it to the GPU.
+   *
+   * The thread reads and parses the file, decodes its images and prepares its
+   * meshes.  Does nothing if the asset is loaded or being prefetched already,
+   * or is neither a general nor an instance mesh.
+   *
+   * @param info The @ref AssetInfo the scene mesh will be loaded with, if it
+   * is loaded with another one it is read anew.
+   * @param splitSemanticMesh The same as for @ref loadScene.
+   */
+  void prefetchScene(const AssetInfo& info, bool splitSemanticMesh = true);
+
+  /**
+   * @brief Whether the background thread started by @ref prefetchScene for
+   * an asset is still running.
+   *
+   * @param filename The identifying string key for the asset.
+   */
+  bool isPrefetchingScene(const std::string& filename) const;
+
+  /**
+   * @brief Drop all prefetched assets that weren't loaded yet, waiting for
+   * the ones still running.
+   */
+  void discardPrefetchedScenes();
+
   /**
    * @brief Construct a unified @ref MeshData from a loaded asset's collision
    * meshes.
@@ -888,8 +942,59 @@ class ResourceManager {
   struct LoadedAssetData {
     AssetInfo assetInfo;
     MeshMetaData meshMetaData;
+    /** @brief Estimated size of the meshes and textures, see @ref
+     * getAssetByteSize */
+    std::size_t byteSize = 0;
+  };
+
+  /**
+   * @brief The part of loading an asset that doesn't need the GL context,
+   * done on a background thread by @ref prefetchScene
+   */
+  struct PrefetchJob {
+    AssetInfo assetInfo;
+    bool splitSemanticMesh = true;
+    /**
+     * @brief Plugin manager of @ref importer, the thread can't share @ref
+     * importerManager_ as plugin managers are not thread-safe
+     */
+    std::unique_ptr<Corrade::PluginManager::Manager<Importer>> importerManager;
+    /** @brief Importer with the file opened, for general meshes */
+    Corrade::Containers::Pointer<Importer> importer;
+    /** @brief All mip levels of all images of @ref importer */
+    std::vector<
+        std::vector<Corrade::Containers::Optional<Magnum::Trade::ImageData2D>>>
+        images;
+    /** @brief All meshes of @ref importer, not uploaded yet */
+    std::vector<std::unique_ptr<GenericMeshData>> meshes;
+    /** @brief The meshes of an instance mesh, not uploaded yet */
+    std::vector<GenericInstanceMeshData::uptr> instanceMeshes;
+    /** @brief Whether the thread succeeded, has to be destroyed first */
+    std::future<bool> loaded;
   };
 
+  /**
+   * @brief Does the work of a @ref PrefetchJob, on the background thread.
+   */
+  static bool runPrefetchJob(PrefetchJob& job);
+
+  /**
+   * @brief Take the prefetched data of an asset out of @ref prefetchJobs_,
+   * waiting for its thread to finish if needed.
+   *
+   * @return nullptr if the asset wasn't prefetched, or with another
+   * configuration, or the thread failed.
+   */
+  std::unique_ptr<PrefetchJob> takePrefetchJob(const AssetInfo& info,
+                                               bool splitSemanticMesh);
+
+  /**
+   * @brief Set the preferred importer plugins of a plugin manager and the
+   * format Basis textures get transcoded to, which depends on the GPU.
+   */
+  void configureImporterManager(
+      Corrade::PluginManager::Manager<Importer>& manager);
+
   //======== Scene Functions ========
 
   /**
@@ -922,8 +1027,11 @@ class ResourceManager {
    * @param importer The importer already loaded with information for the
    * asset.
    * @param loadedAssetData The asset's @ref LoadedAssetData object.
+   * @param prefetched The images decoded by @ref prefetchScene, if any.
    */
-  void loadTextures(Importer& importer, LoadedAssetData& loadedAssetData);
+  void loadTextures(Importer& importer,
+                    LoadedAssetData& loadedAssetData,
+                    PrefetchJob* prefetched = nullptr);
 
   /**
    * @brief Load meshes from importer into assets.
@@ -933,8 +1041,11 @@ class ResourceManager {
    * @param importer The importer already loaded with information for the
    * asset.
    * @param loadedAssetData The asset's @ref LoadedAssetData object.
+   * @param prefetched The meshes prepared by @ref prefetchScene, if any.
    */
-  void loadMeshes(Importer& importer, LoadedAssetData& loadedAssetData);
+  void loadMeshes(Importer& importer,
+                  LoadedAssetData& loadedAssetData,
+                  PrefetchJob* prefetched = nullptr);
 
   /**
    * @brief Recursively parse the mesh component transformation heirarchy for
@@ -1178,6 +1289,12 @@ class ResourceManager {
    */
   std::map<std::string, LoadedAssetData> resourceDict_;
 
+  /**
+   * @brief Assets being loaded or loaded by @ref prefetchScene, but not by
+   * @ref loadScene yet, by the same keys as @ref resourceDict_.
+   */
+  std::map<std::string, std::unique_ptr<PrefetchJob>> prefetchJobs_;
+
   /**
    * @brief The @ref ShaderManager used to store shader information for
    * drawables created by this ResourceManager
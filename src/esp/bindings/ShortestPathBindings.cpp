@@ -11,9 +11,12 @@
 #include <Magnum/Math/Vector3.h>
 
 #include "esp/core/esp.h"
+#include "esp/nav/Crowd.h"
+#include "esp/nav/EpisodeGenerator.h"
 #include "esp/nav/GreedyFollower.h"
 #include "esp/nav/PathFinder.h"
 #include "esp/scene/ObjectControls.h"
+#include "esp/scene/SceneNode.h"
 
 namespace py = pybind11;
 namespace Mn = Magnum;
@@ -37,16 +40,48 @@ void initShortestPathBindings(py::module& m) {
       .def_readwrite("points", &ShortestPath::points)
       .def_readwrite("geodesic_distance", &ShortestPath::geodesicDistance);
 
+  py::class_<GeodesicDistanceField, GeodesicDistanceField::ptr>(
+      m, "GeodesicDistanceField")
+      .def_property_readonly("goals", &GeodesicDistanceField::getGoals);
+
   py::class_<MultiGoalShortestPath, MultiGoalShortestPath::ptr>(
       m, "MultiGoalShortestPath")
       .def(py::init(&MultiGoalShortestPath::create<>))
       .def_readwrite("requested_start", &MultiGoalShortestPath::requestedStart)
       .def_property("requested_ends", &MultiGoalShortestPath::getRequestedEnds,
                     &MultiGoalShortestPath::setRequestedEnds)
+      .def_property("distance_field", &MultiGoalShortestPath::getDistanceField,
+                    &MultiGoalShortestPath::setDistanceField,
+                    R"(Precomputed distance field for the requested ends.
+          Setting it also sets requested_ends to the goals of the field.)")
       .def_readwrite("points", &MultiGoalShortestPath::points)
       .def_readwrite("geodesic_distance",
                      &MultiGoalShortestPath::geodesicDistance);
 
+  py::class_<SlicedShortestPath, SlicedShortestPath::ptr>(m,
+                                                         "SlicedShortestPath")
+      .def(py::init(&SlicedShortestPath::create<>))
+      .def_readwrite("requested_start", &SlicedShortestPath::requestedStart)
+      .def_readwrite("requested_end", &SlicedShortestPath::requestedEnd)
+      .def_readwrite("points", &SlicedShortestPath::points)
+      .def_readwrite("geodesic_distance",
+                     &SlicedShortestPath::geodesicDistance)
+      .def_readonly("is_complete", &SlicedShortestPath::isComplete)
+      .def_property_readonly("is_done", &SlicedShortestPath::isDone);
+
+  py::class_<AgentNavHandle, AgentNavHandle::ptr>(m, "AgentNavHandle")
+      .def(py::init(&AgentNavHandle::create<>))
+      .def("reset", &AgentNavHandle::reset,
+           R"(Forgets the tracked poly, the next step looks it up again.)")
+      .def_property_readonly("is_tracking", &AgentNavHandle::isTracking);
+
+  py::class_<ShortestPathBatch, ShortestPathBatch::ptr>(m, "ShortestPathBatch")
+      .def(py::init(&ShortestPathBatch::create<>))
+      .def_readonly("geodesic_distances",
+                    &ShortestPathBatch::geodesicDistances)
+      .def_readonly("points", &ShortestPathBatch::points)
+      .def_readonly("path_offsets", &ShortestPathBatch::pathOffsets);
+
   py::class_<NavMeshSettings, NavMeshSettings::ptr>(m, "NavMeshSettings")
       .def(py::init(&NavMeshSettings::create<>))
       .def_readwrite("cell_size", &NavMeshSettings::cellSize)
@@ -68,46 +103,373 @@ void initShortestPathBindings(py::module& m) {
       .def_readwrite("filter_ledge_spans", &NavMeshSettings::filterLedgeSpans)
       .def_readwrite("filter_walkable_low_height_spans",
                      &NavMeshSettings::filterWalkableLowHeightSpans)
+      .def_readwrite("build_tiled", &NavMeshSettings::buildTiled)
+      .def_readwrite("tile_size", &NavMeshSettings::tileSize)
       .def("set_defaults", &NavMeshSettings::setDefaults);
 
+  // All queries on the navmesh release the GIL so that a single PathFinder can
+  // be shared between python threads
+  using release_gil = py::call_guard<py::gil_scoped_release>;
+
   py::class_<PathFinder, PathFinder::ptr>(m, "PathFinder")
       .def(py::init(&PathFinder::create<>))
       .def("get_bounds", &PathFinder::bounds)
       .def("seed", &PathFinder::seed)
       .def("get_topdown_view", &PathFinder::getTopDownView,
            R"(Returns the topdown view of the PathFinder's navmesh.)",
-           "pixelsPerMeter"_a, "height"_a)
-      .def("get_random_navigable_point", &PathFinder::getRandomNavigablePoint)
+           "pixelsPerMeter"_a, "height"_a, "rasterize"_a = false,
+           release_gil())
+      .def("get_topdown_island_view", &PathFinder::getTopDownIslandView,
+           R"(Returns the island id of the navmesh at every cell of the
+          topdown view, -1 where it is not navigable.)",
+           "pixelsPerMeter"_a, "height"_a, "max_y_delta"_a = 0.5,
+           release_gil())
+      .def("get_topdown_distance_view", &PathFinder::getTopDownDistanceView,
+           R"(Returns the distance in meters from every cell of the topdown
+          view to the closest non-navigable cell.)",
+           "pixelsPerMeter"_a, "height"_a, "max_y_delta"_a = 0.5,
+           release_gil())
+      .def("get_random_navigable_point", &PathFinder::getRandomNavigablePoint,
+           release_gil())
+      .def("get_random_navigable_points",
+           &PathFinder::getRandomNavigablePoints,
+           R"(Returns an Nx3 array of random navigable points, uniformly
+          distributed over the area of the navmesh.  Only depends on seed.)",
+           "num_points"_a, release_gil())
+      .def("get_random_navigable_points_on_island",
+           &PathFinder::getRandomNavigablePointsOnIsland,
+           R"(Same as get_random_navigable_points but only on the island of
+          pt.  Empty if pt is not on the navmesh.)",
+           "pt"_a, "num_points"_a, release_gil())
+      .def("get_random_navigable_points_around_point",
+           &PathFinder::getRandomNavigablePointsAroundPoint,
+           R"(Same as get_random_navigable_points but only within radius of
+          center.  May return fewer points if hardly any area is in range.)",
+           "center"_a, "radius"_a, "num_points"_a, release_gil())
+      .def("get_random_navigable_points_in_height_band",
+           &PathFinder::getRandomNavigablePointsInHeightBand,
+           R"(Same as get_random_navigable_points but only with heights in
+          [min_height, max_height].  May return fewer points if hardly any
+          area is in range.)",
+           "min_height"_a, "max_height"_a, "num_points"_a, release_gil())
       .def("find_path", py::overload_cast<ShortestPath&>(&PathFinder::findPath),
-           "path"_a)
+           "path"_a, release_gil())
       .def("find_path",
            py::overload_cast<MultiGoalShortestPath&>(&PathFinder::findPath),
-           "path"_a)
-      .def("try_step", &PathFinder::tryStep<Magnum::Vector3>, "start"_a,
-           "end"_a)
-      .def("try_step", &PathFinder::tryStep<vec3f>, "start"_a, "end"_a)
+           "path"_a, release_gil())
+      .def("init_sliced_path", &PathFinder::initSlicedPath,
+           R"(Starts a sliced search between path.requested_start and
+          path.requested_end.  Returns False if there is no path.)",
+           "path"_a, release_gil())
+      .def("update_sliced_path", &PathFinder::updateSlicedPath,
+           R"(Advances a sliced search by at most max_iterations polygons and,
+          if positive, max_microseconds.  Returns whether the search is done.)",
+           "path"_a, "max_iterations"_a, "max_microseconds"_a = 0,
+           release_gil())
+      .def("finalize_sliced_path", &PathFinder::finalizeSlicedPath,
+           R"(Ends a sliced search and writes the path it found to
+          path.points, the best effort so far if it was not done yet.)",
+           "path"_a, release_gil())
+      .def("find_paths", &PathFinder::findPaths,
+           R"(Finds the shortest paths between the rows of starts and ends, two
+          Nx3 arrays, using all available threads.  Returns a ShortestPathBatch
+          with the geodesic distances and, if return_points is set, the points
+          of the i-th path in points[path_offsets[i]:path_offsets[i + 1]].)",
+           "starts"_a, "ends"_a, "return_points"_a = false, release_gil())
+      .def("build_distance_field", &PathFinder::buildDistanceField,
+           R"(Precomputes the geodesic distance from every point on the
+          navmesh to the closest of goals.  Returns None if a goal is not on
+          the navmesh.)",
+           "goals"_a, release_gil())
+      .def("geodesic_distance", &PathFinder::geodesicDistance,
+           R"(Geodesic distance from pt to the closest goal of field, inf if
+          no goal can be reached.)",
+           "field"_a, "pt"_a, release_gil())
+      .def("try_step",
+           py::overload_cast<const Mn::Vector3&, const Mn::Vector3&>(
+               &PathFinder::tryStep<Mn::Vector3>),
+           "start"_a, "end"_a, release_gil())
+      .def("try_step",
+           py::overload_cast<const vec3f&, const vec3f&>(
+               &PathFinder::tryStep<vec3f>),
+           "start"_a, "end"_a, release_gil())
+      .def("try_step",
+           py::overload_cast<AgentNavHandle&, const Mn::Vector3&,
+                             const Mn::Vector3&>(
+               &PathFinder::tryStep<Mn::Vector3>),
+           R"(Same as try_step(start, end) but starts from the poly tracked by
+          handle if start is where its last step ended.)",
+           "handle"_a, "start"_a, "end"_a, release_gil())
+      .def("try_step",
+           py::overload_cast<AgentNavHandle&, const vec3f&, const vec3f&>(
+               &PathFinder::tryStep<vec3f>),
+           "handle"_a, "start"_a, "end"_a, release_gil())
+      .def("try_step_no_sliding",
+           py::overload_cast<const Mn::Vector3&, const Mn::Vector3&>(
+               &PathFinder::tryStepNoSliding<Mn::Vector3>),
+           "start"_a, "end"_a, release_gil())
+      .def("try_step_no_sliding",
+           py::overload_cast<const vec3f&, const vec3f&>(
+               &PathFinder::tryStepNoSliding<vec3f>),
+           "start"_a, "end"_a, release_gil())
+      .def("try_step_no_sliding",
+           py::overload_cast<AgentNavHandle&, const Mn::Vector3&,
+                             const Mn::Vector3&>(
+               &PathFinder::tryStepNoSliding<Mn::Vector3>),
+           "handle"_a, "start"_a, "end"_a, release_gil())
       .def("try_step_no_sliding",
-           &PathFinder::tryStepNoSliding<Magnum::Vector3>, "start"_a, "end"_a)
-      .def("try_step_no_sliding", &PathFinder::tryStepNoSliding<vec3f>,
-           "start"_a, "end"_a)
-      .def("snap_point", &PathFinder::snapPoint<Magnum::Vector3>)
-      .def("snap_point", &PathFinder::snapPoint<vec3f>)
-      .def("island_radius", &PathFinder::islandRadius, "pt"_a)
+           py::overload_cast<AgentNavHandle&, const vec3f&, const vec3f&>(
+               &PathFinder::tryStepNoSliding<vec3f>),
+           "handle"_a, "start"_a, "end"_a, release_gil())
+      .def("snap_point", &PathFinder::snapPoint<Magnum::Vector3>,
+           release_gil())
+      .def("snap_point", &PathFinder::snapPoint<vec3f>, release_gil())
+      .def("island_radius", &PathFinder::islandRadius, "pt"_a, release_gil())
       .def_property_readonly("is_loaded", &PathFinder::isLoaded)
-      .def("load_nav_mesh", &PathFinder::loadNavMesh)
+      .def_property_readonly(
+          "nav_mesh_id", &PathFinder::navMeshId,
+          R"(Changes whenever the navmesh of the active profile is loaded, built
+          or has tiles replaced, and is never reused)")
+      .def_property_readonly("num_profiles", &PathFinder::numProfiles)
+      .def_property_readonly("profile", &PathFinder::getProfile)
+      .def("set_profile", &PathFinder::setProfile,
+           R"(Makes all queries use the navmesh of an agent profile built by
+          Simulator.recompute_navmesh.  Returns False if there is none.)",
+           "profile"_a)
+      .def("add_cylinder_obstacle", &PathFinder::addCylinderObstacle,
+           R"(Adds an upright cylinder that is cut out of the navmesh by the
+          next update_obstacles and returns its id.)",
+           "center"_a, "radius"_a, "height"_a)
+      .def("add_box_obstacle", &PathFinder::addBoxObstacle,
+           R"(Adds a box rotated by yaw radians around the y axis that is cut
+          out of the navmesh by the next update_obstacles and returns its id.)",
+           "center"_a, "half_extents"_a, "yaw"_a = 0.0f)
+      .def("move_obstacle", &PathFinder::moveObstacle, "obstacle_id"_a,
+           "center"_a, "yaw"_a = 0.0f)
+      .def("remove_obstacle", &PathFinder::removeObstacle, "obstacle_id"_a)
+      .def_property_readonly("num_obstacles", &PathFinder::numObstacles)
+      .def_property_readonly(
+          "is_tiled", &PathFinder::isTiled,
+          R"(Whether the navmesh was built tiled, so that it can be updated in
+          place)")
+      .def("update_obstacles", &PathFinder::updateObstacles,
+           R"(Rebuilds the tiles of a tiled navmesh around obstacles that
+          changed, on a background thread.  Unless blocking, only swaps in
+          finished tiles and starts the next rebuild.  Returns whether the
+          navmesh is up to date with all obstacles.)",
+           "blocking"_a = true, release_gil())
+      .def("load_nav_mesh", &PathFinder::loadNavMesh, "path"_a,
+           "memory_map"_a = false)
       .def("save_nav_mesh", &PathFinder::saveNavMesh, "path"_a)
       .def("distance_to_closest_obstacle",
            &PathFinder::distanceToClosestObstacle,
            R"(Returns the distance to the closest obstacle.)", "pt"_a,
-           "max_search_radius"_a = 2.0)
+           "max_search_radius"_a = 2.0, release_gil())
+      .def("set_obstacle_distance_tolerance",
+           &PathFinder::setObstacleDistanceTolerance,
+           R"(Answers distance_to_closest_obstacle from a field precomputed on
+          first use, off by at most tolerance meters, for search radii up to
+          max_search_radius.  A tolerance of 0 disables the field.)",
+           "tolerance"_a, "max_search_radius"_a = 2.0)
+      .def_property_readonly("obstacle_distance_tolerance",
+                             &PathFinder::getObstacleDistanceTolerance)
       .def("closest_obstacle_surface_point",
            &PathFinder::closestObstacleSurfacePoint,
            R"(Returns the hit_pos, hit_normal and hit_dist of the surface point
           on the closest obstacle.)",
-           "pt"_a, "max_search_radius"_a = 2.0)
+           "pt"_a, "max_search_radius"_a = 2.0, release_gil())
       .def("is_navigable", &PathFinder::isNavigable,
            R"(Checks to see if the agent can stand at the specified point.)",
-           "pt"_a, "max_y_delta"_a = 0.5);
+           "pt"_a, "max_y_delta"_a = 0.5, release_gil())
+      // The batched queries write to out in place, so it must be a writeable,
+      // C-contiguous array of the right dtype and shape.  Without out, a new
+      // array is returned
+      .def("snap_points", &PathFinder::snapPoints,
+           R"(Snaps every row of the Nx3 float32 array points to the navmesh,
+          writing the results to the Nx3 float32 array out.)",
+           "points"_a, "out"_a, release_gil())
+      .def(
+          "snap_points",
+          [](PathFinder& self,
+             const Eigen::Ref<const Eigen::RowMatrixXf>& points) {
+            Eigen::RowMatrixXf out(points.rows(), 3);
+            self.snapPoints(points, out);
+            return out;
+          },
+          "points"_a, release_gil())
+      .def("island_radii", &PathFinder::islandRadii,
+           R"(Island radius of every row of the Nx3 float32 array points,
+          written to the float32 array out of size N.)",
+           "points"_a, "out"_a, release_gil())
+      .def(
+          "island_radii",
+          [](PathFinder& self,
+             const Eigen::Ref<const Eigen::RowMatrixXf>& points) {
+            Eigen::VectorXf out(points.rows());
+            self.islandRadii(points, out);
+            return out;
+          },
+          "points"_a, release_gil())
+      .def("distances_to_closest_obstacle",
+           &PathFinder::distancesToClosestObstacle,
+           R"(Distance to the closest obstacle of every row of the Nx3 float32
+          array points, written to the float32 array out of size N.)",
+           "points"_a, "out"_a, "max_search_radius"_a = 2.0, release_gil())
+      .def(
+          "distances_to_closest_obstacle",
+          [](const PathFinder& self,
+             const Eigen::Ref<const Eigen::RowMatrixXf>& points,
+             const float maxSearchRadius) {
+            Eigen::VectorXf out(points.rows());
+            self.distancesToClosestObstacle(points, out, maxSearchRadius);
+            return out;
+          },
+          "points"_a, "max_search_radius"_a = 2.0, release_gil())
+      .def("are_navigable", &PathFinder::areNavigable,
+           R"(Whether or not every row of the Nx3 float32 array points is
+          navigable, written to the bool array out of size N.)",
+           "points"_a, "out"_a, "max_y_delta"_a = 0.5, release_gil())
+      .def(
+          "are_navigable",
+          [](const PathFinder& self,
+             const Eigen::Ref<const Eigen::RowMatrixXf>& points,
+             const float maxYDelta) {
+            Eigen::Matrix<bool, Eigen::Dynamic, 1> out(points.rows());
+            self.areNavigable(points, out, maxYDelta);
+            return out;
+          },
+          "points"_a, "max_y_delta"_a = 0.5, release_gil())
+      .def("cast_rays", &PathFinder::castRays,
+           R"(Casts a ray along the navmesh from every row of the Nx3 float32
+          array starts to the same row of ends.  Writes the hit fractions,
+          infinity if the end was reached, to the float32 array
+          hit_fractions of size N, the hit normals to the Nx3 float32 array
+          hit_normals and the polygons the rays ended on to the uint32 array
+          hit_polys of size N.)",
+           "starts"_a, "ends"_a, "hit_fractions"_a, "hit_normals"_a,
+           "hit_polys"_a, release_gil())
+      .def(
+          "cast_rays",
+          [](const PathFinder& self,
+             const Eigen::Ref<const Eigen::RowMatrixXf>& starts,
+             const Eigen::Ref<const Eigen::RowMatrixXf>& ends) {
+            Eigen::VectorXf hitFractions(starts.rows());
+            Eigen::RowMatrixXf hitNormals(starts.rows(), 3);
+            Eigen::Matrix<uint32_t, Eigen::Dynamic, 1> hitPolys(starts.rows());
+            self.castRays(starts, ends, hitFractions, hitNormals, hitPolys);
+            return std::make_tuple(hitFractions, hitNormals, hitPolys);
+          },
+          "starts"_a, "ends"_a, release_gil());
+
+  py::class_<EpisodeGeneratorSettings, EpisodeGeneratorSettings::ptr>(
+      m, "EpisodeGeneratorSettings")
+      .def(py::init(&EpisodeGeneratorSettings::create<>))
+      .def_readwrite("min_geodesic_distance",
+                     &EpisodeGeneratorSettings::minGeodesicDistance)
+      .def_readwrite("max_geodesic_distance",
+                     &EpisodeGeneratorSettings::maxGeodesicDistance)
+      .def_readwrite("min_geodesic_to_euclidean_ratio",
+                     &EpisodeGeneratorSettings::minGeodesicToEuclideanRatio)
+      .def_readwrite("min_island_radius",
+                     &EpisodeGeneratorSettings::minIslandRadius)
+      .def_readwrite("max_candidates_per_episode",
+                     &EpisodeGeneratorSettings::maxCandidatesPerEpisode);
+
+  py::class_<NavEpisode>(m, "NavEpisode")
+      .def(py::init())
+      .def_readwrite("start", &NavEpisode::start)
+      .def_readwrite("goal", &NavEpisode::goal)
+      .def_readwrite("goal_set_index", &NavEpisode::goalSetIndex)
+      .def_readwrite("geodesic_distance", &NavEpisode::geodesicDistance)
+      .def_readwrite("euclidean_distance", &NavEpisode::euclideanDistance);
+
+  py::class_<EpisodeGeneratorStats>(m, "EpisodeGeneratorStats")
+      .def(py::init())
+      .def_readonly("num_candidates", &EpisodeGeneratorStats::numCandidates)
+      .def_readonly("num_rejected_island",
+                    &EpisodeGeneratorStats::numRejectedIsland)
+      .def_readonly("num_rejected_no_path",
+                    &EpisodeGeneratorStats::numRejectedNoPath)
+      .def_readonly("num_rejected_distance",
+                    &EpisodeGeneratorStats::numRejectedDistance)
+      .def_readonly("num_rejected_ratio",
+                    &EpisodeGeneratorStats::numRejectedRatio)
+      .def_readonly("num_accepted", &EpisodeGeneratorStats::numAccepted);
+
+  py::class_<EpisodeGenerator, EpisodeGenerator::ptr>(m, "EpisodeGenerator")
+      .def(py::init(&EpisodeGenerator::create<PathFinder::ptr>),
+           "pathfinder"_a)
+      .def("set_goal_sets", &EpisodeGenerator::setGoalSets,
+           R"(Use the closest point of a random goal set as the goal of every
+          episode.  Pass an empty list to go back to random goals.)",
+           "goal_sets"_a, release_gil())
+      .def("generate", &EpisodeGenerator::generate,
+           R"(Generates up to num_episodes episodes that satisfy settings on
+          all cores.  The result only depends on seed, which the pathfinder
+          is seeded with.)",
+           "num_episodes"_a, "seed"_a, "settings"_a, release_gil())
+      .def_property_readonly("stats", &EpisodeGenerator::getStats);
+
+  py::class_<CrowdAgentParams, CrowdAgentParams::ptr>(m, "CrowdAgentParams")
+      .def(py::init(&CrowdAgentParams::create<>))
+      .def_readwrite("radius", &CrowdAgentParams::radius)
+      .def_readwrite("height", &CrowdAgentParams::height)
+      .def_readwrite("max_acceleration", &CrowdAgentParams::maxAcceleration)
+      .def_readwrite("max_speed", &CrowdAgentParams::maxSpeed)
+      .def_readwrite("collision_query_range",
+                     &CrowdAgentParams::collisionQueryRange)
+      .def_readwrite("path_optimization_range",
+                     &CrowdAgentParams::pathOptimizationRange)
+      .def_readwrite("separation_weight", &CrowdAgentParams::separationWeight)
+      .def_readwrite("anticipate_turns", &CrowdAgentParams::anticipateTurns)
+      .def_readwrite("obstacle_avoidance",
+                     &CrowdAgentParams::obstacleAvoidance)
+      .def_readwrite("separation", &CrowdAgentParams::separation)
+      .def_readwrite("optimize_visibility",
+                     &CrowdAgentParams::optimizeVisibility)
+      .def_readwrite("optimize_topology", &CrowdAgentParams::optimizeTopology)
+      .def_readwrite("avoidance_quality", &CrowdAgentParams::avoidanceQuality);
+
+  py::class_<Crowd, Crowd::ptr>(m, "Crowd")
+      .def(py::init(&Crowd::create<PathFinder::ptr, int, float>),
+           "pathfinder"_a, "max_agents"_a = 128, "max_agent_radius"_a = 0.5f)
+      .def("add_agent", &Crowd::addAgent,
+           R"(Adds an agent at the closest navigable point to position and
+          returns its id, or -1 if the crowd is full.  If node is given, it is
+          moved and turned along with the agent by update.)",
+           "position"_a, "params"_a, "node"_a = nullptr)
+      .def("remove_agent", &Crowd::removeAgent, "agent_id"_a)
+      .def("set_agent_scene_node", &Crowd::setAgentSceneNode, "agent_id"_a,
+           "node"_a)
+      .def("set_agent_target", &Crowd::setAgentTarget, "agent_id"_a,
+           "target"_a)
+      .def("set_agent_targets", &Crowd::setAgentTargets,
+           R"(Sets the target of every agent in the int32 array agent_ids of
+          size N to the same row of the Nx3 float32 array targets.  Returns
+          how many were set.)",
+           "agent_ids"_a, "targets"_a)
+      .def("reset_agent_target", &Crowd::resetAgentTarget, "agent_id"_a)
+      .def("update", &Crowd::update,
+           R"(Moves all agents by dt seconds and their scene nodes with them.)",
+           "dt"_a)
+      .def_property_readonly("max_agents", &Crowd::maxAgents)
+      .def_property_readonly("num_agents", &Crowd::numAgents)
+      .def("has_agent", &Crowd::hasAgent, "agent_id"_a)
+      .def("get_agent_position", &Crowd::getAgentPosition, "agent_id"_a)
+      .def("get_agent_velocity", &Crowd::getAgentVelocity, "agent_id"_a)
+      .def("get_agent_states", &Crowd::getAgentStates,
+           R"(Writes the positions and velocities of all agents to the
+          max_agents x 3 float32 arrays positions and velocities, the row of
+          an agent is its id and unused rows are NaN.)",
+           "positions"_a, "velocities"_a)
+      .def(
+          "get_agent_states",
+          [](const Crowd& self) {
+            Eigen::RowMatrixXf positions(self.maxAgents(), 3);
+            Eigen::RowMatrixXf velocities(self.maxAgents(), 3);
+            self.getAgentStates(positions, velocities);
+            return std::make_tuple(positions, velocities);
+          });
 
   // this enum is used by GreedyGeodesicFollowerImpl so it needs to be defined
   // before it
@@ -128,6 +490,14 @@ void initShortestPathBindings(py::module& m) {
                     GreedyGeodesicFollowerImpl::MoveFn&,
                     GreedyGeodesicFollowerImpl::MoveFn&, double, double, double,
                     bool, int>))
+      .def(py::init(&GreedyGeodesicFollowerImpl::create<
+                    PathFinder::ptr&, double, double, double, bool, int, bool>),
+           "pathfinder"_a, "goal_dist"_a, "forward_amount"_a, "turn_amount"_a,
+           "fix_thrashing"_a = true, "thrashing_threshold"_a = 16,
+           "allow_sliding"_a = true,
+           R"(Follower that moves with the default move_forward, turn_left and
+turn_right actions in C++, with steps filtered by the pathfinder, instead of
+calling back into python. turn_amount is in radians.)")
       .def("next_action_along",
            py::overload_cast<const Mn::Quaternion&, const Mn::Vector3&,
                              const Mn::Vector3&>(
@@ -146,6 +516,11 @@ void initShortestPathBindings(py::module& m) {
            py::overload_cast<const core::RigidState&, const Mn::Vector3&>(
                &GreedyGeodesicFollowerImpl::findPath),
            py::return_value_policy::move)
+      .def("find_paths", &GreedyGeodesicFollowerImpl::findPaths, "starts"_a,
+           "ends"_a, release_gil(),
+           R"(Runs find_path for every pair of starts and ends, on all threads
+for a follower without python move functions. Returns the actions of every
+pair, empty where find_path failed.)")
       .def("reset", &GreedyGeodesicFollowerImpl::reset);
 }
 
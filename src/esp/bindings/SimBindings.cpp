@@ -46,6 +46,15 @@ void initSimBindings(py::module& m) {
                      &SimulatorConfiguration::sceneLightSetup)
       .def_readwrite("load_semantic_mesh",
                      &SimulatorConfiguration::loadSemanticMesh)
+      .def_readwrite("navmesh_cache_dir",
+                     &SimulatorConfiguration::navMeshCacheDir)
+      .def_readwrite("scene_cache_size",
+                     &SimulatorConfiguration::sceneCacheSize)
+      .def_readwrite("scene_cache_max_bytes",
+                     &SimulatorConfiguration::sceneCacheMaxBytes)
+      .def("requires_scene_reload", &requiresSceneReload, "other"_a,
+           R"(Whether switching a simulator from this configuration to other
+has to load the scene anew)")
       .def(py::self == py::self)
       .def(py::self != py::self);
 
@@ -60,10 +69,22 @@ void initSimBindings(py::module& m) {
            R"(PYTHON DOES NOT GET OWNERSHIP)",
            pybind11::return_value_policy::reference)
       .def_property_readonly("semantic_scene", &Simulator::getSemanticScene)
+      .def_property_readonly(
+          "pathfinder", &Simulator::getPathFinder,
+          R"(The pathfinder of the active scene, with the navmesh found next to
+          the scene loaded if there is one)")
       .def_property_readonly("renderer", &Simulator::getRenderer)
       .def("seed", &Simulator::seed, "new_seed"_a)
       .def("reconfigure", &Simulator::reconfigure, "configuration"_a)
       .def("reset", &Simulator::reset)
+      .def_property_readonly("num_cached_scenes", &Simulator::numCachedScenes)
+      .def("clear_scene_cache", &Simulator::clearSceneCache,
+           R"(Unloads all scenes but the active one)")
+      .def("prefetch_scene", &Simulator::prefetchScene, "configuration"_a,
+           R"(Starts loading the scene of configuration in the background, so
+that reconfigure with it later only has to upload it to the GPU)")
+      .def_property_readonly("is_scene_prefetched",
+                             &Simulator::isScenePrefetched)
       .def_property_readonly("gpu_device", &Simulator::gpuDevice)
       .def_property_readonly("random", &Simulator::random)
       .def_property("frustum_culling", &Simulator::isFrustumCullingEnabled,
@@ -134,8 +155,27 @@ void initSimBindings(py::module& m) {
            "sceneID"_a = 0)
       .def("set_object_bb_draw", &Simulator::setObjectBBDraw, "draw_bb"_a,
            "object_id"_a, "sceneID"_a = 0)
-      .def("recompute_navmesh", &Simulator::recomputeNavMesh, "pathfinder"_a,
-           "navmesh_settings"_a, "include_static_objects"_a)
+      .def("recompute_navmesh",
+           py::overload_cast<nav::PathFinder&, const nav::NavMeshSettings&,
+                             bool>(&Simulator::recomputeNavMesh),
+           "pathfinder"_a, "navmesh_settings"_a, "include_static_objects"_a)
+      .def("recompute_navmesh",
+           py::overload_cast<nav::PathFinder&,
+                             const std::vector<nav::NavMeshSettings>&, bool>(
+               &Simulator::recomputeNavMesh),
+           R"(Builds one navmesh per agent profile, see
+          PathFinder.set_profile.)",
+           "pathfinder"_a, "profiles"_a, "include_static_objects"_a)
+      .def("update_navmesh", &Simulator::updateNavMesh, "pathfinder"_a,
+           "navmesh_settings"_a,
+           R"(Rebuilds only the navmesh tiles around STATIC objects that were
+          added, removed or moved since the navmesh was last computed.)")
+      .def("update_navmesh_obstacles", &Simulator::updateNavMeshObstacles,
+           "pathfinder"_a, "blocking"_a = false,
+           R"(Cuts DYNAMIC and KINEMATIC objects out of a tiled navmesh where
+          they are now, see PathFinder.update_obstacles.  Meant to be called
+          every step.  Returns False without doing anything if the navmesh is
+          not tiled, see PathFinder.is_tiled.)")
       .def("get_light_setup", &Simulator::getLightSetup,
            "key"_a = assets::ResourceManager::DEFAULT_LIGHTING_KEY)
       .def("set_light_setup", &Simulator::setLightSetup, "light_setup"_a,
@@ -0,0 +1,363 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "Crowd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/EigenIntegration/Integration.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Quaternion.h>
+#include <Magnum/Math/Vector3.h>
+
+#include "esp/scene/SceneNode.h"
+
+#include "DetourCrowd.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+namespace Mn = Magnum;
+
+namespace esp {
+namespace nav {
+
+namespace {
+// Same as what PathFinder snaps points to the navmesh with
+constexpr float polyPickExt[3] = {2, 4, 2};
+
+dtCrowdAgentParams toDetourParams(const CrowdAgentParams& params) {
+  dtCrowdAgentParams ap;
+  memset(&ap, 0, sizeof(ap));
+  ap.radius = params.radius;
+  ap.height = params.height;
+  ap.maxAcceleration = params.maxAcceleration;
+  ap.maxSpeed = params.maxSpeed;
+  ap.collisionQueryRange = params.collisionQueryRange * params.radius;
+  ap.pathOptimizationRange = params.pathOptimizationRange * params.radius;
+  ap.separationWeight = params.separationWeight;
+  ap.updateFlags = 0;
+  if (params.anticipateTurns)
+    ap.updateFlags |= DT_CROWD_ANTICIPATE_TURNS;
+  if (params.obstacleAvoidance)
+    ap.updateFlags |= DT_CROWD_OBSTACLE_AVOIDANCE;
+  if (params.separation)
+    ap.updateFlags |= DT_CROWD_SEPARATION;
+  if (params.optimizeVisibility)
+    ap.updateFlags |= DT_CROWD_OPTIMIZE_VIS;
+  if (params.optimizeTopology)
+    ap.updateFlags |= DT_CROWD_OPTIMIZE_TOPO;
+  const int quality = std::min(std::max(params.avoidanceQuality, 0),
+                               DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS - 1);
+  ap.obstacleAvoidanceType = static_cast<unsigned char>(quality);
+  ap.queryFilterType = 0;
+  return ap;
+}
+
+// The low to high quality presets of the Recast demo
+void setAvoidanceQualities(dtCrowd* crowd) {
+  dtObstacleAvoidanceParams params = *crowd->getObstacleAvoidanceParams(0);
+  const unsigned char divs[] = {5, 5, 7, 7};
+  const unsigned char rings[] = {2, 2, 2, 3};
+  const unsigned char depth[] = {1, 2, 3, 3};
+  for (int i = 0; i < 4; ++i) {
+    params.velBias = 0.5f;
+    params.adaptiveDivs = divs[i];
+    params.adaptiveRings = rings[i];
+    params.adaptiveDepth = depth[i];
+    crowd->setObstacleAvoidanceParams(i, &params);
+  }
+}
+}  // namespace
+
+struct Crowd::Impl {
+  struct Agent {
+    bool active = false;
+    CrowdAgentParams params;
+    scene::SceneNode* node = nullptr;
+    // Index in crowd_, not the same as the id once the navmesh changed
+    int crowdIndex = ID_UNDEFINED;
+    vec3f position{NAN, NAN, NAN};
+    vec3f velocity{NAN, NAN, NAN};
+    bool hasTarget = false;
+    vec3f target;
+  };
+
+  struct CrowdDeleter {
+    void operator()(dtCrowd* crowd) { dtFreeCrowd(crowd); }
+  };
+
+  Impl(PathFinder::ptr pathfinder, int maxAgents, float maxAgentRadius)
+      : pathfinder_{std::move(pathfinder)},
+        maxAgentRadius_{maxAgentRadius},
+        agents_(maxAgents) {}
+
+  Agent* getAgent(int agentId) {
+    if (agentId < 0 || agentId >= agents_.size() || !agents_[agentId].active)
+      return nullptr;
+    return &agents_[agentId];
+  }
+
+  const Agent* getAgent(int agentId) const {
+    return const_cast<Impl*>(this)->getAgent(agentId);
+  }
+
+  // (Re)creates crowd_ if the navmesh of the pathfinder changed.  Returns
+  // false if there is none
+  bool syncNavMesh();
+  // Places the agent on the navmesh at its position, with its target
+  bool addToCrowd(Agent& agent);
+  bool requestTarget(Agent& agent);
+
+  PathFinder::ptr pathfinder_;
+  float maxAgentRadius_;
+  std::vector<Agent> agents_;
+  int numAgents_ = 0;
+  std::unique_ptr<dtCrowd, CrowdDeleter> crowd_ = nullptr;
+  //! PathFinder::navMeshId of the navmesh crowd_ was created for.  Unlike
+  //! the address of the navmesh it is never reused
+  size_t navMeshId_ = 0;
+};
+
+bool Crowd::Impl::syncNavMesh() {
+  dtNavMesh* navMesh =
+      pathfinder_->isLoaded() ? pathfinder_->detourNavMesh() : nullptr;
+  if (!navMesh) {
+    crowd_.reset();
+    navMeshId_ = 0;
+    return false;
+  }
+  if (crowd_ && pathfinder_->navMeshId() == navMeshId_)
+    return true;
+
+  // The polys the crowd holds on to may be gone, even if the navmesh itself
+  // is the same one with some tiles replaced
+  crowd_.reset(dtAllocCrowd());
+  if (!crowd_ || !crowd_->init(agents_.size(), maxAgentRadius_, navMesh)) {
+    LOG(ERROR) << "Could not init Detour crowd";
+    crowd_.reset();
+    navMeshId_ = 0;
+    return false;
+  }
+  *crowd_->getEditableFilter(0) = *pathfinder_->detourFilter();
+  setAvoidanceQualities(crowd_.get());
+  navMeshId_ = pathfinder_->navMeshId();
+
+  // Agents keep their ids, targets and velocities on the new navmesh, so
+  // that tiles rebuilt around obstacles don't stop them
+  for (Agent& agent : agents_) {
+    if (!agent.active)
+      continue;
+    const vec3f velocity = agent.velocity;
+    if (!addToCrowd(agent)) {
+      LOG(WARNING) << "Could not place crowd agent on the new navmesh";
+      continue;
+    }
+    if (velocity.allFinite()) {
+      dtCrowdAgent* ag = crowd_->getEditableAgent(agent.crowdIndex);
+      std::copy(velocity.data(), velocity.data() + 3, ag->vel);
+      agent.velocity = velocity;
+    }
+  }
+  return true;
+}
+
+bool Crowd::Impl::addToCrowd(Agent& agent) {
+  agent.crowdIndex = ID_UNDEFINED;
+  dtPolyRef ref = 0;
+  vec3f nearest;
+  crowd_->getNavMeshQuery()->findNearestPoly(
+      agent.position.data(), polyPickExt, crowd_->getFilter(0), &ref,
+      nearest.data());
+  if (!ref)
+    return false;
+
+  const dtCrowdAgentParams ap = toDetourParams(agent.params);
+  agent.crowdIndex = crowd_->addAgent(nearest.data(), &ap);
+  if (agent.crowdIndex < 0) {
+    agent.crowdIndex = ID_UNDEFINED;
+    return false;
+  }
+  agent.position = nearest;
+  agent.velocity.setZero();
+  if (agent.hasTarget)
+    requestTarget(agent);
+  return true;
+}
+
+bool Crowd::Impl::requestTarget(Agent& agent) {
+  if (agent.crowdIndex == ID_UNDEFINED)
+    return false;
+
+  dtPolyRef ref = 0;
+  vec3f nearest;
+  crowd_->getNavMeshQuery()->findNearestPoly(
+      agent.target.data(), polyPickExt, crowd_->getFilter(0), &ref,
+      nearest.data());
+  return ref &&
+         crowd_->requestMoveTarget(agent.crowdIndex, ref, nearest.data());
+}
+
+Crowd::Crowd(PathFinder::ptr pathfinder, int maxAgents, float maxAgentRadius)
+    : pimpl_{spimpl::make_unique_impl<Impl>(std::move(pathfinder),
+                                            maxAgents,
+                                            maxAgentRadius)} {}
+
+int Crowd::addAgent(const vec3f& position,
+                    const CrowdAgentParams& params,
+                    scene::SceneNode* node) {
+  if (!pimpl_->syncNavMesh())
+    return ID_UNDEFINED;
+
+  auto it = std::find_if(
+      pimpl_->agents_.begin(), pimpl_->agents_.end(),
+      [](const Impl::Agent& agent) { return !agent.active; });
+  if (it == pimpl_->agents_.end())
+    return ID_UNDEFINED;
+
+  Impl::Agent agent;
+  agent.params = params;
+  agent.node = node;
+  agent.position = position;
+  if (!pimpl_->addToCrowd(agent))
+    return ID_UNDEFINED;
+
+  agent.active = true;
+  *it = agent;
+  ++pimpl_->numAgents_;
+  return it - pimpl_->agents_.begin();
+}
+
+bool Crowd::removeAgent(int agentId) {
+  Impl::Agent* agent = pimpl_->getAgent(agentId);
+  if (!agent)
+    return false;
+
+  if (pimpl_->crowd_ && agent->crowdIndex != ID_UNDEFINED)
+    pimpl_->crowd_->removeAgent(agent->crowdIndex);
+  *agent = Impl::Agent{};
+  --pimpl_->numAgents_;
+  return true;
+}
+
+bool Crowd::setAgentSceneNode(int agentId, scene::SceneNode* node) {
+  Impl::Agent* agent = pimpl_->getAgent(agentId);
+  if (!agent)
+    return false;
+
+  agent->node = node;
+  return true;
+}
+
+bool Crowd::setAgentTarget(int agentId, const vec3f& target) {
+  Impl::Agent* agent = pimpl_->getAgent(agentId);
+  if (!agent || !pimpl_->syncNavMesh())
+    return false;
+
+  agent->target = target;
+  agent->hasTarget = pimpl_->requestTarget(*agent);
+  return agent->hasTarget;
+}
+
+int Crowd::setAgentTargets(
+    const Eigen::Ref<const Eigen::VectorXi>& agentIds,
+    const Eigen::Ref<const Eigen::RowMatrixXf>& targets) {
+  CORRADE_ASSERT(targets.cols() == 3 && targets.rows() == agentIds.rows(),
+                 "Crowd::setAgentTargets: targets must be an Nx3 array for N "
+                 "agent ids",
+                 0);
+  int numSet = 0;
+  for (int i = 0; i < agentIds.rows(); ++i) {
+    if (setAgentTarget(agentIds[i], targets.row(i).transpose()))
+      ++numSet;
+  }
+  return numSet;
+}
+
+bool Crowd::resetAgentTarget(int agentId) {
+  Impl::Agent* agent = pimpl_->getAgent(agentId);
+  if (!agent)
+    return false;
+
+  agent->hasTarget = false;
+  if (pimpl_->crowd_ && agent->crowdIndex != ID_UNDEFINED)
+    pimpl_->crowd_->resetMoveTarget(agent->crowdIndex);
+  return true;
+}
+
+void Crowd::update(float dt) {
+  if (!pimpl_->syncNavMesh())
+    return;
+
+  pimpl_->crowd_->update(dt, nullptr);
+
+  for (Impl::Agent& agent : pimpl_->agents_) {
+    if (!agent.active || agent.crowdIndex == ID_UNDEFINED)
+      continue;
+
+    const dtCrowdAgent* ag = pimpl_->crowd_->getAgent(agent.crowdIndex);
+    agent.position = vec3f{ag->npos};
+    agent.velocity = vec3f{ag->vel};
+    if (!agent.node)
+      continue;
+
+    agent.node->setTranslation(Mn::Vector3{agent.position});
+    // Turn the node where it is going, standing agents keep their heading
+    if (agent.velocity[0] * agent.velocity[0] +
+            agent.velocity[2] * agent.velocity[2] >
+        1e-6f) {
+      const float yaw = std::atan2(-agent.velocity[0], -agent.velocity[2]);
+      agent.node->setRotation(
+          Mn::Quaternion::rotation(Mn::Rad{yaw}, Mn::Vector3::yAxis()));
+    }
+  }
+}
+
+int Crowd::maxAgents() const {
+  return pimpl_->agents_.size();
+}
+
+int Crowd::numAgents() const {
+  return pimpl_->numAgents_;
+}
+
+bool Crowd::hasAgent(int agentId) const {
+  return pimpl_->getAgent(agentId) != nullptr;
+}
+
+vec3f Crowd::getAgentPosition(int agentId) const {
+  const Impl::Agent* agent = pimpl_->getAgent(agentId);
+  return agent ? agent->position : vec3f{NAN, NAN, NAN};
+}
+
+vec3f Crowd::getAgentVelocity(int agentId) const {
+  const Impl::Agent* agent = pimpl_->getAgent(agentId);
+  return agent ? agent->velocity : vec3f{NAN, NAN, NAN};
+}
+
+void Crowd::getAgentStates(Eigen::Ref<Eigen::RowMatrixXf> positions,
+                           Eigen::Ref<Eigen::RowMatrixXf> velocities) const {
+  const int numRows = maxAgents();
+  CORRADE_ASSERT(positions.cols() == 3 && velocities.cols() == 3 &&
+                     positions.rows() == numRows &&
+                     velocities.rows() == numRows,
+                 "Crowd::getAgentStates: positions and velocities must be "
+                 "maxAgents x 3 arrays", );
+  for (int i = 0; i < numRows; ++i) {
+    const Impl::Agent& agent = pimpl_->agents_[i];
+    if (agent.active) {
+      positions.row(i) = agent.position.transpose();
+      velocities.row(i) = agent.velocity.transpose();
+    } else {
+      positions.row(i).setConstant(NAN);
+      velocities.row(i).setConstant(NAN);
+    }
+  }
+}
+
+}  // namespace nav
+}  // namespace esp
@@ -0,0 +1,150 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include "esp/core/esp.h"
+#include "esp/nav/PathFinder.h"
+
+namespace esp {
+// forward declaration
+namespace scene {
+class SceneNode;
+}
+
+namespace nav {
+
+/**
+ * @brief How an agent of a @ref Crowd moves, see dtCrowdAgentParams
+ */
+struct CrowdAgentParams {
+  float radius = 0.1f;
+  float height = 1.5f;
+  float maxAcceleration = 8.0f;
+  float maxSpeed = 1.0f;
+  //! How close other agents have to be to be avoided, in multiples of the
+  //! radius
+  float collisionQueryRange = 12.0f;
+  //! How far ahead the path is shortcut, in multiples of the radius
+  float pathOptimizationRange = 30.0f;
+  //! How strongly agents keep away from each other if separation is enabled
+  float separationWeight = 2.0f;
+  bool anticipateTurns = true;
+  bool obstacleAvoidance = true;
+  bool separation = false;
+  bool optimizeVisibility = true;
+  bool optimizeTopology = true;
+  //! Quality of the obstacle avoidance, from 0 (low) to 3 (high)
+  int avoidanceQuality = 3;
+
+  ESP_SMART_POINTERS(CrowdAgentParams)
+};
+
+/**
+ * @brief Moves many agents, e.g. NPCs, across the navigation mesh of a @ref
+ * PathFinder at once, with local avoidance between them, using Detour's crowd
+ *
+ * Agents are moved towards their targets by @ref update, a single call per
+ * step no matter how many agents there are.  The crowd follows the navigation
+ * mesh of the active profile of the pathfinder.  If it is rebuilt, loaded
+ * anew or has tiles replaced, e.g. by @ref PathFinder::updateObstacles, all
+ * agents are placed on the new one at their current position and keep their
+ * velocity.
+ */
+class Crowd {
+ public:
+  /**
+   * @param pathfinder The pathfinder whose navigation mesh the agents move on
+   * @param maxAgents The maximum number of agents at once
+   * @param maxAgentRadius The largest radius of any agent
+   */
+  explicit Crowd(PathFinder::ptr pathfinder,
+                 int maxAgents = 128,
+                 float maxAgentRadius = 0.5f);
+
+  /**
+   * @brief Adds an agent at the point of the navigation mesh closest to
+   * position
+   *
+   * @param node If not null, the node is moved along with the agent by @ref
+   * update and turned so that its -Z axis faces where the agent is going.  It
+   * has to outlive the agent or be unset with @ref setAgentSceneNode.
+   * @return The id of the agent, between 0 and @ref maxAgents, or @ref
+   * ID_UNDEFINED if the crowd is full or there is no navigation mesh
+   */
+  int addAgent(const vec3f& position,
+               const CrowdAgentParams& params,
+               scene::SceneNode* node = nullptr);
+
+  /**
+   * @return False if there is no such agent
+   */
+  bool removeAgent(int agentId);
+
+  /**
+   * @brief Sets the scene node that follows an agent, null for none
+   *
+   * @return False if there is no such agent
+   */
+  bool setAgentSceneNode(int agentId, scene::SceneNode* node);
+
+  /**
+   * @brief Makes an agent move to the point of the navigation mesh closest to
+   * target, its path is planned during the next updates
+   *
+   * @return False if there is no such agent or target is not close to the
+   * navigation mesh
+   */
+  bool setAgentTarget(int agentId, const vec3f& target);
+
+  /**
+   * @brief Batched version of @ref setAgentTarget, every row of the Nx3 array
+   * targets is the target of the agent in the same row of agentIds
+   *
+   * @return The number of targets that were set
+   */
+  int setAgentTargets(const Eigen::Ref<const Eigen::VectorXi>& agentIds,
+                      const Eigen::Ref<const Eigen::RowMatrixXf>& targets);
+
+  /**
+   * @brief Makes an agent stop where it is
+   *
+   * @return False if there is no such agent
+   */
+  bool resetAgentTarget(int agentId);
+
+  /**
+   * @brief Advances all agents by dt seconds and moves their scene nodes
+   */
+  void update(float dt);
+
+  int maxAgents() const;
+  int numAgents() const;
+  bool hasAgent(int agentId) const;
+
+  /**
+   * @brief Position of an agent, NaN if there is no such agent
+   */
+  vec3f getAgentPosition(int agentId) const;
+
+  /**
+   * @brief Velocity of an agent, NaN if there is no such agent
+   */
+  vec3f getAgentVelocity(int agentId) const;
+
+  /**
+   * @brief The positions and velocities of all agents as of the last @ref
+   * update, the row of an agent is its id
+   *
+   * @param[out] positions A @ref maxAgents x 3 array, NaN for unused ids
+   * @param[out] velocities A @ref maxAgents x 3 array, NaN for unused ids
+   */
+  void getAgentStates(Eigen::Ref<Eigen::RowMatrixXf> positions,
+                      Eigen::Ref<Eigen::RowMatrixXf> velocities) const;
+
+  ESP_SMART_POINTERS_WITH_UNIQUE_PIMPL(Crowd)
+};
+
+}  // namespace nav
+}  // namespace esp
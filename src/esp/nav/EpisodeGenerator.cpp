@@ -0,0 +1,163 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "esp/nav/EpisodeGenerator.h"
+
+#include <algorithm>
+
+namespace esp {
+namespace nav {
+
+namespace {
+// First constraint a candidate failed
+enum class Rejection { None, Island, NoPath, Distance, Ratio };
+}  // namespace
+
+EpisodeGenerator::EpisodeGenerator(PathFinder::ptr pathfinder)
+    : pathfinder_{std::move(pathfinder)}, random_{0} {}
+
+bool EpisodeGenerator::setGoalSets(
+    const std::vector<std::vector<vec3f>>& goalSets) {
+  std::vector<GeodesicDistanceField::ptr> goalFields;
+  goalFields.reserve(goalSets.size());
+  for (const std::vector<vec3f>& goals : goalSets) {
+    GeodesicDistanceField::ptr field = pathfinder_->buildDistanceField(goals);
+    if (!field) {
+      LOG(ERROR) << "EpisodeGenerator::setGoalSets: goal set "
+                 << goalFields.size() << " is not on the navmesh";
+      return false;
+    }
+    goalFields.emplace_back(std::move(field));
+  }
+  goalFields_ = std::move(goalFields);
+  return true;
+}
+
+std::vector<NavEpisode> EpisodeGenerator::generate(
+    const int numEpisodes,
+    const uint32_t seed,
+    const EpisodeGeneratorSettings& settings) {
+  stats_ = EpisodeGeneratorStats{};
+  std::vector<NavEpisode> episodes;
+  if (numEpisodes <= 0 || !pathfinder_->isLoaded())
+    return episodes;
+
+  pathfinder_->seed(seed);
+  random_.seed(seed);
+
+  // Checks a candidate, episode.start and either episode.goal or
+  // episode.goalSetIndex are set, the rest is filled in
+  auto check = [&](NavEpisode& episode) {
+    if (pathfinder_->islandRadius(episode.start) < settings.minIslandRadius)
+      return Rejection::Island;
+
+    if (episode.goalSetIndex == ID_UNDEFINED) {
+      episode.euclideanDistance = (episode.goal - episode.start).norm();
+      // The geodesic distance can only be longer
+      if (episode.euclideanDistance > settings.maxGeodesicDistance)
+        return Rejection::Distance;
+
+      ShortestPath path;
+      path.requestedStart = episode.start;
+      path.requestedEnd = episode.goal;
+      if (!pathfinder_->findPath(path))
+        return Rejection::NoPath;
+      episode.geodesicDistance = path.geodesicDistance;
+    } else {
+      MultiGoalShortestPath path;
+      path.requestedStart = episode.start;
+      path.setDistanceField(goalFields_[episode.goalSetIndex]);
+      if (!pathfinder_->findPath(path) || path.points.empty())
+        return Rejection::NoPath;
+      episode.goal = path.points.back();
+      episode.euclideanDistance = (episode.goal - episode.start).norm();
+      episode.geodesicDistance = path.geodesicDistance;
+    }
+
+    if (episode.geodesicDistance < settings.minGeodesicDistance ||
+        episode.geodesicDistance > settings.maxGeodesicDistance)
+      return Rejection::Distance;
+    if (episode.geodesicDistance <
+        settings.minGeodesicToEuclideanRatio * episode.euclideanDistance)
+      return Rejection::Ratio;
+    return Rejection::None;
+  };
+
+  // Checking a candidate is a path search at most, so batches need to be
+  // large to keep all threads busy
+  constexpr int minCandidatesPerRound = 1024;
+  const long maxCandidates =
+      static_cast<long>(settings.maxCandidatesPerEpisode) * numEpisodes;
+  long numDrawn = 0;
+  std::vector<NavEpisode> candidates;
+  std::vector<Rejection> rejections;
+  while (episodes.size() < numEpisodes && numDrawn < maxCandidates) {
+    const int numDraws = std::min<long>(
+        std::max<long>(numEpisodes - episodes.size(), minCandidatesPerRound),
+        maxCandidates - numDrawn);
+    numDrawn += numDraws;
+
+    // All random numbers of the batch are drawn here, on one thread
+    const Eigen::RowMatrixXf starts =
+        pathfinder_->getRandomNavigablePoints(numDraws);
+    Eigen::RowMatrixXf goals;
+    if (goalFields_.empty())
+      goals = pathfinder_->getRandomNavigablePoints(numDraws);
+    if (starts.rows() < numDraws ||
+        (goalFields_.empty() && goals.rows() < numDraws)) {
+      LOG(ERROR) << "EpisodeGenerator::generate: failed to sample points";
+      break;
+    }
+
+    candidates.assign(numDraws, NavEpisode{});
+    for (int i = 0; i < numDraws; ++i) {
+      candidates[i].start = starts.row(i).transpose();
+      if (goalFields_.empty())
+        candidates[i].goal = goals.row(i).transpose();
+      else
+        candidates[i].goalSetIndex =
+            random_.uniform_int(0, goalFields_.size());
+    }
+
+    rejections.assign(numDraws, Rejection::None);
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < numDraws; ++i) {
+      rejections[i] = check(candidates[i]);
+    }
+
+    // Candidates are taken in order, so the result does not depend on the
+    // number of threads either
+    for (int i = 0; i < numDraws && episodes.size() < numEpisodes; ++i) {
+      ++stats_.numCandidates;
+      switch (rejections[i]) {
+        case Rejection::None:
+          ++stats_.numAccepted;
+          episodes.push_back(candidates[i]);
+          break;
+        case Rejection::Island:
+          ++stats_.numRejectedIsland;
+          break;
+        case Rejection::NoPath:
+          ++stats_.numRejectedNoPath;
+          break;
+        case Rejection::Distance:
+          ++stats_.numRejectedDistance;
+          break;
+        case Rejection::Ratio:
+          ++stats_.numRejectedRatio;
+          break;
+      }
+    }
+  }
+
+  if (episodes.size() < numEpisodes) {
+    LOG(WARNING) << "EpisodeGenerator::generate: only found "
+                 << episodes.size() << " of " << numEpisodes
+                 << " episodes in " << stats_.numCandidates << " candidates";
+  }
+  return episodes;
+}
+
+}  // namespace nav
+}  // namespace esp
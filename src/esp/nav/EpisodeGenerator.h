@@ -0,0 +1,123 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <vector>
+
+#include "esp/core/esp.h"
+#include "esp/core/random.h"
+#include "esp/nav/PathFinder.h"
+
+namespace esp {
+namespace nav {
+
+/**
+ * @brief Constraints that the episodes generated by @ref EpisodeGenerator
+ * have to satisfy
+ */
+struct EpisodeGeneratorSettings {
+  //! Range of the geodesic distance from the start to the goal
+  float minGeodesicDistance = 1.0f;
+  float maxGeodesicDistance = 30.0f;
+  //! Minimum ratio of the geodesic to the euclidean distance.  1 accepts
+  //! straight line episodes, larger values require some turns
+  float minGeodesicToEuclideanRatio = 1.0f;
+  //! Minimum radius of the island the start is on, rejects starts on small
+  //! disconnected pieces of the navmesh
+  float minIslandRadius = 1.5f;
+  //! Gives up after this many candidates per requested episode
+  int maxCandidatesPerEpisode = 1000;
+
+  ESP_SMART_POINTERS(EpisodeGeneratorSettings)
+};
+
+/**
+ * @brief A start and goal generated by @ref EpisodeGenerator
+ */
+struct NavEpisode {
+  vec3f start;
+  //! The goal, the closest point of the goal set if there are goal sets
+  vec3f goal;
+  //! Index of the goal set, ID_UNDEFINED if there are no goal sets
+  int goalSetIndex = ID_UNDEFINED;
+  float geodesicDistance;
+  float euclideanDistance;
+};
+
+/**
+ * @brief How many candidates were rejected by each constraint in the last
+ * call to @ref EpisodeGenerator.generate.  Constraints are checked in the
+ * order of the members, a candidate is only counted for the first one it
+ * fails.
+ */
+struct EpisodeGeneratorStats {
+  //! Candidates looked at until enough episodes were found
+  int numCandidates = 0;
+  //! Start island smaller than minIslandRadius
+  int numRejectedIsland = 0;
+  //! Goal not reachable from the start
+  int numRejectedNoPath = 0;
+  //! Geodesic distance outside of the range.  Random goals whose euclidean
+  //! distance is already too long are counted here before searching a path
+  int numRejectedDistance = 0;
+  //! Geodesic to euclidean ratio too small
+  int numRejectedRatio = 0;
+  int numAccepted = 0;
+};
+
+/**
+ * @brief Generates PointNav style (random goal) or ObjectNav style (closest
+ * point of a goal set) episodes on the navmesh of a @ref PathFinder
+ *
+ * Candidates are sampled in batches and checked on all available threads.
+ * The random numbers for a batch are drawn up front, so the episodes only
+ * depend on the seed.
+ */
+class EpisodeGenerator {
+ public:
+  explicit EpisodeGenerator(PathFinder::ptr pathfinder);
+
+  /**
+   * @brief Use the closest point of a randomly chosen goal set as the goal
+   * instead of a random navigable point.  Pass an empty list to go back to
+   * random goals.
+   *
+   * @return False if a goal set has no point on the navmesh, the goal sets
+   * are not changed then
+   */
+  bool setGoalSets(const std::vector<std::vector<vec3f>>& goalSets);
+
+  /**
+   * @brief Generates episodes that satisfy @ref settings
+   *
+   * @param[in] numEpisodes The number of episodes to generate
+   * @param[in] seed The random seed
+   * @param[in] settings The constraints
+   *
+   * @return The episodes, fewer than numEpisodes if @ref
+   * EpisodeGeneratorSettings.maxCandidatesPerEpisode was exhausted
+   *
+   * @note This seeds the pathfinder with @ref seed
+   */
+  std::vector<NavEpisode> generate(int numEpisodes,
+                                   uint32_t seed,
+                                   const EpisodeGeneratorSettings& settings);
+
+  /**
+   * @brief Rejection statistics of the last call to @ref generate
+   */
+  const EpisodeGeneratorStats& getStats() const { return stats_; }
+
+ private:
+  PathFinder::ptr pathfinder_;
+  std::vector<GeodesicDistanceField::ptr> goalFields_;
+  core::Random random_;
+  EpisodeGeneratorStats stats_;
+
+  ESP_SMART_POINTERS(EpisodeGenerator)
+};
+
+}  // namespace nav
+}  // namespace esp
@@ -1,5 +1,8 @@
 #include "esp/nav/GreedyFollower.h"
 
+#include <cmath>
+
+#include <Corrade/Utility/Assert.h>
 #include <Magnum/EigenIntegration/GeometryIntegration.h>
 #include <Magnum/EigenIntegration/Integration.h>
 
@@ -32,11 +35,78 @@ GreedyGeodesicFollowerImpl::GreedyGeodesicFollowerImpl(
       fixThrashing_{fixThrashing},
       thrashingThreshold_{thrashingThreshold} {};
 
+GreedyGeodesicFollowerImpl::GreedyGeodesicFollowerImpl(
+    PathFinder::ptr& pathfinder,
+    double goalDist,
+    double forwardAmount,
+    double turnAmount,
+    bool fixThrashing,
+    int thrashingThreshold,
+    bool allowSliding)
+    : pathfinder_{pathfinder},
+      moveForward_{[this](scene::SceneNode* node) {
+        return nativeMoveForward(node);
+      }},
+      turnLeft_{[this](scene::SceneNode* node) {
+        return nativeTurn(node, turnAmount_);
+      }},
+      turnRight_{[this](scene::SceneNode* node) {
+        return nativeTurn(node, -turnAmount_);
+      }},
+      forwardAmount_{forwardAmount},
+      goalDist_{goalDist},
+      turnAmount_{turnAmount},
+      fixThrashing_{fixThrashing},
+      thrashingThreshold_{thrashingThreshold},
+      nativeMoves_{true},
+      allowSliding_{allowSliding} {};
+
+bool GreedyGeodesicFollowerImpl::nativeMoveForward(scene::SceneNode* node) {
+  // Same as the "move_forward" action, filtered by the navmesh the same way
+  // the simulator does it
+  const Mn::Vector3 start = node->MagnumObject::translation();
+  node->translateLocal(node->transformation().backward() * -forwardAmount_);
+  const Mn::Vector3 end = node->MagnumObject::translation();
+  const Mn::Vector3 filteredEnd =
+      allowSliding_ ? pathfinder_->tryStep(start, end)
+                    : pathfinder_->tryStepNoSliding(start, end);
+  node->setTranslation(filteredEnd);
+
+  // The step collided if it covered less distance than it was supposed to
+  constexpr float EPS = 1e-5f;
+  return (filteredEnd - start).dot() + EPS < (end - start).dot();
+}
+
+bool GreedyGeodesicFollowerImpl::nativeTurn(scene::SceneNode* node,
+                                            float angle) {
+  node->rotateYLocal(Mn::Rad{angle});
+  node->setRotation(node->rotation().normalized());
+  return false;
+}
+
 float GreedyGeodesicFollowerImpl::geoDist(const Mn::Vector3& start,
                                           const Mn::Vector3& end) {
+  // Obstacles, rebuilt tiles or another profile change the distances as well
+  if (end != geoDistCacheEnd_ ||
+      pathfinder_->navMeshId() != geoDistCacheNavMeshId_) {
+    geoDistCache_.clear();
+    geoDistCacheEnd_ = end;
+    geoDistCacheNavMeshId_ = pathfinder_->navMeshId();
+  }
+
+  constexpr float cacheResolution = 1e4f;
+  const std::array<int, 3> key{
+      {static_cast<int>(std::lround(start.x() * cacheResolution)),
+       static_cast<int>(std::lround(start.y() * cacheResolution)),
+       static_cast<int>(std::lround(start.z() * cacheResolution))}};
+  auto it = geoDistCache_.find(key);
+  if (it != geoDistCache_.end())
+    return it->second;
+
   geoDistPath_.requestedStart = cast<vec3f>(start);
   geoDistPath_.requestedEnd = cast<vec3f>(end);
   pathfinder_->findPath(geoDistPath_);
+  geoDistCache_.emplace(key, geoDistPath_.geodesicDistance);
   return geoDistPath_.geodesicDistance;
 }
 
@@ -250,9 +320,49 @@ GreedyGeodesicFollowerImpl::findPath(const Mn::Quaternion& currentRot,
   return findPath({currentRot, currentPos}, end);
 }
 
+std::vector<std::vector<GreedyGeodesicFollowerImpl::CODES>>
+GreedyGeodesicFollowerImpl::findPaths(
+    const std::vector<core::RigidState>& starts,
+    const std::vector<Mn::Vector3>& ends) {
+  CORRADE_ASSERT(starts.size() == ends.size(),
+                 "GreedyGeodesicFollowerImpl::findPaths(): expected as many "
+                 "ends as starts",
+                 {});
+
+  std::vector<std::vector<CODES>> paths(starts.size());
+  if (!nativeMoves_) {
+    // The move functions call into python, which only one thread can do
+    for (int i = 0; i < starts.size(); ++i) {
+      reset();
+      paths[i] = findPath(starts[i], ends[i]);
+    }
+    reset();
+    return paths;
+  }
+
+#pragma omp parallel
+  {
+    // The follower keeps the state of the plan in progress, so every thread
+    // plans with its own
+    GreedyGeodesicFollowerImpl follower{
+        pathfinder_,   goalDist_,           forwardAmount_, turnAmount_,
+        fixThrashing_, thrashingThreshold_, allowSliding_};
+
+#pragma omp for schedule(dynamic)
+    for (int i = 0; i < starts.size(); ++i) {
+      follower.reset();
+      paths[i] = follower.findPath(starts[i], ends[i]);
+    }
+  }
+
+  reset();
+  return paths;
+}
+
 void GreedyGeodesicFollowerImpl::reset() {
   actions_.clear();
   thrashingActions_.clear();
+  geoDistCache_.clear();
 }
 
 }  // namespace nav
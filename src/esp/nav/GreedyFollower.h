@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <unordered_map>
+
 #include "esp/core/RigidState.h"
 #include "esp/core/esp.h"
 #include "esp/nav/PathFinder.h"
@@ -76,6 +79,25 @@ class GreedyGeodesicFollowerImpl {
                              bool fixThrashing = true,
                              int thrashingThreshold = 16);
 
+  /**
+   * @brief Constructor for a follower that moves with the default
+   * "move_forward", "turn_left" and "turn_right" actions in C++, filtered by
+   * @ref PathFinder::tryStep, instead of calling back into python
+   *
+   * @param[in] allowSliding Whether steps are filtered with @ref
+   *                         PathFinder::tryStep or @ref
+   *                         PathFinder::tryStepNoSliding
+   *
+   * See the other constructor for the other parameters.
+   */
+  GreedyGeodesicFollowerImpl(PathFinder::ptr& pathfinder,
+                             double goalDist,
+                             double forwardAmount,
+                             double turnAmount,
+                             bool fixThrashing = true,
+                             int thrashingThreshold = 16,
+                             bool allowSliding = true);
+
   /**
    * @brief Calculates the next action to follow the path
    *
@@ -107,6 +129,19 @@ class GreedyGeodesicFollowerImpl {
   std::vector<CODES> findPath(const core::RigidState& start,
                               const Magnum::Vector3& end);
 
+  /**
+   * @brief Runs @ref findPath for every pair of starts and ends
+   *
+   * A follower that moves in C++ plans the pairs on all threads, each with its
+   * own copy of the follower.  One with move functions plans them one after
+   * the other.  The follower is reset afterwards.
+   *
+   * @return The actions of every pair, empty where @ref findPath failed
+   */
+  std::vector<std::vector<CODES>> findPaths(
+      const std::vector<core::RigidState>& starts,
+      const std::vector<Magnum::Vector3>& ends);
+
   /**
    * @brief Reset the planner.
    *
@@ -121,6 +156,9 @@ class GreedyGeodesicFollowerImpl {
   const double forwardAmount_, goalDist_, turnAmount_;
   const bool fixThrashing_;
   const int thrashingThreshold_;
+  //! Whether the moves are done in C++, see the constructor without MoveFn
+  const bool nativeMoves_ = false;
+  const bool allowSliding_ = true;
   const float closeToObsThreshold_ = 0.2f;
   const float collisionCost_ = 0.25f;
 
@@ -136,6 +174,25 @@ class GreedyGeodesicFollowerImpl {
   ShortestPath geoDistPath_;
   float geoDist(const Magnum::Vector3& start, const Magnum::Vector3& end);
 
+  // Geodesic distances to geoDistCacheEnd_ on the navmesh with id
+  // geoDistCacheNavMeshId_ by start position rounded to a tenth of a
+  // millimeter.  Planning tries the same candidate poses over and
+  // over, both within a step and from one step to the next
+  struct GeoDistKeyHash {
+    size_t operator()(const std::array<int, 3>& key) const {
+      return (static_cast<size_t>(key[0]) * 73856093) ^
+             (static_cast<size_t>(key[1]) * 19349663) ^
+             (static_cast<size_t>(key[2]) * 83492791);
+    }
+  };
+  std::unordered_map<std::array<int, 3>, float, GeoDistKeyHash> geoDistCache_;
+  Magnum::Vector3 geoDistCacheEnd_;
+  size_t geoDistCacheNavMeshId_ = 0;
+
+  // The C++ versions of the moves
+  bool nativeMoveForward(scene::SceneNode* node);
+  bool nativeTurn(scene::SceneNode* node, float angle);
+
   struct TryStepResult {
     float postGeodesicDistance, postDistanceToClosestObstacle;
     bool didCollide;
@@ -0,0 +1,168 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "esp/nav/NavMeshCache.h"
+
+#include <Corrade/Utility/Directory.h>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <type_traits>
+
+#include "esp/assets/MeshData.h"
+
+namespace Cr = Corrade;
+
+namespace esp {
+namespace nav {
+
+namespace {
+// Bump when the navmesh builder changes in a way that makes older navmeshes
+// built from the same inputs wrong
+constexpr uint32_t NAVMESH_CACHE_VERSION = 1;
+
+// 64 bit FNV-1a
+class Hasher {
+ public:
+  void add(const void* data, const size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash_ = (hash_ ^ bytes[i]) * 1099511628211ull;
+    }
+  }
+
+  template <typename T>
+  void add(const T& value) {
+    static_assert(std::is_arithmetic<T>::value,
+                  "Hasher::add: only hash arithmetic values directly");
+    add(&value, sizeof(T));
+  }
+
+  uint64_t hash() const { return hash_; }
+
+ private:
+  uint64_t hash_ = 14695981039346656037ull;
+};
+
+// Holds an exclusive lock on a file for its lifetime.  Does not lock if the
+// file can't be opened, the cache then only relies on the atomic rename
+class FileLock {
+ public:
+  explicit FileLock(const std::string& path)
+      : fd_{open(path.c_str(), O_RDWR | O_CREAT, 0666)} {
+    if (fd_ >= 0 && flock(fd_, LOCK_EX) != 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  ~FileLock() {
+    if (fd_ >= 0) {
+      flock(fd_, LOCK_UN);
+      close(fd_);
+    }
+  }
+
+  FileLock(const FileLock&) = delete;
+  FileLock& operator=(const FileLock&) = delete;
+
+ private:
+  int fd_;
+};
+}  // namespace
+
+NavMeshCache::NavMeshCache(const std::string& directory)
+    : directory_{directory} {}
+
+std::string NavMeshCache::key(const NavMeshSettings& settings,
+                              const assets::MeshData& mesh) {
+  Hasher hasher;
+  hasher.add(NAVMESH_CACHE_VERSION);
+
+  // Same members as operator==(NavMeshSettings, NavMeshSettings)
+  hasher.add(settings.cellSize);
+  hasher.add(settings.cellHeight);
+  hasher.add(settings.agentHeight);
+  hasher.add(settings.agentRadius);
+  hasher.add(settings.agentMaxClimb);
+  hasher.add(settings.agentMaxSlope);
+  hasher.add(settings.regionMinSize);
+  hasher.add(settings.regionMergeSize);
+  hasher.add(settings.edgeMaxLen);
+  hasher.add(settings.edgeMaxError);
+  hasher.add(settings.vertsPerPoly);
+  hasher.add(settings.detailSampleDist);
+  hasher.add(settings.detailSampleMaxError);
+  hasher.add(settings.filterLowHangingObstacles);
+  hasher.add(settings.filterLedgeSpans);
+  hasher.add(settings.filterWalkableLowHeightSpans);
+  hasher.add(settings.buildTiled);
+  hasher.add(settings.tileSize);
+
+  // The build only uses positions and indices
+  hasher.add(static_cast<uint64_t>(mesh.vbo.size()));
+  hasher.add(mesh.vbo.data(), mesh.vbo.size() * sizeof(vec3f));
+  hasher.add(static_cast<uint64_t>(mesh.ibo.size()));
+  hasher.add(mesh.ibo.data(), mesh.ibo.size() * sizeof(uint32_t));
+
+  std::ostringstream key;
+  key << std::hex << std::setfill('0') << std::setw(16) << hasher.hash();
+  return key.str();
+}
+
+std::string NavMeshCache::path(const std::string& key) const {
+  return Cr::Utility::Directory::join(directory_, key + ".navmesh");
+}
+
+bool NavMeshCache::build(PathFinder& pathfinder,
+                         const NavMeshSettings& settings,
+                         const assets::MeshData& mesh) {
+  const std::string cachedFile = path(key(settings, mesh));
+  // Files only ever appear complete, so hits don't need the lock
+  if (Cr::Utility::Directory::exists(cachedFile) &&
+      pathfinder.loadNavMesh(cachedFile)) {
+    LOG(INFO) << "Loaded navmesh from cache " << cachedFile;
+    return true;
+  }
+
+  if (!Cr::Utility::Directory::mkpath(directory_)) {
+    LOG(WARNING) << "NavMeshCache::build: can't create " << directory_
+                 << ", building without cache";
+    return pathfinder.build(settings, mesh);
+  }
+
+  // Only one process builds a navmesh, the others wait here and then load it.
+  // The lock file is never removed, removing it would let a process that
+  // opened it before lock a file nobody else sees anymore
+  FileLock lock{cachedFile + ".lock"};
+  if (Cr::Utility::Directory::exists(cachedFile) &&
+      pathfinder.loadNavMesh(cachedFile)) {
+    LOG(INFO) << "Loaded navmesh from cache " << cachedFile;
+    return true;
+  }
+
+  if (!pathfinder.build(settings, mesh))
+    return false;
+
+  // Written to a file of its own first, the rename is atomic.  Also takes
+  // care of a stale file that failed to load above
+  std::ostringstream tmpFile;
+  tmpFile << cachedFile << ".tmp." << getpid() << "." << std::hex
+          << std::random_device{}();
+  if (!pathfinder.saveNavMesh(tmpFile.str()) ||
+      std::rename(tmpFile.str().c_str(), cachedFile.c_str()) != 0) {
+    LOG(WARNING) << "NavMeshCache::build: failed to write " << cachedFile;
+    std::remove(tmpFile.str().c_str());
+  }
+  return true;
+}
+
+}  // namespace nav
+}  // namespace esp
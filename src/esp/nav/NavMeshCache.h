@@ -0,0 +1,65 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <string>
+
+#include "esp/core/esp.h"
+#include "esp/nav/PathFinder.h"
+
+namespace esp {
+namespace assets {
+struct MeshData;
+}
+namespace nav {
+
+/**
+ * @brief Cache of built navigation meshes on disk, keyed by a hash of the
+ * geometry and the @ref NavMeshSettings they were built from
+ *
+ * Any number of processes can share a cache directory.  Only one of them
+ * builds a missing navmesh while the others wait for it, and navmeshes are
+ * moved into place once they are completely written, so a partially written
+ * file is never loaded.
+ */
+class NavMeshCache {
+ public:
+  /**
+   * @param directory Where the navmeshes are stored, created if it does not
+   * exist yet
+   */
+  explicit NavMeshCache(const std::string& directory);
+
+  /**
+   * @brief Key of the navmesh built from @ref mesh with @ref settings.  Only
+   * the inputs of the build are hashed, not the bounds
+   */
+  static std::string key(const NavMeshSettings& settings,
+                         const assets::MeshData& mesh);
+
+  /**
+   * @brief Where the navmesh with @ref key is stored
+   */
+  std::string path(const std::string& key) const;
+
+  /**
+   * @brief Loads the navmesh built from @ref mesh with @ref settings into
+   * @ref pathfinder if it is cached, otherwise builds and caches it
+   *
+   * @return Whether or not @ref pathfinder has a navmesh now.  Failing to
+   * write the cache is not an error.
+   */
+  bool build(PathFinder& pathfinder,
+             const NavMeshSettings& settings,
+             const assets::MeshData& mesh);
+
+ private:
+  std::string directory_;
+
+  ESP_SMART_POINTERS(NavMeshCache)
+};
+
+}  // namespace nav
+}  // namespace esp
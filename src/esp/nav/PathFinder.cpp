@@ -3,7 +3,15 @@
 // LICENSE file in the root directory of this source tree.
 
 #include "PathFinder.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
 #include <numeric>
+#include <queue>
 #include <stack>
 #include <unordered_map>
 
@@ -15,6 +23,11 @@
 
 #include <Corrade/Containers/Optional.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <cstdio>
 #define _USE_MATH_DEFINES
 #include <cmath>
@@ -22,7 +35,9 @@
 
 #include "esp/assets/MeshData.h"
 #include "esp/core/esp.h"
+#include "esp/core/random.h"
 
+#include "DetourCommon.h"
 #include "DetourNavMesh.h"
 #include "DetourNavMeshBuilder.h"
 #include "DetourNavMeshQuery.h"
@@ -35,14 +50,67 @@ namespace Cr = Corrade;
 namespace esp {
 namespace nav {
 
+bool operator==(const NavMeshSettings& a, const NavMeshSettings& b) {
+  // navMeshBMin and navMeshBMax are not used when building
+  return a.cellSize == b.cellSize && a.cellHeight == b.cellHeight &&
+         a.agentHeight == b.agentHeight && a.agentRadius == b.agentRadius &&
+         a.agentMaxClimb == b.agentMaxClimb &&
+         a.agentMaxSlope == b.agentMaxSlope &&
+         a.regionMinSize == b.regionMinSize &&
+         a.regionMergeSize == b.regionMergeSize &&
+         a.edgeMaxLen == b.edgeMaxLen && a.edgeMaxError == b.edgeMaxError &&
+         a.vertsPerPoly == b.vertsPerPoly &&
+         a.detailSampleDist == b.detailSampleDist &&
+         a.detailSampleMaxError == b.detailSampleMaxError &&
+         a.filterLowHangingObstacles == b.filterLowHangingObstacles &&
+         a.filterLedgeSpans == b.filterLedgeSpans &&
+         a.filterWalkableLowHeightSpans == b.filterWalkableLowHeightSpans &&
+         a.buildTiled == b.buildTiled && a.tileSize == b.tileSize;
+}
+
+bool operator!=(const NavMeshSettings& a, const NavMeshSettings& b) {
+  return !(a == b);
+}
+
+struct GeodesicDistanceField::Impl {
+  std::vector<vec3f> goals;
+
+  //! Id of the navmesh the field was built on
+  size_t navMeshId = 0;
+
+  // The field is stored on the goals (nodes [0, goals.size())) and the
+  // vertices of the navmesh.  Every node knows its distance to the closest
+  // goal and the node it has a straight line of sight to along its shortest
+  // path (any-angle parent), which is itself for goals.
+  std::vector<vec3f> nodePos;
+  std::vector<float> nodeDist;
+  std::vector<uint32_t> nodeParent;
+
+  //! The polys a node belongs to are nodePolys[nodePolyStart[i],
+  //! nodePolyStart[i + 1])
+  std::vector<uint32_t> nodePolyStart;
+  std::vector<dtPolyRef> nodePolys;
+
+  //! Maps [tile index][vertex index] to a node
+  std::vector<std::vector<uint32_t>> tileVertNodes;
+  //! Goal nodes inside each poly that contains a goal
+  std::unordered_map<dtPolyRef, std::vector<uint32_t>> polyGoalNodes;
+};
+
+GeodesicDistanceField::GeodesicDistanceField()
+    : pimpl_{spimpl::make_unique_impl<Impl>()} {};
+
+const std::vector<vec3f>& GeodesicDistanceField::getGoals() const {
+  return pimpl_->goals;
+}
+
 struct MultiGoalShortestPath::Impl {
   std::vector<vec3f> requestedEnds;
 
   std::vector<dtPolyRef> endRefs;
   std::vector<vec3f> pathEnds;
 
-  std::vector<float> minTheoreticalDist;
-  vec3f prevRequestedStart = vec3f::Zero();
+  GeodesicDistanceField::ptr distanceField = nullptr;
 };
 
 MultiGoalShortestPath::MultiGoalShortestPath()
@@ -53,15 +121,28 @@ void MultiGoalShortestPath::setRequestedEnds(
   pimpl_->endRefs.clear();
   pimpl_->pathEnds.clear();
   pimpl_->requestedEnds = newEnds;
-
-  pimpl_->minTheoreticalDist.assign(newEnds.size(), 0);
+  pimpl_->distanceField = nullptr;
 }
 
 const std::vector<vec3f>& MultiGoalShortestPath::getRequestedEnds() const {
   return pimpl_->requestedEnds;
 }
 
+void MultiGoalShortestPath::setDistanceField(
+    const GeodesicDistanceField::ptr& field) {
+  setRequestedEnds(field->getGoals());
+  pimpl_->distanceField = field;
+}
+
+const GeodesicDistanceField::ptr& MultiGoalShortestPath::getDistanceField()
+    const {
+  return pimpl_->distanceField;
+}
+
 namespace {
+// Marks the absence of a node in the graphs searched over the navmesh
+constexpr uint32_t INVALID_NODE = std::numeric_limits<uint32_t>::max();
+
 template <typename T>
 std::tuple<dtStatus, dtPolyRef, vec3f> projectToPoly(
     const T& pt,
@@ -88,84 +169,272 @@ std::tuple<dtStatus, dtPolyRef, vec3f> projectToPoly(
 
 namespace impl {
 
+constexpr uint32_t NO_ISLAND = std::numeric_limits<uint32_t>::max();
+
+// Search nodes of every navmesh query, which also bounds the number of polys
+// a single Detour path search can return
+constexpr int NAV_QUERY_MAX_NODES = 2048;
+
 // Runs connected component analysis on the navmesh to figure out which polygons
 // are connected This gives O(1) lookup for if a path between two polygons
 // exists or not
 // Takes O(npolys) to construct
+//
+// The island of every polygon is stored in a flat array per tile that is
+// indexed by the index of the polygon within its tile, so a lookup is a
+// decode of the poly ref and two array reads
 class IslandSystem {
  public:
-  IslandSystem(const dtNavMesh* navMesh, const dtQueryFilter* filter) {
+  IslandSystem(const dtNavMesh* navMesh, const dtQueryFilter* filter)
+      : navMesh_{navMesh} {
+    resizeTiles();
     std::vector<vec3f> islandVerts;
 
     // Iterate over all tiles
     for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
       const dtMeshTile* tile = navMesh->getTile(iTile);
-      if (!tile)
+      if (!tile || !tile->header)
         continue;
 
       // Iterate over all polygons in a tile
       for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
         // Get the polygon reference from the tile and polygon id
-        dtPolyRef startRef = navMesh->encodePolyId(iTile, tile->salt, jPoly);
+        dtPolyRef startRef = navMesh->encodePolyId(tile->salt, iTile, jPoly);
 
         // If the polygon ref is valid, and we haven't seen it yet,
         // start connected component analysis from this polygon
         if (navMesh->isValidPolyRef(startRef) &&
-            (polyToIsland_.find(startRef) == polyToIsland_.end())) {
-          uint32_t newIslandId = islandRadius_.size();
-          expandFrom(navMesh, filter, newIslandId, startRef, islandVerts);
-
-          // The radius is calculated as the max deviation from the mean for all
-          // points in the island
-          vec3f centroid = vec3f::Zero();
-          for (auto& v : islandVerts) {
-            centroid += v;
-          }
-          centroid /= islandVerts.size();
+            tileIslands_[iTile][jPoly] == NO_ISLAND) {
+          addIsland(filter, startRef, islandVerts);
+        }
+      }
+    }
+  }
 
-          float maxRadius = 0.0;
-          for (auto& v : islandVerts) {
-            maxRadius = std::max(maxRadius, (v - centroid).norm());
-          }
+  // Reads islands stored by serialize for the same navmesh.  read fills the
+  // given buffer and returns false if there is not enough data left.
+  // Returns nullptr if the stored islands do not match the navmesh
+  static std::unique_ptr<IslandSystem> deserialize(
+      const dtNavMesh* navMesh,
+      const std::function<bool(void*, size_t)>& read) {
+    std::unique_ptr<IslandSystem> islands{new IslandSystem{navMesh}};
+    islands->resizeTiles();
+
+    IslandsHeader header;
+    if (!read(&header, sizeof(header)) || header.magic != ISLANDS_MAGIC ||
+        header.numTiles != islands->numTiles())
+      return nullptr;
+
+    islands->islandRadius_.resize(header.numIslands);
+    if (!read(islands->islandRadius_.data(),
+              header.numIslands * sizeof(float)))
+      return nullptr;
+
+    for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+      std::vector<uint32_t>& polyIslands = islands->tileIslands_[iTile];
+      if (polyIslands.empty())
+        continue;
+      if (!read(polyIslands.data(), polyIslands.size() * sizeof(uint32_t)))
+        return nullptr;
+      for (const uint32_t islandId : polyIslands) {
+        if (islandId != NO_ISLAND && islandId >= header.numIslands)
+          return nullptr;
+      }
+    }
+
+    // Islands that were freed by update are not used by any polygon
+    std::vector<bool> isUsed(header.numIslands, false);
+    for (const std::vector<uint32_t>& polyIslands : islands->tileIslands_) {
+      for (const uint32_t islandId : polyIslands) {
+        if (islandId != NO_ISLAND)
+          isUsed[islandId] = true;
+      }
+    }
+    for (uint32_t islandId = 0; islandId < header.numIslands; ++islandId) {
+      if (!isUsed[islandId])
+        islands->freeIslandIds_.emplace_back(islandId);
+    }
+
+    return islands;
+  }
+
+  // Writes the islands in the format read by deserialize
+  void serialize(FILE* fp) const {
+    IslandsHeader header;
+    header.magic = ISLANDS_MAGIC;
+    header.numIslands = islandRadius_.size();
+    header.numTiles = numTiles();
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(islandRadius_.data(), sizeof(float), islandRadius_.size(), fp);
+    for (const std::vector<uint32_t>& polyIslands : tileIslands_) {
+      fwrite(polyIslands.data(), sizeof(uint32_t), polyIslands.size(), fp);
+    }
+  }
+
+  // Recomputes the islands after the polys in removedPolys were taken out of
+  // the navmesh and the ones in addedPolys were added.  Only the islands that
+  // touch the changed polys are expanded again, all others are kept
+  void update(const dtQueryFilter* filter,
+              const std::vector<dtPolyRef>& removedPolys,
+              const std::vector<dtPolyRef>& addedPolys) {
+    std::vector<bool> isAffected(islandRadius_.size(), false);
+    for (const dtPolyRef ref : removedPolys) {
+      const uint32_t islandId = getIsland(ref);
+      if (islandId != NO_ISLAND)
+        isAffected[islandId] = true;
+    }
+    // New polys may join islands that were separate before
+    for (const dtPolyRef ref : addedPolys) {
+      const dtMeshTile* tile = 0;
+      const dtPoly* poly = 0;
+      navMesh_->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+      for (unsigned int iLink = poly->firstLink; iLink != DT_NULL_LINK;
+           iLink = tile->links[iLink].next) {
+        const uint32_t islandId = getIsland(tile->links[iLink].ref);
+        if (islandId != NO_ISLAND)
+          isAffected[islandId] = true;
+      }
+    }
+
+    // The tiles of the changed polys start out without any islands
+    resizeTiles();
 
-          islandRadius_.emplace_back(maxRadius);
+    // Forget about the affected islands, any of their polys that are still
+    // part of the navmesh are expanded from again together with the new ones
+    std::vector<dtPolyRef> startRefs = addedPolys;
+    for (int iTile = 0; iTile < navMesh_->getMaxTiles(); ++iTile) {
+      std::vector<uint32_t>& polyIslands = tileIslands_[iTile];
+      for (int jPoly = 0; jPoly < polyIslands.size(); ++jPoly) {
+        if (polyIslands[jPoly] != NO_ISLAND && isAffected[polyIslands[jPoly]]) {
+          polyIslands[jPoly] = NO_ISLAND;
+          startRefs.emplace_back(
+              navMesh_->encodePolyId(tileSalts_[iTile], iTile, jPoly));
         }
       }
     }
+    for (uint32_t islandId = 0; islandId < isAffected.size(); ++islandId) {
+      if (isAffected[islandId]) {
+        islandRadius_[islandId] = 0.0;
+        freeIslandIds_.emplace_back(islandId);
+      }
+    }
+
+    std::vector<vec3f> islandVerts;
+    for (const dtPolyRef startRef : startRefs) {
+      if (getIsland(startRef) == NO_ISLAND)
+        addIsland(filter, startRef, islandVerts);
+    }
   }
 
   inline bool hasConnection(dtPolyRef startRef, dtPolyRef endRef) const {
     // If both polygons are on the same island, there must be a path between
     // them
-    auto itStart = polyToIsland_.find(startRef);
-    if (itStart == polyToIsland_.end())
-      return false;
-
-    auto itEnd = polyToIsland_.find(endRef);
-    if (itEnd == polyToIsland_.end())
+    const uint32_t startIsland = getIsland(startRef);
+    if (startIsland == NO_ISLAND)
       return false;
 
-    return itStart->second == itEnd->second;
+    return startIsland == getIsland(endRef);
   }
 
+  // Id of the island ref is on, NO_ISLAND if it is not part of any
+  inline uint32_t islandId(dtPolyRef ref) const { return getIsland(ref); }
+
   inline float islandRadius(dtPolyRef ref) const {
-    auto itRef = polyToIsland_.find(ref);
-    if (itRef == polyToIsland_.end())
+    const uint32_t islandId = getIsland(ref);
+    if (islandId == NO_ISLAND)
       return 0.0;
 
-    return islandRadius_[itRef->second];
+    return islandRadius_[islandId];
   }
 
  private:
-  std::unordered_map<dtPolyRef, uint32_t> polyToIsland_;
+  static const int ISLANDS_MAGIC = 'I' << 24 | 'S' << 16 | 'L' << 8 | 'D';
+
+  struct IslandsHeader {
+    int magic;
+    uint32_t numIslands;
+    int numTiles;
+  };
+
+  explicit IslandSystem(const dtNavMesh* navMesh) : navMesh_{navMesh} {}
+
+  const dtNavMesh* navMesh_;
+  // Island of every polygon of every tile, indexed by tile and then polygon
+  std::vector<std::vector<uint32_t>> tileIslands_;
+  // Salt of the tile the islands in tileIslands_ were computed for, polys of
+  // tiles that were replaced since then do not belong to any island
+  std::vector<unsigned int> tileSalts_;
   std::vector<float> islandRadius_;
+  // Ids of islands that were removed by update and can be reused
+  std::vector<uint32_t> freeIslandIds_;
 
-  void expandFrom(const dtNavMesh* navMesh,
-                  const dtQueryFilter* filter,
+  inline uint32_t getIsland(dtPolyRef ref) const {
+    unsigned int salt, iTile, jPoly;
+    navMesh_->decodePolyId(ref, salt, iTile, jPoly);
+    if (iTile >= tileIslands_.size() || tileSalts_[iTile] != salt ||
+        jPoly >= tileIslands_[iTile].size())
+      return NO_ISLAND;
+
+    return tileIslands_[iTile][jPoly];
+  }
+
+  int numTiles() const {
+    return std::count_if(
+        tileIslands_.begin(), tileIslands_.end(),
+        [](const std::vector<uint32_t>& polys) { return !polys.empty(); });
+  }
+
+  // Makes the per tile arrays match the tiles of the navmesh.  Tiles that
+  // are new or were replaced start out without any islands
+  void resizeTiles() {
+    tileIslands_.resize(navMesh_->getMaxTiles());
+    tileSalts_.resize(navMesh_->getMaxTiles(), 0);
+    for (int iTile = 0; iTile < navMesh_->getMaxTiles(); ++iTile) {
+      const dtMeshTile* tile = navMesh_->getTile(iTile);
+      if (!tile || !tile->header) {
+        tileIslands_[iTile].clear();
+      } else if (tileSalts_[iTile] != tile->salt ||
+                 tileIslands_[iTile].size() != tile->header->polyCount) {
+        tileSalts_[iTile] = tile->salt;
+        tileIslands_[iTile].assign(tile->header->polyCount, NO_ISLAND);
+      }
+    }
+  }
+
+  void addIsland(const dtQueryFilter* filter,
+                 const dtPolyRef startRef,
+                 std::vector<vec3f>& islandVerts) {
+    uint32_t newIslandId;
+    if (!freeIslandIds_.empty()) {
+      newIslandId = freeIslandIds_.back();
+      freeIslandIds_.pop_back();
+    } else {
+      newIslandId = islandRadius_.size();
+      islandRadius_.emplace_back(0.0);
+    }
+    expandFrom(filter, newIslandId, startRef, islandVerts);
+
+    // The radius is calculated as the max deviation from the mean for all
+    // points in the island
+    vec3f centroid = vec3f::Zero();
+    for (auto& v : islandVerts) {
+      centroid += v;
+    }
+    centroid /= islandVerts.size();
+
+    float maxRadius = 0.0;
+    for (auto& v : islandVerts) {
+      maxRadius = std::max(maxRadius, (v - centroid).norm());
+    }
+
+    islandRadius_[newIslandId] = maxRadius;
+  }
+
+  void expandFrom(const dtQueryFilter* filter,
                   const uint32_t newIslandId,
                   const dtPolyRef& startRef,
                   std::vector<vec3f>& islandVerts) {
-    polyToIsland_.emplace(startRef, newIslandId);
+    setIsland(startRef, newIslandId);
     islandVerts.clear();
 
     // Force std::stack to be implemented via an std::vector as linked
@@ -180,7 +449,7 @@ class IslandSystem {
 
       const dtMeshTile* tile = 0;
       const dtPoly* poly = 0;
-      navMesh->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+      navMesh_->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
 
       for (int iVert = 0; iVert < poly->vertCount; ++iVert) {
         islandVerts.emplace_back(
@@ -192,200 +461,1611 @@ class IslandSystem {
            iLink = tile->links[iLink].next) {
         dtPolyRef neighbourRef = tile->links[iLink].ref;
         // If we've already visited this poly, skip it!
-        if (polyToIsland_.find(neighbourRef) != polyToIsland_.end())
+        if (getIsland(neighbourRef) != NO_ISLAND)
           continue;
 
         const dtMeshTile* neighbourTile = 0;
         const dtPoly* neighbourPoly = 0;
-        navMesh->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile,
-                                           &neighbourPoly);
+        navMesh_->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile,
+                                            &neighbourPoly);
 
         // If a neighbour isn't walkable, don't add it
         if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
           continue;
 
-        polyToIsland_.emplace(neighbourRef, newIslandId);
+        setIsland(neighbourRef, newIslandId);
         stack.push(neighbourRef);
       }
     }
   }
-};
-}  // namespace impl
 
-struct PathFinder::Impl {
-  Impl();
-  ~Impl() = default;
+  inline void setIsland(dtPolyRef ref, uint32_t islandId) {
+    unsigned int salt, iTile, jPoly;
+    navMesh_->decodePolyId(ref, salt, iTile, jPoly);
+    tileIslands_[iTile][jPoly] = islandId;
+  }
+};
 
-  bool build(const NavMeshSettings& bs,
-             const float* verts,
-             const int nverts,
-             const int* tris,
-             const int ntris,
-             const float* bmin,
-             const float* bmax);
-  bool build(const NavMeshSettings& bs, const esp::assets::MeshData& mesh);
+// How close to another island a polygon has to come to be a border, see
+// IslandBorders
+constexpr float ISLAND_BORDER_RADIUS = 1.0f;
 
-  vec3f getRandomNavigablePoint();
+// Flags the polygons that come within ISLAND_BORDER_RADIUS of a polygon of
+// another island,
+// or are not on any island themselves.  Only from those can the nearest
+// polygon to a point be on another island than the polygon the point was
+// reached on, so steps that end elsewhere need no nearest polygon search
+class IslandBorders {
+ public:
+  IslandBorders(const dtNavMesh* navMesh,
+                const dtNavMeshQuery* navQuery,
+                const dtQueryFilter* filter,
+                const IslandSystem& islands)
+      : navMesh_{navMesh} {
+    constexpr int maxPolys = 256;
+    dtPolyRef nearbyPolys[maxPolys];
+    tileFlags_.resize(navMesh->getMaxTiles());
+    tileSalts_.resize(navMesh->getMaxTiles(), 0);
+    for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+      const dtMeshTile* tile = navMesh->getTile(iTile);
+      if (!tile || !tile->header)
+        continue;
 
-  bool findPath(ShortestPath& path);
-  bool findPath(MultiGoalShortestPath& path);
+      tileSalts_[iTile] = tile->salt;
+      std::vector<bool>& flags = tileFlags_[iTile];
+      flags.assign(tile->header->polyCount, true);
+      const dtPolyRef base = navMesh->getPolyRefBase(tile);
+      for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+        const dtPoly* poly = &tile->polys[jPoly];
+        if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+          continue;
+        const dtPolyRef ref = base | static_cast<dtPolyRef>(jPoly);
+        const uint32_t islandId = islands.islandId(ref);
+        if (islandId == NO_ISLAND)
+          continue;
 
-  template <typename T>
-  T tryStep(const T& start, const T& end, bool allowSliding);
+        // The nearest polygon search measures to the detail mesh, which can
+        // be above or below the polygon itself
+        vec3f bmin{tile->verts + poly->verts[0] * 3};
+        vec3f bmax = bmin;
+        for (int kVert = 1; kVert < poly->vertCount; ++kVert) {
+          const vec3f v{tile->verts + poly->verts[kVert] * 3};
+          bmin = bmin.cwiseMin(v);
+          bmax = bmax.cwiseMax(v);
+        }
+        if (tile->detailMeshes) {
+          const dtPolyDetail& pd = tile->detailMeshes[jPoly];
+          for (int kVert = 0; kVert < pd.vertCount; ++kVert) {
+            const vec3f v{tile->detailVerts + (pd.vertBase + kVert) * 3};
+            bmin = bmin.cwiseMin(v);
+            bmax = bmax.cwiseMax(v);
+          }
+        }
+        const vec3f center = 0.5f * (bmin + bmax);
+        const vec3f halfExtents =
+            (0.5f * (bmax - bmin)).array() + ISLAND_BORDER_RADIUS;
+
+        int numPolys = 0;
+        navQuery->queryPolygons(center.data(), halfExtents.data(), filter,
+                                nearbyPolys, &numPolys, maxPolys);
+        // Too many to tell, so assume the worst
+        bool isBorder = numPolys == maxPolys;
+        for (int kPoly = 0; kPoly < numPolys && !isBorder; ++kPoly) {
+          isBorder = islands.islandId(nearbyPolys[kPoly]) != islandId;
+        }
+        flags[jPoly] = isBorder;
+      }
+    }
+  }
 
-  template <typename T>
-  T snapPoint(const T& pt);
+  // Polygons of tiles replaced since this was built count as borders
+  bool isBorder(dtPolyRef ref) const {
+    unsigned int salt, iTile, jPoly;
+    navMesh_->decodePolyId(ref, salt, iTile, jPoly);
+    if (iTile >= tileFlags_.size() || tileSalts_[iTile] != salt ||
+        jPoly >= tileFlags_[iTile].size())
+      return true;
 
-  bool loadNavMesh(const std::string& path);
+    return tileFlags_[iTile][jPoly];
+  }
 
-  bool saveNavMesh(const std::string& path);
+ private:
+  const dtNavMesh* navMesh_;
+  std::vector<std::vector<bool>> tileFlags_;
+  std::vector<unsigned int> tileSalts_;
+};
 
-  bool isLoaded() const { return navMesh_ != nullptr; };
+// Pool of navmesh queries that share a single navmesh.
+// dtNavMeshQuery is not thread-safe as every query mutates its node pool, so
+// each caller borrows a query for the duration of the call and hands it back
+// when done.  The pool grows to the number of concurrent callers and then
+// stays there, so single-threaded use only ever allocates one query
+class NavQueryPool {
+ public:
+  struct NavQueryDeleter {
+    void operator()(dtNavMeshQuery* query) { dtFreeNavMeshQuery(query); }
+  };
+  typedef std::unique_ptr<dtNavMeshQuery, NavQueryDeleter> NavQueryPtr;
+
+  // RAII wrapper returning the borrowed query to the pool on destruction
+  class Handle {
+   public:
+    Handle(NavQueryPool* pool, NavQueryPtr query)
+        : pool_{pool}, query_{std::move(query)} {}
+    Handle(Handle&&) = default;
+    Handle& operator=(Handle&&) = default;
+    ~Handle() {
+      if (query_)
+        pool_->release(std::move(query_));
+    }
 
-  void seed(uint32_t newSeed);
+    dtNavMeshQuery* get() const { return query_.get(); }
+    dtNavMeshQuery* operator->() const { return query_.get(); }
+    explicit operator bool() const { return query_ != nullptr; }
 
-  float islandRadius(const vec3f& pt) const;
+   private:
+    NavQueryPool* pool_;
+    NavQueryPtr query_;
+  };
 
-  float distanceToClosestObstacle(const vec3f& pt,
-                                  const float maxSearchRadius = 2.0) const;
-  HitRecord closestObstacleSurfacePoint(
-      const vec3f& pt,
-      const float maxSearchRadius = 2.0) const;
+  NavQueryPool(const dtNavMesh* navMesh, const int maxNodes)
+      : navMesh_{navMesh}, maxNodes_{maxNodes} {}
+
+  // Returns an empty handle if a new query could not be initialized
+  Handle acquire() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!queries_.empty()) {
+        NavQueryPtr query = std::move(queries_.back());
+        queries_.pop_back();
+        return {this, std::move(query)};
+      }
+    }
 
-  bool isNavigable(const vec3f& pt, const float maxYDelta = 0.5) const;
+    NavQueryPtr query{dtAllocNavMeshQuery()};
+    if (!query || dtStatusFailed(query->init(navMesh_, maxNodes_))) {
+      LOG(ERROR) << "Could not init Detour navmesh query";
+      return {this, nullptr};
+    }
+    return {this, std::move(query)};
+  }
 
-  std::pair<vec3f, vec3f> bounds() const { return bounds_; };
+ private:
+  void release(NavQueryPtr query) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queries_.emplace_back(std::move(query));
+  }
 
-  Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic> getTopDownView(
-      const float pixelsPerMeter,
-      const float height);
+  const dtNavMesh* navMesh_;
+  const int maxNodes_;
+  std::mutex mutex_;
+  std::vector<NavQueryPtr> queries_;
+};
 
-  const assets::MeshData::ptr getNavMeshData();
+// Distance from the navmesh to the closest wall, sampled on a regular grid
+// over the xz bounds of every poly and bilinearly interpolated in between.
+// The distance to the walls changes by at most 1m per 1m moved in xz, so with
+// a spacing of tolerance / sqrt(2) no sample used for a point is further away
+// than tolerance and neither is the interpolated distance
+class ObstacleDistanceField {
+ public:
+  ObstacleDistanceField(const dtNavMesh* navMesh,
+                        NavQueryPool* navQueryPool,
+                        const dtQueryFilter* filter,
+                        const float tolerance,
+                        const float maxSearchRadius)
+      : ObstacleDistanceField{navMesh, tolerance, maxSearchRadius} {
+    // Lay out the samples of every poly first, then fill all of them in
+    // parallel
+    std::vector<dtPolyRef> refs;
+    std::vector<const PolyGrid*> grids;
+    for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+      const dtMeshTile* tile = navMesh->getTile(iTile);
+      if (!tile || !tile->header)
+        continue;
+      tileSalts_[iTile] = tile->salt;
+      std::vector<PolyGrid>& polyGrids = tileGrids_[iTile];
+      polyGrids.resize(tile->header->polyCount);
 
- private:
-  struct NavMeshDeleter {
-    void operator()(dtNavMesh* mesh) { dtFreeNavMesh(mesh); }
-  };
-  struct NavQueryDeleter {
-    void operator()(dtNavMeshQuery* query) { dtFreeNavMeshQuery(query); }
-  };
+      uint32_t numSamples = 0;
+      for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+        const dtPolyRef ref = navMesh->encodePolyId(tile->salt, iTile, jPoly);
+        const dtPoly* poly = &tile->polys[jPoly];
+        PolyGrid& grid = polyGrids[jPoly];
+        grid.offset = numSamples;
+        if (poly->getType() != DT_POLYTYPE_GROUND ||
+            !filter->passFilter(ref, tile, poly))
+          continue;
 
-  std::unique_ptr<dtNavMesh, NavMeshDeleter> navMesh_ = nullptr;
-  std::unique_ptr<dtNavMeshQuery, NavQueryDeleter> navQuery_ = nullptr;
-  std::unique_ptr<dtQueryFilter> filter_ = nullptr;
-  std::unique_ptr<impl::IslandSystem> islandSystem_ = nullptr;
+        Eigen::Vector2f bmin = Eigen::Vector2f::Constant(
+            std::numeric_limits<float>::infinity());
+        Eigen::Vector2f bmax = -bmin;
+        for (int iVert = 0; iVert < poly->vertCount; ++iVert) {
+          const float* v = &tile->verts[poly->verts[iVert] * 3];
+          bmin = bmin.cwiseMin(Eigen::Vector2f(v[0], v[2]));
+          bmax = bmax.cwiseMax(Eigen::Vector2f(v[0], v[2]));
+        }
+        grid.minX = bmin[0];
+        grid.minZ = bmin[1];
+        grid.nx = std::max(
+            static_cast<int>(std::ceil((bmax[0] - bmin[0]) / spacing_)) + 1,
+            2);
+        grid.nz = std::max(
+            static_cast<int>(std::ceil((bmax[1] - bmin[1]) / spacing_)) + 1,
+            2);
+        numSamples += grid.nx * grid.nz;
+
+        refs.emplace_back(ref);
+        grids.emplace_back(&grid);
+      }
+      tileDistances_[iTile].resize(numSamples);
+    }
 
-  //! Holds triangulated geom/topo. Generated when queried. Reset with
-  //! navQuery_.
-  assets::MeshData::ptr meshData_ = nullptr;
+    const int numPolys = refs.size();
+#pragma omp parallel
+    {
+      NavQueryPool::Handle navQuery = navQueryPool->acquire();
 
-  std::pair<vec3f, vec3f> bounds_;
+#pragma omp for schedule(dynamic, 16)
+      for (int i = 0; i < numPolys; ++i) {
+        if (!navQuery)
+          continue;
 
-  void removeZeroAreaPolys();
-  bool initNavQuery();
+        unsigned int salt, iTile, jPoly;
+        navMesh->decodePolyId(refs[i], salt, iTile, jPoly);
+        const PolyGrid& grid = *grids[i];
+        float* distances = &tileDistances_[iTile][grid.offset];
+        vec3f pt, hitPos, hitNormal;
+        for (int z = 0; z < grid.nz; ++z) {
+          for (int x = 0; x < grid.nx; ++x) {
+            // The height of the sample does not matter, walls are found in xz
+            pt << grid.minX + x * spacing_, 0, grid.minZ + z * spacing_;
+            navQuery->findDistanceToWall(refs[i], pt.data(), maxSearchRadius_,
+                                         filter, &distances[z * grid.nx + x],
+                                         hitPos.data(), hitNormal.data());
+          }
+        }
+      }
+    }
+  }
 
-  Cr::Containers::Optional<std::tuple<float, std::vector<vec3f>>>
-  findPathInternal(const vec3f& start,
-                   dtPolyRef startRef,
-                   const vec3f& pathStart,
-                   const vec3f& end,
-                   dtPolyRef endRef,
-                   const vec3f& pathEnd);
+  // Reads a field stored by serialize for the same navmesh, see
+  // IslandSystem::deserialize.  Also returns nullptr if no field was stored
+  static std::unique_ptr<ObstacleDistanceField> deserialize(
+      const dtNavMesh* navMesh,
+      const std::function<bool(void*, size_t)>& read) {
+    FieldHeader header;
+    if (!read(&header, sizeof(header)) || header.magic != FIELD_MAGIC ||
+        header.tolerance <= 0)
+      return nullptr;
+
+    std::unique_ptr<ObstacleDistanceField> field{new ObstacleDistanceField{
+        navMesh, header.tolerance, header.maxSearchRadius}};
+    int numTiles = 0;
+    for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+      const dtMeshTile* tile = navMesh->getTile(iTile);
+      if (!tile || !tile->header || tile->header->polyCount == 0)
+        continue;
+      ++numTiles;
+      field->tileSalts_[iTile] = tile->salt;
+      std::vector<PolyGrid>& polyGrids = field->tileGrids_[iTile];
+      polyGrids.resize(tile->header->polyCount);
+      if (!read(polyGrids.data(), polyGrids.size() * sizeof(PolyGrid)))
+        return nullptr;
+
+      uint32_t numSamples = 0;
+      for (const PolyGrid& grid : polyGrids) {
+        if (grid.offset != numSamples)
+          return nullptr;
+        numSamples += grid.nx * grid.nz;
+      }
+      std::vector<float>& distances = field->tileDistances_[iTile];
+      distances.resize(numSamples);
+      if (!read(distances.data(), numSamples * sizeof(float)))
+        return nullptr;
+    }
+    if (numTiles != header.numTiles)
+      return nullptr;
 
-  bool findPathSetup(MultiGoalShortestPath& path,
-                     dtPolyRef& startRef,
-                     vec3f& pathStart);
-};
+    return field;
+  }
 
-namespace {
-struct Workspace {
-  rcHeightfield* solid = 0;
-  unsigned char* triareas = 0;
-  rcCompactHeightfield* chf = 0;
-  rcContourSet* cset = 0;
-  rcPolyMesh* pmesh = 0;
-  rcPolyMeshDetail* dmesh = 0;
+  // Writes the field in the format read by deserialize.  A null field is
+  // written as an empty header
+  static void serialize(const ObstacleDistanceField* field, FILE* fp) {
+    FieldHeader header;
+    header.magic = FIELD_MAGIC;
+    header.numTiles = 0;
+    header.tolerance = 0;
+    header.maxSearchRadius = 0;
+    if (field) {
+      header.tolerance = field->tolerance_;
+      header.maxSearchRadius = field->maxSearchRadius_;
+      header.numTiles = std::count_if(
+          field->tileGrids_.begin(), field->tileGrids_.end(),
+          [](const std::vector<PolyGrid>& polys) { return !polys.empty(); });
+    }
+    fwrite(&header, sizeof(header), 1, fp);
+    if (!field)
+      return;
+
+    for (int iTile = 0; iTile < field->tileGrids_.size(); ++iTile) {
+      const std::vector<PolyGrid>& polyGrids = field->tileGrids_[iTile];
+      fwrite(polyGrids.data(), sizeof(PolyGrid), polyGrids.size(), fp);
+      const std::vector<float>& distances = field->tileDistances_[iTile];
+      fwrite(distances.data(), sizeof(float), distances.size(), fp);
+    }
+  }
 
-  ~Workspace() {
-    rcFreeHeightField(solid);
-    delete[] triareas;
-    rcFreeCompactHeightfield(chf);
-    rcFreeContourSet(cset);
-    rcFreePolyMesh(pmesh);
-    rcFreePolyMeshDetail(dmesh);
+  float tolerance() const { return tolerance_; }
+  float maxSearchRadius() const { return maxSearchRadius_; }
+
+  // Distance to the closest wall from pt, which must be on the poly ref.  NaN
+  // if the field has no samples for ref
+  float distance(dtPolyRef ref, const vec3f& pt) const {
+    unsigned int salt, iTile, jPoly;
+    navMesh_->decodePolyId(ref, salt, iTile, jPoly);
+    if (iTile >= tileGrids_.size() || tileSalts_[iTile] != salt ||
+        jPoly >= tileGrids_[iTile].size())
+      return NAN;
+    const PolyGrid& grid = tileGrids_[iTile][jPoly];
+    if (grid.nx == 0)
+      return NAN;
+
+    const float fx = std::min(std::max((pt[0] - grid.minX) / spacing_, 0.0f),
+                              grid.nx - 1.0f);
+    const float fz = std::min(std::max((pt[2] - grid.minZ) / spacing_, 0.0f),
+                              grid.nz - 1.0f);
+    const int x = std::min(static_cast<int>(fx), grid.nx - 2);
+    const int z = std::min(static_cast<int>(fz), grid.nz - 2);
+    const float tx = fx - x;
+    const float tz = fz - z;
+
+    const float* d = &tileDistances_[iTile][grid.offset + z * grid.nx + x];
+    return (1 - tz) * ((1 - tx) * d[0] + tx * d[1]) +
+           tz * ((1 - tx) * d[grid.nx] + tx * d[grid.nx + 1]);
   }
-};
 
-enum PolyAreas { POLYAREA_GROUND, POLYAREA_DOOR };
+ private:
+  static const int FIELD_MAGIC = 'O' << 24 | 'D' << 16 | 'S' << 8 | 'T';
 
-enum PolyFlags {
-  POLYFLAGS_WALK = 0x01,      // walkable
-  POLYFLAGS_DOOR = 0x02,      // ability to move through doors
-  POLYFLAGS_DISABLED = 0x04,  // disabled polygon
-  POLYFLAGS_ALL = 0xffff      // all abilities
+  struct FieldHeader {
+    int magic;
+    int numTiles;
+    float tolerance;
+    float maxSearchRadius;
+  };
+
+  // Samples of a poly, nx by nz starting at (minX, minZ) in the distances of
+  // its tile at offset.  Polys without any samples have nx == nz == 0
+  struct PolyGrid {
+    float minX = 0, minZ = 0;
+    int nx = 0, nz = 0;
+    uint32_t offset = 0;
+  };
+
+  ObstacleDistanceField(const dtNavMesh* navMesh,
+                        const float tolerance,
+                        const float maxSearchRadius)
+      : navMesh_{navMesh},
+        tolerance_{tolerance},
+        maxSearchRadius_{maxSearchRadius},
+        spacing_{tolerance / std::sqrt(2.0f)},
+        tileGrids_(navMesh->getMaxTiles()),
+        tileDistances_(navMesh->getMaxTiles()),
+        tileSalts_(navMesh->getMaxTiles(), 0) {}
+
+  const dtNavMesh* navMesh_;
+  const float tolerance_, maxSearchRadius_, spacing_;
+  // Indexed by tile and then poly like the islands
+  std::vector<std::vector<PolyGrid>> tileGrids_;
+  std::vector<std::vector<float>> tileDistances_;
+  std::vector<unsigned int> tileSalts_;
 };
-}  // namespace
 
-PathFinder::Impl::Impl() {
-  filter_ = std::make_unique<dtQueryFilter>();
-  filter_->setIncludeFlags(POLYFLAGS_WALK);
-  filter_->setExcludeFlags(0);
+constexpr uint32_t NO_CLUSTER = std::numeric_limits<uint32_t>::max();
+
+// Middle of the part of the edge of poly that link goes through
+inline vec3f linkMidpoint(const dtMeshTile* tile,
+                          const dtPoly* poly,
+                          const dtLink& link) {
+  Eigen::Map<const vec3f> v0(&tile->verts[poly->verts[link.edge] * 3]);
+  Eigen::Map<const vec3f> v1(
+      &tile->verts[poly->verts[(link.edge + 1) % poly->vertCount] * 3]);
+  float tmin = 0, tmax = 1;
+  // Links across tile borders only cover part of the edge
+  if (link.side != 0xff) {
+    tmin = link.bmin / 255.0f;
+    tmax = link.bmax / 255.0f;
+  }
+  return v0 + 0.5f * (tmin + tmax) * (v1 - v0);
 }
 
-bool PathFinder::Impl::build(const NavMeshSettings& bs,
-                             const float* verts,
-                             const int nverts,
-                             const int* tris,
-                             const int ntris,
-                             const float* bmin,
-                             const float* bmax) {
-  Workspace ws;
-  rcContext ctx;
+// Calls f(neighborRef, linkMidpoint) for every walkable neighbor of ref
+template <typename F>
+void forEachWalkableNeighbor(const dtNavMesh* navMesh,
+                             dtPolyRef ref,
+                             const dtQueryFilter* filter,
+                             F f) {
+  const dtMeshTile* tile = nullptr;
+  const dtPoly* poly = nullptr;
+  navMesh->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+  for (unsigned int iLink = poly->firstLink; iLink != DT_NULL_LINK;
+       iLink = tile->links[iLink].next) {
+    const dtLink& link = tile->links[iLink];
+    if (!link.ref)
+      continue;
+    const dtMeshTile* neighborTile = nullptr;
+    const dtPoly* neighborPoly = nullptr;
+    navMesh->getTileAndPolyByRefUnsafe(link.ref, &neighborTile,
+                                       &neighborPoly);
+    if (neighborPoly->getType() != DT_POLYTYPE_GROUND ||
+        !filter->passFilter(link.ref, neighborTile, neighborPoly))
+      continue;
+    f(link.ref, linkMidpoint(tile, poly, link));
+  }
+}
 
-  //
-  // Step 1. Initialize build config.
-  //
+// Hierarchical abstraction of the navmesh for path queries that are too long
+// for a single A* search over the polys (HPA*).  Connected polys are grouped
+// into small clusters.  Every link between polys of two different clusters is
+// a portal, and the portals of a cluster are connected by the length of the
+// shortest path between them within the cluster.  Long queries first search
+// this much smaller graph of portals and then refine only the corridor of
+// polys along the way, one cluster at a time
+class PathHierarchy {
+ public:
+  PathHierarchy(const dtNavMesh* navMesh, const dtQueryFilter* filter)
+      : navMesh_{navMesh} {
+    buildClusters(filter);
+    buildPortals(filter);
+    connectPortals(filter);
+  }
 
-  // Init build configuration from GUI
-  rcConfig cfg;
-  memset(&cfg, 0, sizeof(cfg));
-  cfg.cs = bs.cellSize;
-  cfg.ch = bs.cellHeight;
-  cfg.walkableSlopeAngle = bs.agentMaxSlope;
-  cfg.walkableHeight = static_cast<int>(ceilf(bs.agentHeight / cfg.ch));
-  cfg.walkableClimb = static_cast<int>(floorf(bs.agentMaxClimb / cfg.ch));
-  cfg.walkableRadius = static_cast<int>(ceilf(bs.agentRadius / cfg.cs));
-  cfg.maxEdgeLen = static_cast<int>(bs.edgeMaxLen / bs.cellSize);
-  cfg.maxSimplificationError = bs.edgeMaxError;
-  cfg.minRegionArea =
-      static_cast<int>(rcSqr(bs.regionMinSize));  // Note: area = size*size
-  cfg.mergeRegionArea =
-      static_cast<int>(rcSqr(bs.regionMergeSize));  // Note: area = size*size
-  cfg.maxVertsPerPoly = static_cast<int>(bs.vertsPerPoly);
-  cfg.detailSampleDist =
-      bs.detailSampleDist < 0.9f ? 0 : bs.cellSize * bs.detailSampleDist;
-  cfg.detailSampleMaxError = bs.cellHeight * bs.detailSampleMaxError;
+  // Finds a corridor of polys from start on startRef to end on endRef.
+  // There is no limit on the length of the corridor
+  bool findCorridor(dtNavMeshQuery* navQuery,
+                    const dtQueryFilter* filter,
+                    dtPolyRef startRef,
+                    const vec3f& start,
+                    dtPolyRef endRef,
+                    const vec3f& end,
+                    std::vector<dtPolyRef>* corridor) const {
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    const PolyCluster* startCluster = getPolyCluster(startRef);
+    const PolyCluster* endCluster = getPolyCluster(endRef);
+    if (!startCluster || !endCluster)
+      return false;
+    const uint32_t sc = startCluster->cluster;
+    const uint32_t ec = endCluster->cluster;
+
+    // Distances from the end to the portals of its cluster
+    std::vector<float> dist;
+    std::vector<vec3f> pos;
+    searchCluster(ec, endRef, end, filter, &dist, &pos);
+    std::unordered_map<uint32_t, float> portalToEnd;
+    for (const uint32_t portal : clusterPortals_[ec]) {
+      const float d = distanceTo(portal, ec, dist, pos);
+      if (d < inf)
+        portalToEnd[portal] = d;
+    }
 
-  // Set the area where the navigation will be build.
-  // Here the bounds of the input mesh are used, but the
-  // area could be specified by an user defined box, etc.
-  rcVcopy(cfg.bmin, bmin);
-  rcVcopy(cfg.bmax, bmax);
-  rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
-  LOG(INFO) << "Building navmesh with " << cfg.width << "x" << cfg.height
-            << " cells";
+    // A* over the portals from start to end, which are the extra nodes
+    // startNode and endNode.  Every node remembers the node and cluster it
+    // was reached through
+    const uint32_t startNode = portals_.size();
+    const uint32_t endNode = startNode + 1;
+    std::unordered_map<uint32_t, float> nodeDist;
+    std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> nodeParent;
+    typedef std::tuple<float, float, uint32_t> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                        std::greater<QueueEntry>>
+        queue;
+    auto relax = [&](const uint32_t node, const float d, const uint32_t from,
+                     const uint32_t cluster) {
+      auto it = nodeDist.find(node);
+      if (it != nodeDist.end() && it->second <= d)
+        return;
+      nodeDist[node] = d;
+      nodeParent[node] = std::make_pair(from, cluster);
+      const float h = node == endNode ? 0 : (portals_[node].pos - end).norm();
+      queue.emplace(d + h, d, node);
+    };
+
+    searchCluster(sc, startRef, start, filter, &dist, &pos);
+    for (const uint32_t portal : clusterPortals_[sc]) {
+      const float d = distanceTo(portal, sc, dist, pos);
+      if (d < inf)
+        relax(portal, d, startNode, sc);
+    }
+    if (sc == ec) {
+      const uint32_t endIndex = endCluster->index;
+      if (dist[endIndex] < inf)
+        relax(endNode, dist[endIndex] + (pos[endIndex] - end).norm(),
+              startNode, sc);
+    }
+
+    bool foundEnd = false;
+    while (!queue.empty()) {
+      const float d = std::get<1>(queue.top());
+      const uint32_t u = std::get<2>(queue.top());
+      queue.pop();
+      if (d > nodeDist[u])
+        continue;
+      if (u == endNode) {
+        foundEnd = true;
+        break;
+      }
+
+      for (const PortalEdge& edge : portalEdges_[u]) {
+        relax(edge.to, d + edge.cost, u, edge.cluster);
+      }
+      auto toEndIt = portalToEnd.find(u);
+      if (toEndIt != portalToEnd.end())
+        relax(endNode, d + toEndIt->second, u, ec);
+    }
+    if (!foundEnd)
+      return false;
+
+    // Nodes and the clusters between them, from startNode to endNode
+    std::vector<std::pair<uint32_t, uint32_t>> route;
+    for (uint32_t node = endNode; node != startNode;
+         node = nodeParent[node].first) {
+      route.emplace_back(node, nodeParent[node].second);
+    }
+    route.emplace_back(startNode, NO_CLUSTER);
+    std::reverse(route.begin(), route.end());
+
+    // Refine every leg of the route with a search that stays within a
+    // cluster (or close to it) and stitch the polys together, cutting out any
+    // loops where the corridor comes back to a poly it already went through
+    corridor->clear();
+    std::unordered_map<dtPolyRef, size_t> corridorIndex;
+    std::vector<dtPolyRef> legPolys(NAV_QUERY_MAX_NODES);
+    for (size_t iLeg = 0; iLeg + 1 < route.size(); ++iLeg) {
+      const uint32_t from = route[iLeg].first;
+      const uint32_t to = route[iLeg + 1].first;
+      const uint32_t cluster = route[iLeg + 1].second;
+      const dtPolyRef fromRef =
+          from == startNode ? startRef : portalRef(from, cluster);
+      const vec3f& fromPos = from == startNode ? start : portals_[from].pos;
+      const dtPolyRef toRef = to == endNode ? endRef : portalRef(to, cluster);
+      const vec3f& toPos = to == endNode ? end : portals_[to].pos;
+
+      int numLegPolys = 0;
+      const dtStatus status = navQuery->findPath(
+          fromRef, toRef, fromPos.data(), toPos.data(), filter,
+          legPolys.data(), &numLegPolys, legPolys.size());
+      if (status != DT_SUCCESS || numLegPolys == 0)
+        return false;
+
+      for (int iPoly = 0; iPoly < numLegPolys; ++iPoly) {
+        const dtPolyRef ref = legPolys[iPoly];
+        auto it = corridorIndex.find(ref);
+        if (it != corridorIndex.end()) {
+          for (size_t j = it->second + 1; j < corridor->size(); ++j) {
+            corridorIndex.erase((*corridor)[j]);
+          }
+          corridor->resize(it->second + 1);
+          continue;
+        }
+        corridorIndex[ref] = corridor->size();
+        corridor->emplace_back(ref);
+      }
+    }
+
+    return !corridor->empty();
+  }
+
+ private:
+  struct PolyCluster {
+    uint32_t cluster = NO_CLUSTER;
+    // Index of the poly within its cluster
+    uint32_t index = 0;
+  };
+
+  // Link between polys refs[0] of clusters[0] and refs[1] of clusters[1]
+  struct Portal {
+    vec3f pos;
+    dtPolyRef refs[2];
+    uint32_t clusters[2];
+  };
+
+  struct PortalEdge {
+    uint32_t to;
+    // The cluster the path between the portals is in
+    uint32_t cluster;
+    float cost;
+  };
+
+  const dtNavMesh* navMesh_;
+  // Indexed by tile and then poly like the islands
+  std::vector<std::vector<PolyCluster>> tilePolyClusters_;
+  std::vector<std::vector<dtPolyRef>> clusterPolys_;
+  std::vector<std::vector<uint32_t>> clusterPortals_;
+  std::vector<Portal> portals_;
+  std::vector<std::vector<PortalEdge>> portalEdges_;
+
+  const PolyCluster* getPolyCluster(dtPolyRef ref) const {
+    unsigned int salt, iTile, jPoly;
+    navMesh_->decodePolyId(ref, salt, iTile, jPoly);
+    if (iTile >= tilePolyClusters_.size() ||
+        jPoly >= tilePolyClusters_[iTile].size() ||
+        tilePolyClusters_[iTile][jPoly].cluster == NO_CLUSTER)
+      return nullptr;
+    return &tilePolyClusters_[iTile][jPoly];
+  }
+
+  dtPolyRef portalRef(uint32_t portal, uint32_t cluster) const {
+    const Portal& p = portals_[portal];
+    return p.clusters[0] == cluster ? p.refs[0] : p.refs[1];
+  }
+
+  template <typename F>
+  void forEachNeighbor(dtPolyRef ref,
+                       const dtQueryFilter* filter,
+                       F f) const {
+    forEachWalkableNeighbor(navMesh_, ref, filter, f);
+  }
+
+  // Dijkstra from `from` on fromRef over the polys of cluster, moving between
+  // polys through the middle of their shared edges like Detour's A*.  Fills
+  // the distance to and the position in every poly of the cluster
+  void searchCluster(uint32_t cluster,
+                     dtPolyRef fromRef,
+                     const vec3f& from,
+                     const dtQueryFilter* filter,
+                     std::vector<float>* dist,
+                     std::vector<vec3f>* pos) const {
+    const std::vector<dtPolyRef>& polys = clusterPolys_[cluster];
+    dist->assign(polys.size(), std::numeric_limits<float>::infinity());
+    pos->resize(polys.size());
+
+    typedef std::pair<float, uint32_t> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                        std::greater<QueueEntry>>
+        queue;
+    const uint32_t fromIndex = getPolyCluster(fromRef)->index;
+    (*dist)[fromIndex] = 0;
+    (*pos)[fromIndex] = from;
+    queue.emplace(0, fromIndex);
+    while (!queue.empty()) {
+      const float d = queue.top().first;
+      const uint32_t i = queue.top().second;
+      queue.pop();
+      if (d > (*dist)[i])
+        continue;
+
+      forEachNeighbor(polys[i], filter,
+                      [&](const dtPolyRef neighborRef, const vec3f& mid) {
+                        const PolyCluster* neighbor =
+                            getPolyCluster(neighborRef);
+                        if (!neighbor || neighbor->cluster != cluster)
+                          return;
+                        const float nd = d + (mid - (*pos)[i]).norm();
+                        if (nd < (*dist)[neighbor->index]) {
+                          (*dist)[neighbor->index] = nd;
+                          (*pos)[neighbor->index] = mid;
+                          queue.emplace(nd, neighbor->index);
+                        }
+                      });
+    }
+  }
+
+  // Distance to portal from the results of searchCluster on cluster
+  float distanceTo(uint32_t portal,
+                   uint32_t cluster,
+                   const std::vector<float>& dist,
+                   const std::vector<vec3f>& pos) const {
+    const uint32_t i = getPolyCluster(portalRef(portal, cluster))->index;
+    return dist[i] + (pos[i] - portals_[portal].pos).norm();
+  }
+
+  // Grows clusters of up to maxClusterPolys polys breadth first
+  void buildClusters(const dtQueryFilter* filter) {
+    const size_t maxClusterPolys = 32;
+    tilePolyClusters_.resize(navMesh_->getMaxTiles());
+    for (int iTile = 0; iTile < navMesh_->getMaxTiles(); ++iTile) {
+      const dtMeshTile* tile = navMesh_->getTile(iTile);
+      if (tile && tile->header)
+        tilePolyClusters_[iTile].resize(tile->header->polyCount);
+    }
+
+    auto addToCluster = [this](const dtPolyRef ref, const uint32_t cluster) {
+      unsigned int salt, iTile, jPoly;
+      navMesh_->decodePolyId(ref, salt, iTile, jPoly);
+      PolyCluster& polyCluster = tilePolyClusters_[iTile][jPoly];
+      polyCluster.cluster = cluster;
+      polyCluster.index = clusterPolys_[cluster].size();
+      clusterPolys_[cluster].emplace_back(ref);
+    };
+
+    for (int iTile = 0; iTile < navMesh_->getMaxTiles(); ++iTile) {
+      const dtMeshTile* tile = navMesh_->getTile(iTile);
+      if (!tile || !tile->header)
+        continue;
+
+      for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+        const dtPolyRef startRef =
+            navMesh_->encodePolyId(tile->salt, iTile, jPoly);
+        const dtPoly* poly = &tile->polys[jPoly];
+        if (tilePolyClusters_[iTile][jPoly].cluster != NO_CLUSTER ||
+            poly->getType() != DT_POLYTYPE_GROUND ||
+            !filter->passFilter(startRef, tile, poly))
+          continue;
+
+        const uint32_t cluster = clusterPolys_.size();
+        clusterPolys_.emplace_back();
+        addToCluster(startRef, cluster);
+        for (size_t i = 0; i < clusterPolys_[cluster].size(); ++i) {
+          forEachNeighbor(clusterPolys_[cluster][i], filter,
+                          [&](const dtPolyRef neighborRef, const vec3f&) {
+                            unsigned int salt, nTile, nPoly;
+                            navMesh_->decodePolyId(neighborRef, salt, nTile,
+                                                   nPoly);
+                            if (clusterPolys_[cluster].size() <
+                                    maxClusterPolys &&
+                                tilePolyClusters_[nTile][nPoly].cluster ==
+                                    NO_CLUSTER)
+                              addToCluster(neighborRef, cluster);
+                          });
+        }
+      }
+    }
+  }
+
+  void buildPortals(const dtQueryFilter* filter) {
+    clusterPortals_.resize(clusterPolys_.size());
+    for (uint32_t cluster = 0; cluster < clusterPolys_.size(); ++cluster) {
+      for (const dtPolyRef ref : clusterPolys_[cluster]) {
+        forEachNeighbor(
+            ref, filter, [&](const dtPolyRef neighborRef, const vec3f& mid) {
+              const PolyCluster* neighbor = getPolyCluster(neighborRef);
+              // Links go both ways, only add the portal once
+              if (!neighbor || neighbor->cluster == cluster ||
+                  neighborRef < ref)
+                return;
+              const uint32_t portal = portals_.size();
+              portals_.push_back(
+                  {mid, {ref, neighborRef}, {cluster, neighbor->cluster}});
+              clusterPortals_[cluster].emplace_back(portal);
+              clusterPortals_[neighbor->cluster].emplace_back(portal);
+            });
+      }
+    }
+  }
+
+  // Connects every pair of portals of every cluster, in parallel over the
+  // clusters
+  void connectPortals(const dtQueryFilter* filter) {
+    const int numClusters = clusterPolys_.size();
+    std::vector<std::vector<std::pair<uint32_t, PortalEdge>>> clusterEdges(
+        numClusters);
+#pragma omp parallel for schedule(dynamic)
+    for (int cluster = 0; cluster < numClusters; ++cluster) {
+      std::vector<float> dist;
+      std::vector<vec3f> pos;
+      for (const uint32_t from : clusterPortals_[cluster]) {
+        searchCluster(cluster, portalRef(from, cluster), portals_[from].pos,
+                      filter, &dist, &pos);
+        for (const uint32_t to : clusterPortals_[cluster]) {
+          if (to == from)
+            continue;
+          const float cost = distanceTo(to, cluster, dist, pos);
+          if (cost < std::numeric_limits<float>::infinity()) {
+            clusterEdges[cluster].emplace_back(
+                from, PortalEdge{to, static_cast<uint32_t>(cluster), cost});
+          }
+        }
+      }
+    }
+
+    portalEdges_.resize(portals_.size());
+    for (const auto& edges : clusterEdges) {
+      for (const auto& edge : edges) {
+        portalEdges_[edge.first].emplace_back(edge.second);
+      }
+    }
+  }
+};
+
+// Private, copy-on-write memory mapping of a whole file.  Pages that are only
+// read are shared with every other process that maps the same file
+class MappedFile {
+ public:
+  static std::unique_ptr<MappedFile> open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return nullptr;
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                  fd, 0);
+    }
+    // The mapping stays valid after the file is closed
+    close(fd);
+    if (data == MAP_FAILED)
+      return nullptr;
+
+    return std::unique_ptr<MappedFile>(
+        new MappedFile(static_cast<unsigned char*>(data), st.st_size));
+  }
+
+  ~MappedFile() { munmap(data_, size_); }
+
+  unsigned char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  MappedFile(unsigned char* data, size_t size) : data_{data}, size_{size} {}
+
+  unsigned char* data_;
+  size_t size_;
+};
+
+// The Detour data of one tile of a navmesh, the caller owns data
+struct TileNavData {
+  unsigned char* data = nullptr;
+  int dataSize = 0;
+  int numVerts = 0;
+  int numPolys = 0;
+};
+
+// The triangles a tiled navmesh was built from
+struct TileGeometry {
+  std::vector<float> verts;
+  std::vector<int> tris;
+};
+
+// Layout of a tiled navmesh, kept after building it so that single tiles can
+// be rebuilt later on
+struct TileGrid {
+  NavMeshSettings settings;
+  // Config of the whole area covered by the grid
+  rcConfig cfg;
+  int tilesX = 0;
+  int tilesY = 0;
+  int tileBits = 0;
+  // Shared with the tiles that are rebuilt in the background for obstacles
+  std::shared_ptr<const TileGeometry> geometry;
+
+  float tileWidth() const { return settings.tileSize * cfg.cs; }
+
+  // Tiles are built with a border so that the polys of neighbouring tiles line
+  // up
+  int borderSize() const { return cfg.walkableRadius + 3; }
+
+  // Poly refs are 32 bits wide and at least 10 of them are used for the salt
+  int maxPolysPerTile() const { return 1 << (22 - tileBits); }
+
+  // Range of tiles that overlap the xz extent of [bmin, bmax] grown by margin
+  void tileRange(const float* bmin,
+                 const float* bmax,
+                 const float margin,
+                 int* tx0,
+                 int* ty0,
+                 int* tx1,
+                 int* ty1) const {
+    const float w = tileWidth();
+    *tx0 = std::max(
+        static_cast<int>(floorf((bmin[0] - cfg.bmin[0] - margin) / w)), 0);
+    *ty0 = std::max(
+        static_cast<int>(floorf((bmin[2] - cfg.bmin[2] - margin) / w)), 0);
+    *tx1 = std::min(
+        static_cast<int>(floorf((bmax[0] - cfg.bmin[0] + margin) / w)),
+        tilesX - 1);
+    *ty1 = std::min(
+        static_cast<int>(floorf((bmax[2] - cfg.bmin[2] + margin) / w)),
+        tilesY - 1);
+  }
+};
+
+// A cylinder or a box rotated around the y axis that is cut out of the navmesh
+struct NavObstacle {
+  bool isCylinder = false;
+  vec3f center;
+  // The radius, half the height and the radius again for cylinders
+  vec3f halfExtents;
+  float yaw = 0.0f;
+
+  bool operator==(const NavObstacle& other) const {
+    return isCylinder == other.isCylinder && center == other.center &&
+           halfExtents == other.halfExtents && yaw == other.yaw;
+  }
+
+  // Bounds of the area that is cut out for an agent of the given radius
+  std::pair<vec3f, vec3f> bounds(const float agentRadius) const {
+    float extentX = halfExtents[0];
+    float extentZ = halfExtents[2];
+    if (!isCylinder) {
+      const float c = std::abs(std::cos(yaw));
+      const float s = std::abs(std::sin(yaw));
+      extentX = c * halfExtents[0] + s * halfExtents[2];
+      extentZ = s * halfExtents[0] + c * halfExtents[2];
+    }
+    const vec3f extent{extentX + agentRadius, halfExtents[1],
+                       extentZ + agentRadius};
+    return std::make_pair(vec3f(center - extent), vec3f(center + extent));
+  }
+};
+
+// Picks polys with a probability proportional to their area, the same
+// weighting that dtNavMeshQuery::findRandomPoint uses, in O(log n) per pick.
+// Polys are sorted by island so that the polys of every island are a
+// contiguous range of the prefix sums.
+class PolyAreaSampler {
+ public:
+  // A set of polys to pick from: either a range [begin, end) of all polys or,
+  // if polys is not empty, a list of them with its own prefix sums
+  struct Selection {
+    int begin = 0, end = 0;
+    std::vector<int> polys;
+    std::vector<double> cumulativeArea;
+
+    bool empty() const { return polys.empty() && begin == end; }
+  };
+
+  PolyAreaSampler(const dtNavMesh* navMesh,
+                  const dtQueryFilter* filter,
+                  const IslandSystem& islandSystem)
+      : navMesh_{navMesh} {
+    struct PolyEntry {
+      uint32_t island;
+      dtPolyRef ref;
+      double area;
+    };
+    std::vector<PolyEntry> entries;
+    for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+      const dtMeshTile* tile = navMesh->getTile(iTile);
+      if (!tile || !tile->header)
+        continue;
+
+      const dtPolyRef base = navMesh->getPolyRefBase(tile);
+      for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+        const dtPoly* poly = &tile->polys[jPoly];
+        const dtPolyRef ref = base | static_cast<dtPolyRef>(jPoly);
+        if (poly->getType() != DT_POLYTYPE_GROUND ||
+            !filter->passFilter(ref, tile, poly))
+          continue;
+
+        const float area = polyArea(tile, poly);
+        if (area > 0)
+          entries.push_back({islandSystem.islandId(ref), ref, area});
+      }
+    }
+    // Stable so that the order, and with it the sampled points, only depend
+    // on the navmesh
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const PolyEntry& a, const PolyEntry& b) {
+                       return a.island < b.island;
+                     });
+
+    refs_.reserve(entries.size());
+    islands_.reserve(entries.size());
+    cumulativeArea_.reserve(entries.size() + 1);
+    cumulativeArea_.push_back(0);
+    for (const PolyEntry& entry : entries) {
+      refs_.push_back(entry.ref);
+      islands_.push_back(entry.island);
+      cumulativeArea_.push_back(cumulativeArea_.back() + entry.area);
+    }
+
+    // Bounds of every poly, grouped by tile for the queries by area and
+    // sorted by their lowest point for the queries by height
+    std::unordered_map<const dtMeshTile*, int> tileIndices;
+    polyMin_.reserve(numPolys());
+    polyMax_.reserve(numPolys());
+    for (int i = 0; i < numPolys(); ++i) {
+      const dtMeshTile* tile;
+      const dtPoly* poly;
+      navMesh_->getTileAndPolyByRefUnsafe(refs_[i], &tile, &poly);
+      vec3f polyMin = vec3f::Constant(std::numeric_limits<float>::max());
+      vec3f polyMax = -polyMin;
+      for (int iVert = 0; iVert < poly->vertCount; ++iVert) {
+        const Eigen::Map<const vec3f> vert(
+            &tile->verts[poly->verts[iVert] * 3]);
+        polyMin = polyMin.cwiseMin(vert);
+        polyMax = polyMax.cwiseMax(vert);
+      }
+      polyMin_.push_back(polyMin);
+      polyMax_.push_back(polyMax);
+      maxPolyHeight_ = std::max(maxPolyHeight_, polyMax[1] - polyMin[1]);
+
+      auto inserted = tileIndices.emplace(tile, tiles_.size());
+      if (inserted.second)
+        tiles_.push_back({polyMin, polyMax, {}});
+      TileBounds& tileBounds = tiles_[inserted.first->second];
+      tileBounds.bmin = tileBounds.bmin.cwiseMin(polyMin);
+      tileBounds.bmax = tileBounds.bmax.cwiseMax(polyMax);
+      tileBounds.polys.push_back(i);
+    }
+
+    byHeight_.resize(numPolys());
+    std::iota(byHeight_.begin(), byHeight_.end(), 0);
+    std::stable_sort(byHeight_.begin(), byHeight_.end(),
+                     [this](const int a, const int b) {
+                       return polyMin_[a][1] < polyMin_[b][1];
+                     });
+    byHeightMin_.reserve(numPolys());
+    for (const int i : byHeight_) {
+      byHeightMin_.push_back(polyMin_[i][1]);
+    }
+  }
+
+  int numPolys() const { return refs_.size(); }
+  dtPolyRef polyRef(int i) const { return refs_[i]; }
+
+  Selection all() const {
+    Selection selection;
+    selection.end = numPolys();
+    return selection;
+  }
+
+  Selection island(uint32_t islandId) const {
+    Selection selection;
+    const auto range =
+        std::equal_range(islands_.begin(), islands_.end(), islandId);
+    selection.begin = range.first - islands_.begin();
+    selection.end = range.second - islands_.begin();
+    return selection;
+  }
+
+  // The polys whose bounds overlap [bmin, bmax]
+  Selection overlapping(const vec3f& bmin, const vec3f& bmax) const {
+    std::vector<int> polys;
+    for (const TileBounds& tile : tiles_) {
+      if (!boundsOverlap(tile.bmin, tile.bmax, bmin, bmax))
+        continue;
+      for (const int i : tile.polys) {
+        if (boundsOverlap(polyMin_[i], polyMax_[i], bmin, bmax))
+          polys.push_back(i);
+      }
+    }
+    return select(std::move(polys));
+  }
+
+  // The polys whose bounds overlap the heights [minHeight, maxHeight]
+  Selection inHeightBand(const float minHeight, const float maxHeight) const {
+    // No poly reaching up to minHeight can start further below it than the
+    // tallest poly is high
+    const auto begin =
+        std::lower_bound(byHeightMin_.begin(), byHeightMin_.end(),
+                         minHeight - maxPolyHeight_);
+    const auto end = std::upper_bound(begin, byHeightMin_.end(), maxHeight);
+    std::vector<int> polys;
+    for (auto it = begin; it != end; ++it) {
+      const int i = byHeight_[it - byHeightMin_.begin()];
+      if (polyMax_[i][1] >= minHeight)
+        polys.push_back(i);
+    }
+    return select(std::move(polys));
+  }
+
+  // Index of the poly of selection that covers the fraction u in [0, 1) of
+  // its total area
+  int pick(const Selection& selection, float u) const {
+    if (selection.polys.empty())
+      return searchPrefixSums(cumulativeArea_, selection.begin, selection.end,
+                              u);
+    return selection.polys[searchPrefixSums(selection.cumulativeArea, 0,
+                                            selection.polys.size(), u)];
+  }
+
+  // Point on poly i for the uniform random numbers s and t.  Its height is
+  // interpolated from the poly vertices, not taken from the detail mesh
+  vec3f pointOnPoly(int i, float s, float t) const {
+    const dtMeshTile* tile;
+    const dtPoly* poly;
+    navMesh_->getTileAndPolyByRefUnsafe(refs_[i], &tile, &poly);
+    float verts[3 * DT_VERTS_PER_POLYGON];
+    float areas[DT_VERTS_PER_POLYGON];
+    for (int iVert = 0; iVert < poly->vertCount; ++iVert) {
+      dtVcopy(&verts[iVert * 3], &tile->verts[poly->verts[iVert] * 3]);
+    }
+    vec3f pt;
+    dtRandomPointInConvexPoly(verts, poly->vertCount, areas, s, t, pt.data());
+    return pt;
+  }
+
+ private:
+  // Area of the poly projected onto the xz plane
+  static float polyArea(const dtMeshTile* tile, const dtPoly* poly) {
+    float area = 0;
+    const float* va = &tile->verts[poly->verts[0] * 3];
+    for (int iVert = 2; iVert < poly->vertCount; ++iVert) {
+      const float* vb = &tile->verts[poly->verts[iVert - 1] * 3];
+      const float* vc = &tile->verts[poly->verts[iVert] * 3];
+      area += dtTriArea2D(va, vb, vc);
+    }
+    return std::abs(area);
+  }
+
+  static bool boundsOverlap(const vec3f& aMin,
+                            const vec3f& aMax,
+                            const vec3f& bMin,
+                            const vec3f& bMax) {
+    return (aMin.array() <= bMax.array()).all() &&
+           (aMax.array() >= bMin.array()).all();
+  }
+
+  // Selection of the given polys, in the order of all polys so that the
+  // sampled points do not depend on how they were found
+  Selection select(std::vector<int> polys) const {
+    std::sort(polys.begin(), polys.end());
+    Selection selection;
+    selection.cumulativeArea.reserve(polys.size() + 1);
+    selection.cumulativeArea.push_back(0);
+    for (const int i : polys) {
+      selection.cumulativeArea.push_back(selection.cumulativeArea.back() +
+                                         cumulativeArea_[i + 1] -
+                                         cumulativeArea_[i]);
+    }
+    selection.polys = std::move(polys);
+    return selection;
+  }
+
+  static int searchPrefixSums(const std::vector<double>& cumulativeArea,
+                              int begin,
+                              int end,
+                              float u) {
+    const double target = cumulativeArea[begin] +
+                          u * (cumulativeArea[end] - cumulativeArea[begin]);
+    const int i = std::upper_bound(cumulativeArea.begin() + begin + 1,
+                                   cumulativeArea.begin() + end + 1, target) -
+                  cumulativeArea.begin() - 1;
+    return std::min(i, end - 1);
+  }
+
+  const dtNavMesh* navMesh_;
+  std::vector<dtPolyRef> refs_;
+  std::vector<uint32_t> islands_;
+  // cumulativeArea_[i] is the total area of the polys before poly i
+  std::vector<double> cumulativeArea_;
+
+  struct TileBounds {
+    vec3f bmin, bmax;
+    std::vector<int> polys;
+  };
+  std::vector<vec3f> polyMin_, polyMax_;
+  std::vector<TileBounds> tiles_;
+  // The polys sorted by the height of their lowest vertex, and those heights
+  std::vector<int> byHeight_;
+  std::vector<float> byHeightMin_;
+  float maxPolyHeight_ = 0;
+};
+}  // namespace impl
+
+struct SlicedShortestPath::Impl {
+  //! Detour keeps the state of a sliced search in the query, so every request
+  //! has its own
+  impl::NavQueryPool::NavQueryPtr navQuery = nullptr;
+  //! Id of the navmesh the search runs on
+  size_t navMeshId = 0;
+  dtStatus status = DT_FAILURE;
+};
+
+SlicedShortestPath::SlicedShortestPath()
+    : geodesicDistance{std::numeric_limits<float>::infinity()},
+      isComplete{false},
+      pimpl_{spimpl::make_unique_impl<Impl>()} {};
+
+bool SlicedShortestPath::isDone() const {
+  return !dtStatusInProgress(pimpl_->status);
+}
+
+struct AgentNavHandle::Impl {
+  //! The polygon the agent was left on, 0 when not tracking
+  dtPolyRef ref = 0;
+  //! Where the agent was left, on the surface of ref
+  vec3f position = vec3f::Zero();
+  //! Id of the navmesh ref belongs to
+  size_t navMeshId = 0;
+};
+
+AgentNavHandle::AgentNavHandle()
+    : pimpl_{spimpl::make_unique_impl<Impl>()} {};
+
+void AgentNavHandle::reset() {
+  pimpl_->ref = 0;
+}
+
+bool AgentNavHandle::isTracking() const {
+  return pimpl_->ref != 0;
+}
+
+struct PathFinder::Impl {
+  Impl();
+  ~Impl() { discardObstacleJob(); }
+
+  bool build(const NavMeshSettings& bs,
+             const float* verts,
+             const int nverts,
+             const int* tris,
+             const int ntris,
+             const float* bmin,
+             const float* bmax);
+  bool build(const NavMeshSettings& bs, const esp::assets::MeshData& mesh);
+  // Builds the navmesh of profiles[i] into impls[i]
+  static bool buildProfiles(const std::vector<NavMeshSettings>& profiles,
+                            const esp::assets::MeshData& mesh,
+                            const std::vector<Impl*>& impls);
+  bool rebuildRegions(const NavMeshSettings& bs,
+                      const esp::assets::MeshData& mesh,
+                      const std::vector<std::pair<vec3f, vec3f>>& regions);
+
+  int addCylinderObstacle(const vec3f& center,
+                          const float radius,
+                          const float height);
+  int addBoxObstacle(const vec3f& center,
+                     const vec3f& halfExtents,
+                     const float yaw);
+  bool moveObstacle(const int obstacleId, const vec3f& center, const float yaw);
+  bool removeObstacle(const int obstacleId);
+  int numObstacles() const { return obstacles_.size(); }
+  bool updateObstacles(const bool blocking);
+  // Makes the obstacles the same as the ones of other, the tiles of the ones
+  // that differ are carved by the next updateObstacles
+  void copyObstacles(const Impl& other);
+  bool isTiled() const { return bool(tileGrid_); }
+
+  vec3f getRandomNavigablePoint();
+  Eigen::RowMatrixXf getRandomNavigablePoints(const int numPoints);
+  Eigen::RowMatrixXf getRandomNavigablePointsOnIsland(const vec3f& pt,
+                                                      const int numPoints);
+  Eigen::RowMatrixXf getRandomNavigablePointsAroundPoint(const vec3f& center,
+                                                         const float radius,
+                                                         const int numPoints);
+  Eigen::RowMatrixXf getRandomNavigablePointsInHeightBand(
+      const float minHeight,
+      const float maxHeight,
+      const int numPoints);
+
+  bool findPath(ShortestPath& path);
+  bool findPath(MultiGoalShortestPath& path);
+
+  bool initSlicedPath(SlicedShortestPath& path);
+  bool updateSlicedPath(SlicedShortestPath& path,
+                        int maxIterations,
+                        float maxMicroseconds);
+  bool finalizeSlicedPath(SlicedShortestPath& path);
+
+  ShortestPathBatch findPaths(
+      const Eigen::Ref<const Eigen::RowMatrixXf>& starts,
+      const Eigen::Ref<const Eigen::RowMatrixXf>& ends,
+      bool returnPoints);
+
+  GeodesicDistanceField::ptr buildDistanceField(
+      const std::vector<vec3f>& goals);
+  float geodesicDistance(const GeodesicDistanceField& field,
+                         const vec3f& pt,
+                         std::vector<vec3f>* points = nullptr);
+
+  template <typename T>
+  T tryStep(const T& start, const T& end, bool allowSliding);
+  template <typename T>
+  T tryStep(AgentNavHandle& handle,
+            const T& start,
+            const T& end,
+            bool allowSliding);
+  // Nudges endPoint, where moveAlongSurface ended on endRef, towards the
+  // center of endRef if it lies on an edge shared with another island than
+  // startRef
+  void keepStepOnIsland(dtNavMeshQuery* navQuery,
+                        dtPolyRef startRef,
+                        dtPolyRef endRef,
+                        vec3f& endPoint) const;
+
+  template <typename T>
+  T snapPoint(const T& pt);
+
+  bool loadNavMesh(const std::string& path, bool memoryMap);
+
+  bool saveNavMesh(const std::string& path);
+
+  bool isLoaded() const { return navMesh_ != nullptr; };
+
+  size_t navMeshId() const { return navMeshId_; }
+
+  void seed(uint32_t newSeed);
+
+  float islandRadius(const vec3f& pt) const;
+
+  float distanceToClosestObstacle(const vec3f& pt,
+                                  const float maxSearchRadius = 2.0) const;
+  HitRecord closestObstacleSurfacePoint(
+      const vec3f& pt,
+      const float maxSearchRadius = 2.0) const;
+
+  bool isNavigable(const vec3f& pt, const float maxYDelta = 0.5) const;
+
+  void setObstacleDistanceTolerance(const float tolerance,
+                                    const float maxSearchRadius);
+  float getObstacleDistanceTolerance() const {
+    return obstacleDistanceTolerance_;
+  }
+
+  void snapPoints(const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+                  Eigen::Ref<Eigen::RowMatrixXf> out) const;
+  void islandRadii(const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+                   Eigen::Ref<Eigen::VectorXf> out) const;
+  void distancesToClosestObstacle(
+      const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+      Eigen::Ref<Eigen::VectorXf> out,
+      const float maxSearchRadius) const;
+  void areNavigable(const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+                    Eigen::Ref<Eigen::Matrix<bool, Eigen::Dynamic, 1>> out,
+                    const float maxYDelta) const;
+  void castRays(const Eigen::Ref<const Eigen::RowMatrixXf>& starts,
+                const Eigen::Ref<const Eigen::RowMatrixXf>& ends,
+                Eigen::Ref<Eigen::VectorXf> hitFractions,
+                Eigen::Ref<Eigen::RowMatrixXf> hitNormals,
+                Eigen::Ref<Eigen::Matrix<uint32_t, Eigen::Dynamic, 1>>
+                    hitPolys) const;
+
+  std::pair<vec3f, vec3f> bounds() const { return bounds_; };
+
+  dtNavMesh* detourNavMesh() const { return navMesh_.get(); }
+  const dtQueryFilter* detourFilter() const { return filter_.get(); }
+
+  Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic> getTopDownView(
+      const float pixelsPerMeter,
+      const float height,
+      bool rasterize);
+  Eigen::MatrixXi getTopDownIslandView(const float pixelsPerMeter,
+                                       const float height,
+                                       const float maxYDelta);
+  Eigen::MatrixXf getTopDownDistanceView(const float pixelsPerMeter,
+                                         const float height,
+                                         const float maxYDelta);
+
+  const assets::MeshData::ptr getNavMeshData();
+
+ private:
+  struct NavMeshDeleter {
+    void operator()(dtNavMesh* mesh) { dtFreeNavMesh(mesh); }
+  };
+
+  //! File the tiles of navMesh_ point into if it was loaded memory mapped.
+  //! Declared first so that it outlives navMesh_
+  std::unique_ptr<impl::MappedFile> mappedNavMesh_ = nullptr;
+  std::unique_ptr<dtNavMesh, NavMeshDeleter> navMesh_ = nullptr;
+  //! Queries are borrowed from the pool so that the navmesh can be queried
+  //! from multiple threads at once
+  std::unique_ptr<impl::NavQueryPool> navQueryPool_ = nullptr;
+  std::unique_ptr<dtQueryFilter> filter_ = nullptr;
+  std::unique_ptr<impl::IslandSystem> islandSystem_ = nullptr;
+  std::unique_ptr<impl::IslandBorders> islandBorders_ = nullptr;
+  std::unique_ptr<impl::PathHierarchy> pathHierarchy_ = nullptr;
+  std::unique_ptr<impl::PolyAreaSampler> polyAreaSampler_ = nullptr;
+  //! Random stream of the batched samplers.  Unlike getRandomNavigablePoint,
+  //! which uses the global rand, it only depends on seed
+  core::Random random_{0};
+  std::mutex randomMutex_;
+  //! Unique id of the current navmesh, used to check that derived data such
+  //! as distance fields belong to it
+  size_t navMeshId_ = 0;
+
+  //! Holds triangulated geom/topo. Generated when queried. Reset with
+  //! navQueryPool_.
+  assets::MeshData::ptr meshData_ = nullptr;
+  std::mutex meshDataMutex_;
+
+  std::pair<vec3f, vec3f> bounds_;
+
+  //! Precomputed distances to the walls, built on first use while
+  //! obstacleDistanceTolerance_ is not 0.  The pointer is published to
+  //! concurrent queries through obstacleDistanceFieldPtr_, the tolerance is
+  //! read by them without a lock as well.  Both settings are only changed
+  //! with obstacleDistanceFieldMutex_ held
+  std::atomic<float> obstacleDistanceTolerance_{0};
+  float obstacleDistanceMaxRadius_ = 2.0;
+  mutable std::unique_ptr<impl::ObstacleDistanceField> obstacleDistanceField_ =
+      nullptr;
+  mutable std::atomic<const impl::ObstacleDistanceField*>
+      obstacleDistanceFieldPtr_{nullptr};
+  mutable std::mutex obstacleDistanceFieldMutex_;
+
+  // Returns nullptr if the field is disabled
+  const impl::ObstacleDistanceField* getObstacleDistanceField() const;
+  void resetObstacleDistanceField(
+      std::unique_ptr<impl::ObstacleDistanceField> field = nullptr);
+
+  void removeZeroAreaPolys();
+
+  // Single point queries using a query the caller already borrowed from
+  // navQueryPool_
+  float islandRadius(const dtNavMeshQuery* navQuery, const vec3f& pt) const;
+  float distanceToClosestObstacle(const dtNavMeshQuery* navQuery,
+                                  const vec3f& pt,
+                                  const float maxSearchRadius) const;
+  HitRecord closestObstacleSurfacePoint(const dtNavMeshQuery* navQuery,
+                                        const vec3f& pt,
+                                        const float maxSearchRadius) const;
+  bool isNavigable(const dtNavMeshQuery* navQuery,
+                   const vec3f& pt,
+                   const float maxYDelta) const;
+
+  // Draws numPoints area uniform points on the polys of selection, keeping
+  // only those for which accept(pt) is true.  Returns fewer points if too
+  // few are accepted
+  template <typename F>
+  Eigen::RowMatrixXf samplePoints(
+      const impl::PolyAreaSampler::Selection& selection,
+      const int numPoints,
+      F accept);
+
+  // Calls f(navQuery, i, pt) for every row pt of pts.  Large batches are
+  // spread over all available threads, each with its own query
+  template <typename F>
+  void forEachPoint(const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+                    F f) const;
+
+  // Island id of the navmesh surface at every sample of the top down view,
+  // ID_UNDEFINED where there is none within maxYDelta of height
+  Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+  rasterizeTopDownView(const float pixelsPerMeter,
+                       const float height,
+                       const float maxYDelta);
+
+  bool loadNavMeshMapped(const std::string& path);
+  // Takes ownership of a freshly loaded navmesh and the file its tiles are in,
+  // if it was memory mapped
+  bool initLoadedNavMesh(
+      dtNavMesh* mesh,
+      std::unique_ptr<impl::MappedFile> mappedFile = nullptr,
+      std::unique_ptr<impl::IslandSystem> islandSystem = nullptr);
+
+  //! Layout of the navmesh if it was built tiled
+  Cr::Containers::Optional<impl::TileGrid> tileGrid_;
+
+  bool buildTiled(const NavMeshSettings& bs,
+                  const rcConfig& solo,
+                  const float* verts,
+                  const int nverts,
+                  const int* tris,
+                  const int ntris,
+                  int* numVerts,
+                  int* numPolys);
+  // Creates a single tile navmesh from tileData, which it takes ownership of
+  bool initSoloNavMesh(impl::TileNavData* tileData);
+  // Everything after the navmesh was built or rebuilt from scratch
+  bool finishBuild(const int numVerts, const int numPolys);
+  // Hands the built tiles over to the navmesh
+  bool addTiles(std::vector<impl::TileNavData>* tiles,
+                int* numVerts,
+                int* numPolys);
+  // Puts the tiles removed by replaceTiles back if it fails, tileIds are the
+  // ones that were swapped out.  Takes ownership of the data of the tiles
+  void restoreTiles(
+      const std::vector<int>& tileIds,
+      std::vector<std::pair<dtTileRef, impl::TileNavData>>* removedTiles);
+  // Replaces the tiles of tileGrid_ with the given ids and updates everything
+  // derived from them.  Leaves the navmesh as it was if that fails
+  bool replaceTiles(const std::vector<int>& tileIds,
+                    std::vector<impl::TileNavData>* tiles,
+                    int* numVerts,
+                    int* numPolys);
+
+  //! Obstacles cut out of the navmesh by id
+  std::map<int, impl::NavObstacle> obstacles_;
+  int nextObstacleId_ = 0;
+  //! Tiles of tileGrid_ whose obstacles changed since they were built
+  std::vector<bool> obstacleDirtyTiles_;
+  // Tiles that are rebuilt for obstacles in the background
+  struct ObstacleJob {
+    std::vector<int> tileIds;
+    std::vector<impl::TileNavData> tiles;
+    std::future<bool> built;
+  };
+  std::unique_ptr<ObstacleJob> obstacleJob_;
+
+  int addObstacle(const impl::NavObstacle& obstacle);
+  std::vector<impl::NavObstacle> obstacleList() const;
+  void markObstacleTilesDirty(const impl::NavObstacle& obstacle);
+  // Swaps in the tiles of obstacleJob_ once they are built
+  bool finishObstacleJob();
+  // Waits for obstacleJob_ and throws its tiles away, they are dirty again
+  void discardObstacleJob();
+  // Called whenever tileGrid_ changes, the new navmesh has all obstacles
+  void resetObstacleTiles();
+  // Uses islandSystem for the connectivity of the navmesh if given, computes
+  // it otherwise
+  bool initNavQuery(
+      std::unique_ptr<impl::IslandSystem> islandSystem = nullptr);
+
+  Cr::Containers::Optional<std::tuple<float, std::vector<vec3f>>>
+  findPathInternal(dtNavMeshQuery* navQuery,
+                   const vec3f& start,
+                   dtPolyRef startRef,
+                   const vec3f& pathStart,
+                   const vec3f& end,
+                   dtPolyRef endRef,
+                   const vec3f& pathEnd);
+
+  // Expands once from pathStart on startRef over the polys for all goals at
+  // once, and calls pathLength for every goal that may be the closest one.
+  // pathLength returns the length of the path to the goal, or infinity if
+  // there is none
+  void findClosestGoal(const dtPolyRef startRef,
+                       const vec3f& pathStart,
+                       const std::vector<dtPolyRef>& endRefs,
+                       const std::vector<vec3f>& pathEnds,
+                       const std::function<float(size_t)>& pathLength) const;
+
+  bool findPathSetup(dtNavMeshQuery* navQuery,
+                     MultiGoalShortestPath& path,
+                     dtPolyRef& startRef,
+                     vec3f& pathStart);
+
+  bool hasLineOfSight(dtNavMeshQuery* navQuery,
+                      const vec3f& from,
+                      dtPolyRef fromRef,
+                      const GeodesicDistanceField::Impl& field,
+                      uint32_t toNode) const;
+  bool hasLineOfSight(dtNavMeshQuery* navQuery,
+                      const GeodesicDistanceField::Impl& field,
+                      uint32_t fromNode,
+                      uint32_t toNode) const;
+};
+
+namespace {
+struct Workspace {
+  rcHeightfield* solid = 0;
+  unsigned char* triareas = 0;
+  rcCompactHeightfield* chf = 0;
+  rcContourSet* cset = 0;
+  rcPolyMesh* pmesh = 0;
+  rcPolyMeshDetail* dmesh = 0;
+
+  ~Workspace() {
+    rcFreeHeightField(solid);
+    delete[] triareas;
+    rcFreeCompactHeightfield(chf);
+    rcFreeContourSet(cset);
+    rcFreePolyMesh(pmesh);
+    rcFreePolyMeshDetail(dmesh);
+  }
+};
+
+enum PolyAreas { POLYAREA_GROUND, POLYAREA_DOOR };
+
+enum PolyFlags {
+  POLYFLAGS_WALK = 0x01,      // walkable
+  POLYFLAGS_DOOR = 0x02,      // ability to move through doors
+  POLYFLAGS_DISABLED = 0x04,  // disabled polygon
+  POLYFLAGS_ALL = 0xffff      // all abilities
+};
+
+std::atomic<size_t> nextNavMeshId{1};
+
+// The Recast pipeline is split in three stages so that the heightfield can be
+// shared between agents that only differ in their radius and height, see
+// PathFinder::Impl::buildProfiles
+
+// Rasterizes the triangles into ws->solid and does the filtering that only
+// depends on the settings all agents sharing the heightfield have in common
+bool rasterizeHeightfield(const NavMeshSettings& bs,
+                          const rcConfig& cfg,
+                          const float* verts,
+                          const int nverts,
+                          const int* tris,
+                          const int ntris,
+                          Workspace* ws) {
+  rcContext ctx;
 
   //
   // Step 2. Rasterize input polygon soup.
   //
 
   // Allocate voxel heightfield where we rasterize our input data to.
-  ws.solid = rcAllocHeightfield();
-  if (!ws.solid) {
+  ws->solid = rcAllocHeightfield();
+  if (!ws->solid) {
     LOG(ERROR) << "Out of memory for heightfield allocation";
     return false;
   }
-  if (!rcCreateHeightfield(&ctx, *ws.solid, cfg.width, cfg.height, cfg.bmin,
+  if (!rcCreateHeightfield(&ctx, *ws->solid, cfg.width, cfg.height, cfg.bmin,
                            cfg.bmax, cfg.cs, cfg.ch)) {
     LOG(ERROR) << "Could not create solid heightfield";
     return false;
@@ -394,8 +2074,8 @@ bool PathFinder::Impl::build(const NavMeshSettings& bs,
   // Allocate array that can hold triangle area types.
   // If you have multiple meshes you need to process, allocate
   // and array which can hold the max number of triangles you need to process.
-  ws.triareas = new unsigned char[ntris];
-  if (!ws.triareas) {
+  ws->triareas = new unsigned char[ntris];
+  if (!ws->triareas) {
     LOG(ERROR) << "Out of memory for triareas" << ntris;
     return false;
   }
@@ -403,11 +2083,11 @@ bool PathFinder::Impl::build(const NavMeshSettings& bs,
   // Find triangles which are walkable based on their slope and rasterize them.
   // If your input data is multiple meshes, you can transform them here,
   // calculate the are type for each of the meshes and rasterize them.
-  memset(ws.triareas, 0, ntris * sizeof(unsigned char));
+  memset(ws->triareas, 0, ntris * sizeof(unsigned char));
   rcMarkWalkableTriangles(&ctx, cfg.walkableSlopeAngle, verts, nverts, tris,
-                          ntris, ws.triareas);
-  if (!rcRasterizeTriangles(&ctx, verts, nverts, tris, ws.triareas, ntris,
-                            *ws.solid, cfg.walkableClimb)) {
+                          ntris, ws->triareas);
+  if (!rcRasterizeTriangles(&ctx, verts, nverts, tris, ws->triareas, ntris,
+                            *ws->solid, cfg.walkableClimb)) {
     LOG(ERROR) << "Could not rasterize triangles.";
     return false;
   }
@@ -419,12 +2099,24 @@ bool PathFinder::Impl::build(const NavMeshSettings& bs,
   // Once all geoemtry is rasterized, we do initial pass of filtering to
   // remove unwanted overhangs caused by the conservative rasterization
   // as well as filter spans where the character cannot possibly stand.
+  // Filtering low hanging obstacles only depends on the climb height
   if (bs.filterLowHangingObstacles)
-    rcFilterLowHangingWalkableObstacles(&ctx, cfg.walkableClimb, *ws.solid);
+    rcFilterLowHangingWalkableObstacles(&ctx, cfg.walkableClimb, *ws->solid);
+
+  return true;
+}
+
+// Filters solid by the height of the agent and compacts it into ws->chf
+bool buildCompactHeightfield(const NavMeshSettings& bs,
+                             const rcConfig& cfg,
+                             rcHeightfield& solid,
+                             Workspace* ws) {
+  rcContext ctx;
+
   if (bs.filterLedgeSpans)
-    rcFilterLedgeSpans(&ctx, cfg.walkableHeight, cfg.walkableClimb, *ws.solid);
+    rcFilterLedgeSpans(&ctx, cfg.walkableHeight, cfg.walkableClimb, solid);
   if (bs.filterWalkableLowHeightSpans)
-    rcFilterWalkableLowHeightSpans(&ctx, cfg.walkableHeight, *ws.solid);
+    rcFilterWalkableLowHeightSpans(&ctx, cfg.walkableHeight, solid);
 
   //
   // Step 4. Partition walkable surface to simple regions.
@@ -433,28 +2125,81 @@ bool PathFinder::Impl::build(const NavMeshSettings& bs,
   // Compact the heightfield so that it is faster to handle from now on.
   // This will result more cache coherent data as well as the neighbours
   // between walkable cells will be calculated.
-  ws.chf = rcAllocCompactHeightfield();
-  if (!ws.chf) {
+  ws->chf = rcAllocCompactHeightfield();
+  if (!ws->chf) {
     LOG(ERROR) << "Out of memory for compact heightfield";
     return false;
   }
   if (!rcBuildCompactHeightfield(&ctx, cfg.walkableHeight, cfg.walkableClimb,
-                                 *ws.solid, *ws.chf)) {
+                                 solid, *ws->chf)) {
     LOG(ERROR) << "Could not build compact heightfield";
     return false;
   }
 
+  return true;
+}
+
+// Marks the cells covered by obstacles as not walkable.  The walkable area is
+// eroded already, so the obstacles are grown by the agent radius.  They also
+// reach down by the climb height so that objects resting on the floor cut it
+void markObstacles(const rcConfig& cfg,
+                   const std::vector<impl::NavObstacle>& obstacles,
+                   rcCompactHeightfield& chf) {
+  rcContext ctx;
+  const float agentRadius = cfg.walkableRadius * cfg.cs;
+  const float climb = cfg.walkableClimb * cfg.ch;
+  for (const impl::NavObstacle& obstacle : obstacles) {
+    const vec3f& center = obstacle.center;
+    const vec3f& halfExtents = obstacle.halfExtents;
+    const float hmin = center[1] - halfExtents[1] - climb;
+    const float hmax = center[1] + halfExtents[1];
+    if (obstacle.isCylinder) {
+      const float pos[3] = {center[0], hmin, center[2]};
+      rcMarkCylinderArea(&ctx, pos, halfExtents[0] + agentRadius, hmax - hmin,
+                         RC_NULL_AREA, chf);
+      continue;
+    }
+
+    const float c = std::cos(obstacle.yaw);
+    const float s = std::sin(obstacle.yaw);
+    const float ex = halfExtents[0] + agentRadius;
+    const float ez = halfExtents[2] + agentRadius;
+    const float corners[4][2] = {{-ex, -ez}, {ex, -ez}, {ex, ez}, {-ex, ez}};
+    float verts[4 * 3];
+    for (int i = 0; i < 4; ++i) {
+      verts[3 * i + 0] = center[0] + c * corners[i][0] + s * corners[i][1];
+      verts[3 * i + 1] = center[1];
+      verts[3 * i + 2] = center[2] - s * corners[i][0] + c * corners[i][1];
+    }
+    rcMarkConvexPolyArea(&ctx, verts, 4, hmin, hmax, RC_NULL_AREA, chf);
+  }
+}
+
+// Runs the rest of the pipeline on ws->chf, from eroding it by the agent
+// radius to creating the Detour data
+bool buildNavDataFromCompactHeightfield(
+    const NavMeshSettings& bs,
+    const rcConfig& cfg,
+    const int tileX,
+    const int tileY,
+    const std::vector<impl::NavObstacle>& obstacles,
+    Workspace* ws,
+    impl::TileNavData* tileData) {
+  rcContext ctx;
+
   // Erode the walkable area by agent radius.
-  if (!rcErodeWalkableArea(&ctx, cfg.walkableRadius, *ws.chf)) {
+  if (!rcErodeWalkableArea(&ctx, cfg.walkableRadius, *ws->chf)) {
     LOG(ERROR) << "Could not erode walkable area";
     return false;
   }
 
+  markObstacles(cfg, obstacles, *ws->chf);
+
   // // (Optional) Mark areas.
   // const ConvexVolume* vols = geom->getConvexVolumes();
   // for (int i  = 0; i < geom->getConvexVolumeCount(); ++i)
   //   rcMarkConvexPolyArea(ctx, vols[i].verts, vols[i].nverts, vols[i].hmin,
-  //   vols[i].hmax, (unsigned char)vols[i].area, *ws.chf);
+  //   vols[i].hmax, (unsigned char)vols[i].area, *ws->chf);
 
   // Partition the heightfield so that we can use simple algorithm later to
   // triangulate the walkable areas. There are 3 martitioning methods, each with
@@ -492,173 +2237,991 @@ bool PathFinder::Impl::build(const NavMeshSettings& bs,
 
   // Prepare for region partitioning, by calculating distance field along the
   // walkable surface.
-  if (!rcBuildDistanceField(&ctx, *ws.chf)) {
+  if (!rcBuildDistanceField(&ctx, *ws->chf)) {
     LOG(ERROR) << "Could not build distance field";
     return false;
   }
-  // Partition the walkable surface into simple regions without holes.
-  if (!rcBuildRegions(&ctx, *ws.chf, 0, cfg.minRegionArea,
-                      cfg.mergeRegionArea)) {
-    LOG(ERROR) << "Could not build watershed regions";
+  // Partition the walkable surface into simple regions without holes.
+  if (!rcBuildRegions(&ctx, *ws->chf, cfg.borderSize, cfg.minRegionArea,
+                      cfg.mergeRegionArea)) {
+    LOG(ERROR) << "Could not build watershed regions";
+    return false;
+  }
+  // // Partition the walkable surface into simple regions without holes.
+  // // Monotone partitioning does not need distancefield.
+  // if (!rcBuildRegionsMonotone(ctx, *ws->chf, 0, cfg.minRegionArea,
+  // cfg.mergeRegionArea))
+  // // Partition the walkable surface into simple regions without holes.
+  // if (!rcBuildLayerRegions(ctx, *ws->chf, 0, cfg.minRegionArea))
+
+  //
+  // Step 5. Trace and simplify region contours.
+  //
+
+  // Create contours.
+  ws->cset = rcAllocContourSet();
+  if (!ws->cset) {
+    LOG(ERROR) << "Out of memory for contour set";
+    return false;
+  }
+  if (!rcBuildContours(&ctx, *ws->chf, cfg.maxSimplificationError,
+                       cfg.maxEdgeLen, *ws->cset)) {
+    LOG(ERROR) << "Could not create contours";
+    return false;
+  }
+
+  //
+  // Step 6. Build polygons mesh from contours.
+  //
+
+  // Build polygon navmesh from the contours.
+  ws->pmesh = rcAllocPolyMesh();
+  if (!ws->pmesh) {
+    LOG(ERROR) << "Out of memory for polymesh";
+    return false;
+  }
+  if (!rcBuildPolyMesh(&ctx, *ws->cset, cfg.maxVertsPerPoly, *ws->pmesh)) {
+    LOG(ERROR) << "Could not triangulate contours";
+    return false;
+  }
+
+  //
+  // Step 7. Create detail mesh which allows to access approximate height on
+  // each polygon.
+  //
+
+  ws->dmesh = rcAllocPolyMeshDetail();
+  if (!ws->dmesh) {
+    LOG(ERROR) << "Out of memory for polymesh detail";
+    return false;
+  }
+
+  if (!rcBuildPolyMeshDetail(&ctx, *ws->pmesh, *ws->chf, cfg.detailSampleDist,
+                             cfg.detailSampleMaxError, *ws->dmesh)) {
+    LOG(ERROR) << "Could not build detail mesh";
+    return false;
+  }
+
+  // At this point the navigation mesh data is ready, you can access it from
+  // ws->pmesh. See duDebugDrawPolyMesh or dtCreateNavMeshData as examples how
+  // to access the data.
+
+  //
+  // Step 8. Create Detour data from Recast poly mesh.
+  //
+
+  tileData->numVerts = ws->pmesh->nverts;
+  tileData->numPolys = ws->pmesh->npolys;
+  // Parts of a tiled navmesh may have nothing walkable in them
+  if (ws->pmesh->npolys == 0)
+    return true;
+
+  // Update poly flags from areas.
+  for (int i = 0; i < ws->pmesh->npolys; ++i) {
+    if (ws->pmesh->areas[i] == RC_WALKABLE_AREA) {
+      ws->pmesh->areas[i] = POLYAREA_GROUND;
+    }
+    if (ws->pmesh->areas[i] == POLYAREA_GROUND) {
+      ws->pmesh->flags[i] = POLYFLAGS_WALK;
+    } else if (ws->pmesh->areas[i] == POLYAREA_DOOR) {
+      ws->pmesh->flags[i] = POLYFLAGS_WALK | POLYFLAGS_DOOR;
+    }
+  }
+
+  dtNavMeshCreateParams params;
+  memset(&params, 0, sizeof(params));
+  params.verts = ws->pmesh->verts;
+  params.vertCount = ws->pmesh->nverts;
+  params.polys = ws->pmesh->polys;
+  params.polyAreas = ws->pmesh->areas;
+  params.polyFlags = ws->pmesh->flags;
+  params.polyCount = ws->pmesh->npolys;
+  params.nvp = ws->pmesh->nvp;
+  params.detailMeshes = ws->dmesh->meshes;
+  params.detailVerts = ws->dmesh->verts;
+  params.detailVertsCount = ws->dmesh->nverts;
+  params.detailTris = ws->dmesh->tris;
+  params.detailTriCount = ws->dmesh->ntris;
+  // params.offMeshConVerts = geom->getOffMeshConnectionVerts();
+  // params.offMeshConRad = geom->getOffMeshConnectionRads();
+  // params.offMeshConDir = geom->getOffMeshConnectionDirs();
+  // params.offMeshConAreas = geom->getOffMeshConnectionAreas();
+  // params.offMeshConFlags = geom->getOffMeshConnectionFlags();
+  // params.offMeshConUserID = geom->getOffMeshConnectionId();
+  // params.offMeshConCount = geom->getOffMeshConnectionCount();
+  params.walkableHeight = bs.agentHeight;
+  params.walkableRadius = bs.agentRadius;
+  params.walkableClimb = bs.agentMaxClimb;
+  rcVcopy(params.bmin, ws->pmesh->bmin);
+  rcVcopy(params.bmax, ws->pmesh->bmax);
+  params.cs = cfg.cs;
+  params.ch = cfg.ch;
+  params.tileX = tileX;
+  params.tileY = tileY;
+  params.buildBvTree = true;
+
+  if (!dtCreateNavMeshData(&params, &tileData->data, &tileData->dataSize)) {
+    LOG(ERROR) << "Could not build Detour navmesh";
+    return false;
+  }
+
+  return true;
+}
+
+// Runs the whole Recast pipeline on the area given by cfg and creates the
+// Detour data for it.  For a tiled navmesh, cfg covers a single tile plus a
+// border of cfg.borderSize cells and only the triangles overlapping it need to
+// be passed, the same goes for obstacles
+bool buildTileNavData(const NavMeshSettings& bs,
+                      const rcConfig& cfg,
+                      const int tileX,
+                      const int tileY,
+                      const float* verts,
+                      const int nverts,
+                      const int* tris,
+                      const int ntris,
+                      const std::vector<impl::NavObstacle>& obstacles,
+                      impl::TileNavData* tileData) {
+  Workspace ws;
+  return rasterizeHeightfield(bs, cfg, verts, nverts, tris, ntris, &ws) &&
+         buildCompactHeightfield(bs, cfg, *ws.solid, &ws) &&
+         buildNavDataFromCompactHeightfield(bs, cfg, tileX, tileY, obstacles,
+                                            &ws, tileData);
+}
+
+void freeTiles(std::vector<impl::TileNavData>* tiles) {
+  for (impl::TileNavData& tile : *tiles) {
+    dtFree(tile.data);
+    tile.data = nullptr;
+  }
+}
+
+// Copies the triangles a tiled navmesh is built from, so that its tiles can be
+// rebuilt for obstacles without the caller keeping the mesh around
+std::shared_ptr<const impl::TileGeometry> makeTileGeometry(const float* verts,
+                                                           const int nverts,
+                                                           const int* tris,
+                                                           const int ntris) {
+  auto geometry = std::make_shared<impl::TileGeometry>();
+  geometry->verts.assign(verts, verts + 3 * nverts);
+  geometry->tris.assign(tris, tris + 3 * ntris);
+  return geometry;
+}
+
+// Builds the tiles of grid with the given ids in parallel.  Only the triangles
+// and obstacles that overlap a tile, including its border, are used for it
+bool buildTiles(const impl::TileGrid& grid,
+                const float* verts,
+                const int nverts,
+                const int* tris,
+                const int ntris,
+                const std::vector<int>& tileIds,
+                const std::vector<impl::NavObstacle>& obstacles,
+                std::vector<impl::TileNavData>* tiles) {
+  const float tileWidth = grid.tileWidth();
+  const float borderWidth = grid.borderSize() * grid.cfg.cs;
+
+  std::vector<int> tileSlots(grid.tilesX * grid.tilesY, -1);
+  for (int i = 0; i < tileIds.size(); ++i) {
+    tileSlots[tileIds[i]] = i;
+  }
+
+  std::vector<std::vector<int>> tileTris(tileIds.size());
+  for (int iTri = 0; iTri < ntris; ++iTri) {
+    float triMin[3], triMax[3];
+    rcVcopy(triMin, &verts[tris[3 * iTri] * 3]);
+    rcVcopy(triMax, triMin);
+    for (int jVert = 1; jVert < 3; ++jVert) {
+      const float* v = &verts[tris[3 * iTri + jVert] * 3];
+      rcVmin(triMin, v);
+      rcVmax(triMax, v);
+    }
+
+    int tx0, ty0, tx1, ty1;
+    grid.tileRange(triMin, triMax, borderWidth, &tx0, &ty0, &tx1, &ty1);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+      for (int tx = tx0; tx <= tx1; ++tx) {
+        const int slot = tileSlots[ty * grid.tilesX + tx];
+        if (slot < 0)
+          continue;
+        tileTris[slot].insert(tileTris[slot].end(), &tris[3 * iTri],
+                              &tris[3 * iTri + 3]);
+      }
+    }
+  }
+
+  const float agentRadius = grid.cfg.walkableRadius * grid.cfg.cs;
+  std::vector<std::vector<impl::NavObstacle>> tileObstacles(tileIds.size());
+  for (const impl::NavObstacle& obstacle : obstacles) {
+    vec3f obstacleMin, obstacleMax;
+    std::tie(obstacleMin, obstacleMax) = obstacle.bounds(agentRadius);
+    int tx0, ty0, tx1, ty1;
+    grid.tileRange(obstacleMin.data(), obstacleMax.data(), borderWidth, &tx0,
+                   &ty0, &tx1, &ty1);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+      for (int tx = tx0; tx <= tx1; ++tx) {
+        const int slot = tileSlots[ty * grid.tilesX + tx];
+        if (slot >= 0)
+          tileObstacles[slot].emplace_back(obstacle);
+      }
+    }
+  }
+
+  rcConfig cfg = grid.cfg;
+  cfg.tileSize = grid.settings.tileSize;
+  cfg.borderSize = grid.borderSize();
+  cfg.width = cfg.tileSize + 2 * cfg.borderSize;
+  cfg.height = cfg.tileSize + 2 * cfg.borderSize;
+
+  // Every tile is independent of the others up until they are added to the
+  // navmesh, so they are all built at once
+  tiles->assign(tileIds.size(), impl::TileNavData{});
+  std::atomic<bool> failed{false};
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < tileIds.size(); ++i) {
+    const std::vector<int>& triIndices = tileTris[i];
+    if (failed || triIndices.empty())
+      continue;
+
+    const int tx = tileIds[i] % grid.tilesX;
+    const int ty = tileIds[i] / grid.tilesX;
+    rcConfig tileCfg = cfg;
+    tileCfg.bmin[0] = grid.cfg.bmin[0] + tx * tileWidth - borderWidth;
+    tileCfg.bmin[2] = grid.cfg.bmin[2] + ty * tileWidth - borderWidth;
+    tileCfg.bmax[0] = grid.cfg.bmin[0] + (tx + 1) * tileWidth + borderWidth;
+    tileCfg.bmax[2] = grid.cfg.bmin[2] + (ty + 1) * tileWidth + borderWidth;
+
+    impl::TileNavData& tile = (*tiles)[i];
+    if (!buildTileNavData(grid.settings, tileCfg, tx, ty, verts, nverts,
+                          triIndices.data(), triIndices.size() / 3,
+                          tileObstacles[i], &tile)) {
+      failed = true;
+    } else if (tile.numPolys > grid.maxPolysPerTile()) {
+      LOG(ERROR) << "Tile " << tx << "," << ty << " has " << tile.numPolys
+                 << " polygons but at most " << grid.maxPolysPerTile()
+                 << " fit, decrease the tile size";
+      failed = true;
+    }
+  }
+
+  if (failed) {
+    freeTiles(tiles);
+    return false;
+  }
+  return true;
+}
+
+// Bounds of all vertices of mesh
+std::pair<vec3f, vec3f> meshBounds(const esp::assets::MeshData& mesh) {
+  const float mf = std::numeric_limits<float>::max();
+  vec3f bmin(mf, mf, mf);
+  vec3f bmax(-mf, -mf, -mf);
+  for (const vec3f& p : mesh.vbo) {
+    bmin = bmin.cwiseMin(p);
+    bmax = bmax.cwiseMax(p);
+  }
+  return std::make_pair(bmin, bmax);
+}
+}  // namespace
+
+PathFinder::Impl::Impl() {
+  filter_ = std::make_unique<dtQueryFilter>();
+  filter_->setIncludeFlags(POLYFLAGS_WALK);
+  filter_->setExcludeFlags(0);
+}
+
+namespace {
+// Step 1 of the Recast pipeline.  Fails if the settings are not supported
+bool initBuildConfig(const NavMeshSettings& bs,
+                     const float* bmin,
+                     const float* bmax,
+                     rcConfig* buildCfg) {
+  // Init build configuration from GUI
+  rcConfig& cfg = *buildCfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.cs = bs.cellSize;
+  cfg.ch = bs.cellHeight;
+  cfg.walkableSlopeAngle = bs.agentMaxSlope;
+  cfg.walkableHeight = static_cast<int>(ceilf(bs.agentHeight / cfg.ch));
+  cfg.walkableClimb = static_cast<int>(floorf(bs.agentMaxClimb / cfg.ch));
+  cfg.walkableRadius = static_cast<int>(ceilf(bs.agentRadius / cfg.cs));
+  cfg.maxEdgeLen = static_cast<int>(bs.edgeMaxLen / bs.cellSize);
+  cfg.maxSimplificationError = bs.edgeMaxError;
+  cfg.minRegionArea =
+      static_cast<int>(rcSqr(bs.regionMinSize));  // Note: area = size*size
+  cfg.mergeRegionArea =
+      static_cast<int>(rcSqr(bs.regionMergeSize));  // Note: area = size*size
+  cfg.maxVertsPerPoly = static_cast<int>(bs.vertsPerPoly);
+  cfg.detailSampleDist =
+      bs.detailSampleDist < 0.9f ? 0 : bs.cellSize * bs.detailSampleDist;
+  cfg.detailSampleMaxError = bs.cellHeight * bs.detailSampleMaxError;
+
+  // The GUI may allow more max points per polygon than Detour can handle.
+  if (cfg.maxVertsPerPoly > DT_VERTS_PER_POLYGON) {
+    LOG(ERROR) << "Detour supports at most " << DT_VERTS_PER_POLYGON
+               << " vertices per polygon, got " << cfg.maxVertsPerPoly;
+    return false;
+  }
+
+  // Set the area where the navigation will be build.
+  // Here the bounds of the input mesh are used, but the
+  // area could be specified by an user defined box, etc.
+  rcVcopy(cfg.bmin, bmin);
+  rcVcopy(cfg.bmax, bmax);
+  rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
+  return true;
+}
+}  // namespace
+
+bool PathFinder::Impl::build(const NavMeshSettings& bs,
+                             const float* verts,
+                             const int nverts,
+                             const int* tris,
+                             const int ntris,
+                             const float* bmin,
+                             const float* bmax) {
+  //
+  // Step 1. Initialize build config.
+  //
+  rcConfig cfg;
+  if (!initBuildConfig(bs, bmin, bmax, &cfg))
+    return false;
+  LOG(INFO) << "Building navmesh with " << cfg.width << "x" << cfg.height
+            << " cells";
+
+  int numVerts = 0;
+  int numPolys = 0;
+  if (!bs.buildTiled) {
+    impl::TileNavData tileData;
+    if (!buildTileNavData(bs, cfg, 0, 0, verts, nverts, tris, ntris,
+                          obstacleList(), &tileData) ||
+        !initSoloNavMesh(&tileData)) {
+      return false;
+    }
+    numVerts = tileData.numVerts;
+    numPolys = tileData.numPolys;
+  } else if (!buildTiled(bs, cfg, verts, nverts, tris, ntris, &numVerts,
+                         &numPolys)) {
+    return false;
+  }
+
+  return finishBuild(numVerts, numPolys);
+}
+
+bool PathFinder::Impl::initSoloNavMesh(impl::TileNavData* tileData) {
+  if (!tileData->data) {
+    LOG(ERROR) << "Could not build Detour navmesh";
+    return false;
+  }
+
+  navMesh_.reset(dtAllocNavMesh());
+  mappedNavMesh_.reset();
+  if (!navMesh_) {
+    dtFree(tileData->data);
+    LOG(ERROR) << "Could not allocate Detour navmesh";
+    return false;
+  }
+
+  dtStatus status;
+  status =
+      navMesh_->init(tileData->data, tileData->dataSize, DT_TILE_FREE_DATA);
+  if (dtStatusFailed(status)) {
+    dtFree(tileData->data);
+    LOG(ERROR) << "Could not init Detour navmesh";
     return false;
   }
-  // // Partition the walkable surface into simple regions without holes.
-  // // Monotone partitioning does not need distancefield.
-  // if (!rcBuildRegionsMonotone(ctx, *ws.chf, 0, cfg.minRegionArea,
-  // cfg.mergeRegionArea))
-  // // Partition the walkable surface into simple regions without holes.
-  // if (!rcBuildLayerRegions(ctx, *ws.chf, 0, cfg.minRegionArea))
+  tileGrid_ = Cr::Containers::NullOpt;
+  resetObstacleTiles();
+  return true;
+}
 
-  //
-  // Step 5. Trace and simplify region contours.
-  //
+bool PathFinder::Impl::finishBuild(const int numVerts, const int numPolys) {
+  // Added as we also need to remove these on navmesh recomputation.  Done
+  // before computing the islands, same as when loading a navmesh
+  removeZeroAreaPolys();
 
-  // Create contours.
-  ws.cset = rcAllocContourSet();
-  if (!ws.cset) {
-    LOG(ERROR) << "Out of memory for contour set";
+  if (!initNavQuery()) {
     return false;
   }
-  if (!rcBuildContours(&ctx, *ws.chf, cfg.maxSimplificationError,
-                       cfg.maxEdgeLen, *ws.cset)) {
-    LOG(ERROR) << "Could not create contours";
+
+  LOG(INFO) << "Created navmesh with " << numVerts << " vertices " << numPolys
+            << " polygons";
+
+  return true;
+}
+
+bool PathFinder::Impl::buildProfiles(
+    const std::vector<NavMeshSettings>& profiles,
+    const esp::assets::MeshData& mesh,
+    const std::vector<Impl*>& impls) {
+  CORRADE_INTERNAL_ASSERT(profiles.size() == impls.size());
+  if (profiles.empty())
     return false;
+
+  // Everything up to and including the rasterization has to be the same for
+  // all agents to share the heightfield.  Tiles have a border that depends on
+  // the agent radius, so they can't share it either
+  const NavMeshSettings& first = profiles.front();
+  bool shareHeightfield = true;
+  for (const NavMeshSettings& bs : profiles) {
+    shareHeightfield = shareHeightfield && !bs.buildTiled &&
+                       bs.cellSize == first.cellSize &&
+                       bs.cellHeight == first.cellHeight &&
+                       bs.agentMaxSlope == first.agentMaxSlope &&
+                       bs.agentMaxClimb == first.agentMaxClimb &&
+                       bs.filterLowHangingObstacles ==
+                           first.filterLowHangingObstacles;
+  }
+  if (!shareHeightfield) {
+    LOG(INFO) << "Agent profiles differ in more than radius and height or are "
+                 "tiled, building their navmeshes one by one";
+    for (int i = 0; i < profiles.size(); ++i) {
+      if (!impls[i]->build(profiles[i], mesh))
+        return false;
+    }
+    return true;
   }
 
-  //
-  // Step 6. Build polygons mesh from contours.
-  //
+  vec3f bmin, bmax;
+  std::tie(bmin, bmax) = meshBounds(mesh);
+  const std::vector<int> tris{mesh.ibo.begin(), mesh.ibo.end()};
+  const int nverts = mesh.vbo.size();
+  const int ntris = tris.size() / 3;
+
+  std::vector<rcConfig> cfgs(profiles.size());
+  for (int i = 0; i < profiles.size(); ++i) {
+    if (!initBuildConfig(profiles[i], bmin.data(), bmax.data(), &cfgs[i]))
+      return false;
+  }
+  LOG(INFO) << "Building " << profiles.size() << " navmeshes with "
+            << cfgs[0].width << "x" << cfgs[0].height << " cells";
 
-  // Build polygon navmesh from the contours.
-  ws.pmesh = rcAllocPolyMesh();
-  if (!ws.pmesh) {
-    LOG(ERROR) << "Out of memory for polymesh";
+  Workspace shared;
+  if (!rasterizeHeightfield(first, cfgs[0], mesh.vbo[0].data(), nverts,
+                            tris.data(), ntris, &shared))
     return false;
+
+  // The height filters only clear the area of spans, so the heightfield is
+  // filtered for one agent at a time and its areas are restored afterwards
+  rcHeightfield& solid = *shared.solid;
+  std::vector<unsigned char> areas;
+  for (int i = 0; i < solid.width * solid.height; ++i) {
+    for (const rcSpan* span = solid.spans[i]; span; span = span->next)
+      areas.push_back(span->area);
   }
-  if (!rcBuildPolyMesh(&ctx, *ws.cset, cfg.maxVertsPerPoly, *ws.pmesh)) {
-    LOG(ERROR) << "Could not triangulate contours";
+  std::vector<Workspace> workspaces(profiles.size());
+  for (int i = 0; i < profiles.size(); ++i) {
+    if (!buildCompactHeightfield(profiles[i], cfgs[i], solid, &workspaces[i]))
+      return false;
+
+    int iSpan = 0;
+    for (int j = 0; j < solid.width * solid.height; ++j) {
+      for (rcSpan* span = solid.spans[j]; span; span = span->next)
+        span->area = areas[iSpan++];
+    }
+  }
+
+  // Eroding, partitioning and meshing are the bulk of the work and
+  // independent for every agent
+  std::atomic<bool> failed{false};
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < profiles.size(); ++i) {
+    impl::TileNavData tileData;
+    if (failed ||
+        !buildNavDataFromCompactHeightfield(profiles[i], cfgs[i], 0, 0,
+                                            impls[i]->obstacleList(),
+                                            &workspaces[i], &tileData) ||
+        !impls[i]->initSoloNavMesh(&tileData) ||
+        !impls[i]->finishBuild(tileData.numVerts, tileData.numPolys)) {
+      failed = true;
+    }
+  }
+  return !failed;
+}
+
+bool PathFinder::Impl::buildTiled(const NavMeshSettings& bs,
+                                  const rcConfig& solo,
+                                  const float* verts,
+                                  const int nverts,
+                                  const int* tris,
+                                  const int ntris,
+                                  int* numVerts,
+                                  int* numPolys) {
+  impl::TileGrid grid;
+  grid.settings = bs;
+  grid.cfg = solo;
+  grid.tilesX = (solo.width + bs.tileSize - 1) / bs.tileSize;
+  grid.tilesY = (solo.height + bs.tileSize - 1) / bs.tileSize;
+  const int numTiles = grid.tilesX * grid.tilesY;
+
+  // Poly refs are 32 bits wide and at least 10 of them are used for the salt
+  grid.tileBits =
+      static_cast<int>(dtIlog2(dtNextPow2(static_cast<unsigned>(numTiles))));
+  if (grid.tileBits > 14) {
+    LOG(ERROR) << "Too many tiles (" << grid.tilesX << "x" << grid.tilesY
+               << "), increase the tile size";
     return false;
   }
 
-  //
-  // Step 7. Create detail mesh which allows to access approximate height on
-  // each polygon.
-  //
+  LOG(INFO) << "Building " << grid.tilesX << "x" << grid.tilesY
+            << " tiles of " << bs.tileSize << "x" << bs.tileSize << " cells";
 
-  ws.dmesh = rcAllocPolyMeshDetail();
-  if (!ws.dmesh) {
-    LOG(ERROR) << "Out of memory for polymesh detail";
+  std::vector<int> tileIds(numTiles);
+  std::iota(tileIds.begin(), tileIds.end(), 0);
+  std::vector<impl::TileNavData> tiles;
+  if (!buildTiles(grid, verts, nverts, tris, ntris, tileIds, obstacleList(),
+                  &tiles))
+    return false;
+  grid.geometry = makeTileGeometry(verts, nverts, tris, ntris);
+
+  navMesh_.reset(dtAllocNavMesh());
+  mappedNavMesh_.reset();
+  if (!navMesh_) {
+    freeTiles(&tiles);
+    LOG(ERROR) << "Could not allocate Detour navmesh";
     return false;
   }
 
-  if (!rcBuildPolyMeshDetail(&ctx, *ws.pmesh, *ws.chf, cfg.detailSampleDist,
-                             cfg.detailSampleMaxError, *ws.dmesh)) {
-    LOG(ERROR) << "Could not build detail mesh";
+  dtNavMeshParams params;
+  rcVcopy(params.orig, solo.bmin);
+  params.tileWidth = grid.tileWidth();
+  params.tileHeight = grid.tileWidth();
+  params.maxTiles = 1 << grid.tileBits;
+  params.maxPolys = grid.maxPolysPerTile();
+  if (dtStatusFailed(navMesh_->init(&params))) {
+    freeTiles(&tiles);
+    LOG(ERROR) << "Could not init Detour navmesh";
     return false;
   }
 
-  // At this point the navigation mesh data is ready, you can access it from
-  // ws.pmesh. See duDebugDrawPolyMesh or dtCreateNavMeshData as examples how to
-  // access the data.
+  if (!addTiles(&tiles, numVerts, numPolys))
+    return false;
 
-  //
-  // (Optional) Step 8. Create Detour data from Recast poly mesh.
-  //
+  tileGrid_ = grid;
+  resetObstacleTiles();
+  return true;
+}
 
-  // The GUI may allow more max points per polygon than Detour can handle.
-  // Only build the detour navmesh if we do not exceed the limit.
-  if (cfg.maxVertsPerPoly <= DT_VERTS_PER_POLYGON) {
-    unsigned char* navData = 0;
-    int navDataSize = 0;
-
-    // Update poly flags from areas.
-    for (int i = 0; i < ws.pmesh->npolys; ++i) {
-      if (ws.pmesh->areas[i] == RC_WALKABLE_AREA) {
-        ws.pmesh->areas[i] = POLYAREA_GROUND;
-      }
-      if (ws.pmesh->areas[i] == POLYAREA_GROUND) {
-        ws.pmesh->flags[i] = POLYFLAGS_WALK;
-      } else if (ws.pmesh->areas[i] == POLYAREA_DOOR) {
-        ws.pmesh->flags[i] = POLYFLAGS_WALK | POLYFLAGS_DOOR;
+bool PathFinder::Impl::addTiles(std::vector<impl::TileNavData>* tiles,
+                                int* numVerts,
+                                int* numPolys) {
+  *numVerts = 0;
+  *numPolys = 0;
+  for (impl::TileNavData& tile : *tiles) {
+    if (!tile.data)
+      continue;
+
+    if (dtStatusFailed(navMesh_->addTile(tile.data, tile.dataSize,
+                                         DT_TILE_FREE_DATA, 0, nullptr))) {
+      freeTiles(tiles);
+      LOG(ERROR) << "Could not add tile to Detour navmesh";
+      return false;
+    }
+    // The navmesh owns the data now
+    tile.data = nullptr;
+    *numVerts += tile.numVerts;
+    *numPolys += tile.numPolys;
+  }
+  return true;
+}
+
+bool PathFinder::Impl::rebuildRegions(
+    const NavMeshSettings& bs,
+    const esp::assets::MeshData& mesh,
+    const std::vector<std::pair<vec3f, vec3f>>& regions) {
+  // Tiles carved for obstacles in the meantime would still have the old mesh
+  discardObstacleJob();
+
+  vec3f bmin, bmax;
+  std::tie(bmin, bmax) = meshBounds(mesh);
+
+  // Tiles can only be swapped out if the new mesh maps to the same grid with
+  // the same settings, otherwise everything needs to be rebuilt
+  if (!isLoaded() || !tileGrid_ || tileGrid_->settings != bs ||
+      vec3f(tileGrid_->cfg.bmin) != bmin ||
+      vec3f(tileGrid_->cfg.bmax) != bmax) {
+    LOG(INFO) << "Navmesh can not be updated in place, rebuilding all of it";
+    return build(bs, mesh);
+  }
+  const impl::TileGrid& grid = *tileGrid_;
+
+  // Changes within the border of a tile affect it as well
+  const float borderWidth = grid.borderSize() * grid.cfg.cs;
+  const int numTiles = grid.tilesX * grid.tilesY;
+  std::vector<bool> isDirty(numTiles, false);
+  for (const auto& region : regions) {
+    int tx0, ty0, tx1, ty1;
+    grid.tileRange(region.first.data(), region.second.data(), borderWidth,
+                   &tx0, &ty0, &tx1, &ty1);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+      for (int tx = tx0; tx <= tx1; ++tx) {
+        isDirty[ty * grid.tilesX + tx] = true;
       }
     }
+  }
+  std::vector<int> tileIds;
+  for (int iTile = 0; iTile < numTiles; ++iTile) {
+    if (isDirty[iTile])
+      tileIds.emplace_back(iTile);
+  }
+  if (tileIds.empty())
+    return true;
 
-    dtNavMeshCreateParams params;
-    memset(&params, 0, sizeof(params));
-    params.verts = ws.pmesh->verts;
-    params.vertCount = ws.pmesh->nverts;
-    params.polys = ws.pmesh->polys;
-    params.polyAreas = ws.pmesh->areas;
-    params.polyFlags = ws.pmesh->flags;
-    params.polyCount = ws.pmesh->npolys;
-    params.nvp = ws.pmesh->nvp;
-    params.detailMeshes = ws.dmesh->meshes;
-    params.detailVerts = ws.dmesh->verts;
-    params.detailVertsCount = ws.dmesh->nverts;
-    params.detailTris = ws.dmesh->tris;
-    params.detailTriCount = ws.dmesh->ntris;
-    // params.offMeshConVerts = geom->getOffMeshConnectionVerts();
-    // params.offMeshConRad = geom->getOffMeshConnectionRads();
-    // params.offMeshConDir = geom->getOffMeshConnectionDirs();
-    // params.offMeshConAreas = geom->getOffMeshConnectionAreas();
-    // params.offMeshConFlags = geom->getOffMeshConnectionFlags();
-    // params.offMeshConUserID = geom->getOffMeshConnectionId();
-    // params.offMeshConCount = geom->getOffMeshConnectionCount();
-    params.walkableHeight = bs.agentHeight;
-    params.walkableRadius = bs.agentRadius;
-    params.walkableClimb = bs.agentMaxClimb;
-    rcVcopy(params.bmin, ws.pmesh->bmin);
-    rcVcopy(params.bmax, ws.pmesh->bmax);
-    params.cs = cfg.cs;
-    params.ch = cfg.ch;
-    params.buildBvTree = true;
-
-    if (!dtCreateNavMeshData(&params, &navData, &navDataSize)) {
-      LOG(ERROR) << "Could not build Detour navmesh";
-      return false;
+  LOG(INFO) << "Rebuilding " << tileIds.size() << " of " << numTiles
+            << " navmesh tiles";
+
+  std::vector<int> indices(mesh.ibo.begin(), mesh.ibo.end());
+  std::vector<impl::TileNavData> tiles;
+  if (!buildTiles(grid, mesh.vbo[0].data(), mesh.vbo.size(), indices.data(),
+                  indices.size() / 3, tileIds, obstacleList(), &tiles)) {
+    return false;
+  }
+
+  int numVerts, numPolys;
+  if (!replaceTiles(tileIds, &tiles, &numVerts, &numPolys))
+    return false;
+
+  tileGrid_->geometry = makeTileGeometry(mesh.vbo[0].data(), mesh.vbo.size(),
+                                         indices.data(), indices.size() / 3);
+  // The rebuilt tiles have all obstacles carved in
+  for (const int iTile : tileIds) {
+    obstacleDirtyTiles_[iTile] = false;
+  }
+
+  LOG(INFO) << "Rebuilt navmesh tiles with " << numVerts << " vertices "
+            << numPolys << " polygons";
+
+  return true;
+}
+
+void PathFinder::Impl::restoreTiles(
+    const std::vector<int>& tileIds,
+    std::vector<std::pair<dtTileRef, impl::TileNavData>>* removedTiles) {
+  const impl::TileGrid& grid = *tileGrid_;
+
+  // Some of the new tiles may have made it in before one failed
+  for (const int iTile : tileIds) {
+    const dtMeshTile* tile =
+        navMesh_->getTileAt(iTile % grid.tilesX, iTile / grid.tilesX, 0);
+    if (tile)
+      navMesh_->removeTile(navMesh_->getTileRef(tile), nullptr, nullptr);
+  }
+
+  // Re-adding them under their old refs keeps every poly ref the same, so
+  // nothing derived from the navmesh has to change
+  bool restored = true;
+  for (auto& removed : *removedTiles) {
+    impl::TileNavData& tile = removed.second;
+    if (dtStatusFailed(navMesh_->addTile(tile.data, tile.dataSize,
+                                         DT_TILE_FREE_DATA, removed.first,
+                                         nullptr))) {
+      dtFree(tile.data);
+      restored = false;
     }
+    tile.data = nullptr;
+  }
+  if (restored)
+    return;
+
+  LOG(ERROR) << "Could not restore the replaced navmesh tiles, recomputing "
+                "everything derived from the navmesh";
+  initNavQuery();
+}
+
+bool PathFinder::Impl::replaceTiles(const std::vector<int>& tileIds,
+                                    std::vector<impl::TileNavData>* tiles,
+                                    int* numVerts,
+                                    int* numPolys) {
+  const impl::TileGrid& grid = *tileGrid_;
+
+  // Swap out the old tiles, remembering their polys so that the islands they
+  // were on can be recomputed.  The navmesh frees the data of removed tiles,
+  // so a copy is kept to put them back if the new ones can't be added
+  std::vector<dtPolyRef> removedPolys;
+  std::vector<std::pair<dtTileRef, impl::TileNavData>> removedTiles;
+  for (size_t i = 0; i < tileIds.size(); ++i) {
+    const int iTile = tileIds[i];
+    const int tx = iTile % grid.tilesX;
+    const int ty = iTile / grid.tilesX;
+    const dtMeshTile* tile = navMesh_->getTileAt(tx, ty, 0);
+    if (!tile)
+      continue;
 
-    navMesh_.reset(dtAllocNavMesh());
-    if (!navMesh_) {
-      dtFree(navData);
-      LOG(ERROR) << "Could not allocate Detour navmesh";
+    const dtPolyRef base = navMesh_->getPolyRefBase(tile);
+    for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+      removedPolys.emplace_back(base | static_cast<dtPolyRef>(jPoly));
+    }
+    impl::TileNavData copy;
+    copy.dataSize = tile->dataSize;
+    copy.data =
+        static_cast<unsigned char*>(dtAlloc(tile->dataSize, DT_ALLOC_PERM));
+    if (!copy.data) {
+      LOG(ERROR) << "Could not allocate a copy of a navmesh tile";
+      freeTiles(tiles);
+      // Only the tiles before this one were swapped out
+      restoreTiles(std::vector<int>(tileIds.begin(), tileIds.begin() + i),
+                   &removedTiles);
       return false;
     }
+    memcpy(copy.data, tile->data, tile->dataSize);
+    removedTiles.emplace_back(navMesh_->getTileRef(tile), copy);
+    navMesh_->removeTile(navMesh_->getTileRef(tile), nullptr, nullptr);
+  }
 
-    dtStatus status;
-    status = navMesh_->init(navData, navDataSize, DT_TILE_FREE_DATA);
-    if (dtStatusFailed(status)) {
-      dtFree(navData);
-      LOG(ERROR) << "Could not init Detour navmesh";
+  if (!addTiles(tiles, numVerts, numPolys)) {
+    restoreTiles(tileIds, &removedTiles);
+    return false;
+  }
+  for (auto& removed : removedTiles) {
+    dtFree(removed.second.data);
+  }
+
+  removeZeroAreaPolys();
+
+  std::vector<dtPolyRef> addedPolys;
+  for (const int iTile : tileIds) {
+    const dtMeshTile* tile =
+        navMesh_->getTileAt(iTile % grid.tilesX, iTile / grid.tilesX, 0);
+    if (!tile)
+      continue;
+
+    const dtPolyRef base = navMesh_->getPolyRefBase(tile);
+    for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+      addedPolys.emplace_back(base | static_cast<dtPolyRef>(jPoly));
+    }
+  }
+
+  // The navmesh object itself is kept, so the queries in the pool stay valid.
+  // Everything derived from the old tiles is not though
+  meshData_.reset();
+  navMeshId_ = nextNavMeshId++;
+  islandSystem_->update(filter_.get(), removedPolys, addedPolys);
+  // Islands far from the replaced tiles may have been split or merged too
+  islandBorders_ = std::make_unique<impl::IslandBorders>(
+      navMesh_.get(), navQueryPool_->acquire().get(), filter_.get(),
+      *islandSystem_);
+  pathHierarchy_ =
+      std::make_unique<impl::PathHierarchy>(navMesh_.get(), filter_.get());
+  polyAreaSampler_ = std::make_unique<impl::PolyAreaSampler>(
+      navMesh_.get(), filter_.get(), *islandSystem_);
+  resetObstacleDistanceField();
+
+  return true;
+}
+
+namespace {
+impl::NavObstacle makeObstacle(const bool isCylinder,
+                               const vec3f& center,
+                               const vec3f& halfExtents,
+                               const float yaw) {
+  impl::NavObstacle obstacle;
+  obstacle.isCylinder = isCylinder;
+  obstacle.center = center;
+  obstacle.halfExtents = halfExtents;
+  obstacle.yaw = yaw;
+  return obstacle;
+}
+}  // namespace
+
+int PathFinder::Impl::addCylinderObstacle(const vec3f& center,
+                                          const float radius,
+                                          const float height) {
+  return addObstacle(makeObstacle(true, center,
+                                  vec3f{radius, 0.5f * height, radius}, 0.0f));
+}
+
+int PathFinder::Impl::addBoxObstacle(const vec3f& center,
+                                     const vec3f& halfExtents,
+                                     const float yaw) {
+  return addObstacle(makeObstacle(false, center, halfExtents, yaw));
+}
+
+int PathFinder::Impl::addObstacle(const impl::NavObstacle& obstacle) {
+  const int obstacleId = nextObstacleId_++;
+  obstacles_[obstacleId] = obstacle;
+  markObstacleTilesDirty(obstacle);
+  return obstacleId;
+}
+
+bool PathFinder::Impl::moveObstacle(const int obstacleId,
+                                    const vec3f& center,
+                                    const float yaw) {
+  auto it = obstacles_.find(obstacleId);
+  if (it == obstacles_.end())
+    return false;
+
+  // Both where the obstacle was and where it is now change
+  impl::NavObstacle& obstacle = it->second;
+  markObstacleTilesDirty(obstacle);
+  obstacle.center = center;
+  if (!obstacle.isCylinder)
+    obstacle.yaw = yaw;
+  markObstacleTilesDirty(obstacle);
+  return true;
+}
+
+bool PathFinder::Impl::removeObstacle(const int obstacleId) {
+  auto it = obstacles_.find(obstacleId);
+  if (it == obstacles_.end())
+    return false;
+
+  markObstacleTilesDirty(it->second);
+  obstacles_.erase(it);
+  return true;
+}
+
+void PathFinder::Impl::copyObstacles(const Impl& other) {
+  for (const auto& it : obstacles_) {
+    auto found = other.obstacles_.find(it.first);
+    if (found == other.obstacles_.end() || !(found->second == it.second))
+      markObstacleTilesDirty(it.second);
+  }
+  for (const auto& it : other.obstacles_) {
+    auto found = obstacles_.find(it.first);
+    if (found == obstacles_.end() || !(found->second == it.second))
+      markObstacleTilesDirty(it.second);
+  }
+  obstacles_ = other.obstacles_;
+  nextObstacleId_ = other.nextObstacleId_;
+}
+
+std::vector<impl::NavObstacle> PathFinder::Impl::obstacleList() const {
+  std::vector<impl::NavObstacle> obstacles;
+  obstacles.reserve(obstacles_.size());
+  for (const auto& it : obstacles_) {
+    obstacles.emplace_back(it.second);
+  }
+  return obstacles;
+}
+
+void PathFinder::Impl::markObstacleTilesDirty(
+    const impl::NavObstacle& obstacle) {
+  if (!tileGrid_)
+    return;
+
+  const impl::TileGrid& grid = *tileGrid_;
+  vec3f bmin, bmax;
+  std::tie(bmin, bmax) = obstacle.bounds(grid.cfg.walkableRadius * grid.cfg.cs);
+  int tx0, ty0, tx1, ty1;
+  grid.tileRange(bmin.data(), bmax.data(), grid.borderSize() * grid.cfg.cs,
+                 &tx0, &ty0, &tx1, &ty1);
+  for (int ty = ty0; ty <= ty1; ++ty) {
+    for (int tx = tx0; tx <= tx1; ++tx) {
+      obstacleDirtyTiles_[ty * grid.tilesX + tx] = true;
+    }
+  }
+}
+
+bool PathFinder::Impl::updateObstacles(const bool blocking) {
+  if (!tileGrid_) {
+    LOG(ERROR) << "Obstacles can only be carved into a navmesh built with "
+                  "NavMeshSettings::buildTiled";
+    return false;
+  }
+
+  if (obstacleJob_) {
+    if (!blocking && obstacleJob_->built.wait_for(std::chrono::seconds(0)) !=
+                         std::future_status::ready) {
       return false;
     }
-    if (!initNavQuery()) {
+    if (!finishObstacleJob())
       return false;
+  }
+
+  std::vector<int> tileIds;
+  for (int iTile = 0; iTile < obstacleDirtyTiles_.size(); ++iTile) {
+    if (obstacleDirtyTiles_[iTile]) {
+      tileIds.emplace_back(iTile);
+      obstacleDirtyTiles_[iTile] = false;
     }
   }
+  if (tileIds.empty())
+    return true;
 
-  // Added as we also need to remove these on navmesh recomputation
-  removeZeroAreaPolys();
+  // The job only works on copies, so the obstacles and the navmesh can be
+  // used and changed while it runs
+  obstacleJob_ = std::make_unique<ObstacleJob>();
+  ObstacleJob* job = obstacleJob_.get();
+  job->tileIds = std::move(tileIds);
+  job->built = std::async(
+      std::launch::async,
+      [job, grid = *tileGrid_, obstacles = obstacleList()]() {
+        const impl::TileGeometry& geometry = *grid.geometry;
+        return buildTiles(grid, geometry.verts.data(),
+                          geometry.verts.size() / 3, geometry.tris.data(),
+                          geometry.tris.size() / 3, job->tileIds, obstacles,
+                          &job->tiles);
+      });
+
+  if (!blocking)
+    return false;
+  return finishObstacleJob();
+}
 
-  LOG(INFO) << "Created navmesh with " << ws.pmesh->nverts << " vertices "
-            << ws.pmesh->npolys << " polygons";
+bool PathFinder::Impl::finishObstacleJob() {
+  std::unique_ptr<ObstacleJob> job = std::move(obstacleJob_);
+  if (!job->built.get()) {
+    LOG(ERROR) << "Could not carve obstacles into the navmesh";
+    return false;
+  }
 
+  int numVerts, numPolys;
+  if (!replaceTiles(job->tileIds, &job->tiles, &numVerts, &numPolys)) {
+    // Try again with the next update
+    for (const int iTile : job->tileIds) {
+      obstacleDirtyTiles_[iTile] = true;
+    }
+    return false;
+  }
   return true;
 }
 
-bool PathFinder::Impl::initNavQuery() {
+void PathFinder::Impl::discardObstacleJob() {
+  if (!obstacleJob_)
+    return;
+
+  std::unique_ptr<ObstacleJob> job = std::move(obstacleJob_);
+  job->built.wait();
+  freeTiles(&job->tiles);
+  for (const int iTile : job->tileIds) {
+    if (iTile < obstacleDirtyTiles_.size())
+      obstacleDirtyTiles_[iTile] = true;
+  }
+}
+
+void PathFinder::Impl::resetObstacleTiles() {
+  discardObstacleJob();
+  obstacleDirtyTiles_.assign(
+      tileGrid_ ? tileGrid_->tilesX * tileGrid_->tilesY : 0, false);
+}
+
+bool PathFinder::Impl::initNavQuery(
+    std::unique_ptr<impl::IslandSystem> islandSystem) {
   // if we are reinitializing the NavQuery, then also reset the MeshData
   meshData_.reset();
+  resetObstacleDistanceField();
 
-  navQuery_.reset(dtAllocNavMeshQuery());
-  dtStatus status = navQuery_->init(navMesh_.get(), 2048);
-  if (dtStatusFailed(status)) {
-    LOG(ERROR) << "Could not init Detour navmesh query";
+  navMeshId_ = nextNavMeshId++;
+  navQueryPool_ = std::make_unique<impl::NavQueryPool>(
+      navMesh_.get(), impl::NAV_QUERY_MAX_NODES);
+  // Initialize the first query eagerly so that failures are reported here
+  if (!navQueryPool_->acquire()) {
     return false;
   }
 
-  islandSystem_ =
-      std::make_unique<impl::IslandSystem>(navMesh_.get(), filter_.get());
+  if (islandSystem) {
+    islandSystem_ = std::move(islandSystem);
+  } else {
+    islandSystem_ =
+        std::make_unique<impl::IslandSystem>(navMesh_.get(), filter_.get());
+  }
+  islandBorders_ = std::make_unique<impl::IslandBorders>(
+      navMesh_.get(), navQueryPool_->acquire().get(), filter_.get(),
+      *islandSystem_);
+  pathHierarchy_ =
+      std::make_unique<impl::PathHierarchy>(navMesh_.get(), filter_.get());
+  polyAreaSampler_ = std::make_unique<impl::PolyAreaSampler>(
+      navMesh_.get(), filter_.get(), *islandSystem_);
 
   return true;
 }
@@ -667,15 +3230,8 @@ bool PathFinder::Impl::build(const NavMeshSettings& bs,
                              const esp::assets::MeshData& mesh) {
   const int numVerts = mesh.vbo.size();
   const int numIndices = mesh.ibo.size();
-  const float mf = std::numeric_limits<float>::max();
-  vec3f bmin(mf, mf, mf);
-  vec3f bmax(-mf, -mf, -mf);
-
-  for (int i = 0; i < numVerts; i++) {
-    const vec3f& p = mesh.vbo[i];
-    bmin = bmin.cwiseMin(p);
-    bmax = bmax.cwiseMax(p);
-  }
+  vec3f bmin, bmax;
+  std::tie(bmin, bmax) = meshBounds(mesh);
 
   int* indices = new int[numIndices];
   for (int i = 0; i < numIndices; i++) {
@@ -690,7 +3246,18 @@ bool PathFinder::Impl::build(const NavMeshSettings& bs,
 
 namespace {
 const int NAVMESHSET_MAGIC = 'M' << 24 | 'S' << 16 | 'E' << 8 | 'T';  //'MSET';
-const int NAVMESHSET_VERSION = 1;
+// Version 2 pads the file so that the data of every tile starts at a multiple
+// of NAVMESHSET_ALIGNMENT, which allows using it in place when memory mapped.
+// Version 3 stores the islands of the navmesh after the tiles
+// Version 4 stores the obstacle distance field after the islands, only its
+// empty header if the field is disabled
+const int NAVMESHSET_VERSION = 4;
+const long NAVMESHSET_ALIGNMENT = 16;
+
+long alignmentPadding(long offset) {
+  return (NAVMESHSET_ALIGNMENT - offset % NAVMESHSET_ALIGNMENT) %
+         NAVMESHSET_ALIGNMENT;
+}
 
 struct NavMeshSetHeader {
   int magic;
@@ -757,13 +3324,13 @@ void PathFinder::Impl::removeZeroAreaPolys() {
   for (int iTile = 0; iTile < navMesh_->getMaxTiles(); ++iTile) {
     const dtMeshTile* tile =
         const_cast<const dtNavMesh*>(navMesh_.get())->getTile(iTile);
-    if (!tile)
+    if (!tile || !tile->header)
       continue;
 
     // Iterate over all polygons in a tile
     for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
       // Get the polygon reference from the tile and polygon id
-      dtPolyRef polyRef = navMesh_->encodePolyId(iTile, tile->salt, jPoly);
+      dtPolyRef polyRef = navMesh_->encodePolyId(tile->salt, iTile, jPoly);
       const dtPoly* poly = nullptr;
       const dtMeshTile* tmp = nullptr;
       navMesh_->getTileAndPolyByRefUnsafe(polyRef, &tmp, &poly);
@@ -778,84 +3345,213 @@ void PathFinder::Impl::removeZeroAreaPolys() {
   }
 }
 
-bool PathFinder::Impl::loadNavMesh(const std::string& path) {
+bool PathFinder::Impl::loadNavMesh(const std::string& path,
+                                   bool memoryMap) {
+  if (memoryMap)
+    return loadNavMeshMapped(path);
+
   FILE* fp = fopen(path.c_str(), "rb");
   if (!fp)
     return false;
 
-  // Read header.
-  NavMeshSetHeader header;
-  size_t readLen = fread(&header, sizeof(NavMeshSetHeader), 1, fp);
-  if (readLen != 1) {
-    fclose(fp);
+  // Read header.
+  NavMeshSetHeader header;
+  size_t readLen = fread(&header, sizeof(NavMeshSetHeader), 1, fp);
+  if (readLen != 1) {
+    fclose(fp);
+    return false;
+  }
+  if (header.magic != NAVMESHSET_MAGIC) {
+    fclose(fp);
+    return false;
+  }
+  if (header.version < 1 || header.version > NAVMESHSET_VERSION) {
+    fclose(fp);
+    return false;
+  }
+
+  dtNavMesh* mesh = dtAllocNavMesh();
+  if (!mesh) {
+    fclose(fp);
+    return false;
+  }
+  dtStatus status = mesh->init(&header.params);
+  if (dtStatusFailed(status)) {
+    dtFreeNavMesh(mesh);
+    fclose(fp);
+    return false;
+  }
+
+  // Read tiles.
+  for (int i = 0; i < header.numTiles; ++i) {
+    NavMeshTileHeader tileHeader;
+    readLen = fread(&tileHeader, sizeof(tileHeader), 1, fp);
+    if (readLen != 1) {
+      dtFreeNavMesh(mesh);
+      fclose(fp);
+      return false;
+    }
+
+    if (!tileHeader.tileRef || !tileHeader.dataSize)
+      break;
+
+    if (header.version >= 2)
+      fseek(fp, alignmentPadding(ftell(fp)), SEEK_CUR);
+
+    unsigned char* data = static_cast<unsigned char*>(
+        dtAlloc(tileHeader.dataSize, DT_ALLOC_PERM));
+    if (!data)
+      break;
+    memset(data, 0, tileHeader.dataSize);
+    readLen = fread(data, tileHeader.dataSize, 1, fp);
+    if (readLen != 1) {
+      dtFree(data);
+      dtFreeNavMesh(mesh);
+      fclose(fp);
+      return false;
+    }
+
+    mesh->addTile(data, tileHeader.dataSize, DT_TILE_FREE_DATA,
+                  tileHeader.tileRef, 0);
+  }
+
+  const auto read = [fp](void* dst, size_t size) {
+    return fread(dst, size, 1, fp) == 1 || size == 0;
+  };
+  std::unique_ptr<impl::IslandSystem> islandSystem = nullptr;
+  if (header.version >= 3) {
+    islandSystem = impl::IslandSystem::deserialize(mesh, read);
+    if (!islandSystem)
+      LOG(WARNING) << "Could not read the islands of " << path;
+  }
+  std::unique_ptr<impl::ObstacleDistanceField> obstacleDistanceField =
+      nullptr;
+  if (header.version >= 4 && islandSystem)
+    obstacleDistanceField =
+        impl::ObstacleDistanceField::deserialize(mesh, read);
+
+  fclose(fp);
+
+  if (!initLoadedNavMesh(mesh, nullptr, std::move(islandSystem)))
+    return false;
+  resetObstacleDistanceField(std::move(obstacleDistanceField));
+  return true;
+}
+
+bool PathFinder::Impl::loadNavMeshMapped(const std::string& path) {
+  std::unique_ptr<impl::MappedFile> file = impl::MappedFile::open(path);
+  if (!file)
     return false;
-  }
-  if (header.magic != NAVMESHSET_MAGIC) {
-    fclose(fp);
+
+  const unsigned char* end = file->data() + file->size();
+  if (file->size() < sizeof(NavMeshSetHeader))
     return false;
-  }
-  if (header.version != NAVMESHSET_VERSION) {
-    fclose(fp);
+  NavMeshSetHeader header;
+  memcpy(&header, file->data(), sizeof(NavMeshSetHeader));
+  if (header.magic != NAVMESHSET_MAGIC)
     return false;
+  if (header.version < 2 || header.version > NAVMESHSET_VERSION) {
+    // Older files do not have their tiles aligned
+    LOG(WARNING) << path << " has version " << header.version
+                 << " which can not be memory mapped, save it again to "
+                    "update it.  Loading a copy instead";
+    return loadNavMesh(path, /*memoryMap=*/false);
   }
 
-  vec3f bmin, bmax;
-
   dtNavMesh* mesh = dtAllocNavMesh();
-  if (!mesh) {
-    fclose(fp);
+  if (!mesh)
     return false;
-  }
   dtStatus status = mesh->init(&header.params);
   if (dtStatusFailed(status)) {
-    fclose(fp);
+    dtFreeNavMesh(mesh);
     return false;
   }
 
-  // Read tiles.
+  // Hand the tiles to the navmesh where they are in the file.  Detour still
+  // writes the links and flags of the polys, those pages are copied on write
+  // while everything else stays shared
+  unsigned char* cursor = file->data() + sizeof(NavMeshSetHeader);
   for (int i = 0; i < header.numTiles; ++i) {
-    NavMeshTileHeader tileHeader;
-    readLen = fread(&tileHeader, sizeof(tileHeader), 1, fp);
-    if (readLen != 1) {
-      fclose(fp);
+    if (end - cursor < static_cast<long>(sizeof(NavMeshTileHeader))) {
+      dtFreeNavMesh(mesh);
       return false;
     }
+    NavMeshTileHeader tileHeader;
+    memcpy(&tileHeader, cursor, sizeof(NavMeshTileHeader));
+    cursor += sizeof(NavMeshTileHeader);
 
     if (!tileHeader.tileRef || !tileHeader.dataSize)
       break;
 
-    unsigned char* data = static_cast<unsigned char*>(
-        dtAlloc(tileHeader.dataSize, DT_ALLOC_PERM));
-    if (!data)
-      break;
-    memset(data, 0, tileHeader.dataSize);
-    readLen = fread(data, tileHeader.dataSize, 1, fp);
-    if (readLen != 1) {
-      dtFree(data);
-      fclose(fp);
+    cursor += alignmentPadding(cursor - file->data());
+    if (end - cursor < tileHeader.dataSize) {
+      dtFreeNavMesh(mesh);
       return false;
     }
 
-    mesh->addTile(data, tileHeader.dataSize, DT_TILE_FREE_DATA,
-                  tileHeader.tileRef, 0);
-    const dtMeshTile* tile = mesh->getTileByRef(tileHeader.tileRef);
-    if (i == 0) {
+    status = mesh->addTile(cursor, tileHeader.dataSize, 0, tileHeader.tileRef,
+                           0);
+    if (dtStatusFailed(status)) {
+      dtFreeNavMesh(mesh);
+      return false;
+    }
+    cursor += tileHeader.dataSize;
+  }
+
+  const auto read = [&cursor, end](void* dst, size_t size) {
+    if (end - cursor < static_cast<long>(size))
+      return false;
+    memcpy(dst, cursor, size);
+    cursor += size;
+    return true;
+  };
+  std::unique_ptr<impl::IslandSystem> islandSystem = nullptr;
+  if (header.version >= 3) {
+    islandSystem = impl::IslandSystem::deserialize(mesh, read);
+    if (!islandSystem)
+      LOG(WARNING) << "Could not read the islands of " << path;
+  }
+  std::unique_ptr<impl::ObstacleDistanceField> obstacleDistanceField =
+      nullptr;
+  if (header.version >= 4 && islandSystem)
+    obstacleDistanceField =
+        impl::ObstacleDistanceField::deserialize(mesh, read);
+
+  if (!initLoadedNavMesh(mesh, std::move(file), std::move(islandSystem)))
+    return false;
+  resetObstacleDistanceField(std::move(obstacleDistanceField));
+  return true;
+}
+
+bool PathFinder::Impl::initLoadedNavMesh(
+    dtNavMesh* mesh,
+    std::unique_ptr<impl::MappedFile> mappedFile,
+    std::unique_ptr<impl::IslandSystem> islandSystem) {
+  vec3f bmin, bmax;
+  bool first = true;
+  for (int i = 0; i < mesh->getMaxTiles(); ++i) {
+    const dtMeshTile* tile = const_cast<const dtNavMesh*>(mesh)->getTile(i);
+    if (!tile || !tile->header)
+      continue;
+    if (first) {
       bmin = vec3f(tile->header->bmin);
       bmax = vec3f(tile->header->bmax);
+      first = false;
     } else {
       bmin = bmin.array().min(Eigen::Array3f{tile->header->bmin});
       bmax = bmax.array().max(Eigen::Array3f{tile->header->bmax});
     }
   }
 
-  fclose(fp);
-
   navMesh_.reset(mesh);
+  mappedNavMesh_ = std::move(mappedFile);
   bounds_ = std::make_pair(bmin, bmax);
+  tileGrid_ = Cr::Containers::NullOpt;
+  resetObstacleTiles();
 
   removeZeroAreaPolys();
 
-  return initNavQuery();
+  return initNavQuery(std::move(islandSystem));
 }
 
 bool PathFinder::Impl::saveNavMesh(const std::string& path) {
@@ -892,9 +3588,15 @@ bool PathFinder::Impl::saveNavMesh(const std::string& path) {
     tileHeader.dataSize = tile->dataSize;
     fwrite(&tileHeader, sizeof(tileHeader), 1, fp);
 
+    const char padding[NAVMESHSET_ALIGNMENT] = {};
+    fwrite(padding, alignmentPadding(ftell(fp)), 1, fp);
     fwrite(tile->data, tile->dataSize, 1, fp);
   }
 
+  islandSystem_->serialize(fp);
+  // Build the field if it is enabled so that loading the file does not have to
+  impl::ObstacleDistanceField::serialize(getObstacleDistanceField(), fp);
+
   fclose(fp);
 
   return true;
@@ -902,8 +3604,10 @@ bool PathFinder::Impl::saveNavMesh(const std::string& path) {
 
 void PathFinder::Impl::seed(uint32_t newSeed) {
   // TODO: this should be using core::Random instead, but passing function
-  // to navQuery_->findRandomPoint needs to be figured out first
+  // to navQuery->findRandomPoint needs to be figured out first
   srand(newSeed);
+  std::lock_guard<std::mutex> lock(randomMutex_);
+  random_.seed(newSeed);
 }
 
 // Returns a random number [0..1]
@@ -915,14 +3619,151 @@ vec3f PathFinder::Impl::getRandomNavigablePoint() {
   dtPolyRef ref;
   constexpr float inf = std::numeric_limits<float>::infinity();
   vec3f pt(inf, inf, inf);
+  impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
   dtStatus status =
-      navQuery_->findRandomPoint(filter_.get(), frand, &ref, pt.data());
+      navQuery->findRandomPoint(filter_.get(), frand, &ref, pt.data());
   if (!dtStatusSucceed(status)) {
     LOG(ERROR) << "Failed to getRandomNavigablePoint";
   }
   return pt;
 }
 
+template <typename F>
+Eigen::RowMatrixXf PathFinder::Impl::samplePoints(
+    const impl::PolyAreaSampler::Selection& selection,
+    const int numPoints,
+    F accept) {
+  Eigen::RowMatrixXf points(std::max(numPoints, 0), 3);
+  if (selection.empty()) {
+    points.resize(0, 3);
+    return points;
+  }
+
+  // Gives up on restrictions that (almost) no point satisfies
+  constexpr int maxCandidatesPerPoint = 100;
+  // Below this, starting the threads costs more than the samples themselves
+  constexpr int minParallelPoints = 256;
+  constexpr int minCandidatesPerRound = 64;
+  const long maxCandidates = static_cast<long>(maxCandidatesPerPoint) *
+                             points.rows();
+
+  int numAccepted = 0;
+  long numCandidates = 0;
+  Eigen::RowMatrixXf draws, candidates;
+  std::vector<char> accepted;
+  while (numAccepted < points.rows() && numCandidates < maxCandidates) {
+    const int numDraws = std::min<long>(
+        std::max<long>(points.rows() - numAccepted, minCandidatesPerRound),
+        maxCandidates - numCandidates);
+    numCandidates += numDraws;
+
+    // The random numbers are drawn up front on one thread, so the points only
+    // depend on the seed and not on the number of threads
+    draws.resize(numDraws, 3);
+    {
+      std::lock_guard<std::mutex> lock(randomMutex_);
+      for (int i = 0; i < numDraws; ++i) {
+        for (int j = 0; j < 3; ++j) {
+          draws(i, j) = random_.uniform_float_01();
+        }
+      }
+    }
+
+    candidates.resize(numDraws, 3);
+    accepted.assign(numDraws, false);
+#pragma omp parallel if (numDraws >= minParallelPoints)
+    {
+      impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
+
+#pragma omp for schedule(dynamic, 64)
+      for (int i = 0; i < numDraws; ++i) {
+        if (!navQuery)
+          continue;
+        const int poly = polyAreaSampler_->pick(selection, draws(i, 0));
+        vec3f pt = polyAreaSampler_->pointOnPoly(poly, draws(i, 1),
+                                                 draws(i, 2));
+        navQuery->getPolyHeight(polyAreaSampler_->polyRef(poly), pt.data(),
+                                &pt[1]);
+        candidates.row(i) = pt.transpose();
+        accepted[i] = accept(pt);
+      }
+    }
+
+    for (int i = 0; i < numDraws && numAccepted < points.rows(); ++i) {
+      if (accepted[i])
+        points.row(numAccepted++) = candidates.row(i);
+    }
+  }
+
+  if (numAccepted < points.rows()) {
+    LOG(WARNING) << "Only found " << numAccepted << " of " << points.rows()
+                 << " random navigable points after " << numCandidates
+                 << " tries";
+    points.conservativeResize(numAccepted, 3);
+  }
+  return points;
+}
+
+Eigen::RowMatrixXf PathFinder::Impl::getRandomNavigablePoints(
+    const int numPoints) {
+  if (!isLoaded())
+    return Eigen::RowMatrixXf(0, 3);
+
+  return samplePoints(polyAreaSampler_->all(), numPoints,
+                      [](const vec3f&) { return true; });
+}
+
+Eigen::RowMatrixXf PathFinder::Impl::getRandomNavigablePointsOnIsland(
+    const vec3f& pt,
+    const int numPoints) {
+  if (!isLoaded())
+    return Eigen::RowMatrixXf(0, 3);
+
+  dtStatus status;
+  dtPolyRef ref;
+  {
+    impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
+    if (!navQuery)
+      return Eigen::RowMatrixXf(0, 3);
+    std::tie(status, ref, std::ignore) =
+        projectToPoly(pt, navQuery.get(), filter_.get());
+  }
+  if (!dtStatusSucceed(status) || ref == 0)
+    return Eigen::RowMatrixXf(0, 3);
+
+  return samplePoints(polyAreaSampler_->island(islandSystem_->islandId(ref)),
+                      numPoints, [](const vec3f&) { return true; });
+}
+
+Eigen::RowMatrixXf PathFinder::Impl::getRandomNavigablePointsAroundPoint(
+    const vec3f& center,
+    const float radius,
+    const int numPoints) {
+  if (!isLoaded())
+    return Eigen::RowMatrixXf(0, 3);
+
+  const vec3f extent = vec3f::Constant(radius);
+  return samplePoints(
+      polyAreaSampler_->overlapping(center - extent, center + extent),
+      numPoints, [&](const vec3f& pt) {
+        return (pt - center).squaredNorm() <= radius * radius;
+      });
+}
+
+Eigen::RowMatrixXf PathFinder::Impl::getRandomNavigablePointsInHeightBand(
+    const float minHeight,
+    const float maxHeight,
+    const int numPoints) {
+  if (!isLoaded())
+    return Eigen::RowMatrixXf(0, 3);
+
+  return samplePoints(
+      polyAreaSampler_->inHeightBand(minHeight, maxHeight), numPoints,
+      [&](const vec3f& pt) {
+        return pt[1] >= minHeight && pt[1] <= maxHeight;
+      });
+}
+
 namespace {
 float pathLength(const std::vector<vec3f>& points) {
   CORRADE_INTERNAL_ASSERT(points.size() > 0);
@@ -951,7 +3792,8 @@ bool PathFinder::Impl::findPath(ShortestPath& path) {
 }
 
 Cr::Containers::Optional<std::tuple<float, std::vector<vec3f>>>
-PathFinder::Impl::findPathInternal(const vec3f& start,
+PathFinder::Impl::findPathInternal(dtNavMeshQuery* navQuery,
+                                   const vec3f& start,
                                    dtPolyRef startRef,
                                    const vec3f& pathStart,
                                    const vec3f& end,
@@ -967,22 +3809,30 @@ PathFinder::Impl::findPathInternal(const vec3f& start,
     return Cr::Containers::NullOpt;
   }
 
-  static const int MAX_POLYS = 256;
-  dtPolyRef polys[MAX_POLYS];
-
+  // The exact search comes first, the approximate hierarchy of clusters is
+  // only used if it runs out of nodes before it reaches the end
+  std::vector<dtPolyRef> polys(impl::NAV_QUERY_MAX_NODES);
   int numPolys = 0;
-  dtStatus status =
-      navQuery_->findPath(startRef, endRef, pathStart.data(), pathEnd.data(),
-                          filter_.get(), polys, &numPolys, MAX_POLYS);
-  if (status != DT_SUCCESS || numPolys == 0) {
+  dtStatus status = navQuery->findPath(startRef, endRef, pathStart.data(),
+                                       pathEnd.data(), filter_.get(),
+                                       polys.data(), &numPolys, polys.size());
+  if (dtStatusFailed(status) || numPolys == 0) {
+    return Cr::Containers::NullOpt;
+  }
+  polys.resize(numPolys);
+  // Any detail flags mean that the search did not make it to the end
+  if (status != DT_SUCCESS &&
+      !pathHierarchy_->findCorridor(navQuery, filter_.get(), startRef,
+                                    pathStart, endRef, pathEnd, &polys)) {
     return Cr::Containers::NullOpt;
   }
 
+  // A straight path has at most one corner per poly
   int numPoints = 0;
-  std::vector<vec3f> points(MAX_POLYS);
-  status = navQuery_->findStraightPath(start.data(), end.data(), polys,
-                                       numPolys, points[0].data(), 0, 0,
-                                       &numPoints, MAX_POLYS);
+  std::vector<vec3f> points(polys.size() + 2);
+  status = navQuery->findStraightPath(start.data(), end.data(), polys.data(),
+                                      polys.size(), points[0].data(), 0, 0,
+                                      &numPoints, points.size());
   if (status != DT_SUCCESS || numPoints == 0) {
     return Corrade::Containers::NullOpt;
   }
@@ -994,7 +3844,8 @@ PathFinder::Impl::findPathInternal(const vec3f& start,
   return std::make_tuple(length, std::move(points));
 }
 
-bool PathFinder::Impl::findPathSetup(MultiGoalShortestPath& path,
+bool PathFinder::Impl::findPathSetup(dtNavMeshQuery* navQuery,
+                                     MultiGoalShortestPath& path,
                                      dtPolyRef& startRef,
                                      vec3f& pathStart) {
   path.geodesicDistance = std::numeric_limits<float>::infinity();
@@ -1003,7 +3854,7 @@ bool PathFinder::Impl::findPathSetup(MultiGoalShortestPath& path,
   // find nearest polys and path
   dtStatus status;
   std::tie(status, startRef, pathStart) =
-      projectToPoly(path.requestedStart, navQuery_.get(), filter_.get());
+      projectToPoly(path.requestedStart, navQuery, filter_.get());
 
   if (status != DT_SUCCESS || startRef == 0) {
     return false;
@@ -1016,7 +3867,7 @@ bool PathFinder::Impl::findPathSetup(MultiGoalShortestPath& path,
     dtPolyRef endRef;
     vec3f pathEnd;
     std::tie(status, endRef, pathEnd) =
-        projectToPoly(rqEnd, navQuery_.get(), filter_.get());
+        projectToPoly(rqEnd, navQuery, filter_.get());
 
     if (status != DT_SUCCESS || endRef == 0) {
       return false;
@@ -1029,59 +3880,731 @@ bool PathFinder::Impl::findPathSetup(MultiGoalShortestPath& path,
   return true;
 }
 
-bool PathFinder::Impl::findPath(MultiGoalShortestPath& path) {
-  dtPolyRef startRef;
-  vec3f pathStart;
-  if (!findPathSetup(path, startRef, pathStart))
-    return false;
+bool PathFinder::Impl::findPath(MultiGoalShortestPath& path) {
+  if (path.pimpl_->distanceField) {
+    // Trace the path down the precomputed field instead of searching
+    path.geodesicDistance =
+        geodesicDistance(*path.pimpl_->distanceField, path.requestedStart,
+                         &path.points);
+    if (path.geodesicDistance == std::numeric_limits<float>::infinity()) {
+      path.points.clear();
+      return false;
+    }
+    return true;
+  }
+
+  impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
+  dtPolyRef startRef;
+  vec3f pathStart;
+  if (!findPathSetup(navQuery.get(), path, startRef, pathStart))
+    return false;
+
+  // A single goal is better served by the directed search
+  if (path.pimpl_->requestedEnds.size() == 1) {
+    const Cr::Containers::Optional<std::tuple<float, std::vector<vec3f>>>
+        findResult =
+            findPathInternal(navQuery.get(), path.requestedStart, startRef,
+                             pathStart, path.pimpl_->requestedEnds[0],
+                             path.pimpl_->endRefs[0], path.pimpl_->pathEnds[0]);
+    if (!findResult)
+      return false;
+    path.geodesicDistance = std::get<0>(*findResult);
+    path.points = std::move(std::get<1>(*findResult));
+    return true;
+  }
+
+  // Every goal that may be the closest gets the same search as a single goal,
+  // so the result is the shortest of the paths to each goal on its own
+  findClosestGoal(
+      startRef, pathStart, path.pimpl_->endRefs, path.pimpl_->pathEnds,
+      [&](const size_t i) {
+        Cr::Containers::Optional<std::tuple<float, std::vector<vec3f>>>
+            findResult = findPathInternal(
+                navQuery.get(), path.requestedStart, startRef, pathStart,
+                path.pimpl_->requestedEnds[i], path.pimpl_->endRefs[i],
+                path.pimpl_->pathEnds[i]);
+        if (!findResult)
+          return std::numeric_limits<float>::infinity();
+        if (std::get<0>(*findResult) < path.geodesicDistance) {
+          path.geodesicDistance = std::get<0>(*findResult);
+          path.points = std::move(std::get<1>(*findResult));
+        }
+        return std::get<0>(*findResult);
+      });
+
+  return path.geodesicDistance < std::numeric_limits<float>::infinity();
+}
+
+void PathFinder::Impl::findClosestGoal(
+    const dtPolyRef startRef,
+    const vec3f& pathStart,
+    const std::vector<dtPolyRef>& endRefs,
+    const std::vector<vec3f>& pathEnds,
+    const std::function<float(size_t)>& pathLength) const {
+  // Goals on other islands can never be reached
+  std::unordered_map<dtPolyRef, std::vector<size_t>> polyGoals;
+  std::vector<bool> goalDone(endRefs.size(), true);
+  size_t numGoalsLeft = 0;
+  for (size_t i = 0; i < endRefs.size(); ++i) {
+    if (islandSystem_->hasConnection(startRef, endRefs[i])) {
+      polyGoals[endRefs[i]].emplace_back(i);
+      goalDone[i] = false;
+      ++numGoalsLeft;
+    }
+  }
+
+  // Every poly is entered once, at the middle of the edge it is reached
+  // through, like in Detour's A*.  Goals are queued as soon as their poly is
+  // settled.  The string-pulled length of a goal can be shorter than its cost,
+  // so goals are taken out of the queue until the cost is more than the
+  // shortest length found so far
+  std::unordered_map<dtPolyRef, uint32_t> polyNodes;
+  std::vector<dtPolyRef> nodeRef;
+  std::vector<vec3f> nodePos;
+  std::vector<float> nodeDist;
+  auto getNode = [&](const dtPolyRef ref) {
+    auto inserted = polyNodes.emplace(ref, nodeRef.size());
+    if (inserted.second) {
+      nodeRef.emplace_back(ref);
+      nodePos.emplace_back(vec3f::Zero());
+      nodeDist.emplace_back(std::numeric_limits<float>::infinity());
+    }
+    return inserted.first->second;
+  };
+
+  // (cost, is goal, node or goal index)
+  typedef std::tuple<float, bool, uint32_t> QueueEntry;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry>>
+      queue;
+  const uint32_t startNode = getNode(startRef);
+  nodePos[startNode] = pathStart;
+  nodeDist[startNode] = 0;
+  queue.emplace(0, false, startNode);
+
+  float minLength = std::numeric_limits<float>::infinity();
+  while (!queue.empty() && numGoalsLeft > 0) {
+    const float dist = std::get<0>(queue.top());
+    const bool isGoal = std::get<1>(queue.top());
+    const uint32_t u = std::get<2>(queue.top());
+    queue.pop();
+
+    if (dist > minLength)
+      break;
+    if (isGoal) {
+      goalDone[u] = true;
+      --numGoalsLeft;
+      minLength = std::min(minLength, pathLength(u));
+      continue;
+    }
+    if (dist > nodeDist[u])
+      continue;
+
+    auto goalsIt = polyGoals.find(nodeRef[u]);
+    if (goalsIt != polyGoals.end()) {
+      for (const size_t i : goalsIt->second) {
+        queue.emplace(dist + (pathEnds[i] - nodePos[u]).norm(), true, i);
+      }
+    }
+
+    impl::forEachWalkableNeighbor(
+        navMesh_.get(), nodeRef[u], filter_.get(),
+        [&](const dtPolyRef neighborRef, const vec3f& mid) {
+          const float neighborDist = dist + (mid - nodePos[u]).norm();
+          const uint32_t v = getNode(neighborRef);
+          if (neighborDist < nodeDist[v]) {
+            nodeDist[v] = neighborDist;
+            nodePos[v] = mid;
+            queue.emplace(neighborDist, false, v);
+          }
+        });
+  }
+
+  // The cost of a goal that was not taken out of the queue does not bound its
+  // length from below, the straight line distance does
+  for (size_t i = 0; i < endRefs.size(); ++i) {
+    if (!goalDone[i] && (pathEnds[i] - pathStart).norm() < minLength)
+      minLength = std::min(minLength, pathLength(i));
+  }
+}
+
+bool PathFinder::Impl::initSlicedPath(SlicedShortestPath& path) {
+  SlicedShortestPath::Impl& p = *path.pimpl_;
+  p.status = DT_FAILURE;
+  path.points.clear();
+  path.geodesicDistance = std::numeric_limits<float>::infinity();
+  path.isComplete = false;
+  if (!isLoaded())
+    return false;
+
+  // Keep the query of the previous search unless the navmesh changed since
+  if (!p.navQuery || p.navMeshId != navMeshId_) {
+    p.navQuery.reset(dtAllocNavMeshQuery());
+    if (!p.navQuery || dtStatusFailed(p.navQuery->init(
+                           navMesh_.get(), impl::NAV_QUERY_MAX_NODES))) {
+      LOG(ERROR) << "Could not init Detour navmesh query";
+      p.navQuery = nullptr;
+      return false;
+    }
+  }
+  p.navMeshId = navMeshId_;
+
+  dtStatus startStatus, endStatus;
+  dtPolyRef startRef, endRef;
+  vec3f pathStart, pathEnd;
+  std::tie(startStatus, startRef, pathStart) =
+      projectToPoly(path.requestedStart, p.navQuery.get(), filter_.get());
+  std::tie(endStatus, endRef, pathEnd) =
+      projectToPoly(path.requestedEnd, p.navQuery.get(), filter_.get());
+  if (startStatus != DT_SUCCESS || startRef == 0 || endStatus != DT_SUCCESS ||
+      endRef == 0 || !islandSystem_->hasConnection(startRef, endRef))
+    return false;
+
+  p.status = p.navQuery->initSlicedFindPath(startRef, endRef, pathStart.data(),
+                                            pathEnd.data(), filter_.get());
+  return !dtStatusFailed(p.status);
+}
+
+bool PathFinder::Impl::updateSlicedPath(SlicedShortestPath& path,
+                                        int maxIterations,
+                                        float maxMicroseconds) {
+  SlicedShortestPath::Impl& p = *path.pimpl_;
+  if (!dtStatusInProgress(p.status))
+    return true;
+  if (p.navMeshId != navMeshId_) {
+    LOG(ERROR) << "Sliced path was started on a different navmesh";
+    p.status = DT_FAILURE;
+    return true;
+  }
+
+  // Without a time budget, everything can be done in a single update
+  constexpr int iterationsPerTimeCheck = 16;
+  const int iterationsPerUpdate =
+      maxMicroseconds > 0 ? iterationsPerTimeCheck : maxIterations;
+  const auto startTime = std::chrono::steady_clock::now();
+  while (maxIterations > 0 && dtStatusInProgress(p.status)) {
+    int doneIterations = 0;
+    p.status = p.navQuery->updateSlicedFindPath(
+        std::min(iterationsPerUpdate, maxIterations), &doneIterations);
+    // Detour does not count an update that finds nothing left to do
+    maxIterations -= std::max(doneIterations, 1);
+
+    if (maxMicroseconds > 0 &&
+        std::chrono::duration<float, std::micro>(
+            std::chrono::steady_clock::now() - startTime)
+                .count() >= maxMicroseconds)
+      break;
+  }
+
+  return !dtStatusInProgress(p.status);
+}
+
+bool PathFinder::Impl::finalizeSlicedPath(SlicedShortestPath& path) {
+  SlicedShortestPath::Impl& p = *path.pimpl_;
+  path.points.clear();
+  path.geodesicDistance = std::numeric_limits<float>::infinity();
+  path.isComplete = false;
+  if (!p.navQuery || p.navMeshId != navMeshId_ || dtStatusFailed(p.status)) {
+    p.status = DT_FAILURE;
+    return false;
+  }
+
+  // Detour ends the search at the node closest to the end so far if it is
+  // still in progress
+  std::vector<dtPolyRef> polys(impl::NAV_QUERY_MAX_NODES);
+  int numPolys = 0;
+  dtStatus status = p.navQuery->finalizeSlicedFindPath(
+      polys.data(), &numPolys, polys.size());
+  p.status = DT_FAILURE;
+  if (dtStatusFailed(status) || numPolys == 0)
+    return false;
+  path.isComplete = !dtStatusDetail(status, DT_PARTIAL_RESULT);
+
+  // A partial path ends at the point of its last poly that is closest to the
+  // end
+  vec3f end = path.requestedEnd;
+  if (!path.isComplete) {
+    p.navQuery->closestPointOnPoly(polys[numPolys - 1],
+                                   path.requestedEnd.data(), end.data(),
+                                   nullptr);
+  }
+
+  int numPoints = 0;
+  std::vector<vec3f> points(numPolys + 2);
+  status = p.navQuery->findStraightPath(path.requestedStart.data(), end.data(),
+                                        polys.data(), numPolys,
+                                        points[0].data(), 0, 0, &numPoints,
+                                        points.size());
+  if (status != DT_SUCCESS || numPoints == 0) {
+    path.isComplete = false;
+    return false;
+  }
+
+  points.resize(numPoints);
+  path.geodesicDistance = pathLength(points);
+  path.points = std::move(points);
+  return true;
+}
+
+ShortestPathBatch PathFinder::Impl::findPaths(
+    const Eigen::Ref<const Eigen::RowMatrixXf>& starts,
+    const Eigen::Ref<const Eigen::RowMatrixXf>& ends,
+    bool returnPoints) {
+  CORRADE_ASSERT(starts.cols() == 3 && ends.cols() == 3,
+                 "PathFinder::findPaths: starts and ends must be Nx3 arrays",
+                 {});
+  CORRADE_ASSERT(starts.rows() == ends.rows(),
+                 "PathFinder::findPaths: starts and ends must have the same "
+                 "number of rows",
+                 {});
+
+  const int numPairs = starts.rows();
+  ShortestPathBatch batch;
+  batch.geodesicDistances.setConstant(numPairs,
+                                      std::numeric_limits<float>::infinity());
+  if (!isLoaded()) {
+    // No pair has a path, so every one of them has no points
+    if (returnPoints) {
+      batch.pathOffsets.setZero(numPairs + 1);
+      batch.points.resize(0, 3);
+    }
+    return batch;
+  }
+
+  std::vector<std::vector<vec3f>> paths(returnPoints ? numPairs : 0);
+
+#pragma omp parallel
+  {
+    // Every thread borrows its own query on the shared navmesh for the whole
+    // loop instead of once per pair
+    impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
+
+#pragma omp for schedule(dynamic, 16)
+    for (int i = 0; i < numPairs; ++i) {
+      if (!navQuery)
+        continue;
+
+      const vec3f start = starts.row(i).transpose();
+      const vec3f end = ends.row(i).transpose();
+
+      dtStatus startStatus, endStatus;
+      dtPolyRef startRef, endRef;
+      vec3f pathStart, pathEnd;
+      std::tie(startStatus, startRef, pathStart) =
+          projectToPoly(start, navQuery.get(), filter_.get());
+      std::tie(endStatus, endRef, pathEnd) =
+          projectToPoly(end, navQuery.get(), filter_.get());
+      if (startStatus != DT_SUCCESS || startRef == 0 ||
+          endStatus != DT_SUCCESS || endRef == 0)
+        continue;
+
+      Cr::Containers::Optional<std::tuple<float, std::vector<vec3f>>>
+          findResult = findPathInternal(navQuery.get(), start, startRef,
+                                        pathStart, end, endRef, pathEnd);
+      if (!findResult)
+        continue;
+
+      batch.geodesicDistances[i] = std::get<0>(*findResult);
+      if (returnPoints)
+        paths[i] = std::move(std::get<1>(*findResult));
+    }
+  }
+
+  if (returnPoints) {
+    batch.pathOffsets.resize(numPairs + 1);
+    batch.pathOffsets[0] = 0;
+    for (int i = 0; i < numPairs; ++i) {
+      batch.pathOffsets[i + 1] = batch.pathOffsets[i] + paths[i].size();
+    }
+
+    batch.points.resize(batch.pathOffsets[numPairs], 3);
+    for (int i = 0; i < numPairs; ++i) {
+      for (int j = 0; j < paths[i].size(); ++j) {
+        batch.points.row(batch.pathOffsets[i] + j) = paths[i][j].transpose();
+      }
+    }
+  }
+
+  return batch;
+}
+
+namespace {
+vec3f polyCenter(const dtMeshTile* tile, const dtPoly* poly) {
+  vec3f center = vec3f::Zero();
+  for (int iVert = 0; iVert < poly->vertCount; ++iVert) {
+    center += Eigen::Map<const vec3f>(&tile->verts[poly->verts[iVert] * 3]);
+  }
+  return center / poly->vertCount;
+}
+}  // namespace
+
+bool PathFinder::Impl::hasLineOfSight(dtNavMeshQuery* navQuery,
+                                      const vec3f& from,
+                                      dtPolyRef fromRef,
+                                      const GeodesicDistanceField::Impl& field,
+                                      uint32_t toNode) const {
+  static const int MAX_POLYS = 256;
+  dtPolyRef polys[MAX_POLYS];
+  int numPolys = 0;
+  float t;
+  vec3f hitNormal;
+  dtStatus status = navQuery->raycast(
+      fromRef, from.data(), field.nodePos[toNode].data(), filter_.get(), &t,
+      hitNormal.data(), polys, &numPolys, MAX_POLYS);
+  // Nodes are on the boundary of polys, so hitting a wall right at the node
+  // still counts as reaching it
+  if (status != DT_SUCCESS || numPolys == 0 || t < 0.999f)
+    return false;
+
+  // Raycasts are done in 2D, so make sure that the ray ended on a poly of the
+  // node and not on one above or below it
+  const auto nodePolysBegin =
+      field.nodePolys.begin() + field.nodePolyStart[toNode];
+  const auto nodePolysEnd =
+      field.nodePolys.begin() + field.nodePolyStart[toNode + 1];
+  return std::find(nodePolysBegin, nodePolysEnd, polys[numPolys - 1]) !=
+         nodePolysEnd;
+}
+
+bool PathFinder::Impl::hasLineOfSight(dtNavMeshQuery* navQuery,
+                                      const GeodesicDistanceField::Impl& field,
+                                      uint32_t fromNode,
+                                      uint32_t toNode) const {
+  const vec3f& from = field.nodePos[fromNode];
+  for (uint32_t iPoly = field.nodePolyStart[fromNode];
+       iPoly < field.nodePolyStart[fromNode + 1]; ++iPoly) {
+    const dtPolyRef fromRef = field.nodePolys[iPoly];
+    const dtMeshTile* tile = nullptr;
+    const dtPoly* poly = nullptr;
+    navMesh_->getTileAndPolyByRefUnsafe(fromRef, &tile, &poly);
+
+    // Raycasts starting exactly on a vertex are degenerate, so start from just
+    // inside of each poly the vertex belongs to
+    constexpr float nudgeDistance = 1e-3f;  // 1mm
+    const vec3f start =
+        from + nudgeDistance * (polyCenter(tile, poly) - from).normalized();
+    if (hasLineOfSight(navQuery, start, fromRef, field, toNode))
+      return true;
+  }
+  return false;
+}
+
+GeodesicDistanceField::ptr PathFinder::Impl::buildDistanceField(
+    const std::vector<vec3f>& goals) {
+  if (!isLoaded())
+    return nullptr;
+
+  impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
+  const dtNavMesh* navMesh = navMesh_.get();
+
+  GeodesicDistanceField::ptr field = GeodesicDistanceField::create();
+  GeodesicDistanceField::Impl& f = *field->pimpl_;
+  f.goals = goals;
+  f.navMeshId = navMeshId_;
+
+  // The goals are the first nodes of the field
+  std::vector<std::vector<dtPolyRef>> nodePolys;
+  std::vector<dtPolyRef> goalRefs;
+  for (const vec3f& goal : goals) {
+    dtStatus status;
+    dtPolyRef goalRef;
+    vec3f goalPt;
+    std::tie(status, goalRef, goalPt) =
+        projectToPoly(goal, navQuery.get(), filter_.get());
+    if (status != DT_SUCCESS || goalRef == 0) {
+      LOG(ERROR) << "Could not snap distance field goal " << goal.transpose()
+                 << " to the navmesh";
+      return nullptr;
+    }
+
+    f.polyGoalNodes[goalRef].emplace_back(f.nodePos.size());
+    f.nodePos.emplace_back(goalPt);
+    nodePolys.push_back({goalRef});
+    goalRefs.emplace_back(goalRef);
+  }
+
+  // Followed by the vertices of every poly that is connected to a goal.
+  // Vertices on tile borders are duplicated in each tile, so they are merged
+  // by position
+  std::map<std::tuple<int, int, int>, uint32_t> vertNodes;
+  f.tileVertNodes.resize(navMesh->getMaxTiles());
+  for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+    const dtMeshTile* tile = navMesh->getTile(iTile);
+    if (!tile || !tile->header)
+      continue;
+
+    f.tileVertNodes[iTile].assign(tile->header->vertCount, INVALID_NODE);
+    for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+      const dtPolyRef ref = navMesh->encodePolyId(tile->salt, iTile, jPoly);
+      const dtPoly* poly = &tile->polys[jPoly];
+      if (poly->getType() != DT_POLYTYPE_GROUND ||
+          !filter_->passFilter(ref, tile, poly))
+        continue;
+
+      if (std::none_of(goalRefs.begin(), goalRefs.end(),
+                       [this, ref](const dtPolyRef goalRef) {
+                         return islandSystem_->hasConnection(goalRef, ref);
+                       }))
+        continue;
+
+      for (int kVert = 0; kVert < poly->vertCount; ++kVert) {
+        uint32_t& node = f.tileVertNodes[iTile][poly->verts[kVert]];
+        if (node == INVALID_NODE) {
+          Eigen::Map<const vec3f> vert(&tile->verts[poly->verts[kVert] * 3]);
+          // Quantize to 1mm
+          const Eigen::Vector3i key = (vert * 1e3f).array().round().cast<int>();
+          auto inserted =
+              vertNodes.emplace(std::make_tuple(key[0], key[1], key[2]),
+                                f.nodePos.size());
+          if (inserted.second) {
+            f.nodePos.emplace_back(vert);
+            nodePolys.emplace_back();
+          }
+          node = inserted.first->second;
+        }
+        nodePolys[node].emplace_back(ref);
+      }
+    }
+  }
+
+  const uint32_t numNodes = f.nodePos.size();
+  f.nodePolyStart.resize(numNodes + 1);
+  f.nodePolyStart[0] = 0;
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    f.nodePolyStart[i + 1] = f.nodePolyStart[i] + nodePolys[i].size();
+    f.nodePolys.insert(f.nodePolys.end(), nodePolys[i].begin(),
+                       nodePolys[i].end());
+  }
+
+  // Dijkstra from all goals at once over the graph that connects all nodes
+  // that share a poly.  A straight line between two nodes that share a poly is
+  // always on the navmesh as polys are convex.  To not be limited to paths
+  // along these lines, a node is connected directly to the parent of the node
+  // it was reached from whenever there is a line of sight between them
+  // (Theta*), which gives any-angle shortest paths
+  f.nodeDist.assign(numNodes, std::numeric_limits<float>::infinity());
+  f.nodeParent.resize(numNodes);
+  std::iota(f.nodeParent.begin(), f.nodeParent.end(), 0);
+
+  typedef std::pair<float, uint32_t> QueueEntry;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry>>
+      queue;
+  for (uint32_t i = 0; i < goals.size(); ++i) {
+    f.nodeDist[i] = 0;
+    queue.emplace(0, i);
+  }
+
+  while (!queue.empty()) {
+    const float dist = queue.top().first;
+    const uint32_t u = queue.top().second;
+    queue.pop();
+    if (dist > f.nodeDist[u])
+      continue;
+
+    const uint32_t parent = f.nodeParent[u];
+    for (uint32_t iPoly = f.nodePolyStart[u]; iPoly < f.nodePolyStart[u + 1];
+         ++iPoly) {
+      const dtPolyRef ref = f.nodePolys[iPoly];
+      const dtMeshTile* tile = nullptr;
+      const dtPoly* poly = nullptr;
+      navMesh->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+      const std::vector<uint32_t>& vertNodesOfTile =
+          f.tileVertNodes[navMesh->decodePolyIdTile(ref)];
+
+      for (int kVert = 0; kVert < poly->vertCount; ++kVert) {
+        const uint32_t w = vertNodesOfTile[poly->verts[kVert]];
+        if (w == u)
+          continue;
+
+        if (parent != u) {
+          const float viaParent =
+              f.nodeDist[parent] + (f.nodePos[parent] - f.nodePos[w]).norm();
+          if (viaParent < f.nodeDist[w] &&
+              hasLineOfSight(navQuery.get(), f, parent, w)) {
+            f.nodeDist[w] = viaParent;
+            f.nodeParent[w] = parent;
+            queue.emplace(viaParent, w);
+            continue;
+          }
+        }
+
+        const float viaU = dist + (f.nodePos[u] - f.nodePos[w]).norm();
+        if (viaU < f.nodeDist[w]) {
+          f.nodeDist[w] = viaU;
+          f.nodeParent[w] = u;
+          queue.emplace(viaU, w);
+        }
+      }
+    }
+  }
+
+  return field;
+}
+
+float PathFinder::Impl::geodesicDistance(const GeodesicDistanceField& field,
+                                         const vec3f& pt,
+                                         std::vector<vec3f>* points) {
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  const GeodesicDistanceField::Impl& f = *field.pimpl_;
+  if (!isLoaded())
+    return inf;
+  if (f.navMeshId != navMeshId_) {
+    LOG(ERROR) << "Distance field was built on a different navmesh";
+    return inf;
+  }
 
-  if (path.pimpl_->requestedEnds.size() > 1) {
-    // Bound the minimum distance any point could be from the start by either
-    // how close it use to be minus how much we moved from the last search point
-    // or just the L2 distance.
+  impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
+  dtStatus status;
+  dtPolyRef ptRef;
+  vec3f polyPt;
+  std::tie(status, ptRef, polyPt) =
+      projectToPoly(pt, navQuery.get(), filter_.get());
+  if (status != DT_SUCCESS || ptRef == 0)
+    return inf;
+
+  // Every node of the poly the point is on can be reached in a straight line:
+  // the vertices of the poly and any goals inside of it
+  const dtMeshTile* tile = nullptr;
+  const dtPoly* poly = nullptr;
+  navMesh_->getTileAndPolyByRefUnsafe(ptRef, &tile, &poly);
+  const std::vector<uint32_t>& vertNodesOfTile =
+      f.tileVertNodes[navMesh_->decodePolyIdTile(ptRef)];
+
+  std::vector<uint32_t> candidates;
+  if (!vertNodesOfTile.empty()) {
+    for (int kVert = 0; kVert < poly->vertCount; ++kVert) {
+      const uint32_t node = vertNodesOfTile[poly->verts[kVert]];
+      if (node != INVALID_NODE && f.nodeDist[node] < inf)
+        candidates.emplace_back(node);
+    }
+  }
+  auto goalNodesIt = f.polyGoalNodes.find(ptRef);
+  if (goalNodesIt != f.polyGoalNodes.end()) {
+    candidates.insert(candidates.end(), goalNodesIt->second.begin(),
+                      goalNodesIt->second.end());
+  }
 
-    ShortestPath prevPath;
-    prevPath.requestedStart = path.requestedStart;
-    prevPath.requestedEnd = path.pimpl_->prevRequestedStart;
-    findPath(prevPath);
-    const float movedAmount = prevPath.geodesicDistance;
+  float bestDist = inf;
+  uint32_t bestNode = INVALID_NODE;
+  for (const uint32_t node : candidates) {
+    const float dist = (polyPt - f.nodePos[node]).norm() + f.nodeDist[node];
+    if (dist < bestDist) {
+      bestDist = dist;
+      bestNode = node;
+    }
+  }
+  if (bestNode == INVALID_NODE)
+    return inf;
+
+  // Going straight to the parent of a candidate is shorter still if it is in
+  // sight.  Try the most promising parents first, this usually takes a single
+  // raycast
+  auto distViaParent = [&f, &polyPt](const uint32_t node) {
+    const uint32_t parent = f.nodeParent[node];
+    return (polyPt - f.nodePos[parent]).norm() + f.nodeDist[parent];
+  };
+  std::sort(candidates.begin(), candidates.end(),
+            [&distViaParent](const uint32_t a, const uint32_t b) {
+              return distViaParent(a) < distViaParent(b);
+            });
+  for (const uint32_t node : candidates) {
+    const float dist = distViaParent(node);
+    if (dist >= bestDist)
+      break;
 
-    for (int i = 0; i < path.pimpl_->requestedEnds.size(); ++i) {
-      path.pimpl_->minTheoreticalDist[i] = std::max(
-          path.pimpl_->minTheoreticalDist[i] - movedAmount,
-          (path.pimpl_->requestedEnds[i] - path.requestedStart).norm());
+    const uint32_t parent = f.nodeParent[node];
+    if (hasLineOfSight(navQuery.get(), polyPt, ptRef, f, parent)) {
+      bestDist = dist;
+      bestNode = parent;
+      break;
     }
+  }
 
-    path.pimpl_->prevRequestedStart = path.requestedStart;
+  if (points) {
+    points->clear();
+    points->emplace_back(polyPt);
+    uint32_t node = bestNode;
+    points->emplace_back(f.nodePos[node]);
+    while (f.nodeParent[node] != node) {
+      node = f.nodeParent[node];
+      points->emplace_back(f.nodePos[node]);
+    }
   }
 
-  // Explore possible goal points by their minimum theoretical distance.
-  std::vector<size_t> ordering(path.pimpl_->requestedEnds.size());
-  std::iota(ordering.begin(), ordering.end(), 0);
-  std::sort(ordering.begin(), ordering.end(),
-            [&path](const size_t a, const size_t b) -> bool {
-              return path.pimpl_->minTheoreticalDist[a] <
-                     path.pimpl_->minTheoreticalDist[b];
-            });
+  return bestDist;
+}
 
-  for (size_t i : ordering) {
-    if (path.pimpl_->minTheoreticalDist[i] > path.geodesicDistance)
-      continue;
+template <typename T>
+T PathFinder::Impl::tryStep(AgentNavHandle& handle,
+                            const T& start,
+                            const T& end,
+                            bool allowSliding) {
+  static const int MAX_POLYS = 256;
+  dtPolyRef polys[MAX_POLYS];
+  // How far start may be from where the last step ended for the tracked
+  // polygon to still be used
+  constexpr float trackingTolerance = 1e-3;
+
+  AgentNavHandle::Impl& h = *handle.pimpl_;
+  const vec3f startPt = Eigen::Map<const vec3f>(start.data());
+  impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
+  if (!navQuery) {
+    return start;
+  }
 
-    const Cr::Containers::Optional<std::tuple<float, std::vector<vec3f>>>
-        findResult =
-            findPathInternal(path.requestedStart, startRef, pathStart,
-                             path.pimpl_->requestedEnds[i],
-                             path.pimpl_->endRefs[i], path.pimpl_->pathEnds[i]);
+  if (h.ref == 0 || h.navMeshId != navMeshId_ ||
+      !navMesh_->isValidPolyRef(h.ref) ||
+      (startPt - h.position).squaredNorm() >
+          trackingTolerance * trackingTolerance) {
+    dtStatus status;
+    std::tie(status, h.ref, h.position) =
+        projectToPoly(startPt, navQuery.get(), filter_.get());
+    if (dtStatusFailed(status) || h.ref == 0) {
+      h.ref = 0;
+      return start;
+    }
+    h.navMeshId = navMeshId_;
+  }
 
-    if (findResult && std::get<0>(*findResult) < path.geodesicDistance) {
-      path.pimpl_->minTheoreticalDist[i] = std::get<0>(*findResult);
-      path.geodesicDistance = std::get<0>(*findResult);
-      path.points = std::move(std::get<1>(*findResult));
+  vec3f endPoint;
+  int numPolys = 0;
+  navQuery->moveAlongSurface(h.ref, h.position.data(), end.data(),
+                             filter_.get(), endPoint.data(), polys, &numPolys,
+                             MAX_POLYS, allowSliding);
+  if (numPolys == 0) {
+    return start;
+  }
+  const dtPolyRef lastRef = polys[numPolys - 1];
+
+  // The step ends at the point closest to end it can reach, so the nearest
+  // poly to end and to where the step ends are both within twice the step
+  // length of lastRef.  Only if that can reach another island do the checks
+  // of the untracked version need to search for them
+  const float stepLength =
+      (Eigen::Map<const vec3f>(end.data()) - h.position).norm();
+  const bool nearOtherIsland = 2 * stepLength > impl::ISLAND_BORDER_RADIUS ||
+                               islandBorders_->isBorder(lastRef);
+  if (nearOtherIsland) {
+    // Same as the untracked version, there is no step towards another island
+    dtStatus endStatus;
+    dtPolyRef endRef;
+    std::tie(endStatus, endRef, std::ignore) =
+        projectToPoly(end, navQuery.get(), filter_.get());
+    if (dtStatusFailed(endStatus) ||
+        !islandSystem_->hasConnection(h.ref, endRef)) {
+      return start;
     }
   }
 
-  return path.geodesicDistance < std::numeric_limits<float>::infinity();
+  // See the untracked version for why the height is taken from the poly
+  navQuery->getPolyHeight(lastRef, endPoint.data(), &endPoint[1]);
+  if (nearOtherIsland)
+    keepStepOnIsland(navQuery.get(), h.ref, lastRef, endPoint);
+
+  h.ref = lastRef;
+  h.position = endPoint;
+  return T{endPoint};
 }
 
 template <typename T>
@@ -1089,13 +4612,14 @@ T PathFinder::Impl::tryStep(const T& start, const T& end, bool allowSliding) {
   static const int MAX_POLYS = 256;
   dtPolyRef polys[MAX_POLYS];
 
+  impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
   dtStatus startStatus, endStatus;
   dtPolyRef startRef, endRef;
   vec3f pathStart;
   std::tie(startStatus, startRef, pathStart) =
-      projectToPoly(start, navQuery_.get(), filter_.get());
+      projectToPoly(start, navQuery.get(), filter_.get());
   std::tie(endStatus, endRef, std::ignore) =
-      projectToPoly(end, navQuery_.get(), filter_.get());
+      projectToPoly(end, navQuery.get(), filter_.get());
 
   if (dtStatusFailed(startStatus) || dtStatusFailed(endStatus)) {
     return start;
@@ -1107,9 +4631,9 @@ T PathFinder::Impl::tryStep(const T& start, const T& end, bool allowSliding) {
 
   vec3f endPoint;
   int numPolys;
-  navQuery_->moveAlongSurface(startRef, pathStart.data(), end.data(),
-                              filter_.get(), endPoint.data(), polys, &numPolys,
-                              MAX_POLYS, allowSliding);
+  navQuery->moveAlongSurface(startRef, pathStart.data(), end.data(),
+                             filter_.get(), endPoint.data(), polys, &numPolys,
+                             MAX_POLYS, allowSliding);
   // If there isn't any possible path between start and end, just return
   // start, that is cleanest
   if (numPolys == 0) {
@@ -1124,16 +4648,25 @@ T PathFinder::Impl::tryStep(const T& start, const T& end, bool allowSliding) {
   // surface at the endPoint and set its height to that.
   // Note, this will never fail as endPoint is always within in the poly
   // polys[numPolys - 1]
-  navQuery_->getPolyHeight(polys[numPolys - 1], endPoint.data(), &endPoint[1]);
+  navQuery->getPolyHeight(polys[numPolys - 1], endPoint.data(), &endPoint[1]);
+  keepStepOnIsland(navQuery.get(), startRef, polys[numPolys - 1], endPoint);
 
+  return T{endPoint};
+}
+
+void PathFinder::Impl::keepStepOnIsland(dtNavMeshQuery* navQuery,
+                                        dtPolyRef startRef,
+                                        dtPolyRef endRef,
+                                        vec3f& endPoint) const {
   // Hack to deal with infinitely thin walls in recast allowing you to
   // transition between two different connected components
   // First check to see if the endPoint as returned by `moveAlongSurface`
   // is in the same connected component as the startRef according to
   // findNearestPoly
-  std::tie(std::ignore, endRef, std::ignore) =
-      projectToPoly(endPoint, navQuery_.get(), filter_.get());
-  if (!this->islandSystem_->hasConnection(startRef, endRef)) {
+  dtPolyRef nearestRef;
+  std::tie(std::ignore, nearestRef, std::ignore) =
+      projectToPoly(endPoint, navQuery, filter_.get());
+  if (!islandSystem_->hasConnection(startRef, nearestRef)) {
     // There isn't a connection!  This happens when endPoint is on an edge
     // shared between two different connected components (aka infinitely thin
     // walls) The way to deal with this is to nudge the point into the polygon
@@ -1141,30 +4674,22 @@ T PathFinder::Impl::tryStep(const T& start, const T& end, bool allowSliding) {
     // endPoint to be in through the polys list
     const dtMeshTile* tile = 0;
     const dtPoly* poly = 0;
-    navMesh_->getTileAndPolyByRefUnsafe(polys[numPolys - 1], &tile, &poly);
-
-    // Calculate the center of the polygon we want the points to be in
-    vec3f polyCenter = vec3f::Zero();
-    for (int iVert = 0; iVert < poly->vertCount; ++iVert) {
-      polyCenter += Eigen::Map<vec3f>(&tile->verts[poly->verts[iVert] * 3]);
-    }
-    polyCenter /= poly->vertCount;
+    navMesh_->getTileAndPolyByRefUnsafe(endRef, &tile, &poly);
 
     constexpr float nudgeDistance = 1e-4;  // 0.1mm
-    const vec3f nudgeDir = (polyCenter - endPoint).normalized();
+    const vec3f nudgeDir = (polyCenter(tile, poly) - endPoint).normalized();
     // And nudge the point towards the center by a little tiny bit :)
     endPoint = endPoint + nudgeDistance * nudgeDir;
   }
-
-  return T{endPoint};
 }
 
 template <typename T>
 T PathFinder::Impl::snapPoint(const T& pt) {
+  impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
   dtStatus status;
   vec3f projectedPt;
   std::tie(status, std::ignore, projectedPt) =
-      projectToPoly(pt, navQuery_.get(), filter_.get());
+      projectToPoly(pt, navQuery.get(), filter_.get());
 
   if (dtStatusSucceed(status)) {
     return T{projectedPt};
@@ -1174,10 +4699,16 @@ T PathFinder::Impl::snapPoint(const T& pt) {
 }
 
 float PathFinder::Impl::islandRadius(const vec3f& pt) const {
+  impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
+  return islandRadius(navQuery.get(), pt);
+}
+
+float PathFinder::Impl::islandRadius(const dtNavMeshQuery* navQuery,
+                                     const vec3f& pt) const {
   dtPolyRef ptRef;
   dtStatus status;
   std::tie(status, ptRef, std::ignore) =
-      projectToPoly(pt, navQuery_.get(), filter_.get());
+      projectToPoly(pt, navQuery, filter_.get());
   if (status != DT_SUCCESS || ptRef == 0) {
     return 0.0;
   } else {
@@ -1188,37 +4719,125 @@ float PathFinder::Impl::islandRadius(const vec3f& pt) const {
 float PathFinder::Impl::distanceToClosestObstacle(
     const vec3f& pt,
     const float maxSearchRadius /*= 2.0*/) const {
-  return closestObstacleSurfacePoint(pt, maxSearchRadius).hitDist;
+  impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
+  return distanceToClosestObstacle(navQuery.get(), pt, maxSearchRadius);
+}
+
+float PathFinder::Impl::distanceToClosestObstacle(
+    const dtNavMeshQuery* navQuery,
+    const vec3f& pt,
+    const float maxSearchRadius) const {
+  const impl::ObstacleDistanceField* field = getObstacleDistanceField();
+  if (!field || maxSearchRadius > field->maxSearchRadius())
+    return closestObstacleSurfacePoint(navQuery, pt, maxSearchRadius).hitDist;
+
+  dtPolyRef ptRef;
+  dtStatus status;
+  vec3f polyPt;
+  std::tie(status, ptRef, polyPt) =
+      projectToPoly(pt, navQuery, filter_.get());
+  if (status != DT_SUCCESS || ptRef == 0)
+    return std::numeric_limits<float>::infinity();
+
+  const float distance = field->distance(ptRef, polyPt);
+  if (std::isnan(distance))
+    return closestObstacleSurfacePoint(navQuery, pt, maxSearchRadius).hitDist;
+  return std::min(distance, maxSearchRadius);
+}
+
+void PathFinder::Impl::setObstacleDistanceTolerance(
+    const float tolerance,
+    const float maxSearchRadius) {
+  CORRADE_ASSERT(tolerance >= 0 && maxSearchRadius > 0,
+                 "PathFinder::setObstacleDistanceTolerance: tolerance must "
+                 "not be negative and maxSearchRadius must be positive", );
+  std::lock_guard<std::mutex> lock(obstacleDistanceFieldMutex_);
+  if (tolerance == obstacleDistanceTolerance_ &&
+      maxSearchRadius == obstacleDistanceMaxRadius_)
+    return;
+
+  obstacleDistanceTolerance_ = tolerance;
+  obstacleDistanceMaxRadius_ = maxSearchRadius;
+  obstacleDistanceField_ = nullptr;
+  obstacleDistanceFieldPtr_.store(nullptr, std::memory_order_release);
+}
+
+const impl::ObstacleDistanceField*
+PathFinder::Impl::getObstacleDistanceField() const {
+  const impl::ObstacleDistanceField* field =
+      obstacleDistanceFieldPtr_.load(std::memory_order_acquire);
+  if (field || obstacleDistanceTolerance_ == 0 || !isLoaded())
+    return field;
+
+  std::lock_guard<std::mutex> lock(obstacleDistanceFieldMutex_);
+  if (!obstacleDistanceField_ && obstacleDistanceTolerance_ != 0) {
+    obstacleDistanceField_ = std::make_unique<impl::ObstacleDistanceField>(
+        navMesh_.get(), navQueryPool_.get(), filter_.get(),
+        obstacleDistanceTolerance_, obstacleDistanceMaxRadius_);
+    obstacleDistanceFieldPtr_.store(obstacleDistanceField_.get(),
+                                    std::memory_order_release);
+  }
+  return obstacleDistanceField_.get();
+}
+
+void PathFinder::Impl::resetObstacleDistanceField(
+    std::unique_ptr<impl::ObstacleDistanceField> field) {
+  std::lock_guard<std::mutex> lock(obstacleDistanceFieldMutex_);
+  // A loaded field is only used if the same one was asked for, queries stay
+  // exact otherwise
+  if (field && (obstacleDistanceTolerance_ == 0 ||
+                field->tolerance() != obstacleDistanceTolerance_ ||
+                field->maxSearchRadius() != obstacleDistanceMaxRadius_)) {
+    field = nullptr;
+  }
+  obstacleDistanceField_ = std::move(field);
+  obstacleDistanceFieldPtr_.store(obstacleDistanceField_.get(),
+                                  std::memory_order_release);
 }
 
 HitRecord PathFinder::Impl::closestObstacleSurfacePoint(
     const vec3f& pt,
     const float maxSearchRadius /*= 2.0*/) const {
+  impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
+  return closestObstacleSurfacePoint(navQuery.get(), pt, maxSearchRadius);
+}
+
+HitRecord PathFinder::Impl::closestObstacleSurfacePoint(
+    const dtNavMeshQuery* navQuery,
+    const vec3f& pt,
+    const float maxSearchRadius) const {
   dtPolyRef ptRef;
   dtStatus status;
   vec3f polyPt;
   std::tie(status, ptRef, polyPt) =
-      projectToPoly(pt, navQuery_.get(), filter_.get());
+      projectToPoly(pt, navQuery, filter_.get());
   if (status != DT_SUCCESS || ptRef == 0) {
     return {vec3f(0, 0, 0), vec3f(0, 0, 0),
             std::numeric_limits<float>::infinity()};
   } else {
     vec3f hitPos, hitNormal;
     float hitDist;
-    navQuery_->findDistanceToWall(ptRef, polyPt.data(), maxSearchRadius,
-                                  filter_.get(), &hitDist, hitPos.data(),
-                                  hitNormal.data());
+    navQuery->findDistanceToWall(ptRef, polyPt.data(), maxSearchRadius,
+                                 filter_.get(), &hitDist, hitPos.data(),
+                                 hitNormal.data());
     return {hitPos, hitNormal, hitDist};
   }
 }
 
 bool PathFinder::Impl::isNavigable(const vec3f& pt,
                                    const float maxYDelta /*= 0.5*/) const {
+  impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
+  return isNavigable(navQuery.get(), pt, maxYDelta);
+}
+
+bool PathFinder::Impl::isNavigable(const dtNavMeshQuery* navQuery,
+                                   const vec3f& pt,
+                                   const float maxYDelta) const {
   dtPolyRef ptRef;
   dtStatus status;
   vec3f polyPt;
   std::tie(status, ptRef, polyPt) =
-      projectToPoly(pt, navQuery_.get(), filter_.get());
+      projectToPoly(pt, navQuery, filter_.get());
 
   if (status != DT_SUCCESS || ptRef == 0)
     return false;
@@ -1231,39 +4850,436 @@ bool PathFinder::Impl::isNavigable(const vec3f& pt,
   return true;
 }
 
+template <typename F>
+void PathFinder::Impl::forEachPoint(
+    const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+    F f) const {
+  if (!isLoaded())
+    return;
+
+  // Below this, starting the threads costs more than the queries themselves
+  constexpr int minParallelPoints = 256;
+  const int numPoints = pts.rows();
+#pragma omp parallel if (numPoints >= minParallelPoints)
+  {
+    impl::NavQueryPool::Handle navQuery = navQueryPool_->acquire();
+
+#pragma omp for schedule(dynamic, 64)
+    for (int i = 0; i < numPoints; ++i) {
+      if (!navQuery)
+        continue;
+      f(navQuery.get(), i, vec3f{pts.row(i).transpose()});
+    }
+  }
+}
+
+void PathFinder::Impl::snapPoints(
+    const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+    Eigen::Ref<Eigen::RowMatrixXf> out) const {
+  CORRADE_ASSERT(pts.cols() == 3 && out.cols() == 3 &&
+                     pts.rows() == out.rows(),
+                 "PathFinder::snapPoints: pts and out must be Nx3 arrays", );
+  out.setConstant(NAN);
+  forEachPoint(pts, [&](const dtNavMeshQuery* navQuery, const int i,
+                        const vec3f& pt) {
+    dtStatus status;
+    vec3f projectedPt;
+    std::tie(status, std::ignore, projectedPt) =
+        projectToPoly(pt, navQuery, filter_.get());
+    if (dtStatusSucceed(status))
+      out.row(i) = projectedPt.transpose();
+  });
+}
+
+void PathFinder::Impl::islandRadii(
+    const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+    Eigen::Ref<Eigen::VectorXf> out) const {
+  CORRADE_ASSERT(pts.cols() == 3 && pts.rows() == out.rows(),
+                 "PathFinder::islandRadii: pts must be an Nx3 array and out "
+                 "must have N elements", );
+  out.setZero();
+  forEachPoint(pts, [&](const dtNavMeshQuery* navQuery, const int i,
+                        const vec3f& pt) {
+    out[i] = islandRadius(navQuery, pt);
+  });
+}
+
+void PathFinder::Impl::distancesToClosestObstacle(
+    const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+    Eigen::Ref<Eigen::VectorXf> out,
+    const float maxSearchRadius) const {
+  CORRADE_ASSERT(pts.cols() == 3 && pts.rows() == out.rows(),
+                 "PathFinder::distancesToClosestObstacle: pts must be an Nx3 "
+                 "array and out must have N elements", );
+  out.setConstant(std::numeric_limits<float>::infinity());
+  // Build the field up front with all threads instead of in the first query
+  getObstacleDistanceField();
+  forEachPoint(pts, [&](const dtNavMeshQuery* navQuery, const int i,
+                        const vec3f& pt) {
+    out[i] = distanceToClosestObstacle(navQuery, pt, maxSearchRadius);
+  });
+}
+
+void PathFinder::Impl::areNavigable(
+    const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+    Eigen::Ref<Eigen::Matrix<bool, Eigen::Dynamic, 1>> out,
+    const float maxYDelta) const {
+  CORRADE_ASSERT(pts.cols() == 3 && pts.rows() == out.rows(),
+                 "PathFinder::areNavigable: pts must be an Nx3 array and out "
+                 "must have N elements", );
+  out.setConstant(false);
+  forEachPoint(pts, [&](const dtNavMeshQuery* navQuery, const int i,
+                        const vec3f& pt) {
+    out[i] = isNavigable(navQuery, pt, maxYDelta);
+  });
+}
+
+void PathFinder::Impl::castRays(
+    const Eigen::Ref<const Eigen::RowMatrixXf>& starts,
+    const Eigen::Ref<const Eigen::RowMatrixXf>& ends,
+    Eigen::Ref<Eigen::VectorXf> hitFractions,
+    Eigen::Ref<Eigen::RowMatrixXf> hitNormals,
+    Eigen::Ref<Eigen::Matrix<uint32_t, Eigen::Dynamic, 1>> hitPolys) const {
+  const int numRays = starts.rows();
+  CORRADE_ASSERT(starts.cols() == 3 && ends.cols() == 3 &&
+                     hitNormals.cols() == 3 && ends.rows() == numRays &&
+                     hitFractions.rows() == numRays &&
+                     hitNormals.rows() == numRays &&
+                     hitPolys.rows() == numRays,
+                 "PathFinder::castRays: starts, ends and hitNormals must be "
+                 "Nx3 arrays and hitFractions and hitPolys must have N "
+                 "elements", );
+  hitFractions.setConstant(NAN);
+  hitNormals.setZero();
+  hitPolys.setZero();
+  forEachPoint(starts, [&](const dtNavMeshQuery* navQuery, const int i,
+                           const vec3f& start) {
+    dtStatus status;
+    dtPolyRef startRef;
+    vec3f startPt;
+    std::tie(status, startRef, startPt) =
+        projectToPoly(start, navQuery, filter_.get());
+    if (dtStatusFailed(status) || startRef == 0)
+      return;
+
+    static const int MAX_POLYS = 256;
+    dtPolyRef polys[MAX_POLYS];
+    int numPolys = 0;
+    float t;
+    vec3f hitNormal;
+    const vec3f end = ends.row(i).transpose();
+    status = navQuery->raycast(startRef, startPt.data(), end.data(),
+                               filter_.get(), &t, hitNormal.data(), polys,
+                               &numPolys, MAX_POLYS);
+    if (dtStatusFailed(status) || numPolys == 0)
+      return;
+
+    dtPolyRef lastRef = polys[numPolys - 1];
+    if (dtStatusDetail(status, DT_BUFFER_TOO_SMALL)) {
+      // Only the first polys fit, so look up the one the ray stopped on
+      const vec3f stop = startPt + std::min(t, 1.0f) * (end - startPt);
+      std::tie(status, lastRef, std::ignore) =
+          projectToPoly(stop, navQuery, filter_.get());
+    }
+
+    const bool hit = t <= 1.0f;
+    hitFractions[i] = hit ? t : std::numeric_limits<float>::infinity();
+    if (hit)
+      hitNormals.row(i) = hitNormal.transpose();
+    hitPolys[i] = lastRef;
+  });
+}
+
 typedef Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic> MatrixXb;
 
+namespace {
+// Samples of the top down view: sample (h, w) is at x = startx + w *
+// pixelsPerMeter and z = startz + h * pixelsPerMeter
+struct TopDownGrid {
+  float startx, startz;
+  int xResolution, zResolution;
+
+  TopDownGrid(const std::pair<vec3f, vec3f>& mapBounds,
+              const float pixelsPerMeter) {
+    const vec3f& bound1 = mapBounds.first;
+    const vec3f& bound2 = mapBounds.second;
+
+    float xspan = std::abs(bound1[0] - bound2[0]);
+    float zspan = std::abs(bound1[2] - bound2[2]);
+    xResolution = xspan / pixelsPerMeter;
+    zResolution = zspan / pixelsPerMeter;
+    startx = fmin(bound1[0], bound2[0]);
+    startz = fmin(bound1[2], bound2[2]);
+  }
+};
+
+// Squared distance transform of f in one dimension, from Felzenszwalb and
+// Huttenlocher, "Distance Transforms of Sampled Functions".  v and z are
+// scratch space of size n and n + 1
+void squaredDistanceTransform(const float* f,
+                              const int n,
+                              float* d,
+                              int* v,
+                              float* z) {
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  int k = 0;
+  v[0] = 0;
+  z[0] = -inf;
+  z[1] = inf;
+  for (int q = 1; q < n; ++q) {
+    if (f[q] == inf)
+      continue;
+    if (f[v[k]] == inf) {
+      v[k] = q;
+      continue;
+    }
+    float s;
+    while (true) {
+      s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+      if (s > z[k] || k == 0)
+        break;
+      --k;
+    }
+    ++k;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = inf;
+  }
+
+  k = 0;
+  for (int q = 0; q < n; ++q) {
+    while (z[k + 1] < q)
+      ++k;
+    d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+  }
+}
+}  // namespace
+
+Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+PathFinder::Impl::rasterizeTopDownView(const float pixelsPerMeter,
+                                       const float height,
+                                       const float maxYDelta) {
+  const TopDownGrid grid{bounds(), pixelsPerMeter};
+  Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> islands(
+      grid.zResolution, grid.xResolution);
+  islands.setConstant(ID_UNDEFINED);
+  if (!isLoaded() || islands.size() == 0)
+    return islands;
+
+  // Gather the detail triangles of all walkable polys that reach into the
+  // height band.  Coordinates are in samples
+  struct TopDownTriangle {
+    Eigen::Vector2f v[3];
+    // y = plane.dot((x, z, 1))
+    vec3f plane;
+    int islandId;
+  };
+  std::vector<TopDownTriangle> triangles;
+  const dtNavMesh* navMesh = navMesh_.get();
+  for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+    const dtMeshTile* tile = navMesh->getTile(iTile);
+    if (!tile || !tile->header)
+      continue;
+
+    for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+      const dtPolyRef ref = navMesh->encodePolyId(tile->salt, iTile, jPoly);
+      const dtPoly* poly = &tile->polys[jPoly];
+      if (poly->getType() != DT_POLYTYPE_GROUND ||
+          !filter_->passFilter(ref, tile, poly))
+        continue;
+
+      const uint32_t islandId = islandSystem_->islandId(ref);
+      for (const Triangle& tri : getPolygonTriangles(poly, tile)) {
+        const float minY =
+            std::min({tri.v[0][1], tri.v[1][1], tri.v[2][1]});
+        const float maxY =
+            std::max({tri.v[0][1], tri.v[1][1], tri.v[2][1]});
+        if (minY > height + maxYDelta || maxY < height - maxYDelta)
+          continue;
+
+        TopDownTriangle t;
+        Eigen::Matrix3f A;
+        for (int k = 0; k < 3; ++k) {
+          t.v[k] = Eigen::Vector2f(tri.v[k][0] - grid.startx,
+                                   tri.v[k][2] - grid.startz) /
+                   pixelsPerMeter;
+          A.row(k) << t.v[k][0], t.v[k][1], 1;
+        }
+        // Walls are vertical in the top down view
+        if (std::abs(A.determinant()) < 1e-6)
+          continue;
+        t.plane = A.partialPivLu().solve(
+            vec3f(tri.v[0][1], tri.v[1][1], tri.v[2][1]));
+        t.islandId = islandId == impl::NO_ISLAND ? ID_UNDEFINED : islandId;
+        triangles.emplace_back(t);
+      }
+    }
+  }
+
+  // Bin the triangles into bands of rows so that every band can be filled
+  // independently of the others
+  constexpr int rowsPerBand = 32;
+  const int numBands = (grid.zResolution + rowsPerBand - 1) / rowsPerBand;
+  std::vector<std::vector<int>> bandTriangles(numBands);
+  for (int iTri = 0; iTri < static_cast<int>(triangles.size()); ++iTri) {
+    const TopDownTriangle& t = triangles[iTri];
+    const float minZ = std::min({t.v[0][1], t.v[1][1], t.v[2][1]});
+    const float maxZ = std::max({t.v[0][1], t.v[1][1], t.v[2][1]});
+    const int firstBand =
+        std::max(static_cast<int>(std::ceil(minZ)), 0) / rowsPerBand;
+    const int lastBand =
+        std::min(static_cast<int>(std::floor(maxZ)), grid.zResolution - 1) /
+        rowsPerBand;
+    for (int band = firstBand; band <= lastBand; ++band) {
+      bandTriangles[band].emplace_back(iTri);
+    }
+  }
+
+#pragma omp parallel
+  {
+    // Where more than one triangle covers a sample, the one closest to height
+    // wins
+    std::vector<float> bestYDelta;
+#pragma omp for schedule(dynamic)
+    for (int band = 0; band < numBands; ++band) {
+      const int firstRow = band * rowsPerBand;
+      const int lastRow =
+          std::min(firstRow + rowsPerBand, grid.zResolution) - 1;
+      bestYDelta.assign((lastRow - firstRow + 1) * grid.xResolution,
+                        std::numeric_limits<float>::infinity());
+
+      for (const int iTri : bandTriangles[band]) {
+        const TopDownTriangle& t = triangles[iTri];
+        const float minZ = std::min({t.v[0][1], t.v[1][1], t.v[2][1]});
+        const float maxZ = std::max({t.v[0][1], t.v[1][1], t.v[2][1]});
+        const int h0 = std::max(static_cast<int>(std::ceil(minZ)), firstRow);
+        const int h1 = std::min(static_cast<int>(std::floor(maxZ)), lastRow);
+
+        for (int h = h0; h <= h1; ++h) {
+          // Extent of the triangle along this row
+          float minX = std::numeric_limits<float>::infinity();
+          float maxX = -std::numeric_limits<float>::infinity();
+          for (int k = 0; k < 3; ++k) {
+            const Eigen::Vector2f& a = t.v[k];
+            const Eigen::Vector2f& b = t.v[(k + 1) % 3];
+            if ((a[1] - h) * (b[1] - h) > 0)
+              continue;
+            if (a[1] == b[1]) {
+              minX = std::min({minX, a[0], b[0]});
+              maxX = std::max({maxX, a[0], b[0]});
+            } else {
+              const float x = a[0] + (h - a[1]) / (b[1] - a[1]) * (b[0] - a[0]);
+              minX = std::min(minX, x);
+              maxX = std::max(maxX, x);
+            }
+          }
+
+          const int w0 = std::max(static_cast<int>(std::ceil(minX)), 0);
+          const int w1 = std::min(static_cast<int>(std::floor(maxX)),
+                                  grid.xResolution - 1);
+          for (int w = w0; w <= w1; ++w) {
+            const float yDelta =
+                std::abs(t.plane.dot(vec3f(w, h, 1)) - height);
+            float& best = bestYDelta[(h - firstRow) * grid.xResolution + w];
+            if (yDelta <= maxYDelta && yDelta < best) {
+              best = yDelta;
+              islands(h, w) = t.islandId;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return islands;
+}
+
 Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic>
 PathFinder::Impl::getTopDownView(const float pixelsPerMeter,
-                                 const float height) {
-  std::pair<vec3f, vec3f> mapBounds = bounds();
-  vec3f bound1 = mapBounds.first;
-  vec3f bound2 = mapBounds.second;
-
-  float xspan = std::abs(bound1[0] - bound2[0]);
-  float zspan = std::abs(bound1[2] - bound2[2]);
-  int xResolution = xspan / pixelsPerMeter;
-  int zResolution = zspan / pixelsPerMeter;
-  float startx = fmin(bound1[0], bound2[0]);
-  float startz = fmin(bound1[2], bound2[2]);
-  MatrixXb topdownMap(zResolution, xResolution);
-
-  float curz = startz;
-  float curx = startx;
-  for (int h = 0; h < zResolution; h++) {
-    for (int w = 0; w < xResolution; w++) {
+                                 const float height,
+                                 bool rasterize) {
+  if (rasterize) {
+    return (rasterizeTopDownView(pixelsPerMeter, height, 0.5).array() !=
+            ID_UNDEFINED)
+        .matrix();
+  }
+
+  const TopDownGrid grid{bounds(), pixelsPerMeter};
+  MatrixXb topdownMap(grid.zResolution, grid.xResolution);
+
+  float curz = grid.startz;
+  float curx = grid.startx;
+  for (int h = 0; h < grid.zResolution; h++) {
+    for (int w = 0; w < grid.xResolution; w++) {
       vec3f point = vec3f(curx, height, curz);
       topdownMap(h, w) = isNavigable(point, 0.5);
       curx = curx + pixelsPerMeter;
     }
     curz = curz + pixelsPerMeter;
-    curx = startx;
+    curx = grid.startx;
   }
 
   return topdownMap;
 }
 
+Eigen::MatrixXi PathFinder::Impl::getTopDownIslandView(
+    const float pixelsPerMeter,
+    const float height,
+    const float maxYDelta) {
+  return rasterizeTopDownView(pixelsPerMeter, height, maxYDelta);
+}
+
+Eigen::MatrixXf PathFinder::Impl::getTopDownDistanceView(
+    const float pixelsPerMeter,
+    const float height,
+    const float maxYDelta) {
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  const Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+      islands = rasterizeTopDownView(pixelsPerMeter, height, maxYDelta);
+  const int rows = islands.rows();
+  const int cols = islands.cols();
+
+  // Exact euclidean distance transform, one dimension at a time.  Everything
+  // outside of the view counts as a wall as well
+  Eigen::MatrixXf dist(rows, cols);
+#pragma omp parallel
+  {
+    std::vector<float> f(cols), d(cols), z(cols + 1);
+    std::vector<int> v(cols);
+#pragma omp for schedule(dynamic, 16)
+    for (int h = 0; h < rows; ++h) {
+      for (int w = 0; w < cols; ++w) {
+        f[w] = islands(h, w) == ID_UNDEFINED ? 0 : inf;
+      }
+      squaredDistanceTransform(f.data(), cols, d.data(), v.data(), z.data());
+      for (int w = 0; w < cols; ++w) {
+        const float toBorder = std::min(w + 1, cols - w);
+        dist(h, w) = std::min(d[w], toBorder * toBorder);
+      }
+    }
+  }
+#pragma omp parallel
+  {
+    std::vector<float> d(rows), z(rows + 1);
+    std::vector<int> v(rows);
+#pragma omp for schedule(dynamic, 16)
+    for (int w = 0; w < cols; ++w) {
+      // Columns are contiguous in dist
+      squaredDistanceTransform(&dist(0, w), rows, d.data(), v.data(),
+                               z.data());
+      for (int h = 0; h < rows; ++h) {
+        const float toBorder = std::min(h + 1, rows - h);
+        dist(h, w) = std::sqrt(std::min(d[h], toBorder * toBorder)) *
+                     pixelsPerMeter;
+      }
+    }
+  }
+
+  return dist;
+}
+
 const assets::MeshData::ptr PathFinder::Impl::getNavMeshData() {
+  std::lock_guard<std::mutex> lock(meshDataMutex_);
   if (meshData_ == nullptr && isLoaded()) {
     meshData_ = assets::MeshData::create();
     std::vector<esp::vec3f>& vbo = meshData_->vbo;
@@ -1273,13 +5289,13 @@ const assets::MeshData::ptr PathFinder::Impl::getNavMeshData() {
     for (int iTile = 0; iTile < navMesh_->getMaxTiles(); ++iTile) {
       const dtMeshTile* tile =
           const_cast<const dtNavMesh*>(navMesh_.get())->getTile(iTile);
-      if (!tile)
+      if (!tile || !tile->header)
         continue;
 
       // Iterate over all polygons in a tile
       for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
         // Get the polygon reference from the tile and polygon id
-        dtPolyRef polyRef = navMesh_->encodePolyId(iTile, tile->salt, jPoly);
+        dtPolyRef polyRef = navMesh_->encodePolyId(tile->salt, iTile, jPoly);
         const dtPoly* poly = nullptr;
         const dtMeshTile* tmp = nullptr;
         navMesh_->getTileAndPolyByRefUnsafe(polyRef, &tmp, &poly);
@@ -1310,17 +5326,134 @@ bool PathFinder::build(const NavMeshSettings& bs,
                        const int ntris,
                        const float* bmin,
                        const float* bmax) {
+  dropProfiles();
   return pimpl_->build(bs, verts, nverts, tris, ntris, bmin, bmax);
 }
 bool PathFinder::build(const NavMeshSettings& bs,
                        const esp::assets::MeshData& mesh) {
+  dropProfiles();
   return pimpl_->build(bs, mesh);
 }
 
+bool PathFinder::build(const std::vector<NavMeshSettings>& profiles,
+                       const esp::assets::MeshData& mesh) {
+  std::vector<spimpl::unique_impl_ptr<Impl>> impls;
+  std::vector<Impl*> implPtrs;
+  for (int i = 0; i < profiles.size(); ++i) {
+    impls.emplace_back(spimpl::make_unique_impl<Impl>());
+    implPtrs.push_back(impls.back().get());
+  }
+  if (!Impl::buildProfiles(profiles, mesh, implPtrs))
+    return false;
+
+  pimpl_ = std::move(impls[0]);
+  profiles_ = std::move(impls);
+  activeProfile_ = 0;
+  return true;
+}
+
+int PathFinder::numProfiles() const {
+  return std::max<int>(profiles_.size(), 1);
+}
+
+bool PathFinder::setProfile(const int profile) {
+  if (profile < 0 || profile >= numProfiles())
+    return false;
+  if (profile == activeProfile_)
+    return true;
+
+  // Obstacles are part of the scene, not of a profile
+  profiles_[profile]->copyObstacles(*pimpl_);
+  std::swap(pimpl_, profiles_[activeProfile_]);
+  std::swap(pimpl_, profiles_[profile]);
+  activeProfile_ = profile;
+  return true;
+}
+
+void PathFinder::dropProfiles() {
+  profiles_.clear();
+  activeProfile_ = 0;
+}
+
+dtNavMesh* PathFinder::detourNavMesh() const {
+  return pimpl_->detourNavMesh();
+}
+
+const dtQueryFilter* PathFinder::detourFilter() const {
+  return pimpl_->detourFilter();
+}
+
+bool PathFinder::rebuildRegions(
+    const NavMeshSettings& bs,
+    const esp::assets::MeshData& mesh,
+    const std::vector<std::pair<vec3f, vec3f>>& regions) {
+  return pimpl_->rebuildRegions(bs, mesh, regions);
+}
+
+int PathFinder::addCylinderObstacle(const vec3f& center,
+                                    const float radius,
+                                    const float height) {
+  return pimpl_->addCylinderObstacle(center, radius, height);
+}
+
+int PathFinder::addBoxObstacle(const vec3f& center,
+                               const vec3f& halfExtents,
+                               const float yaw) {
+  return pimpl_->addBoxObstacle(center, halfExtents, yaw);
+}
+
+bool PathFinder::moveObstacle(const int obstacleId,
+                              const vec3f& center,
+                              const float yaw) {
+  return pimpl_->moveObstacle(obstacleId, center, yaw);
+}
+
+bool PathFinder::removeObstacle(const int obstacleId) {
+  return pimpl_->removeObstacle(obstacleId);
+}
+
+int PathFinder::numObstacles() const {
+  return pimpl_->numObstacles();
+}
+
+bool PathFinder::isTiled() const {
+  return pimpl_->isTiled();
+}
+
+bool PathFinder::updateObstacles(const bool blocking) {
+  return pimpl_->updateObstacles(blocking);
+}
+
 vec3f PathFinder::getRandomNavigablePoint() {
   return pimpl_->getRandomNavigablePoint();
 }
 
+Eigen::RowMatrixXf PathFinder::getRandomNavigablePoints(const int numPoints) {
+  return pimpl_->getRandomNavigablePoints(numPoints);
+}
+
+Eigen::RowMatrixXf PathFinder::getRandomNavigablePointsOnIsland(
+    const vec3f& pt,
+    const int numPoints) {
+  return pimpl_->getRandomNavigablePointsOnIsland(pt, numPoints);
+}
+
+Eigen::RowMatrixXf PathFinder::getRandomNavigablePointsAroundPoint(
+    const vec3f& center,
+    const float radius,
+    const int numPoints) {
+  return pimpl_->getRandomNavigablePointsAroundPoint(center, radius,
+                                                     numPoints);
+}
+
+Eigen::RowMatrixXf PathFinder::getRandomNavigablePointsInHeightBand(
+    const float minHeight,
+    const float maxHeight,
+    const int numPoints) {
+  return pimpl_->getRandomNavigablePointsInHeightBand(minHeight, maxHeight,
+                                                      numPoints);
+}
+
 bool PathFinder::findPath(ShortestPath& path) {
   return pimpl_->findPath(path);
 }
@@ -1329,6 +5462,37 @@ bool PathFinder::findPath(MultiGoalShortestPath& path) {
   return pimpl_->findPath(path);
 }
 
+bool PathFinder::initSlicedPath(SlicedShortestPath& path) {
+  return pimpl_->initSlicedPath(path);
+}
+
+bool PathFinder::updateSlicedPath(SlicedShortestPath& path,
+                                  int maxIterations,
+                                  float maxMicroseconds /*= 0*/) {
+  return pimpl_->updateSlicedPath(path, maxIterations, maxMicroseconds);
+}
+
+bool PathFinder::finalizeSlicedPath(SlicedShortestPath& path) {
+  return pimpl_->finalizeSlicedPath(path);
+}
+
+ShortestPathBatch PathFinder::findPaths(
+    const Eigen::Ref<const Eigen::RowMatrixXf>& starts,
+    const Eigen::Ref<const Eigen::RowMatrixXf>& ends,
+    bool returnPoints) {
+  return pimpl_->findPaths(starts, ends, returnPoints);
+}
+
+GeodesicDistanceField::ptr PathFinder::buildDistanceField(
+    const std::vector<vec3f>& goals) {
+  return pimpl_->buildDistanceField(goals);
+}
+
+float PathFinder::geodesicDistance(const GeodesicDistanceField& field,
+                                   const vec3f& pt) {
+  return pimpl_->geodesicDistance(field, pt);
+}
+
 template vec3f PathFinder::tryStep<vec3f>(const vec3f&, const vec3f&);
 template Mn::Vector3 PathFinder::tryStep<Mn::Vector3>(const Mn::Vector3&,
                                                       const Mn::Vector3&);
@@ -1348,6 +5512,33 @@ T PathFinder::tryStepNoSliding(const T& start, const T& end) {
   return pimpl_->tryStep(start, end, /*allowSliding=*/false);
 }
 
+template vec3f PathFinder::tryStep<vec3f>(AgentNavHandle&,
+                                         const vec3f&,
+                                         const vec3f&);
+template Mn::Vector3 PathFinder::tryStep<Mn::Vector3>(AgentNavHandle&,
+                                                      const Mn::Vector3&,
+                                                      const Mn::Vector3&);
+
+template <typename T>
+T PathFinder::tryStep(AgentNavHandle& handle, const T& start, const T& end) {
+  return pimpl_->tryStep(handle, start, end, /*allowSliding=*/true);
+}
+
+template vec3f PathFinder::tryStepNoSliding<vec3f>(AgentNavHandle&,
+                                                   const vec3f&,
+                                                   const vec3f&);
+template Mn::Vector3 PathFinder::tryStepNoSliding<Mn::Vector3>(
+    AgentNavHandle&,
+    const Mn::Vector3&,
+    const Mn::Vector3&);
+
+template <typename T>
+T PathFinder::tryStepNoSliding(AgentNavHandle& handle,
+                               const T& start,
+                               const T& end) {
+  return pimpl_->tryStep(handle, start, end, /*allowSliding=*/false);
+}
+
 template vec3f PathFinder::snapPoint<vec3f>(const vec3f& pt);
 template Mn::Vector3 PathFinder::snapPoint<Mn::Vector3>(const Mn::Vector3& pt);
 
@@ -1356,8 +5547,9 @@ T PathFinder::snapPoint(const T& pt) {
   return pimpl_->snapPoint(pt);
 }
 
-bool PathFinder::loadNavMesh(const std::string& path) {
-  return pimpl_->loadNavMesh(path);
+bool PathFinder::loadNavMesh(const std::string& path, bool memoryMap) {
+  dropProfiles();
+  return pimpl_->loadNavMesh(path, memoryMap);
 }
 
 bool PathFinder::saveNavMesh(const std::string& path) {
@@ -1368,6 +5560,10 @@ bool PathFinder::isLoaded() const {
   return pimpl_->isLoaded();
 }
 
+size_t PathFinder::navMeshId() const {
+  return pimpl_->navMeshId();
+}
+
 void PathFinder::seed(uint32_t newSeed) {
   return pimpl_->seed(newSeed);
 }
@@ -1387,6 +5583,16 @@ HitRecord PathFinder::closestObstacleSurfacePoint(
   return pimpl_->closestObstacleSurfacePoint(pt, maxSearchRadius);
 }
 
+void PathFinder::setObstacleDistanceTolerance(
+    const float tolerance,
+    const float maxSearchRadius /*= 2.0*/) {
+  pimpl_->setObstacleDistanceTolerance(tolerance, maxSearchRadius);
+}
+
+float PathFinder::getObstacleDistanceTolerance() const {
+  return pimpl_->getObstacleDistanceTolerance();
+}
+
 bool PathFinder::isNavigable(const vec3f& pt, const float maxYDelta) const {
   return pimpl_->isNavigable(pt);
 }
@@ -1397,8 +5603,54 @@ std::pair<vec3f, vec3f> PathFinder::bounds() const {
 
 Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic> PathFinder::getTopDownView(
     const float pixelsPerMeter,
-    const float height) {
-  return pimpl_->getTopDownView(pixelsPerMeter, height);
+    const float height,
+    bool rasterize) {
+  return pimpl_->getTopDownView(pixelsPerMeter, height, rasterize);
+}
+
+void PathFinder::snapPoints(const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+                            Eigen::Ref<Eigen::RowMatrixXf> out) {
+  pimpl_->snapPoints(pts, out);
+}
+
+void PathFinder::islandRadii(const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+                             Eigen::Ref<Eigen::VectorXf> out) const {
+  pimpl_->islandRadii(pts, out);
+}
+
+void PathFinder::distancesToClosestObstacle(
+    const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+    Eigen::Ref<Eigen::VectorXf> out,
+    const float maxSearchRadius /*= 2.0*/) const {
+  pimpl_->distancesToClosestObstacle(pts, out, maxSearchRadius);
+}
+
+void PathFinder::areNavigable(
+    const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+    Eigen::Ref<Eigen::Matrix<bool, Eigen::Dynamic, 1>> out,
+    const float maxYDelta /*= 0.5*/) const {
+  pimpl_->areNavigable(pts, out, maxYDelta);
+}
+
+void PathFinder::castRays(
+    const Eigen::Ref<const Eigen::RowMatrixXf>& starts,
+    const Eigen::Ref<const Eigen::RowMatrixXf>& ends,
+    Eigen::Ref<Eigen::VectorXf> hitFractions,
+    Eigen::Ref<Eigen::RowMatrixXf> hitNormals,
+    Eigen::Ref<Eigen::Matrix<uint32_t, Eigen::Dynamic, 1>> hitPolys) const {
+  pimpl_->castRays(starts, ends, hitFractions, hitNormals, hitPolys);
+}
+
+Eigen::MatrixXi PathFinder::getTopDownIslandView(const float pixelsPerMeter,
+                                                 const float height,
+                                                 const float maxYDelta) {
+  return pimpl_->getTopDownIslandView(pixelsPerMeter, height, maxYDelta);
+}
+
+Eigen::MatrixXf PathFinder::getTopDownDistanceView(const float pixelsPerMeter,
+                                                   const float height,
+                                                   const float maxYDelta) {
+  return pimpl_->getTopDownDistanceView(pixelsPerMeter, height, maxYDelta);
 }
 
 const assets::MeshData::ptr PathFinder::getNavMeshData() {
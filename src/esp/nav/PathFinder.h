@@ -9,6 +9,9 @@
 
 #include "esp/core/esp.h"
 
+class dtNavMesh;
+class dtQueryFilter;
+
 namespace esp {
 // forward declaration
 namespace assets {
@@ -59,6 +62,33 @@ struct ShortestPath {
   ESP_SMART_POINTERS(ShortestPath)
 };
 
+/**
+ * @brief Geodesic distances to a fixed set of goal points, precomputed over
+ * the whole navigation mesh.  Created by @ref PathFinder.buildDistanceField
+ *
+ * Building the field runs a single expansion over the navigation mesh from
+ * all goals at once.  Afterwards, @ref PathFinder.geodesicDistance answers
+ * "how far is this point from the closest goal" with a @ref
+ * PathFinder.snapPoint and a constant amount of work, so the field is worth
+ * keeping around for as long as the goals do not change (i.e. across
+ * episodes).
+ *
+ * @note A field is only valid for the navigation mesh it was built on
+ */
+class GeodesicDistanceField {
+ public:
+  GeodesicDistanceField();
+
+  /**
+   * @brief The goal points the field was built for
+   */
+  const std::vector<vec3f>& getGoals() const;
+
+  friend class PathFinder;
+
+  ESP_SMART_POINTERS_WITH_UNIQUE_PIMPL(GeodesicDistanceField);
+};
+
 /**
  * @brief Struct for multi-goal shortest path finding. Used in conjunction with
  * @ref PathFinder.findPath
@@ -73,11 +103,24 @@ struct MultiGoalShortestPath {
 
   /**
    * @brief Set the list of desired potential end points
+   *
+   * @note This clears any distance field set by @ref setDistanceField
    */
   void setRequestedEnds(const std::vector<vec3f>& newEnds);
 
   const std::vector<vec3f>& getRequestedEnds() const;
 
+  /**
+   * @brief Use a precomputed distance field to find the path.  The requested
+   * ends are set to the goals of the field.
+   *
+   * @ref PathFinder.findPath will then trace the path down the field instead
+   * of searching the navigation mesh once per end point.
+   */
+  void setDistanceField(const std::shared_ptr<GeodesicDistanceField>& field);
+
+  const std::shared_ptr<GeodesicDistanceField>& getDistanceField() const;
+
   /**
    * @brief A list of points that specify the shortest path on the navigation
    * mesh between @ref requestedStart and the closest (by geodesic distance)
@@ -99,6 +142,115 @@ struct MultiGoalShortestPath {
   ESP_SMART_POINTERS_WITH_UNIQUE_PIMPL(MultiGoalShortestPath);
 };
 
+/**
+ * @brief Struct for shortest path finding that is spread over many calls with
+ * a bounded amount of work each.  Started with @ref
+ * PathFinder.initSlicedPath, advanced with @ref PathFinder.updateSlicedPath
+ * and finished with @ref PathFinder.finalizeSlicedPath
+ *
+ * Every request holds its own navigation mesh query, so any number of them
+ * can be in progress at the same time.
+ */
+struct SlicedShortestPath {
+  SlicedShortestPath();
+
+  /**
+   * @brief The starting point for the path
+   */
+  vec3f requestedStart;
+
+  /**
+   * @brief The ending point for the path
+   */
+  vec3f requestedEnd;
+
+  /**
+   * @brief A list of points that specify the path found by @ref
+   * PathFinder.finalizeSlicedPath.  If the search was not done yet, the path
+   * leads to the point closest to @ref requestedEnd found so far.
+   *
+   * Will be empty if no path exists
+   */
+  std::vector<vec3f> points;
+
+  /**
+   * @brief The geodesic distance along @ref points
+   *
+   * Will be inf if no path exists
+   */
+  float geodesicDistance;
+
+  /**
+   * @brief Whether or not @ref points reach @ref requestedEnd
+   */
+  bool isComplete;
+
+  /**
+   * @brief Whether or not the search has finished, successfully or not.
+   * @ref PathFinder.updateSlicedPath has nothing left to do then.
+   */
+  bool isDone() const;
+
+  friend class PathFinder;
+
+  ESP_SMART_POINTERS_WITH_UNIQUE_PIMPL(SlicedShortestPath);
+};
+
+/**
+ * @brief Remembers the navmesh polygon an agent was left on by @ref
+ * PathFinder.tryStep so the next step can start from it directly instead of
+ * searching the navmesh for the polygon under the agent.
+ *
+ * Keep one per agent.  Tracking is dropped and the polygon looked up again
+ * whenever the agent is moved by anything else or the navmesh changes.
+ */
+struct AgentNavHandle {
+  AgentNavHandle();
+
+  /**
+   * @brief Forgets the tracked polygon
+   */
+  void reset();
+
+  /**
+   * @brief Whether or not a polygon is currently tracked
+   */
+  bool isTracking() const;
+
+  friend class PathFinder;
+
+  ESP_SMART_POINTERS_WITH_UNIQUE_PIMPL(AgentNavHandle);
+};
+
+/**
+ * @brief Struct holding the results of batched shortest path finding. Returned
+ * by @ref PathFinder.findPaths
+ */
+struct ShortestPathBatch {
+  /**
+   * @brief The geodesic distance for every (start, end) pair
+   *
+   * @note Will be inf for pairs where no path exists
+   */
+  Eigen::VectorXf geodesicDistances;
+
+  /**
+   * @brief The points of all paths packed into a single Mx3 array
+   *
+   * The points of the i-th path are the rows in [@ref pathOffsets[i], @ref
+   * pathOffsets[i + 1]).  Will be empty if the points were not requested.
+   */
+  Eigen::RowMatrixXf points;
+
+  /**
+   * @brief Offsets of each path into @ref points.  Has N + 1 entries if the
+   * points were requested, otherwise it is empty
+   */
+  Eigen::VectorXi pathOffsets;
+
+  ESP_SMART_POINTERS(ShortestPathBatch)
+};
+
 struct NavMeshSettings {
   //! Cell size in world units
   float cellSize;
@@ -133,6 +285,12 @@ struct NavMeshSettings {
   bool filterLedgeSpans;
   bool filterWalkableLowHeightSpans;
 
+  //! Build the navmesh as a grid of tiles that are built in parallel instead
+  //! of as a single mesh
+  bool buildTiled;
+  //! Width and depth of a tile in voxels
+  int tileSize;
+
   void setDefaults() {
     cellSize = 0.05f;
     cellHeight = 0.2f;
@@ -150,14 +308,24 @@ struct NavMeshSettings {
     filterLowHangingObstacles = true;
     filterLedgeSpans = true;
     filterWalkableLowHeightSpans = true;
+    buildTiled = false;
+    tileSize = 256;
   }
 
   ESP_SMART_POINTERS(NavMeshSettings)
 };
 
+bool operator==(const NavMeshSettings& a, const NavMeshSettings& b);
+bool operator!=(const NavMeshSettings& a, const NavMeshSettings& b);
+
 /** Loads and/or builds a navigation mesh and then performs path
  * finding and collision queries on that navmesh
  *
+ * The query methods (@ref findPath, @ref tryStep, @ref snapPoint, @ref
+ * isNavigable, ...) may be called concurrently from multiple threads on the
+ * same instance: the navigation mesh and its connectivity information are
+ * shared while every call borrows its own Detour query from an internal pool.
+ * Building or loading a navigation mesh must not overlap with any query.
  */
 class PathFinder {
  public:
@@ -176,6 +344,142 @@ class PathFinder {
              const float* bmax);
   bool build(const NavMeshSettings& bs, const esp::assets::MeshData& mesh);
 
+  /**
+   * @brief Builds one navigation mesh per agent profile from @ref mesh
+   *
+   * Profiles that only differ in the agent radius and height, and are not
+   * tiled, share a single rasterization of @ref mesh and their remaining
+   * build stages run in parallel.  Other profiles are built one by one.
+   *
+   * The first profile is selected afterwards, see @ref setProfile.  Building
+   * or loading a single navigation mesh drops all profiles again.
+   *
+   * @return Whether or not all navigation meshes were built.  Nothing is
+   * changed if one of them fails
+   */
+  bool build(const std::vector<NavMeshSettings>& profiles,
+             const esp::assets::MeshData& mesh);
+
+  /**
+   * @brief Number of agent profiles built by @ref build, 1 if it was built or
+   * loaded otherwise
+   */
+  int numProfiles() const;
+
+  /**
+   * @brief Makes all queries use the navigation mesh of @ref profile, which
+   * is an index into the profiles passed to @ref build
+   *
+   * Settings such as the seed or the obstacle distance tolerance belong to
+   * the navigation mesh of a profile.  Obstacles are the same for all
+   * profiles: the ones that changed since @ref profile was last active are
+   * carved into it by the next @ref updateObstacles.  Must not overlap with
+   * any query.
+   *
+   * @return False if there is no such profile
+   */
+  bool setProfile(int profile);
+
+  /**
+   * @brief The profile currently used by queries
+   */
+  int getProfile() const { return activeProfile_; }
+
+  /**
+   * @brief Rebuilds only the tiles of the navigation mesh that overlap any of
+   * the given regions and keeps the rest of it.
+   *
+   * Meant for when a few objects in the scene were added, removed or moved
+   * since the last build: only the tiles around them are voxelized again and
+   * only the islands that touch these tiles are recomputed.  Updating in place
+   * requires the current navigation mesh to be built with @ref
+   * NavMeshSettings.buildTiled and the same settings from a mesh with the same
+   * bounds, otherwise the whole navigation mesh is rebuilt.
+   *
+   * @param bs The settings to build with
+   * @param mesh The complete mesh to build the navigation mesh from
+   * @param regions Axis aligned bounding boxes, as min and max corner, of the
+   * parts of the scene that changed
+   * @return Whether or not the navigation mesh was updated successfully
+   */
+  bool rebuildRegions(const NavMeshSettings& bs,
+                      const esp::assets::MeshData& mesh,
+                      const std::vector<std::pair<vec3f, vec3f>>& regions);
+
+  /**
+   * @brief Adds an upright cylinder that is cut out of the navigation mesh,
+   * e.g. for a moving object.
+   *
+   * Obstacles are grown by the agent radius and cut out of every build from
+   * now on.  Adding, moving or removing an obstacle only marks the tiles it
+   * overlaps, see @ref updateObstacles for carving them.
+   *
+   * @param center The center of the cylinder
+   * @param radius The radius of the cylinder
+   * @param height The height of the cylinder
+   * @return The id of the obstacle
+   */
+  int addCylinderObstacle(const vec3f& center, float radius, float height);
+
+  /**
+   * @brief Adds a box rotated around the y axis that is cut out of the
+   * navigation mesh, see @ref addCylinderObstacle.
+   *
+   * @param center The center of the box
+   * @param halfExtents Half the size of the box along its local axes
+   * @param yaw Rotation of the box around the y axis, in radians
+   * @return The id of the obstacle
+   */
+  int addBoxObstacle(const vec3f& center,
+                     const vec3f& halfExtents,
+                     float yaw = 0.0f);
+
+  /**
+   * @brief Moves an obstacle, the yaw is ignored for cylinders
+   *
+   * @return False if there is no such obstacle
+   */
+  bool moveObstacle(int obstacleId, const vec3f& center, float yaw = 0.0f);
+
+  /**
+   * @brief Removes an obstacle
+   *
+   * @return False if there is no such obstacle
+   */
+  bool removeObstacle(int obstacleId);
+
+  /**
+   * @brief The number of obstacles
+   */
+  int numObstacles() const;
+
+  /**
+   * @brief Whether the navigation mesh of the active profile was built with
+   * @ref NavMeshSettings.buildTiled, which @ref rebuildRegions and @ref
+   * updateObstacles need to update it in place.  Loaded navigation meshes
+   * are not.
+   */
+  bool isTiled() const;
+
+  /**
+   * @brief Carves the obstacles that changed since the last update into the
+   * navigation mesh.
+   *
+   * Only the tiles that an obstacle overlapped before or overlaps now are
+   * rebuilt, from the mesh the navigation mesh was built from, so this
+   * requires a navigation mesh built with @ref NavMeshSettings.buildTiled.
+   * Otherwise the obstacles only take effect on the next build.
+   *
+   * The tiles are rebuilt on a background thread.  If @p blocking is false,
+   * the call only swaps in the tiles of a finished rebuild and starts the next
+   * one, meant to be called once per step.  Swapping in tiles must not overlap
+   * with any query.
+   *
+   * @param blocking Whether to wait until all changes are carved
+   * @return Whether the navigation mesh is up to date with all obstacles
+   */
+  bool updateObstacles(bool blocking = true);
+
   /**
    * @brief Returns a random navigable point
    *
@@ -187,6 +491,54 @@ class PathFinder {
    */
   vec3f getRandomNavigablePoint();
 
+  /**
+   * @brief Returns random navigable points, uniformly distributed over the
+   * area of the navmesh
+   *
+   * Unlike @ref getRandomNavigablePoint, the points are drawn from a random
+   * stream owned by the pathfinder, so they only depend on @ref seed and not
+   * on other uses of the global c @ref rand or on the number of threads.
+   *
+   * @param[in] numPoints The number of points to sample
+   *
+   * @return A numPoints x 3 array of points, empty if no navmesh is loaded
+   */
+  Eigen::RowMatrixXf getRandomNavigablePoints(const int numPoints);
+
+  /**
+   * @brief Same as @ref getRandomNavigablePoints but only on the island that
+   * @ref pt is on
+   *
+   * @return A numPoints x 3 array of points, empty if @ref pt is not on the
+   * navmesh
+   */
+  Eigen::RowMatrixXf getRandomNavigablePointsOnIsland(const vec3f& pt,
+                                                      const int numPoints);
+
+  /**
+   * @brief Same as @ref getRandomNavigablePoints but only within @ref radius
+   * of @ref center
+   *
+   * @return An up to numPoints x 3 array of points.  Has fewer rows if hardly
+   * any of the navmesh is within @ref radius
+   */
+  Eigen::RowMatrixXf getRandomNavigablePointsAroundPoint(const vec3f& center,
+                                                         const float radius,
+                                                         const int numPoints);
+
+  /**
+   * @brief Same as @ref getRandomNavigablePoints but only with heights in
+   * [@ref minHeight, @ref maxHeight], for example a single floor of a
+   * building
+   *
+   * @return An up to numPoints x 3 array of points.  Has fewer rows if hardly
+   * any of the navmesh is within the band
+   */
+  Eigen::RowMatrixXf getRandomNavigablePointsInHeightBand(
+      const float minHeight,
+      const float maxHeight,
+      const int numPoints);
+
   /**
    * @brief Finds the shortest path between two points on the navigation mesh
    *
@@ -214,6 +566,84 @@ class PathFinder {
    */
   bool findPath(MultiGoalShortestPath& path);
 
+  /**
+   * @brief Starts a sliced search for the shortest path between @ref
+   * SlicedShortestPath.requestedStart and @ref
+   * SlicedShortestPath.requestedEnd
+   *
+   * @return Whether or not the search could be started.  It can not if
+   * either point is not on the navigation mesh or there is no path between
+   * them
+   */
+  bool initSlicedPath(SlicedShortestPath& path);
+
+  /**
+   * @brief Advances a sliced search by at most maxIterations polygons
+   *
+   * @param[in] maxIterations The maximum number of polygons to expand
+   * @param[in] maxMicroseconds If positive, also stop once this much time
+   * has passed.  The time is checked every few iterations, so it can be
+   * exceeded by a little.
+   *
+   * @return Whether or not the search is done, see @ref
+   * SlicedShortestPath.isDone
+   */
+  bool updateSlicedPath(SlicedShortestPath& path,
+                        int maxIterations,
+                        float maxMicroseconds = 0);
+
+  /**
+   * @brief Ends a sliced search and fills @ref SlicedShortestPath.points with
+   * the path it found.  If it was not done yet, the path is the best effort
+   * so far.
+   *
+   * @return Whether or not a path was found
+   */
+  bool finalizeSlicedPath(SlicedShortestPath& path);
+
+  /**
+   * @brief Finds the shortest paths between many pairs of points at once
+   *
+   * The pairs are distributed across all available threads, each of which
+   * runs its own query on the shared navigation mesh.
+   *
+   * @param[in] starts Nx3 array of starting points
+   * @param[in] ends Nx3 array of end points, one for every starting point
+   * @param[in] returnPoints Whether or not to also return the points along
+   * every path
+   *
+   * @return The geodesic distances and, if requested, the packed path points
+   */
+  ShortestPathBatch findPaths(
+      const Eigen::Ref<const Eigen::RowMatrixXf>& starts,
+      const Eigen::Ref<const Eigen::RowMatrixXf>& ends,
+      bool returnPoints = false);
+
+  /**
+   * @brief Precomputes the geodesic distance from every navigable point to
+   * the closest of the given goal points
+   *
+   * @param[in] goals The goal points
+   *
+   * @return The distance field, or nullptr if any goal could not be snapped to
+   * the navigation mesh
+   */
+  GeodesicDistanceField::ptr buildDistanceField(
+      const std::vector<vec3f>& goals);
+
+  /**
+   * @brief Looks up the geodesic distance from a point to the closest goal of
+   * a distance field built by @ref buildDistanceField
+   *
+   * @param[in] field The distance field
+   * @param[in] pt The point to look up
+   *
+   * @return The geodesic distance.  Will be inf if @ref pt is not navigable,
+   * cannot reach any goal, or @ref field was built on a different navigation
+   * mesh
+   */
+  float geodesicDistance(const GeodesicDistanceField& field, const vec3f& pt);
+
   /**
    * @brief Attempts to move from @ref start to @ref end and returns the
    * navigable point closest to @ref end that is feasibly reachable from @ref
@@ -233,6 +663,31 @@ class PathFinder {
   template <typename T>
   T tryStepNoSliding(const T& start, const T& end);
 
+  /**
+   * @brief Same as @ref tryStep but starts from the polygon tracked by @ref
+   * handle when @ref start is where the last step with it ended.  Only the
+   * polygons crossed by the step are visited then, so the cost does not
+   * depend on the size of the navmesh.  Steps that end within a meter of
+   * another island, or are longer than half a meter, additionally search
+   * for the nearest polygons to stay on the same island as @ref tryStep
+   * does.
+   *
+   * @param[in,out] handle The tracking state of the agent taking the step
+   * @param[in] start The starting location
+   * @param[in] end The desired end location
+   *
+   * @return The found end location
+   */
+  template <typename T>
+  T tryStep(AgentNavHandle& handle, const T& start, const T& end);
+
+  /**
+   * @brief Same as @ref tryStep with a @ref AgentNavHandle but does not allow
+   * for sliding along walls
+   */
+  template <typename T>
+  T tryStepNoSliding(AgentNavHandle& handle, const T& start, const T& end);
+
   /**
    * @brief Snaps a point to the navigation mesh
    *
@@ -249,10 +704,14 @@ class PathFinder {
    *
    * @param[in] path The saved navigation mesh file, generally has extension
    * ``.navmesh``
+   * @param[in] memoryMap Use the file in place instead of reading a copy of
+   * it.  Processes that map the same file share most of its memory through
+   * the page cache.  The file must not be modified while it is mapped.
+   * Files saved before alignment was added to the format are read instead
    *
    * @return Whether or not the navmesh was successfully loaded
    */
-  bool loadNavMesh(const std::string& path);
+  bool loadNavMesh(const std::string& path, bool memoryMap = false);
 
   /**
    * @brief Saves a navigation mesh to later be loaded by @ref loadNavMesh
@@ -268,12 +727,25 @@ class PathFinder {
    */
   bool isLoaded() const;
 
+  /**
+   * @brief Identifies the navigation mesh of the active profile as it is
+   * right now
+   *
+   * Changes whenever the navigation mesh is loaded, built or has any of its
+   * tiles replaced and is never reused, so it can be used to tell whether
+   * state derived from the navigation mesh is stale. 0 if nothing was ever
+   * loaded.
+   */
+  size_t navMeshId() const;
+
   /**
    * @brief Seed the pathfinder.  Useful for @ref getRandomNavigablePoint
+   * and @ref getRandomNavigablePoints
    *
    * @param[in] newSeed The random seed
    *
-   * @note This just seeds the global c @ref rand function.
+   * @note This also seeds the global c @ref rand function, which @ref
+   * getRandomNavigablePoint uses.
    */
   void seed(uint32_t newSeed);
 
@@ -298,9 +770,35 @@ class PathFinder {
   float distanceToClosestObstacle(const vec3f& pt,
                                   const float maxSearchRadius = 2.0) const;
 
+  /**
+   * @brief Answers @ref distanceToClosestObstacle from a precomputed field
+   * instead of searching the navigation mesh for every query
+   *
+   * The field samples the distance to the walls on a grid over every
+   * polygon.  It is built on the first query after it is enabled, rebuilt
+   * whenever the navigation mesh changes and saved with it by @ref
+   * saveNavMesh.  A field saved with a navigation mesh is only used when
+   * loading it if the same tolerance and search radius were set beforehand,
+   * the saved settings are never adopted.  Changing the settings frees the
+   * field, so it must not overlap with any query.
+   *
+   * @param[in] tolerance The largest error allowed for the interpolated
+   * distances, in meters.  Smaller values need quadratically more samples.  0
+   * disables the field.
+   * @param[in] maxSearchRadius The largest search radius the field is used
+   * for, queries with larger ones search the navigation mesh
+   */
+  void setObstacleDistanceTolerance(const float tolerance,
+                                    const float maxSearchRadius = 2.0);
+
+  /**
+   * @return The tolerance of the obstacle distance field, 0 if it is disabled
+   */
+  float getObstacleDistanceTolerance() const;
+
   /**
    * @brief Same as @ref distanceToClosestObstacle but returns additional
-   * information.
+   * information.  Always searches the navigation mesh.
    */
   HitRecord closestObstacleSurfacePoint(
       const vec3f& pt,
@@ -321,14 +819,86 @@ class PathFinder {
    */
   bool isNavigable(const vec3f& pt, const float maxYDelta = 0.5) const;
 
+  /**
+   * @brief Batched versions of @ref snapPoint, @ref islandRadius, @ref
+   * distanceToClosestObstacle and @ref isNavigable
+   *
+   * Every row of the Nx3 array pts is a query point and the result for it is
+   * written to the same row of out, which must already have N rows.  Large
+   * batches are spread across all available threads.
+   */
+  void snapPoints(const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+                  Eigen::Ref<Eigen::RowMatrixXf> out);
+  void islandRadii(const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+                   Eigen::Ref<Eigen::VectorXf> out) const;
+  void distancesToClosestObstacle(
+      const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+      Eigen::Ref<Eigen::VectorXf> out,
+      const float maxSearchRadius = 2.0) const;
+  void areNavigable(const Eigen::Ref<const Eigen::RowMatrixXf>& pts,
+                    Eigen::Ref<Eigen::Matrix<bool, Eigen::Dynamic, 1>> out,
+                    const float maxYDelta = 0.5) const;
+
+  /**
+   * @brief Casts rays along the navigation mesh from every row of the Nx3
+   * array starts to the same row of ends, e.g. for line of sight checks
+   *
+   * Rays are cast in 2D along the surface, starting on the polygon under the
+   * start, see dtNavMeshQuery::raycast.  A ray that reaches its end has a hit
+   * fraction of infinity and a zero normal.  A ray whose start is not on the
+   * navigation mesh has a hit fraction of NaN and a polygon of 0.  Large
+   * batches are spread across all available threads.
+   *
+   * @param[out] hitFractions How far along the segment the ray hit the
+   * boundary of the navigation mesh, from 0 at the start to 1 at the end
+   * @param[out] hitNormals The normal of the boundary edge that was hit, in
+   * the xz plane
+   * @param[out] hitPolys The polygon the ray ended on.  Compare it with the
+   * polygon under the end to tell whether the ray ended on another floor.
+   */
+  void castRays(const Eigen::Ref<const Eigen::RowMatrixXf>& starts,
+                const Eigen::Ref<const Eigen::RowMatrixXf>& ends,
+                Eigen::Ref<Eigen::VectorXf> hitFractions,
+                Eigen::Ref<Eigen::RowMatrixXf> hitNormals,
+                Eigen::Ref<Eigen::Matrix<uint32_t, Eigen::Dynamic, 1>>
+                    hitPolys) const;
+
   /**
    * @return The axis aligned bounding box containing the navigation mesh.
    */
   std::pair<vec3f, vec3f> bounds() const;
 
+  /**
+   * @brief Top down occupancy grid of the navmesh at height, sampled every
+   * pixelsPerMeter meters starting at the minimum corner of @ref bounds.
+   *
+   * @param[in] rasterize If true, the navmesh triangles are rasterized into
+   * the grid in parallel instead of querying every sample with @ref
+   * isNavigable, which is much faster for large maps.  The two only differ
+   * at the edges of the navmesh.
+   */
   Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic> getTopDownView(
       const float pixelsPerMeter,
-      const float height);
+      const float height,
+      bool rasterize = false);
+
+  /**
+   * @brief Same grid as the rasterized @ref getTopDownView, but with the
+   * island id of the navmesh at every sample, or @ref ID_UNDEFINED where
+   * there is no navmesh within maxYDelta of height.
+   */
+  Eigen::MatrixXi getTopDownIslandView(const float pixelsPerMeter,
+                                       const float height,
+                                       const float maxYDelta = 0.5);
+
+  /**
+   * @brief Same grid as the rasterized @ref getTopDownView, but with the
+   * distance in meters from every sample to the closest non-navigable sample
+   * or to the border of the grid, 0 for non-navigable samples.
+   */
+  Eigen::MatrixXf getTopDownDistanceView(const float pixelsPerMeter,
+                                         const float height,
+                                         const float maxYDelta = 0.5);
 
   /**
    * @brief Returns a MeshData object containing triangulated NavMesh polys. The
@@ -341,6 +911,22 @@ class PathFinder {
   const std::shared_ptr<assets::MeshData> getNavMeshData();
 
   ESP_SMART_POINTERS_WITH_UNIQUE_PIMPL(PathFinder);
+
+ private:
+  //! Navigation meshes of all agent profiles.  The one of the active profile
+  //! is moved to pimpl_, leaving its entry empty.  Empty unless built from
+  //! profiles
+  std::vector<spimpl::unique_impl_ptr<Impl>> profiles_;
+  int activeProfile_ = 0;
+
+  // Called by everything that replaces the navigation mesh with a single one
+  void dropProfiles();
+
+  friend class Crowd;
+  // The Detour navmesh and filter of the active profile for the queries of a
+  // crowd, the navmesh is null if nothing is loaded
+  dtNavMesh* detourNavMesh() const;
+  const dtQueryFilter* detourFilter() const;
 };
 
 }  // namespace nav
@@ -14,13 +14,22 @@ int SceneManager::initSceneGraph() {
   return index;
 }
 
+bool SceneManager::deleteSceneGraph(int sceneID) {
+  if (sceneID < 0 || sceneID >= sceneGraphs_.size() || !sceneGraphs_[sceneID])
+    return false;
+  sceneGraphs_[sceneID] = nullptr;
+  return true;
+}
+
 SceneGraph& SceneManager::getSceneGraph(int sceneID) {
   ASSERT(sceneID >= 0 && sceneID < sceneGraphs_.size());
+  ASSERT(sceneGraphs_[sceneID]);
   return (*(sceneGraphs_[sceneID].get()));
 }
 
 const SceneGraph& SceneManager::getSceneGraph(int sceneID) const {
   ASSERT(sceneID >= 0 && sceneID < sceneGraphs_.size());
+  ASSERT(sceneGraphs_[sceneID]);
   return (*(sceneGraphs_[sceneID].get()));
 }
 
@@ -26,6 +26,10 @@ class SceneManager {
   // returns the scene ID
   int initSceneGraph();
 
+  // destroys the scene graph along with all its nodes, the ID is not reused.
+  // returns false if there is no such scene graph
+  bool deleteSceneGraph(int sceneID);
+
   // returns the scene graph
   SceneGraph& getSceneGraph(int sceneID);
   const SceneGraph& getSceneGraph(int sceneID) const;
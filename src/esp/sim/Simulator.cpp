@@ -4,6 +4,8 @@
 
 #include "Simulator.h"
 
+#include <algorithm>
+#include <limits>
 #include <string>
 
 #include <Corrade/Utility/Directory.h>
@@ -16,6 +18,7 @@
 #include "esp/gfx/RenderCamera.h"
 #include "esp/gfx/Renderer.h"
 #include "esp/io/io.h"
+#include "esp/nav/NavMeshCache.h"
 #include "esp/nav/PathFinder.h"
 #include "esp/physics/PhysicsManager.h"
 #include "esp/scene/ObjectControls.h"
@@ -27,6 +30,104 @@ namespace Cr = Corrade;
 namespace esp {
 namespace sim {
 
+namespace {
+std::string getSceneFilename(const SimulatorConfiguration& cfg) {
+  if (cfg.scene.filepaths.count("mesh")) {
+    return cfg.scene.filepaths.at("mesh");
+  }
+  return cfg.scene.id;
+}
+
+std::string getHouseFilename(const SimulatorConfiguration& cfg) {
+  const std::string sceneFilename = getSceneFilename(cfg);
+  std::string houseFilename = io::changeExtension(sceneFilename, ".house");
+  if (!io::exists(houseFilename)) {
+    houseFilename = io::changeExtension(sceneFilename, ".scn");
+  }
+  if (cfg.scene.filepaths.count("house")) {
+    houseFilename = cfg.scene.filepaths.at("house");
+  }
+
+  if (!io::exists(houseFilename)) {
+    houseFilename = io::changeExtension(sceneFilename, ".scn");
+  }
+  return houseFilename;
+}
+
+//! The semantic mesh to load next to the scene mesh, empty if there is none
+std::string getSemanticMeshFilename(const SimulatorConfiguration& cfg) {
+  const std::string houseFilename = getHouseFilename(cfg);
+  if (!cfg.createRenderer || !cfg.loadSemanticMesh ||
+      !io::exists(houseFilename)) {
+    return {};
+  }
+  // TODO: remove hardcoded filename change and use SceneConfiguration
+  const std::string semanticMeshFilename =
+      io::removeExtension(houseFilename) + "_semantic.ply";
+  return io::exists(semanticMeshFilename) ? semanticMeshFilename : "";
+}
+
+assets::AssetInfo getSceneInfo(const SimulatorConfiguration& cfg) {
+  assets::AssetInfo sceneInfo =
+      assets::AssetInfo::fromPath(getSceneFilename(cfg));
+  sceneInfo.requiresLighting =
+      cfg.sceneLightSetup != assets::ResourceManager::NO_LIGHT_KEY;
+  return sceneInfo;
+}
+
+// Neither needs the GL context, so they can also run in the background
+nav::PathFinder::ptr loadPathFinder(const SimulatorConfiguration& cfg) {
+  // create pathfinder and load navmesh if available
+  nav::PathFinder::ptr pathfinder = nav::PathFinder::create();
+  std::string navmeshFilename =
+      io::changeExtension(getSceneFilename(cfg), ".navmesh");
+  if (cfg.scene.filepaths.count("navmesh")) {
+    navmeshFilename = cfg.scene.filepaths.at("navmesh");
+  }
+  if (io::exists(navmeshFilename)) {
+    LOG(INFO) << "Loading navmesh from " << navmeshFilename;
+    pathfinder->loadNavMesh(navmeshFilename);
+    LOG(INFO) << "Loaded.";
+  } else {
+    LOG(WARNING) << "Navmesh file not found, checked at " << navmeshFilename;
+  }
+  return pathfinder;
+}
+
+std::shared_ptr<scene::SemanticScene> loadSemanticScene(
+    const SimulatorConfiguration& cfg) {
+  const std::string sceneFilename = getSceneFilename(cfg);
+  std::string houseFilename = getHouseFilename(cfg);
+  auto semanticScene = scene::SemanticScene::create();
+  switch (assets::AssetInfo::fromPath(sceneFilename).type) {
+    case assets::AssetType::INSTANCE_MESH:
+      houseFilename = Cr::Utility::Directory::join(
+          Cr::Utility::Directory::path(houseFilename), "info_semantic.json");
+      if (io::exists(houseFilename)) {
+        scene::SemanticScene::loadReplicaHouse(houseFilename, *semanticScene);
+      }
+      break;
+    case assets::AssetType::MP3D_MESH:
+      // TODO(msb) Fix AssetType determination logic.
+      if (io::exists(houseFilename)) {
+        using Corrade::Utility::String::endsWith;
+        if (endsWith(houseFilename, ".house")) {
+          scene::SemanticScene::loadMp3dHouse(houseFilename, *semanticScene);
+        } else if (endsWith(houseFilename, ".scn")) {
+          scene::SemanticScene::loadGibsonHouse(houseFilename, *semanticScene);
+        }
+      }
+      break;
+    case assets::AssetType::SUNCG_SCENE:
+      scene::SemanticScene::loadSuncgHouse(sceneFilename, *semanticScene);
+      break;
+    default:
+      break;
+  }
+  return semanticScene;
+}
+}  // namespace
+
 Simulator::Simulator(const SimulatorConfiguration& cfg)
     : random_{core::Random::create(cfg.randomSeed)} {
   // initalize members according to cfg
@@ -45,55 +146,44 @@ void Simulator::reconfigure(const SimulatorConfiguration& cfg) {
     reset();
     return;
   }
-  // otherwise set current configuration and initialize
-  // TODO can optimize to do partial re-initialization instead of from-scratch
+  // keep the loaded scene if only settings that are not used to load it
+  // changed, they are read from config_ as they are needed
+  if (activeSceneID_ != ID_UNDEFINED && !requiresSceneReload(config_, cfg)) {
+    config_ = cfg;
+    seed(config_.randomSeed);
+    trimSceneCache();
+    reset();
+    return;
+  }
+  // otherwise switch to another scene, which is either still loaded from
+  // before or initialized from scratch
+  cacheActiveScene();
   config_ = cfg;
-
-  // load scene
-  std::string sceneFilename = cfg.scene.id;
-  if (cfg.scene.filepaths.count("mesh")) {
-    sceneFilename = cfg.scene.filepaths.at("mesh");
+  if (restoreCachedScene()) {
+    seed(config_.randomSeed);
+    trimSceneCache();
+    reset();
+    return;
   }
 
-  // create pathfinder and load navmesh if available
-  pathfinder_ = nav::PathFinder::create();
-  std::string navmeshFilename = io::changeExtension(sceneFilename, ".navmesh");
-  if (cfg.scene.filepaths.count("navmesh")) {
-    navmeshFilename = cfg.scene.filepaths.at("navmesh");
-  }
-  if (io::exists(navmeshFilename)) {
-    LOG(INFO) << "Loading navmesh from " << navmeshFilename;
-    pathfinder_->loadNavMesh(navmeshFilename);
-    LOG(INFO) << "Loaded.";
-  } else {
-    LOG(WARNING) << "Navmesh file not found, checked at " << navmeshFilename;
+  // the CPU side of loading may be done already by prefetchScene()
+  std::unique_ptr<ScenePrefetch> prefetch;
+  if (scenePrefetch_ &&
+      !requiresSceneReload(scenePrefetch_->config, config_)) {
+    prefetch = std::move(scenePrefetch_);
   }
 
+  // load scene
+  const std::string sceneFilename = getSceneFilename(cfg);
+  pathfinder_ = prefetch ? prefetch->pathfinder.get() : loadPathFinder(config_);
+
   // Calling to seeding needs to be done after the pathfinder creation
   seed(config_.randomSeed);
 
-  std::string houseFilename = io::changeExtension(sceneFilename, ".house");
-  if (!io::exists(houseFilename)) {
-    houseFilename = io::changeExtension(sceneFilename, ".scn");
-  }
-  if (cfg.scene.filepaths.count("house")) {
-    houseFilename = cfg.scene.filepaths.at("house");
-  }
+  const assets::AssetInfo sceneInfo = getSceneInfo(cfg);
 
-  if (!io::exists(houseFilename)) {
-    houseFilename = io::changeExtension(sceneFilename, ".scn");
-  }
-
-  assets::AssetInfo sceneInfo = assets::AssetInfo::fromPath(sceneFilename);
-  sceneInfo.requiresLighting =
-      cfg.sceneLightSetup != assets::ResourceManager::NO_LIGHT_KEY;
-
-  // initalize scene graph
-  // CAREFUL!
-  // previous scene graph is not deleted!
-  // TODO:
-  // We need to make a design decision here:
-  // when doing reconfigure, shall we delete all of the previous scene graphs
+  // initalize scene graph, the previous one is deleted by trimSceneCache()
+  // once it drops out of the cache
   activeSceneID_ = sceneManager_.initSceneGraph();
 
   // LOG(INFO) << "Active scene graph ID = " << activeSceneID_;
@@ -129,16 +219,17 @@ void Simulator::reconfigure(const SimulatorConfiguration& cfg) {
       // Pass the error to the python through pybind11 allowing graceful exit
       throw std::invalid_argument("Cannot load: " + sceneFilename);
     }
+    activeSceneAssets_.push_back(sceneFilename);
+    addActiveSceneNodes(rootNode);
     const Magnum::Range3D& sceneBB = rootNode.computeCumulativeBB();
     resourceManager_.setLightSetup(gfx::getLightsAtBoxCorners(sceneBB));
 
+    const std::string houseFilename = getHouseFilename(cfg);
     if (io::exists(houseFilename)) {
       LOG(INFO) << "Loading house from " << houseFilename;
       // if semantic mesh exists, load it as well
-      // TODO: remove hardcoded filename change and use SceneConfiguration
-      const std::string semanticMeshFilename =
-          io::removeExtension(houseFilename) + "_semantic.ply";
-      if (cfg.loadSemanticMesh && io::exists(semanticMeshFilename)) {
+      const std::string semanticMeshFilename = getSemanticMeshFilename(cfg);
+      if (!semanticMeshFilename.empty()) {
         LOG(INFO) << "Loading semantic mesh " << semanticMeshFilename;
         activeSemanticSceneID_ = sceneManager_.initSceneGraph();
         sceneID_.push_back(activeSemanticSceneID_);
@@ -151,6 +242,8 @@ void Simulator::reconfigure(const SimulatorConfiguration& cfg) {
         resourceManager_.loadScene(
             semanticSceneInfo, &semanticRootNode, &semanticDrawables,
             assets::ResourceManager::NO_LIGHT_KEY, cfg.frustumCulling);
+        activeSceneAssets_.push_back(semanticMeshFilename);
+        addActiveSceneNodes(semanticRootNode);
         LOG(INFO) << "Loaded.";
       } else {
         activeSemanticSceneID_ = ID_UNDEFINED;
@@ -171,35 +264,222 @@ void Simulator::reconfigure(const SimulatorConfiguration& cfg) {
     }
   }
 
+  semanticScene_ =
+      prefetch ? prefetch->semanticScene.get() : loadSemanticScene(config_);
+
+  trimSceneCache();
+  reset();
+}
+
+void Simulator::prefetchScene(const SimulatorConfiguration& cfg) {
+  auto isLoadedFor = [&cfg](const SimulatorConfiguration& loaded) {
+    return !requiresSceneReload(loaded, cfg);
+  };
+  if ((activeSceneID_ != ID_UNDEFINED && isLoadedFor(config_)) ||
+      (scenePrefetch_ && isLoadedFor(scenePrefetch_->config)) ||
+      std::any_of(sceneCache_.begin(), sceneCache_.end(),
+                  [&](const CachedScene& scene) {
+                    return isLoadedFor(scene.config);
+                  })) {
+    return;
+  }
+  // only one scene is prefetched at a time
+  scenePrefetch_ = nullptr;
+  resourceManager_.discardPrefetchedScenes();
+
+  auto prefetch = std::make_unique<ScenePrefetch>();
+  prefetch->config = cfg;
+  prefetch->pathfinder = std::async(
+      std::launch::async, [cfg]() { return loadPathFinder(cfg); });
+  prefetch->semanticScene = std::async(
+      std::launch::async, [cfg]() { return loadSemanticScene(cfg); });
+  if (cfg.createRenderer) {
+    resourceManager_.prefetchScene(getSceneInfo(cfg));
+    const std::string semanticMeshFilename = getSemanticMeshFilename(cfg);
+    if (!semanticMeshFilename.empty()) {
+      resourceManager_.prefetchScene(
+          assets::AssetInfo::fromPath(semanticMeshFilename),
+          cfg.frustumCulling);
+    }
+  }
+  scenePrefetch_ = std::move(prefetch);
+}
+
+bool Simulator::isScenePrefetched() const {
+  if (!scenePrefetch_) {
+    return false;
+  }
+  auto isReady = [](const auto& future) {
+    return future.wait_for(std::chrono::seconds(0)) ==
+           std::future_status::ready;
+  };
+  const SimulatorConfiguration& cfg = scenePrefetch_->config;
+  return isReady(scenePrefetch_->pathfinder) &&
+         isReady(scenePrefetch_->semanticScene) &&
+         !resourceManager_.isPrefetchingScene(getSceneFilename(cfg)) &&
+         !resourceManager_.isPrefetchingScene(getSemanticMeshFilename(cfg));
+}
+
+void Simulator::cacheActiveScene() {
+  if (activeSceneID_ == ID_UNDEFINED) {
+    return;
+  }
+
+  std::size_t byteSize = 0;
+  for (const std::string& asset : activeSceneAssets_) {
+    byteSize += resourceManager_.getAssetByteSize(asset);
+  }
+  sceneCache_.push_front(CachedScene{
+      config_, activeSceneID_, activeSemanticSceneID_, std::move(pathfinder_),
+      std::move(semanticScene_), std::move(physicsManager_),
+      std::move(navMeshObjects_), std::move(navMeshObstacles_),
+      std::move(activeSceneNodes_), std::move(activeSceneAssets_), byteSize});
+
+  activeSceneID_ = ID_UNDEFINED;
+  activeSemanticSceneID_ = ID_UNDEFINED;
+  pathfinder_ = nullptr;
   semanticScene_ = nullptr;
-  semanticScene_ = scene::SemanticScene::create();
-  switch (sceneInfo.type) {
-    case assets::AssetType::INSTANCE_MESH:
-      houseFilename = Cr::Utility::Directory::join(
-          Cr::Utility::Directory::path(houseFilename), "info_semantic.json");
-      if (io::exists(houseFilename)) {
-        scene::SemanticScene::loadReplicaHouse(houseFilename, *semanticScene_);
+  physicsManager_ = nullptr;
+  navMeshObjects_.clear();
+  navMeshObstacles_.clear();
+  activeSceneNodes_.clear();
+  activeSceneAssets_.clear();
+}
+
+bool Simulator::restoreCachedScene() {
+  auto it = std::find_if(sceneCache_.begin(), sceneCache_.end(),
+                         [this](const CachedScene& scene) {
+                           return !requiresSceneReload(scene.config, config_);
+                         });
+  if (it == sceneCache_.end()) {
+    return false;
+  }
+
+  LOG(INFO) << "Reusing the loaded scene " << config_.scene.id;
+  activeSceneID_ = it->sceneID;
+  activeSemanticSceneID_ = it->semanticSceneID;
+  pathfinder_ = std::move(it->pathfinder);
+  semanticScene_ = std::move(it->semanticScene);
+  physicsManager_ = std::move(it->physicsManager);
+  navMeshObjects_ = std::move(it->navMeshObjects);
+  navMeshObstacles_ = std::move(it->navMeshObstacles);
+  activeSceneNodes_ = std::move(it->sceneNodes);
+  activeSceneAssets_ = std::move(it->assets);
+  sceneCache_.erase(it);
+
+  // the lights were last placed around whichever scene was loaded last
+  if (config_.createRenderer) {
+    const Magnum::Range3D& sceneBB =
+        getActiveSceneGraph().getRootNode().computeCumulativeBB();
+    resourceManager_.setLightSetup(gfx::getLightsAtBoxCorners(sceneBB));
+  }
+  return true;
+}
+
+void Simulator::trimSceneCache() {
+  std::size_t byteSize = 0;
+  for (const std::string& asset : activeSceneAssets_) {
+    byteSize += resourceManager_.getAssetByteSize(asset);
+  }
+
+  int numKept = 0;
+  for (auto it = sceneCache_.begin(); it != sceneCache_.end();) {
+    byteSize += it->byteSize;
+    if (numKept < config_.sceneCacheSize &&
+        (config_.sceneCacheMaxBytes == 0 ||
+         byteSize <= config_.sceneCacheMaxBytes)) {
+      ++numKept;
+      ++it;
+      continue;
+    }
+
+    byteSize -= it->byteSize;
+    CachedScene scene = std::move(*it);
+    it = sceneCache_.erase(it);
+    unloadScene(scene);
+  }
+}
+
+void Simulator::clearSceneCache() {
+  while (!sceneCache_.empty()) {
+    CachedScene scene = std::move(sceneCache_.front());
+    sceneCache_.pop_front();
+    unloadScene(scene);
+  }
+}
+
+void Simulator::addActiveSceneNodes(scene::SceneNode& rootNode) {
+  for (MagnumObject& child : rootNode.children()) {
+    activeSceneNodes_.push_back(static_cast<scene::SceneNode*>(&child));
+  }
+}
+
+void Simulator::unloadScene(CachedScene& scene) {
+  LOG(INFO) << "Unloading the scene " << scene.config.scene.id;
+
+  // objects belong to the scene and are deleted along with it
+  std::vector<const scene::SceneNode*> objectNodes;
+  if (scene.physicsManager) {
+    for (int objectID : scene.physicsManager->getExistingObjectIDs()) {
+      objectNodes.push_back(
+          &scene.physicsManager->getObjectSceneNode(objectID));
+    }
+  }
+
+  // the physics scene refers to the nodes and collision meshes of the scene
+  scene.physicsManager = nullptr;
+  scene.semanticScene = nullptr;
+  scene.pathfinder = nullptr;
+
+  std::vector<int> sceneIDs{scene.sceneID};
+  if (scene.semanticSceneID != ID_UNDEFINED &&
+      scene.semanticSceneID != scene.sceneID) {
+    sceneIDs.push_back(scene.semanticSceneID);
+  }
+  scene::SceneNode& activeRootNode = getActiveSceneGraph().getRootNode();
+  for (int sceneID : sceneIDs) {
+    // everything else the scene was not loaded into was added by the caller,
+    // e.g. agents, sensors or crowd agents, which may still hold on to it
+    std::vector<scene::SceneNode*> keptNodes;
+    int numObjects = 0;
+    for (MagnumObject& child :
+         sceneManager_.getSceneGraph(sceneID).getRootNode().children()) {
+      auto* node = static_cast<scene::SceneNode*>(&child);
+      if (std::find(scene.sceneNodes.begin(), scene.sceneNodes.end(), node) !=
+          scene.sceneNodes.end()) {
+        continue;
       }
-      break;
-    case assets::AssetType::MP3D_MESH:
-      // TODO(msb) Fix AssetType determination logic.
-      if (io::exists(houseFilename)) {
-        using Corrade::Utility::String::endsWith;
-        if (endsWith(houseFilename, ".house")) {
-          scene::SemanticScene::loadMp3dHouse(houseFilename, *semanticScene_);
-        } else if (endsWith(houseFilename, ".scn")) {
-          scene::SemanticScene::loadGibsonHouse(houseFilename, *semanticScene_);
-        }
+      if (std::find(objectNodes.begin(), objectNodes.end(), node) !=
+          objectNodes.end()) {
+        ++numObjects;
+        continue;
       }
-      break;
-    case assets::AssetType::SUNCG_SCENE:
-      scene::SemanticScene::loadSuncgHouse(sceneFilename, *semanticScene_);
-      break;
-    default:
-      break;
+      keptNodes.push_back(node);
+    }
+    if (numObjects > 0) {
+      LOG(WARNING) << "Deleting " << numObjects
+                   << " objects along with the scene " << scene.config.scene.id
+                   << ", their nodes can't be used anymore";
+    }
+    for (scene::SceneNode* node : keptNodes) {
+      node->setParent(&activeRootNode);
+    }
+
+    sceneManager_.deleteSceneGraph(sceneID);
   }
 
-  reset();
+  // the meshes and textures may be shared with the scenes that are left
+  for (const std::string& asset : scene.assets) {
+    bool inUse = std::find(activeSceneAssets_.begin(), activeSceneAssets_.end(),
+                           asset) != activeSceneAssets_.end();
+    for (const CachedScene& other : sceneCache_) {
+      inUse = inUse || std::find(other.assets.begin(), other.assets.end(),
+                                 asset) != other.assets.end();
+    }
+    if (!inUse) {
+      resourceManager_.unloadAsset(asset);
+    }
+  }
 }
 
 void Simulator::reset() {
@@ -249,13 +529,19 @@ scene::SceneGraph& Simulator::getActiveSemanticSceneGraph() {
 bool operator==(const SimulatorConfiguration& a,
                 const SimulatorConfiguration& b) {
   return a.scene == b.scene && a.defaultAgentId == b.defaultAgentId &&
+         a.gpuDeviceId == b.gpuDeviceId && a.randomSeed == b.randomSeed &&
          a.defaultCameraUuid == b.defaultCameraUuid &&
          a.compressTextures == b.compressTextures &&
          a.createRenderer == b.createRenderer &&
+         a.allowSliding == b.allowSliding &&
+         a.frustumCulling == b.frustumCulling &&
          a.enablePhysics == b.enablePhysics &&
          a.physicsConfigFile.compare(b.physicsConfigFile) == 0 &&
          a.loadSemanticMesh == b.loadSemanticMesh &&
-         a.sceneLightSetup.compare(b.sceneLightSetup) == 0;
+         a.sceneLightSetup.compare(b.sceneLightSetup) == 0 &&
+         a.navMeshCacheDir.compare(b.navMeshCacheDir) == 0 &&
+         a.sceneCacheSize == b.sceneCacheSize &&
+         a.sceneCacheMaxBytes == b.sceneCacheMaxBytes;
 }
 
 bool operator!=(const SimulatorConfiguration& a,
@@ -263,6 +549,22 @@ bool operator!=(const SimulatorConfiguration& a,
   return !(a == b);
 }
 
+bool requiresSceneReload(const SimulatorConfiguration& a,
+                         const SimulatorConfiguration& b) {
+  // Meshes are only loaded with a renderer, and the semantic mesh only if
+  // asked for, so turning these on needs a load while turning them off does
+  // not.  The semantic mesh is split by object for frustum culling.  The GPU
+  // device can't change once the context exists.
+  const bool semanticMeshChanged =
+      b.loadSemanticMesh &&
+      (!a.loadSemanticMesh || a.frustumCulling != b.frustumCulling);
+  return a.scene != b.scene || a.compressTextures != b.compressTextures ||
+         a.enablePhysics != b.enablePhysics ||
+         a.physicsConfigFile.compare(b.physicsConfigFile) != 0 ||
+         a.sceneLightSetup.compare(b.sceneLightSetup) != 0 ||
+         (b.createRenderer && (!a.createRenderer || semanticMeshChanged));
+}
+
 // === Physics Simulator Functions ===
 
 int Simulator::addObject(int objectLibIndex,
@@ -536,6 +838,199 @@ bool Simulator::recomputeNavMesh(nav::PathFinder& pathfinder,
       "loaded without renderer initialization.",
       false);
 
+  std::map<int, NavMeshObject> navMeshObjects;
+  assets::MeshData::uptr joinedMesh =
+      createJoinedNavMeshMesh(includeStaticObjects, navMeshObjects);
+  const size_t prevNavMeshId = pathfinder.navMeshId();
+
+  // The joined mesh has the STATIC objects in place, so the cache key covers
+  // their layout as well
+  const bool built =
+      config_.navMeshCacheDir.empty()
+          ? pathfinder.build(navMeshSettings, *joinedMesh)
+          : nav::NavMeshCache{config_.navMeshCacheDir}.build(
+                pathfinder, navMeshSettings, *joinedMesh);
+  if (!built) {
+    LOG(ERROR) << "Failed to build navmesh";
+    return false;
+  }
+  navMeshObjects_.erase(prevNavMeshId);
+  navMeshObjects_[pathfinder.navMeshId()] = std::move(navMeshObjects);
+
+  LOG(INFO) << "reconstruct navmesh successful";
+  return true;
+}
+
+bool Simulator::recomputeNavMesh(
+    nav::PathFinder& pathfinder,
+    const std::vector<nav::NavMeshSettings>& profiles,
+    bool includeStaticObjects) {
+  CORRADE_ASSERT(
+      config_.createRenderer,
+      "Simulator::recomputeNavMesh: SimulatorConfiguration::createRenderer is "
+      "false. Scene geometry is required to recompute navmesh. No geometry is "
+      "loaded without renderer initialization.",
+      false);
+
+  std::map<int, NavMeshObject> navMeshObjects;
+  assets::MeshData::uptr joinedMesh =
+      createJoinedNavMeshMesh(includeStaticObjects, navMeshObjects);
+
+  std::vector<size_t> prevNavMeshIds;
+  const int prevProfile = pathfinder.getProfile();
+  for (int i = 0; i < pathfinder.numProfiles(); ++i) {
+    pathfinder.setProfile(i);
+    prevNavMeshIds.push_back(pathfinder.navMeshId());
+  }
+  pathfinder.setProfile(prevProfile);
+
+  if (!pathfinder.build(profiles, *joinedMesh)) {
+    LOG(ERROR) << "Failed to build navmeshes";
+    return false;
+  }
+  for (size_t id : prevNavMeshIds) {
+    navMeshObjects_.erase(id);
+  }
+  // Every profile starts from the same objects, each one keeps its own
+  // baseline from here on
+  for (int i = pathfinder.numProfiles() - 1; i >= 0; --i) {
+    pathfinder.setProfile(i);
+    navMeshObjects_[pathfinder.navMeshId()] = navMeshObjects;
+  }
+
+  return true;
+}
+
+bool Simulator::updateNavMesh(nav::PathFinder& pathfinder,
+                              const nav::NavMeshSettings& navMeshSettings) {
+  CORRADE_ASSERT(
+      config_.createRenderer,
+      "Simulator::updateNavMesh: SimulatorConfiguration::createRenderer is "
+      "false. Scene geometry is required to recompute navmesh. No geometry is "
+      "loaded without renderer initialization.",
+      false);
+
+  std::map<int, NavMeshObject> navMeshObjects;
+  assets::MeshData::uptr joinedMesh =
+      createJoinedNavMeshMesh(true, navMeshObjects);
+
+  const size_t prevNavMeshId = pathfinder.navMeshId();
+  std::vector<std::pair<vec3f, vec3f>> changedRegions;
+  auto baseline = navMeshObjects_.find(prevNavMeshId);
+  if (baseline == navMeshObjects_.end()) {
+    // Nothing is known about what this navmesh was built from, so all of it
+    // is rebuilt
+    const float mf = std::numeric_limits<float>::max();
+    std::pair<vec3f, vec3f> bounds{vec3f(mf, mf, mf), vec3f(-mf, -mf, -mf)};
+    for (const vec3f& p : joinedMesh->vbo) {
+      bounds.first = bounds.first.cwiseMin(p);
+      bounds.second = bounds.second.cwiseMax(p);
+    }
+    changedRegions.emplace_back(bounds);
+  } else {
+    // Both where an object was and where it is now need to be rebuilt
+    const std::map<int, NavMeshObject>& prevObjects = baseline->second;
+    for (const auto& prev : prevObjects) {
+      auto it = navMeshObjects.find(prev.first);
+      if (it == navMeshObjects.end() || !(it->second == prev.second)) {
+        changedRegions.emplace_back(prev.second.bounds);
+      }
+    }
+    for (const auto& current : navMeshObjects) {
+      auto it = prevObjects.find(current.first);
+      if (it == prevObjects.end() || !(it->second == current.second)) {
+        changedRegions.emplace_back(current.second.bounds);
+      }
+    }
+  }
+
+  if (!pathfinder.rebuildRegions(navMeshSettings, *joinedMesh,
+                                 changedRegions)) {
+    LOG(ERROR) << "Failed to update navmesh";
+    return false;
+  }
+  navMeshObjects_.erase(prevNavMeshId);
+  navMeshObjects_[pathfinder.navMeshId()] = std::move(navMeshObjects);
+
+  return true;
+}
+
+bool Simulator::updateNavMeshObstacles(nav::PathFinder& pathfinder,
+                                       bool blocking) {
+  // Called every step, so a navmesh that can't be updated in place is not an
+  // error worth logging each time
+  if (!pathfinder.isTiled()) {
+    return false;
+  }
+
+  std::map<int, NavMeshObstacle> navMeshObstacles;
+  if (physicsManager_ != nullptr) {
+    for (auto objectID : physicsManager_->getExistingObjectIDs()) {
+      if (physicsManager_->getObjectMotionType(objectID) ==
+          physics::MotionType::STATIC) {
+        continue;
+      }
+      const scene::SceneNode& node =
+          physicsManager_->getObjectVisualSceneNode(objectID);
+      const Magnum::Matrix4 transformation =
+          node.absoluteTransformationMatrix();
+      const Magnum::Range3D& localBB = node.getCumulativeBB();
+      const float mf = std::numeric_limits<float>::max();
+      std::pair<vec3f, vec3f> bounds{vec3f(mf, mf, mf), vec3f(-mf, -mf, -mf)};
+      for (int i = 0; i < 8; ++i) {
+        const Magnum::Vector3 corner{
+            (i & 1) ? localBB.max().x() : localBB.min().x(),
+            (i & 2) ? localBB.max().y() : localBB.min().y(),
+            (i & 4) ? localBB.max().z() : localBB.min().z()};
+        const vec3f p = Magnum::EigenIntegration::cast<vec3f>(
+            transformation.transformPoint(corner));
+        bounds.first = bounds.first.cwiseMin(p);
+        bounds.second = bounds.second.cwiseMax(p);
+      }
+
+      NavMeshObstacle& obstacle = navMeshObstacles[objectID];
+      obstacle.bounds = bounds;
+      auto it = navMeshObstacles_.find(objectID);
+      if (it != navMeshObstacles_.end()) {
+        const float moved = std::max(
+            (bounds.first - it->second.bounds.first).cwiseAbs().maxCoeff(),
+            (bounds.second - it->second.bounds.second).cwiseAbs().maxCoeff());
+        if (moved <= 0.01f) {
+          obstacle = it->second;
+          continue;
+        }
+        pathfinder.removeObstacle(it->second.obstacleId);
+      }
+      obstacle.obstacleId = pathfinder.addBoxObstacle(
+          0.5f * (bounds.first + bounds.second),
+          0.5f * (bounds.second - bounds.first));
+    }
+  }
+
+  // Objects that were removed or became STATIC
+  for (const auto& prev : navMeshObstacles_) {
+    if (navMeshObstacles.find(prev.first) == navMeshObstacles.end()) {
+      pathfinder.removeObstacle(prev.second.obstacleId);
+    }
+  }
+  navMeshObstacles_ = std::move(navMeshObstacles);
+
+  // Cutting the obstacles out replaces tiles, the objects the navmesh was
+  // built from stay the same
+  const size_t prevNavMeshId = pathfinder.navMeshId();
+  const bool updated = pathfinder.updateObstacles(blocking);
+  auto baseline = navMeshObjects_.find(prevNavMeshId);
+  if (baseline != navMeshObjects_.end() &&
+      pathfinder.navMeshId() != prevNavMeshId) {
+    navMeshObjects_[pathfinder.navMeshId()] = std::move(baseline->second);
+    navMeshObjects_.erase(baseline);
+  }
+  return updated;
+}
+
+assets::MeshData::uptr Simulator::createJoinedNavMeshMesh(
+    bool includeStaticObjects,
+    std::map<int, NavMeshObject>& navMeshObjects) {
   assets::MeshData::uptr joinedMesh =
       resourceManager_.createJoinedCollisionMesh(config_.scene.id);
 
@@ -567,20 +1062,27 @@ bool Simulator::recomputeNavMesh(nav::PathFinder& pathfinder,
               joinedObjectMesh->ibo[ix] + prevNumVerts;
         }
         joinedMesh->vbo.reserve(joinedObjectMesh->vbo.size() + prevNumVerts);
+
+        NavMeshObject& navMeshObject = navMeshObjects[objectID];
+        navMeshObject.meshHandle = meshHandle;
+        navMeshObject.transformation =
+            physicsManager_->getObjectVisualSceneNode(objectID)
+                .absoluteTransformationMatrix();
+        navMeshObject.scale = initializationTemplate->getScale();
+        const float mf = std::numeric_limits<float>::max();
+        navMeshObject.bounds = {vec3f(mf, mf, mf), vec3f(-mf, -mf, -mf)};
         for (auto& vert : joinedObjectMesh->vbo) {
           joinedMesh->vbo.push_back(objectTransform * vert);
+          navMeshObject.bounds.first =
+              navMeshObject.bounds.first.cwiseMin(joinedMesh->vbo.back());
+          navMeshObject.bounds.second =
+              navMeshObject.bounds.second.cwiseMax(joinedMesh->vbo.back());
         }
       }
     }
   }
 
-  if (!pathfinder.build(navMeshSettings, *joinedMesh)) {
-    LOG(ERROR) << "Failed to build navmesh";
-    return false;
-  }
-
-  LOG(INFO) << "reconstruct navmesh successful";
-  return true;
+  return joinedMesh;
 }
 
 // Agents
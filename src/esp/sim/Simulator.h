@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <future>
+#include <list>
+#include <map>
+
 #include "esp/agent/Agent.h"
 #include "esp/assets/ResourceManager.h"
 #include "esp/core/esp.h"
@@ -53,6 +57,23 @@ struct SimulatorConfiguration {
                                                 // object here?
   /** @brief Light setup key for scene */
   std::string sceneLightSetup = assets::ResourceManager::NO_LIGHT_KEY;
+  /**
+   * @brief Directory of a @ref nav::NavMeshCache used by @ref
+   * Simulator::recomputeNavMesh, empty to always build
+   */
+  std::string navMeshCacheDir;
+  /**
+   * @brief How many scenes besides the active one stay loaded when switching
+   * scenes, so that switching back to them is instant.  The least recently
+   * used ones are unloaded first.
+   */
+  int sceneCacheSize = 0;
+  /**
+   * @brief Upper bound for the estimated memory of the meshes and textures of
+   * all loaded scenes, the active one included, 0 for none.  Cached scenes
+   * are unloaded until they fit.
+   */
+  std::size_t sceneCacheMaxBytes = 0;
 
   ESP_SMART_POINTERS(SimulatorConfiguration)
 };
@@ -61,11 +82,28 @@ bool operator==(const SimulatorConfiguration& a,
 bool operator!=(const SimulatorConfiguration& a,
                 const SimulatorConfiguration& b);
 
+/**
+ * @brief Whether switching a simulator from configuration a to b has to load
+ * the scene anew, i.e. whether b changes the scene or how it is loaded
+ *
+ * Everything else, like the random seed or sliding, is taken over by @ref
+ * Simulator::reconfigure without touching the loaded scene.
+ */
+bool requiresSceneReload(const SimulatorConfiguration& a,
+                         const SimulatorConfiguration& b);
+
 class Simulator {
  public:
   explicit Simulator(const SimulatorConfiguration& cfg);
   virtual ~Simulator();
 
+  /**
+   * @brief Applies a new configuration
+   *
+   * The scene graphs, navmesh, physics world and semantic scene of the loaded
+   * scene are kept unless @ref requiresSceneReload says otherwise, in which
+   * case the scene is loaded from scratch.
+   */
   virtual void reconfigure(const SimulatorConfiguration& cfg);
 
   virtual void reset();
@@ -88,6 +126,35 @@ class Simulator {
    */
   int gpuDevice() const { return context_->gpuDevice(); }
 
+  /**
+   * @brief The number of scenes that are loaded besides the active one, see
+   * @ref SimulatorConfiguration::sceneCacheSize
+   */
+  int numCachedScenes() const { return sceneCache_.size(); }
+
+  /**
+   * @brief Unloads all scenes but the active one, freeing their scene graphs,
+   * meshes and textures
+   */
+  void clearSceneCache();
+
+  /**
+   * @brief Starts loading the scene of cfg on background threads, so that
+   * @ref reconfigure with it later only has to upload it to the GPU.
+   *
+   * Reads and parses the scene and semantic meshes, decodes their textures
+   * and loads the navmesh and the semantic annotations, while the current
+   * scene can be used as usual.  Only one scene is prefetched at a time,
+   * prefetching another one drops the previous one.
+   */
+  void prefetchScene(const SimulatorConfiguration& cfg);
+
+  /**
+   * @brief Whether the background loading started by @ref prefetchScene is
+   * done, i.e. @ref reconfigure won't wait for it
+   */
+  bool isScenePrefetched() const;
+
   // === Physics Simulator Functions ===
   // TODO: support multi-scene physics (default sceneID=0 currently).
 
@@ -517,11 +584,61 @@ class Simulator {
    * @param navMeshSettings The @ref nav::NavMeshSettings instance to
    * parameterize the navmesh construction.
    * @return Whether or not the navmesh recomputation succeeded.
+   *
+   * If @ref SimulatorConfiguration::navMeshCacheDir is set, a navmesh that
+   * was built from the same geometry, STATIC objects included, and settings
+   * before is loaded from there instead.
    */
   bool recomputeNavMesh(nav::PathFinder& pathfinder,
                         const nav::NavMeshSettings& navMeshSettings,
                         bool includeStaticObjects = false);
 
+  /**
+   * @brief Same as @ref recomputeNavMesh but builds one navmesh per agent
+   * profile, see @ref nav::PathFinder::build.  The navmeshes are not cached.
+   */
+  bool recomputeNavMesh(nav::PathFinder& pathfinder,
+                        const std::vector<nav::NavMeshSettings>& profiles,
+                        bool includeStaticObjects = false);
+
+  /**
+   * @brief Update the navmesh of the referenced @ref nav::PathFinder for the
+   * STATIC objects that were added, removed or moved since its navmesh was
+   * last built by @ref recomputeNavMesh or @ref updateNavMesh.
+   *
+   * Only the navmesh tiles around these objects are rebuilt, see @ref
+   * nav::PathFinder::rebuildRegions.  This falls back to recomputing the whole
+   * navmesh if it was not built tiled with the same settings or was not built
+   * by this simulator, e.g. loaded from a file.
+   * @param pathfinder The pathfinder object whose navmesh will be updated.
+   * @param navMeshSettings The @ref nav::NavMeshSettings instance to
+   * parameterize the navmesh construction.
+   * @return Whether or not the navmesh update succeeded.
+   */
+  bool updateNavMesh(nav::PathFinder& pathfinder,
+                     const nav::NavMeshSettings& navMeshSettings);
+
+  /**
+   * @brief Cut the DYNAMIC and KINEMATIC objects out of the navmesh of the
+   * referenced @ref nav::PathFinder as obstacles at where they are now.
+   *
+   * Meant to be called every step, always with the same pathfinder.  Objects
+   * are cut out as their axis aligned bounding box and only the ones that
+   * moved by more than a centimeter since the last call are updated, see
+   * @ref nav::PathFinder::updateObstacles.  This requires a navmesh built with
+   * @ref nav::NavMeshSettings.buildTiled, see @ref
+   * nav::PathFinder::isTiled, any other navmesh is left as it is.  The
+   * obstacles apply to all agent profiles of the pathfinder, see @ref
+   * nav::PathFinder::setProfile.
+   * @param pathfinder The pathfinder object whose navmesh will be updated.
+   * @param blocking Whether to wait until the navmesh is updated instead of
+   * updating it in the background.
+   * @return Whether the navmesh is up to date with all objects, always false
+   * if it is not tiled.
+   */
+  bool updateNavMeshObstacles(nav::PathFinder& pathfinder,
+                              bool blocking = false);
+
   agent::Agent::ptr getAgent(int agentId);
 
   agent::Agent::ptr addAgent(const agent::AgentConfiguration& agentConfig,
@@ -618,6 +735,80 @@ class Simulator {
     return isValidScene(sceneID) && physicsManager_ != nullptr;
   }
 
+  //! A STATIC object as it was when it was added to the navmesh
+  struct NavMeshObject {
+    std::string meshHandle;
+    Magnum::Matrix4 transformation;
+    Magnum::Vector3 scale;
+    //! World space bounds
+    std::pair<vec3f, vec3f> bounds;
+
+    bool operator==(const NavMeshObject& other) const {
+      return meshHandle == other.meshHandle &&
+             transformation == other.transformation && scale == other.scale;
+    }
+  };
+
+  //! A DYNAMIC or KINEMATIC object as it was when it was last cut out of the
+  //! navmesh
+  struct NavMeshObstacle {
+    int obstacleId;
+    //! World space bounds
+    std::pair<vec3f, vec3f> bounds;
+  };
+
+  //! A loaded scene that is not active, see @ref
+  //! SimulatorConfiguration::sceneCacheSize
+  struct CachedScene {
+    SimulatorConfiguration config;
+    int sceneID;
+    int semanticSceneID;
+    nav::PathFinder::ptr pathfinder;
+    std::shared_ptr<scene::SemanticScene> semanticScene;
+    std::shared_ptr<physics::PhysicsManager> physicsManager;
+    std::map<size_t, std::map<int, NavMeshObject>> navMeshObjects;
+    std::map<int, NavMeshObstacle> navMeshObstacles;
+    //! Nodes the scene was loaded into, see @ref activeSceneNodes_
+    std::vector<scene::SceneNode*> sceneNodes;
+    //! Files loaded by the @ref assets::ResourceManager for the scene
+    std::vector<std::string> assets;
+    std::size_t byteSize;
+  };
+
+  //! The parts of a scene loaded in the background by prefetchScene(), its
+  //! meshes and textures are kept by the ResourceManager
+  struct ScenePrefetch {
+    SimulatorConfiguration config;
+    std::future<nav::PathFinder::ptr> pathfinder;
+    std::future<std::shared_ptr<scene::SemanticScene>> semanticScene;
+  };
+
+  //! Moves the active scene into the cache, leaving no scene active
+  void cacheActiveScene();
+
+  //! Makes a cached scene that config_ can use active, if there is one
+  bool restoreCachedScene();
+
+  //! Unloads the least recently used cached scenes until the cache fits
+  //! config_
+  void trimSceneCache();
+
+  //! Records the children of a root node the active scene was just loaded
+  //! into in @ref activeSceneNodes_
+  void addActiveSceneNodes(scene::SceneNode& rootNode);
+
+  //! Destroys the scene graphs and physics of a scene that was taken out of
+  //! the cache and unloads the assets no other scene uses.  Nodes in it that
+  //! were neither loaded with the scene nor are physics objects, such as
+  //! agents, are moved to the active scene.
+  void unloadScene(CachedScene& scene);
+
+  //! Joins the scene's collision mesh with the STATIC objects, if included,
+  //! and records the objects in navMeshObjects
+  assets::MeshData::uptr createJoinedNavMeshMesh(
+      bool includeStaticObjects,
+      std::map<int, NavMeshObject>& navMeshObjects);
+
   gfx::WindowlessContext::uptr context_ = nullptr;
   std::shared_ptr<gfx::Renderer> renderer_ = nullptr;
   // CANNOT make the specification of resourceManager_ above the context_!
@@ -637,11 +828,27 @@ class Simulator {
 
   std::shared_ptr<physics::PhysicsManager> physicsManager_ = nullptr;
 
+  //! Children of the root nodes the active scene was loaded into, everything
+  //! else in its scene graphs was added later
+  std::vector<scene::SceneNode*> activeSceneNodes_;
+  //! Files loaded by the @ref assets::ResourceManager for the active scene
+  std::vector<std::string> activeSceneAssets_;
+  //! Loaded scenes besides the active one, most recently used first.  Has
+  //! to be destroyed before the scene graphs and assets it refers to.
+  std::list<CachedScene> sceneCache_;
+  std::unique_ptr<ScenePrefetch> scenePrefetch_;
+
   core::Random::ptr random_;
   SimulatorConfiguration config_;
 
   std::vector<agent::Agent::ptr> agents_;
   nav::PathFinder::ptr pathfinder_;
+  //! STATIC objects each navmesh was last built from by @ref
+  //! recomputeNavMesh or @ref updateNavMesh, keyed by @ref
+  //! nav::PathFinder::navMeshId
+  std::map<size_t, std::map<int, NavMeshObject>> navMeshObjects_;
+  //! Obstacles of the objects cut out by @ref updateNavMeshObstacles
+  std::map<int, NavMeshObstacle> navMeshObstacles_;
   // state indicating frustum culling is enabled or not
   //
   // TODO:
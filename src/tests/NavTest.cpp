@@ -3,11 +3,17 @@
 // LICENSE file in the root directory of this source tree.
 
 #include <Corrade/Utility/Directory.h>
+#include <Magnum/EigenIntegration/Integration.h>
 #include <gtest/gtest.h>
+#include <thread>
 
 #include "esp/assets/MeshData.h"
 #include "esp/core/esp.h"
 #include "esp/core/random.h"
+#include "esp/nav/Crowd.h"
+#include "esp/nav/EpisodeGenerator.h"
+#include "esp/nav/GreedyFollower.h"
+#include "esp/nav/NavMeshCache.h"
 #include "esp/nav/PathFinder.h"
 #include "esp/scene/ObjectControls.h"
 #include "esp/scene/SceneGraph.h"
@@ -15,6 +21,7 @@
 #include "configure.h"
 
 namespace Cr = Corrade;
+namespace Mn = Magnum;
 
 using namespace esp;
 using namespace esp::nav;
@@ -167,3 +174,907 @@ TEST(NavTest, PathFinderTestMeshData) {
   ASSERT_EQ(meshData->vbo.size(), 63);
   ASSERT_EQ(meshData->ibo.size(), 63);
 }
+
+TEST(NavTest, PathFinderTestFindPaths) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  pf.seed(0);
+
+  constexpr int numPairs = 1000;
+  Eigen::RowMatrixXf starts(numPairs, 3), ends(numPairs, 3);
+  for (int i = 0; i < numPairs; ++i) {
+    starts.row(i) = pf.getRandomNavigablePoint().transpose();
+    ends.row(i) = pf.getRandomNavigablePoint().transpose();
+  }
+
+  const ShortestPathBatch batch =
+      pf.findPaths(starts, ends, /*returnPoints=*/true);
+  ASSERT_EQ(batch.geodesicDistances.size(), numPairs);
+  ASSERT_EQ(batch.pathOffsets.size(), numPairs + 1);
+  ASSERT_EQ(batch.pathOffsets[numPairs], batch.points.rows());
+
+  for (int i = 0; i < numPairs; ++i) {
+    ShortestPath path;
+    path.requestedStart = starts.row(i).transpose();
+    path.requestedEnd = ends.row(i).transpose();
+    pf.findPath(path);
+
+    EXPECT_EQ(batch.geodesicDistances[i], path.geodesicDistance);
+    ASSERT_EQ(batch.pathOffsets[i + 1] - batch.pathOffsets[i],
+              path.points.size());
+    for (int j = 0; j < path.points.size(); ++j) {
+      EXPECT_TRUE(batch.points.row(batch.pathOffsets[i] + j)
+                      .transpose()
+                      .isApprox(path.points[j]));
+    }
+  }
+
+  // Without a navmesh no pair has a path, but the layout stays the same
+  PathFinder unloaded;
+  const ShortestPathBatch emptyBatch =
+      unloaded.findPaths(starts, ends, /*returnPoints=*/true);
+  ASSERT_EQ(emptyBatch.geodesicDistances.size(), numPairs);
+  EXPECT_TRUE((emptyBatch.geodesicDistances.array() ==
+               std::numeric_limits<float>::infinity())
+                  .all());
+  ASSERT_EQ(emptyBatch.pathOffsets.size(), numPairs + 1);
+  EXPECT_TRUE((emptyBatch.pathOffsets.array() == 0).all());
+  EXPECT_EQ(emptyBatch.points.rows(), 0);
+}
+
+TEST(NavTest, PathFinderTestConcurrentQueries) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  pf.seed(0);
+
+  constexpr int numPaths = 1000;
+  std::vector<ShortestPath> expected(numPaths);
+  for (auto& path : expected) {
+    path.requestedStart = pf.getRandomNavigablePoint();
+    path.requestedEnd = pf.getRandomNavigablePoint();
+    pf.findPath(path);
+  }
+
+  // Share one PathFinder between several threads that all query it at once
+  constexpr int numThreads = 4;
+  std::vector<ShortestPath> results(numPaths);
+  std::vector<vec3f> snapped(numPaths);
+  std::vector<std::thread> threads;
+  for (int iThread = 0; iThread < numThreads; ++iThread) {
+    threads.emplace_back([&, iThread]() {
+      for (int i = iThread; i < numPaths; i += numThreads) {
+        results[i].requestedStart = expected[i].requestedStart;
+        results[i].requestedEnd = expected[i].requestedEnd;
+        pf.findPath(results[i]);
+        snapped[i] = pf.snapPoint(expected[i].requestedEnd);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (int i = 0; i < numPaths; ++i) {
+    EXPECT_EQ(results[i].geodesicDistance, expected[i].geodesicDistance);
+    EXPECT_EQ(results[i].points.size(), expected[i].points.size());
+    EXPECT_TRUE(snapped[i].isApprox(pf.snapPoint(expected[i].requestedEnd)));
+  }
+}
+
+TEST(NavTest, PathFinderTestDistanceField) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  pf.seed(0);
+
+  const std::vector<vec3f> goals{pf.getRandomNavigablePoint(),
+                                 pf.getRandomNavigablePoint()};
+  GeodesicDistanceField::ptr field = pf.buildDistanceField(goals);
+  ASSERT_NE(field, nullptr);
+  EXPECT_EQ(pf.geodesicDistance(*field, goals[0]), 0);
+
+  for (int i = 0; i < 1000; ++i) {
+    MultiGoalShortestPath path;
+    path.requestedStart = pf.getRandomNavigablePoint();
+    path.setRequestedEnds(goals);
+    const bool found = pf.findPath(path);
+
+    MultiGoalShortestPath fieldPath;
+    fieldPath.requestedStart = path.requestedStart;
+    fieldPath.setDistanceField(field);
+    ASSERT_EQ(pf.findPath(fieldPath), found);
+    if (!found)
+      continue;
+
+    // The field is built from an any-angle expansion over the vertices of the
+    // navmesh, so it is close to but not exactly the string-pulled path
+    const float dist = pf.geodesicDistance(*field, path.requestedStart);
+    EXPECT_EQ(fieldPath.geodesicDistance, dist);
+    EXPECT_NEAR(dist, path.geodesicDistance,
+                0.05 * path.geodesicDistance + 0.1);
+    ASSERT_GE(fieldPath.points.size(), 2);
+    EXPECT_TRUE(fieldPath.points.back().isApprox(
+                    pf.snapPoint(goals[0]), 1e-3) ||
+                fieldPath.points.back().isApprox(pf.snapPoint(goals[1]), 1e-3));
+  }
+}
+
+TEST(NavTest, PathFinderTestMemoryMapped) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+
+  // Save in the current, aligned, format first
+  const std::string navmeshFile = Cr::Utility::Directory::join(
+      Cr::Utility::Directory::tmp(), "NavTestMemoryMapped.navmesh");
+  ASSERT_TRUE(pf.saveNavMesh(navmeshFile));
+
+  PathFinder mapped;
+  ASSERT_TRUE(mapped.loadNavMesh(navmeshFile, /*memoryMap=*/true));
+
+  pf.seed(0);
+  for (int i = 0; i < 1000; ++i) {
+    ShortestPath path;
+    path.requestedStart = pf.getRandomNavigablePoint();
+    path.requestedEnd = pf.getRandomNavigablePoint();
+    ShortestPath mappedPath = path;
+    EXPECT_EQ(pf.findPath(path), mapped.findPath(mappedPath));
+    EXPECT_EQ(path.geodesicDistance, mappedPath.geodesicDistance);
+    EXPECT_EQ(pf.islandRadius(path.requestedStart),
+              mapped.islandRadius(path.requestedStart));
+  }
+
+  Cr::Utility::Directory::rm(navmeshFile);
+}
+
+TEST(NavTest, PathFinderTestSavedIslands) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+
+  // The islands are stored in the file and read back instead of recomputed
+  const std::string navmeshFile = Cr::Utility::Directory::join(
+      Cr::Utility::Directory::tmp(), "NavTestSavedIslands.navmesh");
+  ASSERT_TRUE(pf.saveNavMesh(navmeshFile));
+  PathFinder loaded;
+  ASSERT_TRUE(loaded.loadNavMesh(navmeshFile));
+
+  pf.seed(0);
+  for (int i = 0; i < 1000; ++i) {
+    const vec3f start = pf.getRandomNavigablePoint();
+    const vec3f end = pf.getRandomNavigablePoint();
+    EXPECT_EQ(pf.islandRadius(start), loaded.islandRadius(start));
+
+    ShortestPath path;
+    path.requestedStart = start;
+    path.requestedEnd = end;
+    ShortestPath loadedPath = path;
+    EXPECT_EQ(pf.findPath(path), loaded.findPath(loadedPath));
+  }
+
+  Cr::Utility::Directory::rm(navmeshFile);
+}
+
+TEST(NavTest, PathFinderTestRasterizedTopDownView) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  pf.seed(0);
+  const float height = pf.getRandomNavigablePoint()[1];
+  const float metersPerPixel = 0.1;
+
+  // The two only differ at the edges of the navmesh
+  const auto sampled = pf.getTopDownView(metersPerPixel, height);
+  const auto rasterized =
+      pf.getTopDownView(metersPerPixel, height, /*rasterize=*/true);
+  ASSERT_EQ(sampled.rows(), rasterized.rows());
+  ASSERT_EQ(sampled.cols(), rasterized.cols());
+  ASSERT_GT(sampled.count(), 0);
+  const int numDifferent = (sampled.array() != rasterized.array()).count();
+  EXPECT_LT(numDifferent, 0.05 * sampled.count());
+
+  const Eigen::MatrixXi islands =
+      pf.getTopDownIslandView(metersPerPixel, height);
+  const Eigen::MatrixXf distances =
+      pf.getTopDownDistanceView(metersPerPixel, height);
+  for (int h = 0; h < islands.rows(); ++h) {
+    for (int w = 0; w < islands.cols(); ++w) {
+      EXPECT_EQ(islands(h, w) != ID_UNDEFINED, rasterized(h, w));
+      EXPECT_EQ(distances(h, w) > 0, rasterized(h, w));
+    }
+  }
+}
+
+TEST(NavTest, PathFinderTestObstacleDistanceField) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  PathFinder exact;
+  exact.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+
+  const float tolerance = 0.05;
+  pf.setObstacleDistanceTolerance(tolerance);
+  EXPECT_EQ(pf.getObstacleDistanceTolerance(), tolerance);
+
+  const std::string navmeshFile = Cr::Utility::Directory::join(
+      Cr::Utility::Directory::tmp(), "NavTestObstacleDistanceField.navmesh");
+  ASSERT_TRUE(pf.saveNavMesh(navmeshFile));
+  // The saved field is only used if it was asked for
+  PathFinder loaded;
+  loaded.setObstacleDistanceTolerance(tolerance);
+  ASSERT_TRUE(loaded.loadNavMesh(navmeshFile));
+  EXPECT_EQ(loaded.getObstacleDistanceTolerance(), tolerance);
+  PathFinder loadedExact;
+  ASSERT_TRUE(loadedExact.loadNavMesh(navmeshFile));
+  EXPECT_EQ(loadedExact.getObstacleDistanceTolerance(), 0);
+
+  pf.seed(0);
+  for (int i = 0; i < 1000; ++i) {
+    const vec3f pt = pf.getRandomNavigablePoint();
+    const float distance = exact.distanceToClosestObstacle(pt);
+    EXPECT_NEAR(pf.distanceToClosestObstacle(pt), distance, tolerance);
+    EXPECT_EQ(pf.distanceToClosestObstacle(pt),
+              loaded.distanceToClosestObstacle(pt));
+    EXPECT_EQ(loadedExact.distanceToClosestObstacle(pt), distance);
+    // Larger search radii are not covered by the field
+    EXPECT_EQ(pf.distanceToClosestObstacle(pt, 4.0),
+              exact.distanceToClosestObstacle(pt, 4.0));
+  }
+
+  Cr::Utility::Directory::rm(navmeshFile);
+}
+
+TEST(NavTest, PathFinderTestLongPaths) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+
+  // Paths between points that are far apart are only planned on the
+  // hierarchy of clusters if the direct search runs out of nodes, they must
+  // still be valid paths on the navmesh
+  pf.seed(0);
+  int numLongPaths = 0;
+  int numExactPaths = 0;
+  for (int i = 0; i < 1000; ++i) {
+    ShortestPath path;
+    path.requestedStart = pf.getRandomNavigablePoint();
+    path.requestedEnd = pf.getRandomNavigablePoint();
+    if ((path.requestedStart - path.requestedEnd).norm() < 10 ||
+        !pf.findPath(path))
+      continue;
+    ++numLongPaths;
+
+    // Whenever the plain Detour search makes it to the end, which the sliced
+    // search does with the same number of nodes, the path is the same
+    SlicedShortestPath sliced;
+    sliced.requestedStart = path.requestedStart;
+    sliced.requestedEnd = path.requestedEnd;
+    ASSERT_TRUE(pf.initSlicedPath(sliced));
+    while (!pf.updateSlicedPath(sliced, 1000)) {
+    }
+    ASSERT_TRUE(pf.finalizeSlicedPath(sliced));
+    if (sliced.isComplete) {
+      ++numExactPaths;
+      EXPECT_NEAR(path.geodesicDistance, sliced.geodesicDistance, 1e-3);
+    }
+
+    EXPECT_GE(path.geodesicDistance,
+              (path.requestedStart - path.requestedEnd).norm() - 1e-3);
+    ASSERT_GE(path.points.size(), 2);
+    EXPECT_TRUE(path.points.front().isApprox(path.requestedStart, 1e-3));
+    EXPECT_TRUE(path.points.back().isApprox(path.requestedEnd, 1e-3));
+    for (const vec3f& pt : path.points) {
+      EXPECT_EQ(pf.islandRadius(pt), pf.islandRadius(path.requestedStart));
+    }
+  }
+  EXPECT_GT(numLongPaths, 0);
+  EXPECT_GT(numExactPaths, 0);
+}
+
+TEST(NavTest, PathFinderTestMultiGoalSingleExpansion) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  pf.seed(0);
+
+  std::vector<vec3f> goals;
+  for (int i = 0; i < 50; ++i) {
+    goals.emplace_back(pf.getRandomNavigablePoint());
+  }
+
+  for (int i = 0; i < 100; ++i) {
+    MultiGoalShortestPath path;
+    path.requestedStart = pf.getRandomNavigablePoint();
+    path.setRequestedEnds(goals);
+    const bool found = pf.findPath(path);
+
+    // The closest goal by the searches for every goal on its own
+    float closestDist = std::numeric_limits<float>::infinity();
+    for (const vec3f& goal : goals) {
+      ShortestPath goalPath;
+      goalPath.requestedStart = path.requestedStart;
+      goalPath.requestedEnd = goal;
+      if (pf.findPath(goalPath))
+        closestDist = std::min(closestDist, goalPath.geodesicDistance);
+    }
+    ASSERT_EQ(found, closestDist < std::numeric_limits<float>::infinity());
+    if (!found)
+      continue;
+
+    EXPECT_EQ(path.geodesicDistance, closestDist);
+    ASSERT_GE(path.points.size(), 2);
+    EXPECT_TRUE(path.points.front().isApprox(path.requestedStart, 1e-3));
+  }
+}
+
+TEST(NavTest, PathFinderTestSlicedPath) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  pf.seed(0);
+
+  for (int i = 0; i < 100; ++i) {
+    ShortestPath path;
+    path.requestedStart = pf.getRandomNavigablePoint();
+    path.requestedEnd = pf.getRandomNavigablePoint();
+    const bool found = pf.findPath(path);
+
+    SlicedShortestPath sliced;
+    sliced.requestedStart = path.requestedStart;
+    sliced.requestedEnd = path.requestedEnd;
+    ASSERT_EQ(pf.initSlicedPath(sliced), found);
+    if (!found)
+      continue;
+
+    int numUpdates = 0;
+    while (!pf.updateSlicedPath(sliced, 8)) {
+      ++numUpdates;
+      ASSERT_LT(numUpdates, 10000);
+    }
+    EXPECT_TRUE(sliced.isDone());
+    ASSERT_TRUE(pf.finalizeSlicedPath(sliced));
+    // Very long searches run out of query nodes like a plain Detour search
+    if (!sliced.isComplete)
+      continue;
+    EXPECT_NEAR(sliced.geodesicDistance, path.geodesicDistance, 1e-3);
+    EXPECT_TRUE(sliced.points.back().isApprox(path.points.back(), 1e-3));
+  }
+
+  // Running out of budget still gives a path towards the end
+  SlicedShortestPath sliced;
+  do {
+    sliced.requestedStart = pf.getRandomNavigablePoint();
+    sliced.requestedEnd = pf.getRandomNavigablePoint();
+  } while (!pf.initSlicedPath(sliced) ||
+           (sliced.requestedStart - sliced.requestedEnd).norm() < 5);
+  EXPECT_FALSE(pf.updateSlicedPath(sliced, 1));
+  EXPECT_FALSE(sliced.isDone());
+  ASSERT_TRUE(pf.finalizeSlicedPath(sliced));
+  EXPECT_FALSE(sliced.isComplete);
+  EXPECT_GE(sliced.points.size(), 2);
+  EXPECT_TRUE(sliced.isDone());
+}
+
+TEST(NavTest, PathFinderTestTrackedStep) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  pf.seed(0);
+
+  AgentNavHandle handle;
+  EXPECT_FALSE(handle.isTracking());
+
+  const vec3f directions[] = {vec3f::UnitX(), vec3f::UnitZ(), -vec3f::UnitX(),
+                              -vec3f::UnitZ()};
+  vec3f tracked = pf.getRandomNavigablePoint();
+  vec3f untracked = tracked;
+  int numSteps = 0, numMatching = 0;
+  for (int i = 0; i < 1000; ++i) {
+    // Teleport every now and then, the handle has to notice
+    if (i % 100 == 0) {
+      tracked = untracked = pf.getRandomNavigablePoint();
+    }
+    const vec3f delta = 0.25f * directions[(i / 7) % 4];
+
+    const vec3f next = pf.tryStep(handle, tracked, vec3f{tracked + delta});
+    EXPECT_TRUE(handle.isTracking());
+    EXPECT_TRUE(pf.isNavigable(next));
+    EXPECT_EQ(pf.islandRadius(next), pf.islandRadius(tracked));
+
+    const vec3f expected = pf.tryStep(untracked, vec3f{untracked + delta});
+    ++numSteps;
+    if (next.isApprox(expected, 1e-3))
+      ++numMatching;
+
+    tracked = next;
+    untracked = expected;
+  }
+  // The untracked version may snap to a different poly on stacked floors or
+  // thin walls, otherwise both walk the same polys
+  EXPECT_GT(numMatching, 0.9 * numSteps);
+
+  handle.reset();
+  EXPECT_FALSE(handle.isTracking());
+}
+
+TEST(NavTest, PathFinderTestTrackedStepAlongWalls) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  pf.seed(1);
+
+  // Walking on in the same direction slides along walls, where both versions
+  // have to keep the agent on its island the same way
+  const vec3f directions[] = {vec3f::UnitX(), vec3f::UnitZ(), -vec3f::UnitX(),
+                              -vec3f::UnitZ()};
+  for (int i = 0; i < 50; ++i) {
+    AgentNavHandle handle;
+    vec3f pos = pf.getRandomNavigablePoint();
+    const vec3f delta = 0.25f * directions[i % 4];
+    for (int j = 0; j < 40; ++j) {
+      const vec3f tracked = pf.tryStep(handle, pos, vec3f{pos + delta});
+      const vec3f untracked = pf.tryStep(pos, vec3f{pos + delta});
+      EXPECT_LT((tracked - untracked).norm(), 1e-4);
+      EXPECT_EQ(pf.islandRadius(tracked), pf.islandRadius(pos));
+      pos = tracked;
+    }
+  }
+}
+
+TEST(NavTest, PathFinderTestBatchedRandomPoints) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+
+  // The same seed should produce the same points, regardless of the global
+  // rand
+  pf.seed(1);
+  const Eigen::RowMatrixXf points = pf.getRandomNavigablePoints(1000);
+  pf.seed(1);
+  rand();
+  EXPECT_EQ(points, pf.getRandomNavigablePoints(1000));
+  EXPECT_NE(points, pf.getRandomNavigablePoints(1000));
+
+  ASSERT_EQ(points.rows(), 1000);
+  for (int i = 0; i < points.rows(); ++i) {
+    EXPECT_TRUE(pf.isNavigable(points.row(i).transpose()));
+  }
+
+  const vec3f center = points.row(0).transpose();
+  const Eigen::RowMatrixXf islandPoints =
+      pf.getRandomNavigablePointsOnIsland(center, 100);
+  ASSERT_EQ(islandPoints.rows(), 100);
+  for (int i = 0; i < islandPoints.rows(); ++i) {
+    EXPECT_EQ(pf.islandRadius(islandPoints.row(i).transpose()),
+              pf.islandRadius(center));
+  }
+
+  const float radius = 2.0;
+  const Eigen::RowMatrixXf nearbyPoints =
+      pf.getRandomNavigablePointsAroundPoint(center, radius, 100);
+  EXPECT_EQ(nearbyPoints.rows(), 100);
+  for (int i = 0; i < nearbyPoints.rows(); ++i) {
+    EXPECT_LE((nearbyPoints.row(i).transpose() - center).norm(), radius);
+  }
+
+  const Eigen::RowMatrixXf floorPoints =
+      pf.getRandomNavigablePointsInHeightBand(center[1] - 0.5,
+                                              center[1] + 0.5, 100);
+  EXPECT_EQ(floorPoints.rows(), 100);
+  for (int i = 0; i < floorPoints.rows(); ++i) {
+    EXPECT_NEAR(floorPoints(i, 1), center[1], 0.5);
+  }
+
+  // Nothing to sample from
+  EXPECT_EQ(pf.getRandomNavigablePointsInHeightBand(1e3, 1e3 + 1, 10).rows(),
+            0);
+  EXPECT_EQ(PathFinder{}.getRandomNavigablePoints(10).rows(), 0);
+}
+
+TEST(NavTest, EpisodeGeneratorTest) {
+  PathFinder::ptr pf = PathFinder::create();
+  pf->loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+
+  EpisodeGeneratorSettings settings;
+  settings.minGeodesicDistance = 2.0;
+  settings.maxGeodesicDistance = 10.0;
+  settings.minGeodesicToEuclideanRatio = 1.05;
+
+  EpisodeGenerator generator{pf};
+  const std::vector<NavEpisode> episodes = generator.generate(200, 0, settings);
+  ASSERT_EQ(episodes.size(), 200);
+  const EpisodeGeneratorStats stats = generator.getStats();
+  EXPECT_EQ(stats.numAccepted, 200);
+  EXPECT_EQ(stats.numCandidates,
+            stats.numAccepted + stats.numRejectedIsland +
+                stats.numRejectedNoPath + stats.numRejectedDistance +
+                stats.numRejectedRatio);
+
+  for (const NavEpisode& episode : episodes) {
+    EXPECT_EQ(episode.goalSetIndex, ID_UNDEFINED);
+    EXPECT_GE(episode.geodesicDistance, settings.minGeodesicDistance);
+    EXPECT_LE(episode.geodesicDistance, settings.maxGeodesicDistance);
+    EXPECT_GE(episode.geodesicDistance,
+              settings.minGeodesicToEuclideanRatio *
+                  episode.euclideanDistance);
+    EXPECT_GE(pf->islandRadius(episode.start), settings.minIslandRadius);
+  }
+
+  // The same seed should produce the same episodes
+  const std::vector<NavEpisode> again = generator.generate(200, 0, settings);
+  ASSERT_EQ(again.size(), episodes.size());
+  for (int i = 0; i < episodes.size(); ++i) {
+    EXPECT_EQ(again[i].start, episodes[i].start);
+    EXPECT_EQ(again[i].goal, episodes[i].goal);
+  }
+  EXPECT_EQ(generator.getStats().numCandidates, stats.numCandidates);
+
+  // Goals are the closest points of a goal set
+  std::vector<std::vector<vec3f>> goalSets(3);
+  for (int i = 0; i < 3; ++i) {
+    goalSets[i].push_back(episodes[i].goal);
+    goalSets[i].push_back(episodes[i + 3].goal);
+  }
+  ASSERT_TRUE(generator.setGoalSets(goalSets));
+  for (const NavEpisode& episode : generator.generate(50, 1, settings)) {
+    ASSERT_GE(episode.goalSetIndex, 0);
+    ASSERT_LT(episode.goalSetIndex, 3);
+    ShortestPath path;
+    path.requestedStart = episode.start;
+    for (const vec3f& goal : goalSets[episode.goalSetIndex]) {
+      path.requestedEnd = goal;
+      if (pf->findPath(path))
+        EXPECT_GE(1.05 * path.geodesicDistance + 0.1, episode.geodesicDistance);
+    }
+  }
+}
+
+TEST(NavTest, NavMeshCacheTest) {
+  PathFinder source;
+  source.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  // Any geometry to build from will do
+  const esp::assets::MeshData::ptr mesh = source.getNavMeshData();
+
+  const std::string cacheDir = Cr::Utility::Directory::join(
+      Cr::Utility::Directory::tmp(), "NavTestNavMeshCache");
+  NavMeshCache cache{cacheDir};
+  NavMeshSettings settings;
+  settings.setDefaults();
+  const std::string key = NavMeshCache::key(settings, *mesh);
+  Cr::Utility::Directory::rm(cache.path(key));
+
+  PathFinder built;
+  ASSERT_TRUE(cache.build(built, settings, *mesh));
+  ASSERT_TRUE(Cr::Utility::Directory::exists(cache.path(key)));
+
+  PathFinder cached;
+  ASSERT_TRUE(cache.build(cached, settings, *mesh));
+  EXPECT_EQ(cached.bounds(), built.bounds());
+  EXPECT_EQ(cached.getNavMeshData()->vbo.size(),
+            built.getNavMeshData()->vbo.size());
+
+  // Different inputs are different navmeshes
+  NavMeshSettings otherSettings = settings;
+  otherSettings.agentRadius *= 2;
+  EXPECT_NE(NavMeshCache::key(otherSettings, *mesh), key);
+  esp::assets::MeshData otherMesh = *mesh;
+  otherMesh.vbo[0][1] += 0.1;
+  EXPECT_NE(NavMeshCache::key(settings, otherMesh), key);
+
+  // A broken file is rebuilt and replaced
+  Cr::Utility::Directory::writeString(cache.path(key), "not a navmesh");
+  PathFinder rebuilt;
+  ASSERT_TRUE(cache.build(rebuilt, settings, *mesh));
+  EXPECT_EQ(rebuilt.bounds(), built.bounds());
+  PathFinder reloaded;
+  EXPECT_TRUE(reloaded.loadNavMesh(cache.path(key)));
+
+  Cr::Utility::Directory::rm(cache.path(key));
+  Cr::Utility::Directory::rm(cache.path(key) + ".lock");
+}
+
+TEST(NavTest, PathFinderTestProfiles) {
+  PathFinder source;
+  source.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  const esp::assets::MeshData::ptr mesh = source.getNavMeshData();
+
+  std::vector<NavMeshSettings> profiles(3);
+  for (int i = 0; i < profiles.size(); ++i) {
+    profiles[i].setDefaults();
+    profiles[i].agentRadius = 0.1 + 0.1 * i;
+    profiles[i].agentHeight = 1.5 - 0.2 * i;
+  }
+
+  PathFinder pf;
+  ASSERT_TRUE(pf.build(profiles, *mesh));
+  EXPECT_EQ(pf.numProfiles(), profiles.size());
+  EXPECT_EQ(pf.getProfile(), 0);
+  EXPECT_FALSE(pf.setProfile(profiles.size()));
+
+  // Sharing the heightfield gives the same navmeshes as building them on
+  // their own
+  for (int i = profiles.size() - 1; i >= 0; --i) {
+    ASSERT_TRUE(pf.setProfile(i));
+    EXPECT_EQ(pf.getProfile(), i);
+    PathFinder single;
+    ASSERT_TRUE(single.build(profiles[i], *mesh));
+    EXPECT_EQ(pf.getNavMeshData()->vbo, single.getNavMeshData()->vbo);
+
+    single.seed(0);
+    for (int j = 0; j < 100; ++j) {
+      const vec3f pt = single.getRandomNavigablePoint();
+      EXPECT_EQ(pf.islandRadius(pt), single.islandRadius(pt));
+      EXPECT_EQ(pf.distanceToClosestObstacle(pt),
+                single.distanceToClosestObstacle(pt));
+    }
+  }
+
+  // Building a single navmesh drops the profiles
+  ASSERT_TRUE(pf.build(profiles[1], *mesh));
+  EXPECT_EQ(pf.numProfiles(), 1);
+  EXPECT_EQ(pf.getProfile(), 0);
+}
+
+TEST(NavTest, PathFinderTestObstacles) {
+  PathFinder source;
+  source.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  const esp::assets::MeshData::ptr mesh = source.getNavMeshData();
+
+  NavMeshSettings settings;
+  settings.setDefaults();
+  settings.buildTiled = true;
+  settings.tileSize = 64;
+  PathFinder pf;
+  ASSERT_TRUE(pf.build(settings, *mesh));
+
+  // A point with enough room around it for an obstacle to not touch any wall
+  pf.seed(0);
+  vec3f pt = pf.getRandomNavigablePoint();
+  while (pf.distanceToClosestObstacle(pt) < 1.0f)
+    pt = pf.getRandomNavigablePoint();
+  ASSERT_TRUE(pf.isNavigable(pt));
+
+  const int cylinder =
+      pf.addCylinderObstacle(pt + vec3f{0, 0.5f, 0}, 0.25f, 1.0f);
+  EXPECT_EQ(pf.numObstacles(), 1);
+  EXPECT_TRUE(pf.isNavigable(pt));
+  EXPECT_TRUE(pf.updateObstacles());
+  EXPECT_FALSE(pf.isNavigable(pt));
+
+  // Moved out of the way in the background
+  const vec3f away = pt + vec3f{0.75f, 0, 0};
+  EXPECT_TRUE(pf.moveObstacle(cylinder, away + vec3f{0, 0.5f, 0}));
+  while (!pf.updateObstacles(false))
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_TRUE(pf.isNavigable(pt));
+  EXPECT_FALSE(pf.isNavigable(away));
+
+  // Obstacles above the agent do not cut the floor
+  const int box = pf.addBoxObstacle(pt + vec3f{0, 3.0f, 0},
+                                    vec3f{0.25f, 0.25f, 0.25f}, 0.5f);
+  EXPECT_TRUE(pf.updateObstacles());
+  EXPECT_TRUE(pf.isNavigable(pt));
+
+  EXPECT_TRUE(pf.removeObstacle(cylinder));
+  EXPECT_TRUE(pf.removeObstacle(box));
+  EXPECT_FALSE(pf.removeObstacle(box));
+  EXPECT_EQ(pf.numObstacles(), 0);
+  EXPECT_TRUE(pf.updateObstacles());
+  EXPECT_TRUE(pf.isNavigable(away));
+}
+
+TEST(NavTest, PathFinderTestObstaclesAcrossProfiles) {
+  PathFinder source;
+  source.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  EXPECT_FALSE(source.isTiled());
+  const esp::assets::MeshData::ptr mesh = source.getNavMeshData();
+
+  std::vector<NavMeshSettings> profiles(2);
+  for (int i = 0; i < profiles.size(); ++i) {
+    profiles[i].setDefaults();
+    profiles[i].buildTiled = true;
+    profiles[i].tileSize = 64;
+    profiles[i].agentRadius = 0.1 + 0.1 * i;
+  }
+  PathFinder pf;
+  ASSERT_TRUE(pf.build(profiles, *mesh));
+  EXPECT_TRUE(pf.isTiled());
+
+  pf.seed(0);
+  vec3f pt = pf.getRandomNavigablePoint();
+  while (pf.distanceToClosestObstacle(pt) < 1.0f)
+    pt = pf.getRandomNavigablePoint();
+  const int cylinder =
+      pf.addCylinderObstacle(pt + vec3f{0, 0.5f, 0}, 0.25f, 1.0f);
+  EXPECT_TRUE(pf.updateObstacles());
+  EXPECT_FALSE(pf.isNavigable(pt));
+
+  // The other profile gets the same obstacles, under the same ids
+  ASSERT_TRUE(pf.setProfile(1));
+  EXPECT_EQ(pf.numObstacles(), 1);
+  EXPECT_TRUE(pf.isNavigable(pt));
+  EXPECT_TRUE(pf.updateObstacles());
+  EXPECT_FALSE(pf.isNavigable(pt));
+
+  // Changes made meanwhile are carved when switching back
+  EXPECT_TRUE(pf.removeObstacle(cylinder));
+  ASSERT_TRUE(pf.setProfile(0));
+  EXPECT_EQ(pf.numObstacles(), 0);
+  EXPECT_TRUE(pf.updateObstacles());
+  EXPECT_TRUE(pf.isNavigable(pt));
+}
+
+TEST(NavTest, PathFinderTestCastRays) {
+  PathFinder pf;
+  pf.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+
+  const int numRays = 1000;
+  pf.seed(0);
+  Eigen::RowMatrixXf starts = pf.getRandomNavigablePoints(numRays);
+  Eigen::RowMatrixXf ends = pf.getRandomNavigablePoints(numRays);
+  // A ray to its own start, one through every wall and one from off the
+  // navmesh
+  ends.row(0) = starts.row(0);
+  ends.row(1) = starts.row(1) + Eigen::RowVector3f{1000, 0, 0};
+  starts.row(2) = Eigen::RowVector3f{1e6, 1e6, 1e6};
+
+  Eigen::VectorXf hitFractions(numRays);
+  Eigen::RowMatrixXf hitNormals(numRays, 3);
+  Eigen::Matrix<uint32_t, Eigen::Dynamic, 1> hitPolys(numRays);
+  pf.castRays(starts, ends, hitFractions, hitNormals, hitPolys);
+
+  EXPECT_EQ(hitFractions[0], std::numeric_limits<float>::infinity());
+  EXPECT_NE(hitPolys[0], 0u);
+  EXPECT_LT(hitFractions[1], 1.0f);
+  EXPECT_NEAR(hitNormals.row(1).norm(), 1.0f, 1e-3f);
+  EXPECT_TRUE(std::isnan(hitFractions[2]));
+  EXPECT_EQ(hitPolys[2], 0u);
+
+  for (int i = 3; i < numRays; ++i) {
+    EXPECT_NE(hitPolys[i], 0u);
+    if (std::isinf(hitFractions[i])) {
+      EXPECT_EQ(hitNormals.row(i).norm(), 0.0f);
+    } else {
+      EXPECT_GE(hitFractions[i], 0.0f);
+      EXPECT_LE(hitFractions[i], 1.0f);
+      // Nothing in the way up to the hit
+      const Eigen::RowVector3f hit =
+          starts.row(i) +
+          0.99f * hitFractions[i] * (ends.row(i) - starts.row(i));
+      Eigen::VectorXf again(1);
+      Eigen::RowMatrixXf againNormal(1, 3);
+      Eigen::Matrix<uint32_t, Eigen::Dynamic, 1> againPoly(1);
+      pf.castRays(starts.row(i), hit, again, againNormal, againPoly);
+      EXPECT_EQ(again[0], std::numeric_limits<float>::infinity());
+    }
+  }
+}
+
+TEST(NavTest, CrowdTest) {
+  PathFinder::ptr pf = PathFinder::create();
+  pf->loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+
+  const int numAgents = 32;
+  Crowd crowd{pf, numAgents};
+  CrowdAgentParams params;
+  pf->seed(0);
+  const vec3f center = pf->getRandomNavigablePoint();
+  const Eigen::RowMatrixXf starts =
+      pf->getRandomNavigablePointsOnIsland(center, numAgents);
+  const Eigen::RowMatrixXf targets =
+      pf->getRandomNavigablePointsOnIsland(center, numAgents);
+  Eigen::VectorXi agentIds(numAgents);
+  for (int i = 0; i < numAgents; ++i) {
+    agentIds[i] = crowd.addAgent(starts.row(i).transpose(), params);
+    ASSERT_EQ(agentIds[i], i);
+  }
+  EXPECT_EQ(crowd.addAgent(center, params), ID_UNDEFINED);
+  EXPECT_EQ(crowd.numAgents(), numAgents);
+  EXPECT_EQ(crowd.setAgentTargets(agentIds, targets), numAgents);
+
+  // Everyone gets closer to their target and stays on the navmesh
+  Eigen::RowMatrixXf positions(numAgents, 3), velocities(numAgents, 3);
+  crowd.getAgentStates(positions, velocities);
+  const float initialDistance = (positions - targets).rowwise().norm().sum();
+  for (int step = 0; step < 100; ++step)
+    crowd.update(0.1f);
+  crowd.getAgentStates(positions, velocities);
+  EXPECT_LT((positions - targets).rowwise().norm().sum(), initialDistance);
+  for (int i = 0; i < numAgents; ++i) {
+    EXPECT_TRUE(pf->isNavigable(positions.row(i).transpose()));
+    EXPECT_EQ(crowd.getAgentPosition(i), vec3f{positions.row(i).transpose()});
+  }
+
+  EXPECT_TRUE(crowd.removeAgent(3));
+  EXPECT_FALSE(crowd.hasAgent(3));
+  EXPECT_TRUE(std::isnan(crowd.getAgentPosition(3)[0]));
+  EXPECT_EQ(crowd.addAgent(center, params), 3);
+
+  // Agents carry over to a reloaded navmesh
+  pf->loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  crowd.update(0.1f);
+  EXPECT_EQ(crowd.numAgents(), numAgents);
+  for (int i = 0; i < numAgents; ++i)
+    EXPECT_TRUE(pf->isNavigable(crowd.getAgentPosition(i)));
+}
+
+TEST(NavTest, GreedyFollowerTestFindPaths) {
+  PathFinder::ptr pf = PathFinder::create();
+  pf->loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  pf->seed(0);
+
+  constexpr float forwardAmount = 0.25f;
+  GreedyGeodesicFollowerImpl follower{pf, 0.75 * forwardAmount, forwardAmount,
+                                      float(Mn::Rad{Mn::Deg{10.0f}})};
+
+  constexpr int numPairs = 16;
+  std::vector<core::RigidState> starts;
+  std::vector<Mn::Vector3> ends;
+  for (int i = 0; i < numPairs; ++i) {
+    starts.emplace_back(Mn::Quaternion{},
+                        Mn::Vector3{pf->getRandomNavigablePoint()});
+    ends.emplace_back(pf->getRandomNavigablePoint());
+  }
+
+  // Planning on all threads gives the same actions as planning one by one
+  const auto paths = follower.findPaths(starts, ends);
+  ASSERT_EQ(paths.size(), numPairs);
+  int numFound = 0;
+  for (int i = 0; i < numPairs; ++i) {
+    follower.reset();
+    const auto path = follower.findPath(starts[i], ends[i]);
+    EXPECT_EQ(paths[i], path);
+    if (!path.empty()) {
+      EXPECT_EQ(path.back(), GreedyGeodesicFollowerImpl::CODES::STOP);
+      ++numFound;
+    }
+  }
+  EXPECT_GT(numFound, 0);
+}
+
+TEST(NavTest, GreedyFollowerTestNavMeshChanges) {
+  PathFinder source;
+  source.loadNavMesh(Cr::Utility::Directory::join(
+      SCENE_DATASETS, "habitat-test-scenes/skokloster-castle.navmesh"));
+  const esp::assets::MeshData::ptr mesh = source.getNavMeshData();
+
+  NavMeshSettings settings;
+  settings.setDefaults();
+  settings.buildTiled = true;
+  settings.tileSize = 64;
+  PathFinder::ptr pf = PathFinder::create();
+  ASSERT_TRUE(pf->build(settings, *mesh));
+
+  pf->seed(0);
+  vec3f pt = pf->getRandomNavigablePoint();
+  while (pf->distanceToClosestObstacle(pt) < 1.0f)
+    pt = pf->getRandomNavigablePoint();
+  const core::RigidState start{Mn::Quaternion{}, Mn::Vector3{pt}};
+  const Mn::Vector3 goal{pt + vec3f{0, 0, -0.9f}};
+
+  constexpr float forwardAmount = 0.25f;
+  GreedyGeodesicFollowerImpl follower{pf, 0.75 * forwardAmount, forwardAmount,
+                                      float(Mn::Rad{Mn::Deg{10.0f}})};
+  EXPECT_EQ(follower.nextActionAlong(start, goal),
+            GreedyGeodesicFollowerImpl::CODES::FORWARD);
+
+  // An obstacle right in the way, the distances cached before no longer hold
+  pf->addCylinderObstacle(pt + vec3f{0, 0.5f, -0.45f}, 0.2f, 1.0f);
+  ASSERT_TRUE(pf->updateObstacles());
+  GreedyGeodesicFollowerImpl fresh{pf, 0.75 * forwardAmount, forwardAmount,
+                                   float(Mn::Rad{Mn::Deg{10.0f}})};
+  EXPECT_EQ(follower.nextActionAlong(start, goal),
+            fresh.nextActionAlong(start, goal));
+}
@@ -3,6 +3,7 @@
 // LICENSE file in the root directory of this source tree.
 
 #include <Corrade/Containers/StridedArrayView.h>
+#include <Corrade/TestSuite/Compare/Numeric.h>
 #include <Corrade/TestSuite/Tester.h>
 #include <Corrade/Utility/Directory.h>
 #include <Magnum/DebugTools/CompareImage.h>
@@ -82,6 +83,9 @@ struct SimTest : Cr::TestSuite::Tester {
 
   void basic();
   void reconfigure();
+  void sceneCache();
+  void unloadSceneKeepsNodes();
+  void prefetchScene();
   void reset();
   void getSceneRGBAObservation();
   void getSceneWithLightingRGBAObservation();
@@ -91,6 +95,7 @@ struct SimTest : Cr::TestSuite::Tester {
   void updateObjectLightSetupRGBAObservation();
   void multipleLightingSetupsRGBAObservation();
   void recomputeNavmeshWithStaticObjects();
+  void updateNavmeshWithStaticObjects();
   void loadingObjectTemplates();
 
   // TODO: remove outlier pixels from image and lower maxThreshold
@@ -106,6 +111,9 @@ SimTest::SimTest() {
   // clang-format off
   addTests({&SimTest::basic,
             &SimTest::reconfigure,
+            &SimTest::sceneCache,
+            &SimTest::unloadSceneKeepsNodes,
+            &SimTest::prefetchScene,
             &SimTest::reset,
             &SimTest::getSceneRGBAObservation,
             &SimTest::getSceneWithLightingRGBAObservation,
@@ -115,6 +123,7 @@ SimTest::SimTest() {
             &SimTest::updateObjectLightSetupRGBAObservation,
             &SimTest::multipleLightingSetupsRGBAObservation,
             &SimTest::recomputeNavmeshWithStaticObjects,
+            &SimTest::updateNavmeshWithStaticObjects,
             &SimTest::loadingObjectTemplates});
   // clang-format on
 }
@@ -138,6 +147,108 @@ void SimTest::reconfigure() {
   cfg2.scene.id = skokloster;
   simulator.reconfigure(cfg2);
   CORRADE_VERIFY(pathfinder != simulator.getPathFinder());
+
+  // Settings that aren't used for loading keep the loaded scene
+  SimulatorConfiguration cfg3 = cfg2;
+  cfg3.allowSliding = !cfg2.allowSliding;
+  cfg3.randomSeed = cfg2.randomSeed + 1;
+  CORRADE_VERIFY(!esp::sim::requiresSceneReload(cfg2, cfg3));
+  pathfinder = simulator.getPathFinder();
+  esp::scene::SceneGraph* sceneGraph = &simulator.getActiveSceneGraph();
+  simulator.reconfigure(cfg3);
+  CORRADE_VERIFY(pathfinder == simulator.getPathFinder());
+  CORRADE_VERIFY(sceneGraph == &simulator.getActiveSceneGraph());
+}
+
+void SimTest::sceneCache() {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  cfg.sceneCacheSize = 1;
+  Simulator simulator(cfg);
+  PathFinder::ptr pathfinder = simulator.getPathFinder();
+  esp::scene::SceneGraph* sceneGraph = &simulator.getActiveSceneGraph();
+  auto agent = simulator.addAgent(AgentConfiguration{});
+  CORRADE_COMPARE(simulator.numCachedScenes(), 0);
+
+  SimulatorConfiguration cfg2 = cfg;
+  cfg2.scene.id = skokloster;
+  simulator.reconfigure(cfg2);
+  CORRADE_COMPARE(simulator.numCachedScenes(), 1);
+  CORRADE_VERIFY(pathfinder != simulator.getPathFinder());
+
+  // Switching back reuses the cached scene instead of loading it again
+  simulator.reconfigure(cfg);
+  CORRADE_COMPARE(simulator.numCachedScenes(), 1);
+  CORRADE_VERIFY(pathfinder == simulator.getPathFinder());
+  CORRADE_VERIFY(sceneGraph == &simulator.getActiveSceneGraph());
+
+  // Scenes that don't fit anymore are unloaded, agents in them are kept
+  SimulatorConfiguration cfg3 = cfg2;
+  cfg3.sceneCacheSize = 0;
+  simulator.reconfigure(cfg3);
+  CORRADE_COMPARE(simulator.numCachedScenes(), 0);
+  CORRADE_VERIFY(pathfinder != simulator.getPathFinder());
+  CORRADE_VERIFY(agent->node().parent() ==
+                 &simulator.getActiveSceneGraph().getRootNode());
+
+  // Neither scene fits into the byte budget
+  cfg.sceneCacheMaxBytes = 1;
+  simulator.reconfigure(cfg);
+  CORRADE_COMPARE(simulator.numCachedScenes(), 0);
+}
+
+void SimTest::unloadSceneKeepsNodes() {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  cfg.sceneCacheSize = 0;
+  Simulator simulator(cfg);
+  // Not an agent but still held by the caller, like the node of a crowd agent
+  // with a sensor rig on it
+  esp::scene::SceneNode& node =
+      simulator.getActiveSceneGraph().getRootNode().createChild();
+  esp::scene::SceneNode& rig = node.createChild();
+  const std::size_t numSceneNodes =
+      simulator.getActiveSceneGraph().getRootNode().children().size() - 1;
+
+  SimulatorConfiguration cfg2 = cfg;
+  cfg2.scene.id = skokloster;
+  simulator.reconfigure(cfg2);
+  CORRADE_COMPARE(simulator.numCachedScenes(), 0);
+  esp::scene::SceneNode& rootNode =
+      simulator.getActiveSceneGraph().getRootNode();
+  CORRADE_VERIFY(node.parent() == &rootNode);
+  CORRADE_VERIFY(rig.parent() == &node);
+
+  // The nodes of the unloaded scene itself are gone
+  simulator.reconfigure(cfg);
+  CORRADE_COMPARE(
+      simulator.getActiveSceneGraph().getRootNode().children().size(),
+      numSceneNodes + 1);
+}
+
+void SimTest::prefetchScene() {
+  SimulatorConfiguration cfg;
+  cfg.scene.id = vangogh;
+  Simulator simulator(cfg);
+  PathFinder::ptr pathfinder = simulator.getPathFinder();
+  CORRADE_VERIFY(!simulator.isScenePrefetched());
+
+  // The loaded scene doesn't need to be prefetched
+  simulator.prefetchScene(cfg);
+  CORRADE_VERIFY(!simulator.isScenePrefetched());
+
+  // The active scene stays usable while the next one loads
+  SimulatorConfiguration cfg2 = cfg;
+  cfg2.scene.id = skokloster;
+  simulator.prefetchScene(cfg2);
+  CORRADE_VERIFY(pathfinder == simulator.getPathFinder());
+  CORRADE_VERIFY(simulator.getPathFinder()->isLoaded());
+
+  simulator.reconfigure(cfg2);
+  CORRADE_VERIFY(!simulator.isScenePrefetched());
+  CORRADE_VERIFY(pathfinder != simulator.getPathFinder());
+  CORRADE_VERIFY(simulator.getPathFinder()->isLoaded());
+  CORRADE_VERIFY(simulator.getActiveSceneGraph().getDrawables().size() > 0);
 }
 
 void SimTest::reset() {
@@ -386,6 +497,65 @@ void SimTest::recomputeNavmeshWithStaticObjects() {
       simulator->getPathFinder()->isNavigable(randomNavPoint + offset, 0.2));
 }
 
+void SimTest::updateNavmeshWithStaticObjects() {
+  auto simulator = getSimulator(skokloster);
+  auto pathfinder = simulator->getPathFinder();
+
+  esp::nav::NavMeshSettings navMeshSettings;
+  navMeshSettings.setDefaults();
+  navMeshSettings.buildTiled = true;
+  navMeshSettings.tileSize = 64;
+  CORRADE_VERIFY(simulator->recomputeNavMesh(*pathfinder, navMeshSettings));
+
+  esp::vec3f randomNavPoint = pathfinder->getRandomNavigablePoint();
+  while (pathfinder->distanceToClosestObstacle(randomNavPoint) < 1.0 ||
+         randomNavPoint[1] > 1.0) {
+    randomNavPoint = pathfinder->getRandomNavigablePoint();
+  }
+  esp::vec3f otherNavPoint = pathfinder->getRandomNavigablePoint();
+  while (pathfinder->distanceToClosestObstacle(otherNavPoint) < 1.0 ||
+         otherNavPoint[1] > 1.0 ||
+         (otherNavPoint - randomNavPoint).norm() < 5.0) {
+    otherNavPoint = pathfinder->getRandomNavigablePoint();
+  }
+
+  // adding a static object only changes the navmesh around it
+  auto objs = simulator->getObjectTemplateHandles("nested_box");
+  int objectID = simulator->addObjectByHandle(objs[0]);
+  simulator->setTranslation(Magnum::Vector3{randomNavPoint}, objectID);
+  simulator->setObjectMotionType(esp::physics::MotionType::STATIC, objectID);
+  CORRADE_VERIFY(simulator->updateNavMesh(*pathfinder, navMeshSettings));
+  CORRADE_VERIFY(!pathfinder->isNavigable(randomNavPoint, 0.1));
+  CORRADE_VERIFY(pathfinder->isNavigable(otherNavPoint, 0.1));
+
+  // moving it frees up where it was
+  simulator->setTranslation(Magnum::Vector3{otherNavPoint}, objectID);
+  CORRADE_VERIFY(simulator->updateNavMesh(*pathfinder, navMeshSettings));
+  CORRADE_VERIFY(pathfinder->isNavigable(randomNavPoint, 0.1));
+  CORRADE_VERIFY(!pathfinder->isNavigable(otherNavPoint, 0.1));
+
+  // and paths are the same as on a navmesh built from scratch
+  esp::nav::PathFinder fromScratch;
+  CORRADE_VERIFY(
+      simulator->recomputeNavMesh(fromScratch, navMeshSettings, true));
+  for (int i = 0; i < 100; ++i) {
+    esp::nav::ShortestPath path;
+    path.requestedStart = fromScratch.getRandomNavigablePoint();
+    path.requestedEnd = fromScratch.getRandomNavigablePoint();
+    esp::nav::ShortestPath updatedPath = path;
+    const bool found = fromScratch.findPath(path);
+    CORRADE_COMPARE(pathfinder->findPath(updatedPath), found);
+    if (found) {
+      CORRADE_COMPARE_WITH(updatedPath.geodesicDistance, path.geodesicDistance,
+                           Cr::TestSuite::Compare::around(1e-3f));
+    }
+  }
+
+  simulator->removeObject(objectID);
+  CORRADE_VERIFY(simulator->updateNavMesh(*pathfinder, navMeshSettings));
+  CORRADE_VERIFY(pathfinder->isNavigable(otherNavPoint, 0.1));
+}
+
 void SimTest::loadingObjectTemplates() {
   auto simulator = getSimulator(planeScene);
 
@@ -13,6 +13,7 @@
 
 #include "esp/assets/Mp3dInstanceMeshData.h"
 #include "esp/core/esp.h"
+#include "esp/nav/NavMeshCache.h"
 #include "esp/nav/PathFinder.h"
 #include "esp/scene/SemanticScene.h"
 
@@ -20,14 +21,20 @@ using namespace esp::assets;
 using namespace esp::scene;
 using namespace esp::nav;
 
-int createNavMesh(const std::string& meshFile, const std::string& navmeshFile) {
+int createNavMesh(const std::string& meshFile,
+                  const std::string& navmeshFile,
+                  const std::string& cacheDir) {
   SceneLoader loader;
   const AssetInfo info = AssetInfo::fromPath(meshFile);
   const MeshData mesh = loader.load(info);
   NavMeshSettings bs;
   bs.setDefaults();
+  bs.buildTiled = true;
   PathFinder pf;
-  if (!pf.build(bs, mesh)) {
+  const bool built = cacheDir.empty()
+                         ? pf.build(bs, mesh)
+                         : NavMeshCache{cacheDir}.build(pf, bs, mesh);
+  if (!built) {
     LOG(ERROR) << "Failed to build navmesh";
     return 2;
   }
@@ -152,12 +159,14 @@ int createMp3dSemanticMesh(const std::string& plyFile,
 
 int main(int argc, char** argv) {
   if (argc < 4) {
-    std::cout << "Usage: datatool task input_file output_file" << std::endl;
+    std::cout << "Usage: datatool task input_file output_file [cache_dir]"
+              << std::endl;
     return 64;
   }
   const std::string task = argv[1];
   if (task == "create_navmesh") {
-    createNavMesh(argv[2], argv[3]);
+    // An optional cache directory shared between runs, see NavMeshCache
+    createNavMesh(argv[2], argv[3], argc > 4 ? argv[4] : "");
   } else if (task == "create_mp3d_semantic_mesh") {
     if (argc < 5) {
       std::cout << "Usage: datatool create_mp3d_semantic_mesh input_ply "
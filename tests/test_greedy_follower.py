@@ -55,7 +55,8 @@ total_spl = 0.0
 @pytest.mark.parametrize("test_navmesh", test_navmeshes)
 @pytest.mark.parametrize("move_filter_fn", ["try_step", "try_step_no_sliding"])
 @pytest.mark.parametrize("action_noise", [False, True])
-def test_greedy_follower(test_navmesh, move_filter_fn, action_noise, pbar):
+@pytest.mark.parametrize("native", [False, True])
+def test_greedy_follower(test_navmesh, move_filter_fn, action_noise, native, pbar):
     global num_fails
     global num_tested
     global total_spl
@@ -98,13 +99,20 @@ def test_greedy_follower(test_navmesh, move_filter_fn, action_noise, pbar):
             )
         )
 
-    follower = habitat_sim.GreedyGeodesicFollower(
-        pathfinder,
-        agent,
-        forward_key="move_forward",
-        left_key="turn_left",
-        right_key="turn_right",
-    )
+    def make_follower(native):
+        return habitat_sim.GreedyGeodesicFollower(
+            pathfinder,
+            agent,
+            forward_key="move_forward",
+            left_key="turn_left",
+            right_key="turn_right",
+            native=native,
+            allow_sliding=move_filter_fn == "try_step",
+        )
+
+    follower = make_follower(native)
+    # Planning in C++ has to give the same actions as through the agent's controls
+    python_follower = make_follower(False) if native and not action_noise else None
 
     test_spl = 0.0
     for _ in range(NUM_TESTS):
@@ -135,6 +143,13 @@ def test_greedy_follower(test_navmesh, move_filter_fn, action_noise, pbar):
             except habitat_sim.errors.GreedyFollowerError:
                 action_list = [None]
 
+            if python_follower is not None:
+                try:
+                    python_action_list = python_follower.find_path(goal_pos)
+                except habitat_sim.errors.GreedyFollowerError:
+                    python_action_list = [None]
+                assert action_list == python_action_list
+
         while True:
             # If there is action noise, we need to plan a single action, actually take it, and repeat
             if action_noise:
@@ -180,3 +195,43 @@ def test_greedy_follower(test_navmesh, move_filter_fn, action_noise, pbar):
 
     if not test_all:
         assert test_spl / NUM_TESTS >= ACCEPTABLE_SPLS[(move_filter_fn, action_noise)]
+
+
+@pytest.mark.parametrize("allow_sliding", [True, False])
+def test_native_greedy_follower_find_paths(allow_sliding):
+    test_navmesh = test_navmeshes[1]
+    if not osp.exists(test_navmesh):
+        pytest.skip(f"{test_navmesh} not found")
+
+    pathfinder = habitat_sim.PathFinder()
+    pathfinder.load_nav_mesh(test_navmesh)
+    pathfinder.seed(0)
+
+    scene_graph = habitat_sim.SceneGraph()
+    agent = habitat_sim.Agent(scene_graph.get_root_node().create_child())
+    follower = habitat_sim.GreedyGeodesicFollower(
+        pathfinder, agent, native=True, allow_sliding=allow_sliding
+    )
+
+    start_states = []
+    goal_positions = []
+    for _ in range(16):
+        state = habitat_sim.AgentState()
+        state.position = pathfinder.get_random_navigable_point()
+        start_states.append(state)
+        goal_positions.append(pathfinder.get_random_navigable_point())
+
+    # Planning the batch on all threads gives the same actions as planning
+    # every pair from the agent's state
+    paths = follower.find_paths(start_states, goal_positions)
+    assert len(paths) == len(start_states)
+    for state, goal_pos, path in zip(start_states, goal_positions, paths):
+        agent.state = state
+        try:
+            expected = follower.find_path(goal_pos)
+        except habitat_sim.errors.GreedyFollowerError:
+            expected = None
+
+        assert path == expected
+        if path is not None:
+            assert path[-1] is None
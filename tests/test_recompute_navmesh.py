@@ -105,3 +105,40 @@ def test_recompute_navmesh(test_scene, sim):
             some_diff = True
 
     assert some_diff
+
+
+@pytest.mark.parametrize("test_scene", test_scenes)
+def test_recompute_navmesh_tiled(test_scene, sim):
+    if not osp.exists(test_scene):
+        pytest.skip(f"{test_scene} not found")
+
+    cfg_settings = examples.settings.default_sim_settings.copy()
+    cfg_settings["scene"] = test_scene
+    hab_cfg = examples.settings.make_cfg(cfg_settings)
+    sim.reconfigure(hab_cfg)
+
+    navmesh_settings = habitat_sim.NavMeshSettings()
+    navmesh_settings.set_defaults()
+    assert sim.recompute_navmesh(sim.pathfinder, navmesh_settings)
+    samples = [
+        (
+            sim.pathfinder.get_random_navigable_point(),
+            sim.pathfinder.get_random_navigable_point(),
+        )
+        for _ in range(100)
+    ]
+    solo_results = get_shortest_path(sim, samples)
+
+    navmesh_settings.build_tiled = True
+    navmesh_settings.tile_size = 64
+    assert sim.recompute_navmesh(sim.pathfinder, navmesh_settings)
+    assert sim.pathfinder.is_loaded
+    tiled_results = get_shortest_path(sim, samples)
+
+    # Tiles are triangulated independently, so paths are close but not
+    # identical to the ones on the single mesh
+    num_same = 0
+    for solo, tiled in zip(solo_results, tiled_results):
+        if solo[0] and tiled[0]:
+            num_same += abs(solo[1] - tiled[1]) < 0.05 * solo[1] + 0.1
+    assert num_same >= 0.9 * sum(solo[0] for solo in solo_results)
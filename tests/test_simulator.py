@@ -162,3 +162,65 @@ def test_object_template_editing(sim):
     # test adding a new object
     object_id = sim.add_object(template_ids[0])
     assert object_id != -1
+
+
+def test_partial_reconfigure(sim):
+    cfg_settings = examples.settings.default_sim_settings.copy()
+    cfg_settings["scene"] = "data/scene_datasets/habitat-test-scenes/van-gogh-room.glb"
+    cfg_settings["depth_sensor"] = True
+    hab_cfg = examples.settings.make_cfg(cfg_settings)
+    sim.reconfigure(hab_cfg)
+    pathfinder = sim.pathfinder
+    depth_sensor = sim._sensors["depth_sensor"]
+
+    # Changing the resolution of one sensor keeps the scene, the navmesh and
+    # the other sensors
+    new_cfg = examples.settings.make_cfg(cfg_settings)
+    color_spec = new_cfg.agents[0].sensor_specifications[0]
+    assert color_spec.uuid == "color_sensor"
+    color_spec.resolution = [cfg_settings["height"], cfg_settings["width"] // 2]
+    new_cfg.sim_cfg.allow_sliding = not hab_cfg.sim_cfg.allow_sliding
+    assert not hab_cfg.sim_cfg.requires_scene_reload(new_cfg.sim_cfg)
+    sim.reconfigure(new_cfg)
+    assert sim.pathfinder is pathfinder
+    assert sim._sensors["depth_sensor"] is depth_sensor
+
+    obs = sim.reset()
+    assert obs["color_sensor"].shape[1] == cfg_settings["width"] // 2
+    assert obs["depth_sensor"].shape[1] == cfg_settings["width"]
+
+    # Changing the scene loads it anew
+    cfg_settings[
+        "scene"
+    ] = "data/scene_datasets/habitat-test-scenes/skokloster-castle.glb"
+    new_cfg = examples.settings.make_cfg(cfg_settings)
+    assert hab_cfg.sim_cfg.requires_scene_reload(new_cfg.sim_cfg)
+    sim.reconfigure(new_cfg)
+    assert sim.pathfinder is not pathfinder
+
+
+def test_prefetch_scene(sim):
+    cfg_settings = examples.settings.default_sim_settings.copy()
+    cfg_settings["scene"] = "data/scene_datasets/habitat-test-scenes/van-gogh-room.glb"
+    hab_cfg = examples.settings.make_cfg(cfg_settings)
+    sim.reconfigure(hab_cfg)
+
+    cfg_settings[
+        "scene"
+    ] = "data/scene_datasets/habitat-test-scenes/skokloster-castle.glb"
+    prefetched_cfg = examples.settings.make_cfg(cfg_settings)
+    sim.prefetch_scene(prefetched_cfg)
+    sim.reconfigure(prefetched_cfg)
+    assert not sim.is_scene_prefetched
+    # The navmesh loaded in the background is used as is
+    assert sim.pathfinder is sim._sim.pathfinder
+    assert sim.pathfinder.is_loaded
+    state = sim.get_agent(0).state
+    prefetched_obs = sim.get_sensor_observations()
+
+    # The prefetched scene looks the same as one loaded right away
+    sim.reconfigure(hab_cfg)
+    sim.reconfigure(examples.settings.make_cfg(cfg_settings))
+    sim.get_agent(0).set_state(state)
+    obs = sim.get_sensor_observations()
+    assert np.array_equal(obs["color_sensor"], prefetched_obs["color_sensor"])
@@ -32,3 +32,29 @@ def test_snap_point(nudge, test_data):
     hypothesis.assume(not math.isnan(proj_pt[0]))
 
     assert pf.is_navigable(proj_pt), "{} -> {} not navigable!".format(pt, proj_pt)
+
+
+def test_batched_point_queries(test_data):
+    pf, start_pt = test_data
+
+    rng = np.random.RandomState(0)
+    pts = (start_pt + rng.uniform([-10, -2.5, -10], [10, 2.5, 10], (1000, 3))).astype(
+        np.float32
+    )
+
+    snapped = np.empty_like(pts)
+    pf.snap_points(pts, snapped)
+    navigable = pf.are_navigable(snapped)
+    radii = pf.island_radii(snapped)
+    distances = pf.distances_to_closest_obstacle(snapped)
+
+    for i, pt in enumerate(pts):
+        proj_pt = pf.snap_point(pt)
+        if math.isnan(proj_pt[0]):
+            assert np.isnan(snapped[i]).all()
+            continue
+
+        assert np.allclose(snapped[i], proj_pt)
+        assert navigable[i] == pf.is_navigable(snapped[i])
+        assert radii[i] == pf.island_radius(snapped[i])
+        assert distances[i] == pf.distance_to_closest_obstacle(snapped[i])